@@ -24,6 +24,7 @@ This class represents our type-abstraction layer. It is the means by which
 
 
 #include "Argument.h"
+#include "Slab.h"
 
 #include <PriorityQueue.h>
 #if defined(CONFIG_MANUVR_IMG_SUPPORT)
@@ -32,6 +33,19 @@ This class represents our type-abstraction layer. It is the means by which
 
 #include <Platform/Identity.h>
 
+/* FNV-1a, for the key index. */
+static inline uint32_t _key_hash(const char* k) {
+  uint32_t h = 2166136261u;
+  while (*k) {
+    h = (h ^ (uint8_t) *k++) * 16777619u;
+  }
+  return h;
+}
+
+static inline bool _key_matches(const char* key, const char* k) {
+  return ((key == k) || ((nullptr != key) && (0 == strcmp(key, k))));
+}
+
 /*******************************************************************************
 *      _______.___________.    ___   .___________. __    ______     _______.
 *     /       |           |   /   \  |           ||  |  /      |   /       |
@@ -44,201 +58,31 @@ This class represents our type-abstraction layer. It is the means by which
 *******************************************************************************/
 #if defined(MANUVR_CBOR)
 
-int8_t Argument::encodeToCBOR(Argument* src, StringBuilder* out) {
-  cbor::output_dynamic output;
-  cbor::encoder encoder(output);
-  while (nullptr != src) {
-    if (nullptr != src->getKey()) {
-      // This is a map.
-      encoder.write_map(1);
-      encoder.write_string(src->getKey());
-    }
-    switch(src->typeCode()) {
-      case TCode::INT8:
-        {
-          int8_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((int) x);
-          }
-        }
-        break;
-      case TCode::INT16:
-        {
-          int16_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((int) x);
-          }
-        }
-        break;
-      case TCode::INT32:
-        {
-          int32_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((int) x);
-          }
-        }
-        break;
-      case TCode::INT64:
-        {
-          long long x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int(x);
-          }
-        }
-        break;
-      case TCode::UINT8:
-        {
-          uint8_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((unsigned int) x);
-          }
-        }
-        break;
-      case TCode::UINT16:
-        {
-          uint16_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((unsigned int) x);
-          }
-        }
-        break;
-      case TCode::UINT32:
-        {
-          uint32_t x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int((unsigned int) x);
-          }
-        }
-        break;
-      case TCode::UINT64:
-        {
-          unsigned long long x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_int(x);
-          }
-        }
-        break;
-      case TCode::FLOAT:
-        {
-          float x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_float(x);
-          }
-        }
-        break;
-
-      case TCode::DOUBLE:
-        {
-          double x = 0;
-          if (0 == src->getValueAs(&x)) {
-            encoder.write_double(x);
-          }
-        }
-        break;
-
-      case TCode::STR:
-        {
-          char* buf;
-          if (0 == src->getValueAs(&buf)) {
-            encoder.write_string(buf);
-          }
-        }
-        break;
-      case TCode::STR_BUILDER:
-        {
-          StringBuilder* buf;
-          if (0 == src->getValueAs(&buf)) {
-            encoder.write_string((char*) buf->string());
-          }
-        }
-        break;
-
-      case TCode::BINARY:
-      case TCode::VECT_3_FLOAT:
-      case TCode::VECT_4_FLOAT:
-        // NOTE: This ought to work for any types retaining portability isn't important.
-        // TODO: Gradually convert types out of this block. As much as possible should
-        //   be portable. VECT_3_FLOAT ought to be an array of floats, for instance.
-        encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(src->typeCode()));
-        encoder.write_bytes((uint8_t*) src->pointer(), src->length());
-        break;
-
-      case TCode::IDENTITY:
-        {
-          Identity* ident;
-          if (0 == src->getValueAs(&ident)) {
-            uint16_t i_len = ident->length();
-            uint8_t buf[i_len];
-            if (ident->toBuffer(buf)) {
-              encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(src->typeCode()));
-              encoder.write_bytes(buf, i_len);
-            }
-          }
-        }
-        break;
-      //case TCode::ARGUMENT:
-      //  {
-      //    StringBuilder intermediary;
-      //    Argument *subj;
-      //    if (0 == src->getValueAs(&subj)) {
-      //      // NOTE: Recursion.
-      //      if (Argument::encodeToCBOR(subj, &intermediary)) {
-      //        encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(src->typeCode()));
-      //        encoder.write_bytes(intermediary.string(), intermediary.length());
-      //      }
-      //    }
-      //  }
-      //  break;
-      case TCode::IMAGE:
-        #if defined(CONFIG_MANUVR_IMG_SUPPORT)
-          {
-            Image* img;
-            if (0 == src->getValueAs(&img)) {
-              uint32_t sz_buf = img->bytesUsed();
-              if (sz_buf > 0) {
-                uint32_t nb_buf = 0;
-                uint8_t* intermediary = (uint8_t*) alloca(32);
-                if (0 == img->serializeWithoutBuffer(intermediary, &nb_buf)) {
-                  encoder.write_tag(MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(src->typeCode()));
-                  encoder.write_bytes(intermediary, nb_buf);   // TODO: This might cause two discrete CBOR objects.
-                  encoder.write_bytes(img->buffer(), sz_buf);
-                }
-              }
-            }
-          }
-        #endif   // CONFIG_MANUVR_IMG_SUPPORT
-        break;
-      //case TCode::SYS_PIPE_FXN_PTR:
-      //case TCode::SYS_ARG_FXN_PTR:
-      //case TCode::SYS_MANUVR_XPORT:
-      //case TCode::SYS_FXN_PTR:
-      //case TCode::SYS_THREAD_FXN_PTR:
-      //case TCode::SYS_MANUVRMSG:
-      case TCode::RESERVED:
-        // Peacefully ignore the types we can't export.
-        break;
-      default:
-        // TODO: Handle pointer types, bool
-        break;
+/**
+* Encodes the chain as CBOR, onto the end of the given buffer. The encoding is
+*   sized first, and written into a single allocation.
+*
+* @param  src  The chain to encode.
+* @param  out  The buffer to append to.
+* @return The length of the encoding, or -1 on failure.
+*/
+int Argument::encodeToCBOR(Argument* src, StringBuilder* out) {
+  const int len = ArgEncoder::sizeCBOR(src);
+  if (0 < len) {
+    uint8_t* buf = (uint8_t*) malloc(len);
+    if (nullptr == buf) return -1;
+    if (len != ArgEncoder::writeCBOR(src, buf, len)) {
+      free(buf);
+      return -1;
     }
-    src = src->_next;
-  }
-  int final_size = output.size();
-  if (final_size) {
-    out->concat(output.data(), final_size);
+    out->concatHandoff(buf, len);
   }
-  return final_size;
+  return len;
 }
 
 
-
 Argument* Argument::decodeFromCBOR(uint8_t* src, unsigned int len) {
-  Argument* return_value = nullptr;
-  CBORArgListener listener(&return_value);
-  cbor::input input(src, len);
-  cbor::decoder decoder(input, listener);
-  decoder.run();
-  return return_value;
+  return CBORArgDecoder::decode(src, len, nullptr);
 }
 #endif  // MANUVR_CBOR
 
@@ -246,8 +90,26 @@ Argument* Argument::decodeFromCBOR(uint8_t* src, unsigned int len) {
 #if defined(MANUVR_JSON)
 #include "jansson/include/jansson.h"
 
-int8_t Argument::encodeToJSON(Argument* src, StringBuilder* out) {
-  return -1;
+/**
+* Encodes the chain as JSON, onto the end of the given buffer. The encoding is
+*   sized first, and written into a single allocation.
+*
+* @param  src  The chain to encode.
+* @param  out  The buffer to append to.
+* @return The length of the encoding, or -1 on failure.
+*/
+int Argument::encodeToJSON(Argument* src, StringBuilder* out) {
+  const int len = ArgEncoder::sizeJSON(src);
+  if (0 < len) {
+    uint8_t* buf = (uint8_t*) malloc(len);
+    if (nullptr == buf) return -1;
+    if (len != ArgEncoder::writeJSON(src, buf, len)) {
+      free(buf);
+      return -1;
+    }
+    out->concatHandoff(buf, len);
+  }
+  return len;
 }
 
 Argument* Argument::decodeFromJSON(StringBuilder* src) {
@@ -304,11 +166,8 @@ Argument::Argument(void* ptr, int l, TCode code) : Argument(code) {
   target_mem = ptr;
 }
 
-Argument::Argument(double val) : Argument(malloc(sizeof(double)), sizeof(double), TCode::DOUBLE) {
-  if (nullptr != target_mem) {
-    *((double*) target_mem) = val;
-    _alter_flags(true, MANUVR_ARG_FLAG_REAP_VALUE);
-  }
+Argument::Argument(double val) : Argument(TCode::DOUBLE) {
+  _take_copy(&val, sizeof(double));
 }
 
 
@@ -317,11 +176,56 @@ Argument::~Argument() {
 }
 
 
+/*
+* The slab that all Arguments come from. It is created on first use, and never
+*   destroyed, so that static construction and destruction order are moot.
+*/
+static Slab* _arg_arena() {
+  static Slab* arena = new Slab(sizeof(Argument), ARGUMENT_SLAB_CHUNK, ARGUMENT_SLAB_MAX_CHUNKS);
+  return arena;
+}
+
+void* Argument::operator new(size_t sz) {
+  // Subclasses are larger than a slot, and go straight to the heap.
+  void* return_value = (sizeof(Argument) == sz) ? _arg_arena()->take() : nullptr;
+  return ((nullptr != return_value) ? return_value : ::operator new(sz));
+}
+
+void Argument::operator delete(void* ptr) {
+  if (nullptr == ptr) return;
+  if (!_arg_arena()->give(ptr)) ::operator delete(ptr);
+}
+
+/**
+* Returns idle chunks of the Argument slab to the heap.
+*
+* @return The number of chunks freed.
+*/
+uint16_t Argument::trimArena() {
+  return _arg_arena()->trim();
+}
+
+/**
+* Debug support method.
+*
+* @param   StringBuilder* The buffer into which this fxn should write its output.
+*/
+void Argument::printArena(StringBuilder* output) {
+  _arg_arena()->printDebug(output);
+}
+
+
 void Argument::wipe() {
+  dropIndex();
   if (nullptr != _next) {
     Argument* a = _next;
     _next       = nullptr;
-    delete a;
+    if (a->_check_flags(MANUVR_ARG_FLAG_ARENA)) {
+      a->~Argument();   // Its memory belongs to a decoder block, or a message.
+    }
+    else {
+      delete a;
+    }
   }
   if (nullptr != target_mem) {
     void* p = target_mem;
@@ -339,6 +243,84 @@ void Argument::wipe() {
 }
 
 
+/**
+* Takes a copy of the given value that we own. Values that fit are held inline.
+*   Others go to the heap, and are reaped.
+*
+* @param  src  The value.
+* @param  n    Its length.
+* @return true on success. false if we couldn't allocate.
+*/
+bool Argument::_take_copy(const void* src, unsigned int n) {
+  if (n <= ARGUMENT_INLINE_BYTES) {
+    memcpy(_inline, src, n);
+    target_mem = _inline;
+    _alter_flags(true, MANUVR_ARG_FLAG_INLINE);
+  }
+  else {
+    void* buf = malloc(n);
+    if (nullptr == buf) return false;
+    memcpy(buf, src, n);
+    target_mem = buf;
+    _alter_flags(true, MANUVR_ARG_FLAG_REAP_VALUE);
+  }
+  len = n;
+  return true;
+}
+
+
+/**
+* If our value is a pointer to memory that someone else owns, take a copy of
+*   it. Short strings, vectors and doubles will be held inline.
+*
+* @return 0 on success, 1 if we already owned our value, -1 if our type can't
+*   be copied, or -2 if we couldn't allocate.
+*/
+int8_t Argument::copyValue() {
+  if (isValueDirect() || reapValue() || _check_flags(MANUVR_ARG_FLAG_INLINE)) {
+    return 1;
+  }
+  switch (_t_code) {
+    case TCode::STR:
+    case TCode::BINARY:
+    case TCode::DOUBLE:
+    case TCode::VECT_4_FLOAT:
+    case TCode::VECT_3_FLOAT:
+    case TCode::VECT_3_UINT16:
+    case TCode::VECT_3_INT16:
+      if (nullptr == target_mem) return -1;
+      return (_take_copy(target_mem, len) ? 0 : -2);
+    default:
+      return -1;
+  }
+}
+
+
+/**
+* Moves everything we hold into the given (empty) Argument, and leaves us empty.
+*   Used to evacuate Arguments from storage that is about to go away.
+*
+* @param  dst  A freshly-constructed Argument.
+*/
+void Argument::_move_to(Argument* dst) {
+  dropIndex();
+  dst->target_mem = target_mem;
+  dst->_next      = _next;
+  dst->_key       = _key;
+  dst->len        = len;
+  dst->_t_code    = _t_code;
+  dst->_flags     = _flags & ~MANUVR_ARG_FLAG_ARENA;
+  if (_check_flags(MANUVR_ARG_FLAG_INLINE)) {
+    memcpy(dst->_inline, _inline, sizeof(_inline));
+    dst->target_mem = dst->_inline;
+  }
+  target_mem = nullptr;
+  _next      = nullptr;
+  _key       = nullptr;
+  _flags     = 0;
+}
+
+
 /**
 * Given an Argument pointer, finds that pointer and drops it from the list.
 *
@@ -346,6 +328,7 @@ void Argument::wipe() {
 * @return       0 on success. 1 on warning, -1 on "not found".
 */
 int8_t Argument::dropArg(Argument** root, Argument* drop) {
+  dropIndex();
   if (*root == drop) {
     // Re-write the root parameter.
     root = &_next; // NOTE: may be null. Who cares.
@@ -386,16 +369,8 @@ int Argument::collectKeys(StringBuilder* key_set) {
 * @return 0 on success or appropriate failure code.
 */
 int8_t Argument::getValueAs(uint8_t idx, void* trg_buf) {
-  int8_t return_value = -1;
-  if (0 < idx) {
-    if (nullptr != _next) {
-      return_value = _next->getValueAs(--idx, trg_buf);
-    }
-  }
-  else {
-    return_value = getValueAs(trg_buf);
-  }
-  return return_value;
+  Argument* a = retrieveArgByIdx(idx);
+  return ((nullptr != a) ? a->getValueAs(trg_buf) : -1);
 }
 
 /**
@@ -406,21 +381,8 @@ int8_t Argument::getValueAs(uint8_t idx, void* trg_buf) {
 * @return 0 on success or appropriate failure code.
 */
 int8_t Argument::getValueAs(const char* k, void* trg_buf) {
-  if (nullptr != k) {
-    if (nullptr != _key) {
-      //if (_key == k) {
-      // TODO: Awful. Hash map? pointer-comparisons?
-      if (0 == strcmp(_key, k)) {
-        // If pointer comparison worked, return the value.
-        return getValueAs(trg_buf);
-      }
-    }
-
-    if (nullptr != _next) {
-      return _next->getValueAs(k, trg_buf);
-    }
-  }
-  return -1;
+  Argument* a = retrieveArgByKey(k);
+  return ((nullptr != a) ? a->getValueAs(trg_buf) : -1);
 }
 
 
@@ -490,86 +452,81 @@ int8_t Argument::getValueAs(void* trg_buf) {
 
 
 /*
-* The purpose of this fxn is to pack up this Argument into something that can be stored or sent
-*   over a wire.
-* This is the point at which we will have to translate any pointer types into something concrete.
+* Finds the bytes that represent this Argument's value on the wire.
+* Pointer types are translated into something concrete.
 *
-* Returns 0 (0) on success.
+* @param  n  Receives the number of bytes.
+* @return A pointer to the bytes, or nullptr if this type is not sent.
 */
-int8_t Argument::serialize(StringBuilder *out) {
-  unsigned char *temp_str = (unsigned char *) target_mem;   // Just a general use pointer.
-
-  unsigned char *scratchpad = (unsigned char *) alloca(258);  // This is the maximum size for an argument.
-  unsigned char *sp_index   = (scratchpad + 2);
-  uint8_t arg_bin_len       = len;
-
+const uint8_t* Argument::_raw_value(unsigned int* n) {
   switch (_t_code) {
-    /* These are hard types that we can send as-is. */
+    /* These are hard types that we can send as-is. Remember: LITTLE ENDIAN */
     case TCode::INT8:
     case TCode::UINT8:   // This frightens the compiler. Its fears are unfounded.
-      arg_bin_len = 1;
-      *((uint8_t*) sp_index) = *((uint8_t*)& target_mem);
-      break;
+      *n = 1;
+      return (const uint8_t*) &target_mem;
     case TCode::INT16:
     case TCode::UINT16:   // This frightens the compiler. Its fears are unfounded.
-      arg_bin_len = 2;
-      *((uint16_t*) sp_index) = *((uint16_t*)& target_mem);
-      break;
+      *n = 2;
+      return (const uint8_t*) &target_mem;
     case TCode::INT32:
     case TCode::UINT32:   // This frightens the compiler. Its fears are unfounded.
     case TCode::FLOAT:   // This frightens the compiler. Its fears are unfounded.
-      arg_bin_len = 4;
-      *((uint32_t*) sp_index) = *((uint32_t*)& target_mem);
-      break;
-
-    /* These are pointer types to data that can be sent as-is. Remember: LITTLE ENDIAN */
-    //case TCode::INT8_PTR:
-    //case TCode::UINT8_PTR:
-    //  arg_bin_len = 1;
-    //  *((uint8_t*) sp_index) = *((uint8_t*) target_mem);
-    //  break;
-    //case TCode::INT16_PTR:
-    //case TCode::UINT16_PTR:
-    //  arg_bin_len = 2;
-    //  *((uint16_t*) sp_index) = *((uint16_t*) target_mem);
-    //  break;
-    //case TCode::INT32_PTR:
-    //case TCode::UINT32_PTR:
-    //case TCode::FLOAT_PTR:
-    //  arg_bin_len = 4;
-    //  //*((uint32_t*) sp_index) = *((uint32_t*) target_mem);
-    //  for (int i = 0; i < 4; i++) {
-    //    *((uint8_t*) sp_index + i) = *((uint8_t*) target_mem + i);
-    //  }
-    //  break;
+      *n = 4;
+      return (const uint8_t*) &target_mem;
 
     /* These are pointer types that require conversion. */
     case TCode::STR_BUILDER:     // This is a pointer to some StringBuilder. Presumably this is on the heap.
     case TCode::URL:             // This is a pointer to some StringBuilder. Presumably this is on the heap.
-      temp_str    = ((StringBuilder*) target_mem)->string();
-      arg_bin_len = ((StringBuilder*) target_mem)->length();
+      *n = ((StringBuilder*) target_mem)->length();
+      return ((StringBuilder*) target_mem)->string();
+
+    case TCode::STR:
     case TCode::DOUBLE:
     case TCode::VECT_4_FLOAT:  // NOTE!!! This only works for Vectors because of the template layout. FRAGILE!!!
     case TCode::VECT_3_FLOAT:  // NOTE!!! This only works for Vectors because of the template layout. FRAGILE!!!
     case TCode::VECT_3_UINT16: // NOTE!!! This only works for Vectors because of the template layout. FRAGILE!!!
     case TCode::VECT_3_INT16:  // NOTE!!! This only works for Vectors because of the template layout. FRAGILE!!!
-    case TCode::BINARY:
-      for (int i = 0; i < arg_bin_len; i++) {
-        *(sp_index + i) = *(temp_str + i);
-      }
-      break;
+    case TCode::BINARY:        // This is a pointer to a big binary blob.
+      *n = len;
+      return (const uint8_t*) target_mem;
 
     /* Anything else should be dropped. */
     default:
-      break;
+      *n = 0;
+      return nullptr;
   }
+}
 
-  *(scratchpad + 0) = (uint8_t) _t_code;
-  *(scratchpad + 1) = arg_bin_len;
-  out->concat(scratchpad, (arg_bin_len+2));
-  if (_next) {
-    _next->serialize(out);
+
+/*
+* The purpose of this fxn is to pack up this Argument into something that can be stored or sent
+*   over a wire. Each Argument is written as its type, its length, and its value.
+* The whole chain is sized first, and written into a single allocation.
+*
+* Returns 0 (0) on success.
+*/
+int8_t Argument::serialize(StringBuilder *out) {
+  unsigned int total = 0;
+  unsigned int n     = 0;
+  for (Argument* a = this; nullptr != a; a = a->_next) {
+    if (nullptr == a->_raw_value(&n)) n = a->len;
+    total += 2 + (uint8_t) n;   // This is the maximum size for an argument.
   }
+  uint8_t* buf = (uint8_t*) malloc(total);
+  if (nullptr == buf) return -1;
+
+  uint8_t* cursor = buf;
+  for (Argument* a = this; nullptr != a; a = a->_next) {
+    const uint8_t* src = a->_raw_value(&n);
+    const uint8_t  arg_bin_len = (uint8_t) ((nullptr == src) ? a->len : n);
+    *(cursor++) = (uint8_t) a->_t_code;
+    *(cursor++) = arg_bin_len;
+    if (nullptr != src) memcpy(cursor, src, arg_bin_len);
+    else                memset(cursor, 0, arg_bin_len);   // Types we can't send keep their place.
+    cursor += arg_bin_len;
+  }
+  out->concatHandoff(buf, total);
   return 0;
 }
 
@@ -579,94 +536,67 @@ int8_t Argument::serialize(StringBuilder *out) {
 *   with a minimum of overhead. We write only the bytes that *are* the data, and not the metadata
 *   because we are relying on the parser at the other side to know what the type is.
 * We still have to translate any pointer types into something concrete.
+* Each run of Arguments is sized first, and written into a single allocation.
 *
-* Returns 0 on success. Also updates the length of data in the offset argument.
-*
+* Returns 0 on success.
 */
 int8_t Argument::serialize_raw(StringBuilder *out) {
   if (out == nullptr) return -1;
+  Argument* a = this;
+  while (nullptr != a) {
+    // Size the run of Arguments up to the next one that must serialize itself.
+    unsigned int total = 0;
+    unsigned int n     = 0;
+    Argument*    stop  = a;
+    while ((nullptr != stop) && (TCode::IMAGE != stop->_t_code)) {
+      if (nullptr != stop->_raw_value(&n)) total += n;
+      stop = stop->_next;
+    }
+    if (0 < total) {
+      uint8_t* buf = (uint8_t*) malloc(total);
+      if (nullptr == buf) return -1;
+      uint8_t* cursor = buf;
+      for (; a != stop; a = a->_next) {
+        const uint8_t* src = a->_raw_value(&n);
+        if (nullptr != src) {
+          memcpy(cursor, src, n);
+          cursor += n;
+        }
+      }
+      out->concatHandoff(buf, total);
+    }
 
-  switch (_t_code) {
-    /* These are hard types that we can send as-is. */
-    case TCode::INT8:
-    case TCode::UINT8:
-      out->concat((unsigned char*) &target_mem, 1);
-      break;
-    case TCode::INT16:
-    case TCode::UINT16:
-      out->concat((unsigned char*) &target_mem, 2);
-      break;
-    case TCode::INT32:
-    case TCode::UINT32:
-    case TCode::FLOAT:
-      out->concat((unsigned char*) &target_mem, 4);
-      break;
-
-    /* These are pointer types to data that can be sent as-is. Remember: LITTLE ENDIAN */
-    //case TCode::INT8_PTR:
-    //case TCode::UINT8_PTR:
-    //  out->concat((unsigned char*) *((unsigned char**)target_mem), 1);
-    //  break;
-    //case TCode::INT16_PTR:
-    //case TCode::UINT16_PTR:
-    //  out->concat((unsigned char*) *((unsigned char**)target_mem), 2);
-    //  break;
-    //case TCode::INT32_PTR:
-    //case TCode::UINT32_PTR:
-    //case TCode::FLOAT_PTR:
-    //  out->concat((unsigned char*) *((unsigned char**)target_mem), 4);
-    //  break;
-
-    /* These are pointer types that require conversion. */
-    case TCode::STR_BUILDER:     // This is a pointer to some StringBuilder. Presumably this is on the heap.
-    case TCode::URL:             // This is a pointer to some StringBuilder. Presumably this is on the heap.
-      out->concat((StringBuilder*) target_mem);
-      break;
-    case TCode::STR:
-    case TCode::DOUBLE:
-    case TCode::VECT_4_FLOAT:
-    case TCode::VECT_3_FLOAT:
-    case TCode::VECT_3_UINT16:
-    case TCode::VECT_3_INT16:
-    case TCode::BINARY:     // This is a pointer to a big binary blob.
-      out->concat((unsigned char*) target_mem, len);
-      break;
-
-    case TCode::IMAGE:      // This is a pointer to an Image.
+    if (nullptr != stop) {
       #if defined(CONFIG_MANUVR_IMG_SUPPORT)
-        {
-          Image* img = (Image*) target_mem;
-          uint32_t sz_buf = img->bytesUsed();
-          if (sz_buf > 0) {
-            if (0 != img->serialize(out)) {
-              // Failure
-            }
+        Image* img = (Image*) stop->target_mem;
+        uint32_t sz_buf = img->bytesUsed();
+        if (sz_buf > 0) {
+          if (0 != img->serialize(out)) {
+            // Failure
           }
         }
       #endif   // CONFIG_MANUVR_IMG_SUPPORT
-      break;
-
-    /* Anything else should be dropped. */
-    default:
-      break;
-  }
-
-  if (_next) {
-    _next->serialize_raw(out);
+      stop = stop->_next;
+    }
+    a = stop;
   }
   return 0;
 }
 
 
 /**
+* Adds an Argument to the end of the chain. If we have an index, it is used to
+*   find the end, and then dropped.
+*
 * @return A pointer to the linked argument.
 */
 Argument* Argument::link(Argument* arg) {
-  if (nullptr == _next) {
-    _next = arg;
-    return arg;
-  }
-  return _next->link(arg);
+  ArgIndex* index = _indexed();
+  Argument* tail  = (nullptr != index) ? index->tail : this;
+  dropIndex();
+  while (nullptr != tail->_next) tail = tail->_next;
+  tail->_next = arg;
+  return arg;
 }
 
 
@@ -686,48 +616,152 @@ int Argument::sumAllLengths() {
 }
 
 /**
-* @return [description]
+* Positional lookup. This will use an index if a keyed lookup has built one,
+*   but will not build one itself.
+*
+* @param  idx  The position in the chain. This Argument is zero.
+* @return The Argument at that position, or nullptr if the chain is shorter.
 */
 Argument* Argument::retrieveArgByIdx(unsigned int idx) {
-  switch (idx) {
-    case 0:
-      return this;   // Special case.
-    default:
-      if (nullptr != _next) {
-        return _next->retrieveArgByIdx(idx-1);
-      }
-      // NOTE: No break
-      // Fall-through if the index is greater than the list's cardinality.
-    case 1:
-      return _next;  // Terminus of recursion for all args but 0.
+  ArgIndex* index = _indexed();
+  if (nullptr != index) {
+    return ((idx < index->count) ? index->pos[idx] : nullptr);
+  }
+  Argument* a = this;
+  while ((0 < idx) && (nullptr != a)) {
+    a = a->_next;
+    idx--;
   }
+  return a;
 }
 
 
 /*
 * Does an Argument in our rank have the given key?
+* Keys are compared as pointers first, since they are usually literals or
+*   interned, and by strcmp() otherwise.
+*
+* The first ARGUMENT_INDEX_MIN_ARGS Arguments are simply walked. If the search
+*   must go further than that, we build an index for the chain and use it for
+*   this and every later lookup, until the chain is changed by link() or
+*   dropArg(). Changing keys of Arguments in an indexed chain requires a call to
+*   dropIndex().
 *
 * Returns nullptr if the answer is 'no'. Otherwise, ptr to the first matching key.
 */
 Argument* Argument::retrieveArgByKey(const char* k) {
-  if (nullptr != k) {
-    if (nullptr != _key) {
-      //if (_key == k) {
-      // TODO: Awful. Hash map? pointer-comparisons?
-      if (0 == strcmp(_key, k)) {
-        // If pointer comparison worked, we win.
-        return this;
+  if (nullptr == k) return nullptr;
+  ArgIndex* index = _indexed();
+  if (nullptr == index) {
+    Argument* a = this;
+    for (unsigned int i = 0; (nullptr != a) && (i < ARGUMENT_INDEX_MIN_ARGS); i++) {
+      if (_key_matches(a->_key, k)) return a;
+      a = a->_next;
+    }
+    if (nullptr == a) return nullptr;   // Short chain. Not worth indexing.
+    if (!_build_index()) {
+      // No memory for an index. Walk the rest of the chain.
+      for (; nullptr != a; a = a->_next) {
+        if (_key_matches(a->_key, k)) return a;
       }
+      return nullptr;
     }
+    index = _index;
+  }
 
-    if (nullptr != _next) {
-      return _next->retrieveArgByKey(k);
+  const uint32_t h = _key_hash(k);
+  for (uint32_t i = h & index->mask; 0 != index->slots[i].pos; i = (i + 1) & index->mask) {
+    if (h == index->slots[i].hash) {
+      Argument* a = index->pos[index->slots[i].pos - 1];
+      if (_key_matches(a->_key, k)) return a;
     }
   }
   return nullptr;
 }
 
 
+/**
+* Frees our index, if we have one. The chain is untouched.
+*/
+void Argument::dropIndex() {
+  if (nullptr != _index) {
+    void* idx = _index;
+    _index = nullptr;
+    free(idx);
+  }
+}
+
+
+/**
+* @return Our index, if we have one, and it still describes the chain.
+*/
+ArgIndex* Argument::_indexed() {
+  if (nullptr != _index) {
+    if (nullptr == _index->tail->_next) {
+      return _index;
+    }
+    dropIndex();   // Something was linked after our tail by way of another Argument.
+  }
+  return nullptr;
+}
+
+
+/**
+* Builds an index of the chain that starts with this Argument. The positional
+*   array, and a hash table with at least twice as many slots as there are keys,
+*   are taken from a single allocation.
+*
+* @return true if we now have an index.
+*/
+bool Argument::_build_index() {
+  dropIndex();
+  uint32_t count = 0;
+  uint32_t keyed = 0;
+  Argument* tail = this;
+  for (Argument* a = this; nullptr != a; a = a->_next) {
+    if (nullptr != a->_key) keyed++;
+    tail = a;
+    count++;
+  }
+  if (count > 0xFFFF) return false;   // Positions must fit in a slot.
+
+  uint32_t slot_count = 8;
+  while (slot_count < (keyed * 2)) slot_count <<= 1;
+
+  const size_t pos_bytes = count * sizeof(Argument*);
+  uint8_t* mem = (uint8_t*) malloc(sizeof(ArgIndex) + pos_bytes + (slot_count * sizeof(ArgIndexSlot)));
+  if (nullptr == mem) return false;
+  ArgIndex* index = (ArgIndex*) mem;
+  index->tail  = tail;
+  index->pos   = (Argument**) (mem + sizeof(ArgIndex));
+  index->slots = (ArgIndexSlot*) (mem + sizeof(ArgIndex) + pos_bytes);
+  index->count = (uint16_t) count;
+  index->mask  = slot_count - 1;
+  memset(index->slots, 0, slot_count * sizeof(ArgIndexSlot));
+
+  uint16_t p = 0;
+  for (Argument* a = this; nullptr != a; a = a->_next) {
+    index->pos[p++] = a;
+    if (nullptr != a->_key) {
+      const uint32_t h = _key_hash(a->_key);
+      uint32_t i = h & index->mask;
+      bool dupe = false;
+      while ((0 != index->slots[i].pos) && !dupe) {
+        // The first Argument with a given key is the one we return.
+        dupe = (h == index->slots[i].hash) && _key_matches(index->pos[index->slots[i].pos - 1]->_key, a->_key);
+        i = (i + 1) & index->mask;
+      }
+      if (!dupe) {
+        index->slots[i].hash = h;
+        index->slots[i].pos  = p;   // Already incremented, hence plus one.
+      }
+    }
+  }
+  _index = index;
+  return true;
+}
+
+
 void Argument::valToString(StringBuilder* out) {
   uint8_t* buf = (uint8_t*) pointer();
   switch (_t_code) {
@@ -48,6 +48,8 @@ Template for a preallocated pool manager.
 */
 #define MANUVR_ARG_FLAG_REAP_VALUE     0x01  // Should the pointer be freed?
 #define MANUVR_ARG_FLAG_DIRECT_VALUE   0x02  // The value is NOT a pointer.
+#define MANUVR_ARG_FLAG_ARENA          0x04  // Lives in storage owned by someone else. Never deleted.
+#define MANUVR_ARG_FLAG_INLINE         0x08  // The value is held in _inline.
 #define MANUVR_ARG_FLAG_REAP_KEY       0x10  //
 #define MANUVR_ARG_FLAG_CLOBBERABLE    0x20  //
 #define MANUVR_ARG_FLAG_CONST_REDUCED  0x40  // Key reduced to const.
@@ -60,6 +62,24 @@ class EventReceiver;
 class Identity;
 class ManuvrMsg;
 
+/*
+* A lookup index for a chain of Arguments. One allocation holds the header, a
+*   positional array of the chain, and an open-addressed table of key hashes
+*   that refer back into the positional array.
+*/
+typedef struct {
+  uint32_t hash;    // FNV-1a of the key.
+  uint16_t pos;     // Position in the chain, plus one. Zero means empty.
+} ArgIndexSlot;
+
+typedef struct {
+  Argument*     tail;     // If this has grown a _next, the index is stale.
+  Argument**    pos;
+  ArgIndexSlot* slots;
+  uint16_t      count;    // Arguments in the positional array.
+  uint32_t      mask;     // Slot count, less one. Slot count is a power of two.
+} ArgIndex;
+
 /* This is how we define arguments to messages. */
 class Argument {
   public:
@@ -111,6 +131,12 @@ class Argument {
     Argument(Vector3f*    val) : Argument((void*) val, 12, TCode::VECT_3_FLOAT)  {};
     Argument(Vector4f*    val) : Argument((void*) val, 16, TCode::VECT_4_FLOAT)  {};
 
+    /* Vectors passed by reference are copied, and held inline. */
+    Argument(const Vector3ui16& val) : Argument(TCode::VECT_3_UINT16) {  _take_copy(&val, 6);   };
+    Argument(const Vector3i16&  val) : Argument(TCode::VECT_3_INT16)  {  _take_copy(&val, 6);   };
+    Argument(const Vector3f&    val) : Argument(TCode::VECT_3_FLOAT)  {  _take_copy(&val, 12);  };
+    Argument(const Vector4f&    val) : Argument(TCode::VECT_4_FLOAT)  {  _take_copy(&val, 16);  };
+
     /* Character pointers. */
     Argument(const char* val) : Argument((void*) val, (strlen(val)+1), TCode::STR) {};
     Argument(char* val)       : Argument((void*) val, (strlen(val)+1), TCode::STR) {};
@@ -135,12 +161,19 @@ class Argument {
 
     ~Argument();
 
+    /* Arguments live in a shared slab, and only fall back to the heap when it is full. */
+    static void* operator new(size_t);
+    static void  operator delete(void*);
+    static uint16_t trimArena();
+    static void printArena(StringBuilder*);
+
 
     int8_t dropArg(Argument**, Argument*);
+    int8_t copyValue();
 
     inline void reapKey(bool en) {    _alter_flags(en, MANUVR_ARG_FLAG_REAP_KEY);      };
     inline bool reapKey() {           return _check_flags(MANUVR_ARG_FLAG_REAP_KEY);   };
-    inline void reapValue(bool en) {  _alter_flags(en, MANUVR_ARG_FLAG_REAP_VALUE);    };
+    inline void reapValue(bool en) {  _alter_flags(en && !_check_flags(MANUVR_ARG_FLAG_INLINE), MANUVR_ARG_FLAG_REAP_VALUE);  };
     inline bool reapValue() {         return _check_flags(MANUVR_ARG_FLAG_REAP_VALUE); };
 
     inline void*    pointer() {       return target_mem; };
@@ -162,6 +195,7 @@ class Argument {
     int    sumAllLengths();
     Argument* retrieveArgByIdx(unsigned int idx);
     Argument* retrieveArgByKey(const char*);
+    void      dropIndex();
 
     Argument* link(Argument* arg);
     inline Argument* append(uint8_t val) {          return link(new Argument(val));   }
@@ -185,6 +219,10 @@ class Argument {
     inline Argument* append(Vector3i16 *val) {      return link(new Argument(val));   }
     inline Argument* append(Vector3f *val) {        return link(new Argument(val));   }
     inline Argument* append(Vector4f *val) {        return link(new Argument(val));   }
+    inline Argument* append(const Vector3ui16& val) {  return link(new Argument(val));   }
+    inline Argument* append(const Vector3i16& val) {   return link(new Argument(val));   }
+    inline Argument* append(const Vector3f& val) {     return link(new Argument(val));   }
+    inline Argument* append(const Vector4f& val) {     return link(new Argument(val));   }
 
     inline Argument* append(void *val, int len) {   return link(new Argument(val, len));   }
     inline Argument* append(const char *val) {      return link(new Argument(val));   }
@@ -235,7 +273,10 @@ class Argument {
     static char*  printBinStringToBuffer(unsigned char *str, int len, char *buffer);
 
     #if defined(MANUVR_CBOR)
-    static int8_t encodeToCBOR(Argument*, StringBuilder*);
+    static int encodeToCBOR(Argument*, StringBuilder*);
+    static inline int encodeToCBOR(Argument* src, uint8_t* buf, unsigned int len) {
+      return ArgEncoder::writeCBOR(src, buf, len);
+    };
     static Argument* decodeFromCBOR(uint8_t*, unsigned int);
     static inline Argument* decodeFromCBOR(StringBuilder* buf) {
       return decodeFromCBOR(buf->string(), buf->length());
@@ -243,7 +284,10 @@ class Argument {
     #endif
 
     #if defined(MANUVR_JSON)
-    static int8_t encodeToJSON(Argument*, StringBuilder*);
+    static int encodeToJSON(Argument*, StringBuilder*);
+    static inline int encodeToJSON(Argument* src, uint8_t* buf, unsigned int len) {
+      return ArgEncoder::writeJSON(src, buf, len);
+    };
     static Argument* decodeFromJSON(StringBuilder*);
     #endif
 
@@ -258,6 +302,11 @@ class Argument {
     Argument(void* ptr, int len, uint8_t code) : Argument(ptr, len, (TCode) code){};   // TODO: Shim
 
     void wipe();
+    const uint8_t* _raw_value(unsigned int*);
+    ArgIndex* _indexed();
+    bool      _build_index();
+    bool      _take_copy(const void*, unsigned int);
+    void      _move_to(Argument*);
 
     // TODO: Might-should move this to someplace more accessable?
     static uintptr_t get_const_from_char_ptr(char*);
@@ -265,6 +314,14 @@ class Argument {
 
   private:
     uint8_t     _flags     = 0;
+    ArgIndex*   _index     = nullptr;   // Only ever on the Argument that was searched.
+    uint64_t    _inline[(ARGUMENT_INLINE_BYTES + 7) / 8];   // Small values live here.
+
+    friend class ArgEncoder;       // Walks chains to encode them.
+    friend class ManuvrMsg;        // Places Arguments into its own pool.
+    #if defined(MANUVR_CBOR)
+    friend class CBORArgDecoder;   // Places Arguments into its own blocks.
+    #endif
 
     /* Inlines for altering and reading the flags. */
     inline void _alter_flags(bool en, uint8_t mask) {
@@ -0,0 +1,224 @@
+/*
+File:   ListenerTable.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A flat table of listener functions, keyed by message code.
+
+All listeners live in one contiguous array, sorted by code, and in order of
+  registration within a code. Firing a code is a bitmap test (to reject codes
+  that nobody listens for), a binary search, and a linear walk. Nothing is
+  allocated or mutated to iterate.
+
+Listeners may be added or removed from within a listener. Removals during a
+  fire() leave a tombstone, and additions are held aside. Both are settled when
+  the outermost fire() returns, so indices never move under an iteration.
+  A listener added during a fire() will not see the event being fired.
+*/
+
+#ifndef __MANUVR_LISTENER_TABLE_H__
+#define __MANUVR_LISTENER_TABLE_H__
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+template <class A> class ListenerTable {
+  public:
+    typedef int (*Fxn)(A);
+
+    ListenerTable() {
+      memset(_hint, 0, sizeof(_hint));
+    };
+
+    ~ListenerTable() {
+      if (_entries) free(_entries);
+      if (_pending) free(_pending);
+    };
+
+    /**
+    * Adds a listener for the given code.
+    *
+    * @param  code  The message code.
+    * @param  fxn   The listener.
+    * @return 0 on success, -1 on null listener, -2 on allocation failure.
+    */
+    int8_t add(uint16_t code, Fxn fxn) {
+      if (nullptr == fxn) return -1;
+      if (_busy) {
+        if (!_reserve(&_pending, &_pending_cap, _pending_count + 1)) return -2;
+        _pending[_pending_count].code = code;
+        _pending[_pending_count].fxn  = fxn;
+        _pending_count++;
+        return 0;
+      }
+      if (!_reserve(&_entries, &_cap, _count + 1)) return -2;
+      // Insert after every existing listener for this code, to preserve order.
+      uint32_t i = _upper_bound(code);
+      memmove(&_entries[i + 1], &_entries[i], (_count - i) * sizeof(Entry));
+      _entries[i].code = code;
+      _entries[i].fxn  = fxn;
+      _count++;
+      _hint_set(code);
+      return 0;
+    };
+
+    /**
+    * Removes the first matching listener for the given code.
+    *
+    * @param  code  The message code.
+    * @param  fxn   The listener.
+    * @return 0 on success, -1 if no such listener was found.
+    */
+    int8_t remove(uint16_t code, Fxn fxn) {
+      for (uint32_t i = 0; i < _pending_count; i++) {
+        if ((code == _pending[i].code) && (fxn == _pending[i].fxn)) {
+          memmove(&_pending[i], &_pending[i + 1], (_pending_count - i - 1) * sizeof(Entry));
+          _pending_count--;
+          return 0;
+        }
+      }
+      for (uint32_t i = _lower_bound(code); (i < _count) && (code == _entries[i].code); i++) {
+        if (fxn == _entries[i].fxn) {
+          if (_busy) {
+            _entries[i].fxn = nullptr;   // Tombstone. Swept by _settle().
+            _tombstones++;
+          }
+          else {
+            memmove(&_entries[i], &_entries[i + 1], (_count - i - 1) * sizeof(Entry));
+            _count--;
+            _hint_rebuild();
+          }
+          return 0;
+        }
+      }
+      return -1;
+    };
+
+    /**
+    * Calls every listener for the given code, in order of registration.
+    *
+    * @param  code  The message code.
+    * @param  arg   Passed to each listener.
+    * @return The number of listeners that returned non-zero.
+    */
+    int fire(uint16_t code, A arg) {
+      if (!_hint_test(code)) return 0;
+      uint32_t i = _lower_bound(code);
+      int return_value = 0;
+      _busy++;
+      for (; (i < _count) && (code == _entries[i].code); i++) {
+        Fxn fxn = _entries[i].fxn;
+        if ((nullptr != fxn) && fxn(arg)) return_value++;
+      }
+      if (0 == --_busy) _settle();
+      return return_value;
+    };
+
+    /* How many listeners are registered for the given code? */
+    uint32_t count(uint16_t code) {
+      uint32_t return_value = 0;
+      for (uint32_t i = _lower_bound(code); (i < _count) && (code == _entries[i].code); i++) {
+        if (nullptr != _entries[i].fxn) return_value++;
+      }
+      return return_value;
+    };
+
+    inline uint32_t size() {   return (_count - _tombstones + _pending_count);  };
+
+
+  private:
+    typedef struct {
+      uint16_t code;
+      Fxn      fxn;
+    } Entry;
+
+    Entry*   _entries       = nullptr;
+    Entry*   _pending       = nullptr;   // Additions made during a fire().
+    uint32_t _count         = 0;
+    uint32_t _cap           = 0;
+    uint32_t _pending_count = 0;
+    uint32_t _pending_cap   = 0;
+    uint32_t _tombstones    = 0;         // Removals made during a fire().
+    uint32_t _hint[8];                   // Bit (code & 0xFF) is set if any listener might match.
+    uint8_t  _busy          = 0;         // fire() nesting depth.
+
+    /* Index of the first entry with a code not less than the given one. */
+    uint32_t _lower_bound(uint16_t code) {
+      uint32_t lo = 0;
+      uint32_t hi = _count;
+      while (lo < hi) {
+        const uint32_t mid = (lo + hi) >> 1;
+        if (_entries[mid].code < code) lo = mid + 1;
+        else hi = mid;
+      }
+      return lo;
+    };
+
+    /* Index of the first entry with a code greater than the given one. */
+    uint32_t _upper_bound(uint16_t code) {
+      uint32_t lo = 0;
+      uint32_t hi = _count;
+      while (lo < hi) {
+        const uint32_t mid = (lo + hi) >> 1;
+        if (_entries[mid].code <= code) lo = mid + 1;
+        else hi = mid;
+      }
+      return lo;
+    };
+
+    inline void _hint_set(uint16_t code) {   _hint[(code & 0xFF) >> 5] |= (1u << (code & 0x1F));  };
+    inline bool _hint_test(uint16_t code) {  return (_hint[(code & 0xFF) >> 5] & (1u << (code & 0x1F)));  };
+
+    void _hint_rebuild() {
+      memset(_hint, 0, sizeof(_hint));
+      for (uint32_t i = 0; i < _count; i++) _hint_set(_entries[i].code);
+    };
+
+    /* Sweeps tombstones and applies additions that were deferred by fire(). */
+    void _settle() {
+      if (_tombstones) {
+        uint32_t w = 0;
+        for (uint32_t r = 0; r < _count; r++) {
+          if (nullptr != _entries[r].fxn) _entries[w++] = _entries[r];
+        }
+        _count      = w;
+        _tombstones = 0;
+        _hint_rebuild();
+      }
+      if (_pending_count) {
+        const uint32_t n = _pending_count;
+        _pending_count = 0;
+        for (uint32_t i = 0; i < n; i++) add(_pending[i].code, _pending[i].fxn);
+      }
+    };
+
+    /* Grows an array (by doubling) so that it holds at least the given count. */
+    static bool _reserve(Entry** arr, uint32_t* cap, uint32_t needed) {
+      if (needed <= *cap) return true;
+      uint32_t nu_cap = (*cap) ? (*cap << 1) : 8;
+      while (nu_cap < needed) nu_cap <<= 1;
+      Entry* nu = (Entry*) realloc(*arr, nu_cap * sizeof(Entry));
+      if (nullptr == nu) return false;
+      *arr = nu;
+      *cap = nu_cap;
+      return true;
+    };
+};
+
+#endif  // __MANUVR_LISTENER_TABLE_H__
@@ -0,0 +1,125 @@
+/*
+File:   MPSCRing.h
+Author: agent
+Date:   2026.10.16
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A bounded, lock-free, multi-producer/single-consumer ring.
+
+Any number of threads (or ISRs) may push() concurrently. Exactly one thread
+  may pop(). Each cell carries a sequence number that tells producers and the
+  consumer whose turn it is, so no cell is ever read before it is completely
+  written, and no global masking is required.
+
+Capacity is a compile-time constant and must be a power of two. Storage is
+  inline, so this class never touches the heap.
+*/
+
+#ifndef __MANUVR_MPSC_RING_H__
+#define __MANUVR_MPSC_RING_H__
+
+#include <inttypes.h>
+
+template <class T, unsigned int CAP> class MPSCRing {
+  public:
+    MPSCRing() {
+      for (uint32_t i = 0; i < CAP; i++) {
+        _cells[i].seq = i;
+      }
+    };
+
+    /**
+    * Push an element into the ring. Safe to call from any thread or ISR.
+    *
+    * @param  val  The element to push.
+    * @return true on success. false if the ring is full.
+    */
+    bool push(T val) {
+      uint32_t pos = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+      Cell* cell;
+      for (;;) {
+        cell = &_cells[pos & (CAP - 1)];
+        const uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        const int32_t  dif = (int32_t) (seq - pos);
+        if (0 == dif) {
+          // Our turn. Try to claim the cell.
+          if (__atomic_compare_exchange_n(&_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+          }
+          // Someone beat us to it. pos was reloaded by the CAS.
+        }
+        else if (dif < 0) {
+          // The consumer hasn't freed this cell yet. We are full.
+          __atomic_add_fetch(&_drops, 1, __ATOMIC_RELAXED);
+          return false;
+        }
+        else {
+          pos = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        }
+      }
+      cell->val = val;
+      __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+      return true;
+    };
+
+    /**
+    * Pop an element from the ring. Only the consumer thread may call this.
+    *
+    * @param  val  A pointer to the location where the element will be written.
+    * @return true if an element was popped. false if none were ready.
+    */
+    bool pop(T* val) {
+      Cell* cell = &_cells[_tail & (CAP - 1)];
+      const uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      if ((int32_t) (seq - (_tail + 1)) < 0) {
+        return false;   // Empty, or the producer is still writing.
+      }
+      *val = cell->val;
+      __atomic_store_n(&cell->seq, _tail + CAP, __ATOMIC_RELEASE);
+      _tail++;
+      return true;
+    };
+
+    /**
+    * @return true if there is nothing ready to be popped. Consumer-only.
+    */
+    inline bool empty() {
+      const uint32_t seq = __atomic_load_n(&_cells[_tail & (CAP - 1)].seq, __ATOMIC_ACQUIRE);
+      return ((int32_t) (seq - (_tail + 1)) < 0);
+    };
+
+    /* Approximate occupancy. Exact only when producers are quiet. */
+    inline uint32_t count() {     return (__atomic_load_n(&_head, __ATOMIC_RELAXED) - _tail);   };
+    inline uint32_t drops() {     return __atomic_load_n(&_drops, __ATOMIC_RELAXED);            };
+    inline uint32_t capacity() {  return CAP;  };
+
+
+  private:
+    typedef struct {
+      uint32_t seq;
+      T        val;
+    } Cell;
+
+    Cell     _cells[CAP];
+    uint32_t _head  = 0;   // Next position to be claimed by a producer.
+    uint32_t _tail  = 0;   // Next position to be read by the consumer.
+    uint32_t _drops = 0;   // How many pushes were refused because we were full?
+
+    static_assert((CAP > 1) && (0 == (CAP & (CAP - 1))), "MPSCRing capacity must be a power of two.");
+};
+
+#endif  // __MANUVR_MPSC_RING_H__
@@ -0,0 +1,249 @@
+/*
+File:   Slab.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "Slab.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Slots are rounded up so that anything placed in them is suitably aligned. */
+static inline size_t _slab_round(size_t sz) {
+  const size_t align = 2 * sizeof(void*);
+  return ((sz + align - 1) / align) * align;
+}
+
+
+/*******************************************************************************
+*   ___ _              ___      _ _              _      _
+*  / __| |__ _ ______ | _ ) ___(_) |___ _ _ _ __| |__ _| |_ ___
+* | (__| / _` (_-<_-< | _ \/ _ \ | / -_) '_| '_ \ / _` |  _/ -_)
+*  \___|_\__,_/__/__/ |___/\___/_|_\___|_| | .__/_\__,_|\__\___|
+*                                          |_|
+* Constructors/destructors, class initialization functions and so-forth...
+*******************************************************************************/
+
+/**
+* Constructor. The slab starts empty, and grows on demand.
+*
+* @param slot_size    The size of each slot, in bytes.
+* @param chunk_slots  How many slots are added each time the slab grows.
+* @param max_chunks   The most chunks the slab will allocate.
+*/
+Slab::Slab(size_t slot_size, uint16_t chunk_slots, uint16_t max_chunks) :
+  Slab(slot_size, chunk_slots, max_chunks, nullptr, 0) {
+}
+
+/**
+* Constructor. The slab starts with the given static storage, which it will
+*   never free.
+*
+* @param slot_size     The size of each slot, in bytes.
+* @param chunk_slots   How many slots are added each time the slab grows.
+* @param max_chunks    The most chunks the slab will allocate.
+* @param static_mem    Storage for static_slots slots, each of slot_size.
+* @param static_slots  How many slots are in the static storage.
+*/
+Slab::Slab(size_t slot_size, uint16_t chunk_slots, uint16_t max_chunks, void* static_mem, uint16_t static_slots) :
+  _slot_size(_slab_round(slot_size)), _chunk_slots(chunk_slots), _max_chunks(max_chunks) {
+  _chunks = (SlabChunk*) malloc((_max_chunks + 1) * sizeof(SlabChunk));
+  // Our slots may be larger than the caller's (alignment), so count how many
+  //   of ours fit into the static storage.
+  const uint16_t fitting = (uint16_t) ((static_slots * slot_size) / _slot_size);
+  if ((nullptr != static_mem) && (0 < fitting)) {
+    _has_static = _add_chunk((uint8_t*) static_mem, fitting);
+  }
+}
+
+/**
+* Destructor. Frees our chunks, regardless of whether anything is still using them.
+*/
+Slab::~Slab() {
+  for (uint16_t i = (_has_static ? 1 : 0); i < _chunk_count; i++) {
+    free(_chunks[i].base);
+  }
+  if (_chunks) free(_chunks);
+  if (_free)   free(_free);
+}
+
+
+/*******************************************************************************
+* Slab management
+*******************************************************************************/
+
+/**
+* Adds a block of slots to the slab, and pushes them all onto the free stack.
+* Caller must hold the lock (or be the constructor).
+*
+* @return true on success.
+*/
+bool Slab::_add_chunk(uint8_t* base, uint16_t slots) {
+  if ((nullptr == _chunks) || (_chunk_count > _max_chunks)) return false;
+  // The free stack must be able to hold every slot we own at once.
+  const uint32_t needed = _free_count + _in_use + slots;
+  if (needed > _free_cap) {
+    void** nu = (void**) realloc(_free, needed * sizeof(void*));
+    if (nullptr == nu) return false;
+    _free     = nu;
+    _free_cap = needed;
+  }
+  _chunks[_chunk_count].base  = base;
+  _chunks[_chunk_count].slots = slots;
+  _chunks[_chunk_count].free  = slots;
+  _chunk_count++;
+  // Pushed in reverse, so that the lowest addresses are taken first.
+  for (int i = slots - 1; i >= 0; i--) {
+    _free[_free_count++] = base + (i * _slot_size);
+  }
+  return true;
+}
+
+
+/**
+* @return The index of the chunk that holds the given pointer, or -1.
+*/
+int Slab::_chunk_of(void* ptr) {
+  const uint8_t* p = (const uint8_t*) ptr;
+  for (uint16_t i = 0; i < _chunk_count; i++) {
+    if ((p >= _chunks[i].base) && (p < (_chunks[i].base + (_chunks[i].slots * _slot_size)))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+/**
+* Takes a slot from the slab, growing it if need be.
+*
+* @return A pointer to a slot, or nullptr if the slab is at its limit.
+*/
+void* Slab::take() {
+  void* return_value = nullptr;
+  _lock();
+  if (0 == _free_count) {
+    _misses++;
+    const uint16_t dynamic_chunks = _chunk_count - (_has_static ? 1 : 0);
+    if (dynamic_chunks < _max_chunks) {
+      uint8_t* base = (uint8_t*) malloc(_chunk_slots * _slot_size);
+      if (nullptr != base) {
+        if (_add_chunk(base, _chunk_slots)) {
+          _grows++;
+        }
+        else {
+          free(base);
+        }
+      }
+    }
+  }
+  if (0 < _free_count) {
+    return_value = _free[--_free_count];
+    _chunks[_chunk_of(return_value)].free--;
+    _in_use++;
+    if (_in_use > _high_water) _high_water = _in_use;
+  }
+  else {
+    _fallbacks++;
+  }
+  _unlock();
+  return return_value;
+}
+
+
+/**
+* Returns a slot to the slab.
+*
+* @param  ptr  A slot that was returned by take().
+* @return true if the slot was ours. false otherwise (and nothing was done).
+*/
+bool Slab::give(void* ptr) {
+  bool return_value = false;
+  _lock();
+  int idx = _chunk_of(ptr);
+  if (0 <= idx) {
+    _chunks[idx].free++;
+    _free[_free_count++] = ptr;
+    _in_use--;
+    return_value = true;
+  }
+  _unlock();
+  return return_value;
+}
+
+
+/**
+* @return true if the given pointer belongs to one of our chunks.
+*/
+bool Slab::contains(void* ptr) {
+  _lock();
+  bool return_value = (0 <= _chunk_of(ptr));
+  _unlock();
+  return return_value;
+}
+
+
+/**
+* Returns every dynamic chunk that is entirely free to the heap.
+* This walks the free stack, so it should be called when the owner is idle.
+*
+* @return The number of chunks that were freed.
+*/
+uint16_t Slab::trim() {
+  uint16_t return_value = 0;
+  _lock();
+  int i = _chunk_count - 1;
+  const int lowest = (_has_static ? 1 : 0);
+  while (i >= lowest) {
+    if (_chunks[i].free == _chunks[i].slots) {
+      // Drop this chunk's slots from the free stack.
+      uint8_t* base = _chunks[i].base;
+      uint8_t* end  = base + (_chunks[i].slots * _slot_size);
+      uint32_t w = 0;
+      for (uint32_t r = 0; r < _free_count; r++) {
+        uint8_t* p = (uint8_t*) _free[r];
+        if ((p < base) || (p >= end)) _free[w++] = _free[r];
+      }
+      _free_count = w;
+      free(base);
+      // Fill the hole with the last chunk.
+      _chunks[i] = _chunks[--_chunk_count];
+      _shrinks++;
+      return_value++;
+    }
+    i--;
+  }
+  _unlock();
+  return return_value;
+}
+
+
+/**
+* Debug support method.
+*
+* @param   StringBuilder* The buffer into which this fxn should write its output.
+*/
+void Slab::printDebug(StringBuilder* output) {
+  output->concatf("\t Slot size:    %lu bytes\n", (unsigned long) _slot_size);
+  output->concatf("\t Chunks:       %u (%u max, %u slots each)\n", _chunk_count, _max_chunks, _chunk_slots);
+  output->concatf("\t In use:       %lu (high-water %lu)\n", (unsigned long) _in_use, (unsigned long) _high_water);
+  output->concatf("\t Free slots:   %lu\n", (unsigned long) _free_count);
+  output->concatf("\t Misses:       %lu\n", (unsigned long) _misses);
+  output->concatf("\t Heap fallback %lu\n", (unsigned long) _fallbacks);
+  output->concatf("\t Grows/shrinks %lu / %lu\n", (unsigned long) _grows, (unsigned long) _shrinks);
+}
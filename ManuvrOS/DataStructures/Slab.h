@@ -0,0 +1,97 @@
+/*
+File:   Slab.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A growable slab of fixed-size slots.
+
+The slab starts with an optional block of static storage, and grows by
+  whole chunks (up to a limit) when demand outstrips it. Chunks that are
+  entirely free can be returned to the heap with trim(), which the owner
+  should call when it is idle. When the slab is at its limit, take() returns
+  nullptr, and the caller should fall back to the heap.
+
+Slots are raw memory. Constructing and destroying objects in them is the
+  caller's business.
+
+take() and give() are guarded by a spinlock, so any thread may use the slab.
+  ISRs may not.
+*/
+
+#ifndef __MANUVR_SLAB_H__
+#define __MANUVR_SLAB_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <StringBuilder.h>
+
+class Slab {
+  public:
+    Slab(size_t slot_size, uint16_t chunk_slots, uint16_t max_chunks);
+    Slab(size_t slot_size, uint16_t chunk_slots, uint16_t max_chunks, void* static_mem, uint16_t static_slots);
+    ~Slab();
+
+    void*    take();
+    bool     give(void*);
+    bool     contains(void*);
+    uint16_t trim();
+
+    void printDebug(StringBuilder*);
+
+    inline uint32_t inUse() {       return _in_use;       };
+    inline uint32_t highWater() {   return _high_water;   };
+    inline uint32_t misses() {      return _misses;       };   // take() found no free slot.
+    inline uint32_t fallbacks() {   return _fallbacks;    };   // take() returned nullptr.
+    inline uint32_t grows() {       return _grows;        };
+    inline uint32_t shrinks() {     return _shrinks;      };
+    inline uint16_t chunks() {      return _chunk_count;  };
+
+
+  private:
+    typedef struct {
+      uint8_t* base;
+      uint16_t slots;
+      uint16_t free;
+    } SlabChunk;
+
+    const size_t   _slot_size;
+    const uint16_t _chunk_slots;
+    const uint16_t _max_chunks;    // Dynamic chunks only. The static block doesn't count.
+    SlabChunk*     _chunks      = nullptr;
+    uint16_t       _chunk_count = 0;
+    bool           _has_static  = false;   // If true, _chunks[0] is not ours to free.
+    uint8_t        _locked      = 0;
+    void**         _free        = nullptr; // Stack of free slots.
+    uint32_t       _free_count  = 0;
+    uint32_t       _free_cap    = 0;
+
+    uint32_t _in_use     = 0;
+    uint32_t _high_water = 0;
+    uint32_t _misses     = 0;
+    uint32_t _fallbacks  = 0;
+    uint32_t _grows      = 0;
+    uint32_t _shrinks    = 0;
+
+    bool _add_chunk(uint8_t* base, uint16_t slots);
+    int  _chunk_of(void*);
+
+    inline void _lock() {     while (__atomic_test_and_set(&_locked, __ATOMIC_ACQUIRE)) {}  };
+    inline void _unlock() {   __atomic_clear(&_locked, __ATOMIC_RELEASE);                  };
+};
+
+#endif  // __MANUVR_SLAB_H__
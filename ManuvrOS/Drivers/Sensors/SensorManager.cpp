@@ -50,6 +50,15 @@ SensorManager::SensorManager() : EventReceiver("SensorManager") {
 SensorManager::~SensorManager() {
   _sensor_report.enableSchedule(false);
   platform.kernel()->removeSchedule(&_sensor_report);
+  for (uint32_t i = 0; i < _poll_heap_size; i++) {
+    _poll_heap[i]->_poll_idx = -1;
+  }
+  if (nullptr != _poll_heap) {
+    free(_poll_heap);
+    _poll_heap = nullptr;
+  }
+  _poll_heap_size = 0;
+  _poll_heap_cap  = 0;
 }
 
 
@@ -67,6 +76,13 @@ int8_t SensorManager::addSensor(SensorWrapper* sensor) {
 
   if (0 <= _sensors.insertIfAbsent(sensor)) {
     sensor->setSensorManager(this);
+    sensor->_next_due = micros();   // New sensors are read on the next pass.
+    if (0 != _poll_insert(sensor)) {
+      _sensors.remove(sensor);
+      sensor->setSensorManager(nullptr);
+      return -1;
+    }
+    _reschedule_service();
   }
   return 0;
 }
@@ -78,24 +94,156 @@ int8_t SensorManager::addSensor(SensorWrapper* sensor) {
 */
 int8_t SensorManager::dropSensor(SensorWrapper* sensor) {
   if (nullptr == sensor) return -1;
+  _poll_remove(sensor);
   return (_sensors.remove(sensor) ? 0 : -1);
 }
 
 
+
+/*******************************************************************************
+* Polling
+*******************************************************************************/
+
+/**
+* Reads the sensors that are due, soonest deadline first, until either none
+*   are due, or the pass has spent its budget. A sensor left over by the budget
+*   keeps its (now late) deadline, and so heads the queue on the next pass.
+* At least one sensor is read per pass, so a budget smaller than the slowest
+*   sensor can't starve anything.
+*
+* Sensors are due-checked against the time the pass began. A sensor is never
+*   read twice in one pass, however short its period.
+*
+* @return The number of sensors that were read without error.
+*/
 int SensorManager::_service_sensors() {
   int return_val = 0;
-  //Kernel::log("_service_sensors()\n");
-  for (int i = 0; i < _sensors.size(); i++) {
-    SensorWrapper* current = _sensors.get(i);
-    // TODO: This ought to be a general time-sharing fxn.
+  int reads      = 0;
+  const uint32_t pass_start = micros();
+  uint32_t now = pass_start;
+
+  while (0 < _poll_heap_size) {
+    SensorWrapper* current = _poll_heap[0];
+    if (_poll_earlier(pass_start, current->_next_due)) {
+      break;   // Nothing else is due.
+    }
+    if ((0 < reads) && ((now - pass_start) >= _poll_budget_us)) {
+      _overruns++;
+      break;
+    }
+    const uint32_t t0 = micros();
     if (SensorError::NO_ERROR == current->readSensor()) {
       return_val++;
     }
+    now = micros();
+    current->_note_read(now - t0);
+    reads++;
+
+    // Advance by whole periods. If we have fallen more than a period behind,
+    //   don't try to catch up with a burst of reads.
+    const uint32_t period_us = current->_period_ms * 1000;
+    current->_next_due += period_us;
+    if (!_poll_earlier(pass_start, current->_next_due)) {
+      current->_next_due = now + period_us;
+    }
+    _poll_sift_down(0);
   }
+
+  const uint32_t pass_us = now - pass_start;
+  if (pass_us > _pass_us_max) _pass_us_max = pass_us;
+  _passes++;
+  _reschedule_service();
   return return_val;
 }
 
 
+/*
+* Sets the service schedule to fire when the soonest sensor comes due.
+*/
+void SensorManager::_reschedule_service() {
+  if (!_sensor_report.isScheduled()) return;   // Not yet attached.
+  uint32_t wait_ms = SENSOR_MGR_MAX_TICK_MS;
+  if (0 < _poll_heap_size) {
+    const int32_t until = (int32_t) (_poll_heap[0]->_next_due - micros());
+    wait_ms = (until <= 0) ? 0 : ((uint32_t) until / 1000);
+    if (wait_ms < SENSOR_MGR_MIN_TICK_MS) wait_ms = SENSOR_MGR_MIN_TICK_MS;
+    if (wait_ms > SENSOR_MGR_MAX_TICK_MS) wait_ms = SENSOR_MGR_MAX_TICK_MS;
+  }
+  if (wait_ms != _sensor_report.schedulePeriod()) {
+    _sensor_report.alterSchedulePeriod(wait_ms);
+  }
+}
+
+
+/**
+* @param  sensor  The sensor to add to the poll heap.
+* @return 0 on success and -1 on failure.
+*/
+int8_t SensorManager::_poll_insert(SensorWrapper* sensor) {
+  if (0 <= sensor->_poll_idx) return 0;
+  if (_poll_heap_size == _poll_heap_cap) {
+    uint32_t nu_cap = (0 == _poll_heap_cap) ? 8 : (_poll_heap_cap << 1);
+    SensorWrapper** nu_heap = (SensorWrapper**) realloc(_poll_heap, nu_cap * sizeof(SensorWrapper*));
+    if (nullptr == nu_heap) return -1;
+    _poll_heap     = nu_heap;
+    _poll_heap_cap = nu_cap;
+  }
+  _poll_place(_poll_heap_size, sensor);
+  _poll_sift_up(_poll_heap_size++);
+  return 0;
+}
+
+
+void SensorManager::_poll_remove(SensorWrapper* sensor) {
+  if (sensor->_poll_idx < 0) return;
+  uint32_t idx = (uint32_t) sensor->_poll_idx;
+  sensor->_poll_idx = -1;
+  if (idx < --_poll_heap_size) {
+    _poll_place(idx, _poll_heap[_poll_heap_size]);
+    _poll_rekey(_poll_heap[idx]);
+  }
+}
+
+
+/*
+* A sensor's deadline has moved in an unknown direction.
+*/
+void SensorManager::_poll_rekey(SensorWrapper* sensor) {
+  if (sensor->_poll_idx < 0) return;
+  _poll_sift_up((uint32_t) sensor->_poll_idx);
+  _poll_sift_down((uint32_t) sensor->_poll_idx);
+  if (0 == sensor->_poll_idx) _reschedule_service();
+}
+
+
+void SensorManager::_poll_sift_up(uint32_t idx) {
+  SensorWrapper* obj = _poll_heap[idx];
+  while (idx > 0) {
+    uint32_t parent = (idx - 1) >> 1;
+    if (!_poll_earlier(obj->_next_due, _poll_heap[parent]->_next_due)) break;
+    _poll_place(idx, _poll_heap[parent]);
+    idx = parent;
+  }
+  _poll_place(idx, obj);
+}
+
+
+void SensorManager::_poll_sift_down(uint32_t idx) {
+  SensorWrapper* obj = _poll_heap[idx];
+  while (true) {
+    uint32_t child = (idx << 1) + 1;
+    if (child >= _poll_heap_size) break;
+    if (((child + 1) < _poll_heap_size) && _poll_earlier(_poll_heap[child + 1]->_next_due, _poll_heap[child]->_next_due)) {
+      child++;
+    }
+    if (!_poll_earlier(_poll_heap[child]->_next_due, obj->_next_due)) break;
+    _poll_place(idx, _poll_heap[child]);
+    idx = child;
+  }
+  _poll_place(idx, obj);
+}
+
+
 int SensorManager::_report_sensors() {
   Kernel::log("_report_sensors()\n");
   return 0;
@@ -171,7 +319,7 @@ int SensorManager::_report_sensor_data_by_index(uint8_t idx, TCode tcode, String
 */
 void SensorManager::printSensorList(StringBuilder* output) {
   output->concatf("-- Managing %d sensors:", _sensors.size());
-  output->concat("\n\t-UUID---------------------------------Name---------a-c-d---lastUpdate---");
+  output->concat("\n\t-UUID---------------------------------Name---------a-c-d---lastUpdate---period---reads---us_last-us_mean-us_max-");
   for (int i = 0; i < _sensors.size(); i++) {
     SensorWrapper* current = _sensors.get(i);
     output->concat("\n\t");
@@ -247,10 +395,11 @@ int8_t SensorManager::attached() {
     _sensor_report.incRefs();
     _sensor_report.specific_target = (EventReceiver*) this;
     _sensor_report.alterScheduleRecurrence(-1);
-    _sensor_report.alterSchedulePeriod(1001);
+    _sensor_report.alterSchedulePeriod(SENSOR_MGR_MAX_TICK_MS);
     _sensor_report.autoClear(false);
     _sensor_report.enableSchedule(true);
     platform.kernel()->addSchedule(&_sensor_report);
+    _reschedule_service();
     return 1;
   }
   return 0;
@@ -264,6 +413,15 @@ int8_t SensorManager::attached() {
 */
 void SensorManager::printDebug(StringBuilder* output) {
   EventReceiver::printDebug(output);
+  output->concatf("-- Poll budget:       %u us\n", _poll_budget_us);
+  output->concatf("-- Service passes:    %u (%u over budget)\n", _passes, _overruns);
+  output->concatf("-- Longest pass:      %u us\n", _pass_us_max);
+  if (0 < _poll_heap_size) {
+    output->concatf("-- Next due:          %s in %d us\n",
+      _poll_heap[0]->sensorName(),
+      (int32_t) (_poll_heap[0]->_next_due - micros())
+    );
+  }
   printSensorList(output);
   output->concat("\n");
 }
@@ -147,6 +147,37 @@ void SensorWrapper::setSensorId(const char *uid_str) {
 }
 
 
+/**
+* Sets how often the SensorManager should read this sensor. If the new period
+*   would make the next read come sooner than already planned, the read is
+*   pulled in. Otherwise, the new period applies after the next read.
+*
+* @param  ms  The sample period in milliseconds. Zero is taken as one, and
+*               anything beyond SENSOR_MAX_PERIOD_MS is taken as that.
+*/
+void SensorWrapper::samplePeriod(uint32_t ms) {
+  _period_ms = (0 == ms) ? 1 : ((SENSOR_MAX_PERIOD_MS < ms) ? SENSOR_MAX_PERIOD_MS : ms);
+  uint32_t sooner = micros() + (_period_ms * 1000);
+  if ((int32_t) (sooner - _next_due) < 0) {
+    _next_due = sooner;
+    #if defined(CONFIG_MANUVR_SENSOR_MGR)
+      if (_sm && (0 <= _poll_idx)) _sm->_poll_rekey(this);
+    #endif
+  }
+}
+
+
+/*
+* Called by the SensorManager after each read it does on our behalf.
+*/
+void SensorWrapper::_note_read(uint32_t us) {
+  _read_count++;
+  _read_us_last   = us;
+  _read_us_total += us;
+  if (us > _read_us_max) _read_us_max = us;
+}
+
+
 /*******************************************************************************
 * Functions that manage the "dirty" state and autoreporting behavior of data.  *
 *******************************************************************************/
@@ -261,12 +292,17 @@ SensorError SensorWrapper::readAsString(uint8_t dat, StringBuilder* buffer) {
 
 void SensorWrapper::printSensorSummary(StringBuilder* output) {
   uuid_to_sb(&uuid, output);
-  output->concatf(": %12s %c %c %c   %ld",
+  output->concatf(": %12s %c %c %c   %10ld  %7u  %6u  %6u  %6u",
     name,
     isActive() ? 'x':' ',
     isCalibrated() ? 'x':' ',
     isDirty() ? 'x':' ',
-    lastUpdate()
+    lastUpdate(),
+    _period_ms,
+    _read_count,
+    readMicrosLast(),
+    readMicrosMean(),
+    _read_us_max
   );
 }
 
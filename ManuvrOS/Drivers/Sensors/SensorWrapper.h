@@ -94,6 +94,22 @@ typedef struct sense_datum_flag_def_t {
 #define MANUVR_MSG_SENSOR_MGR_SVC      0x05F0
 #define MANUVR_MSG_SENSOR_MGR_REPORT   0x05F1
 
+/*
+* SensorManager polling parameters.
+* Each sensor is read no more often than its own sample period. A single
+*   service pass will stop reading sensors once it has spent the budget, and
+*   the sensors it didn't get to will be first in line on the next pass.
+*/
+#ifndef SENSOR_DEFAULT_PERIOD_MS
+  #define SENSOR_DEFAULT_PERIOD_MS   1000    // Default sample period for a sensor.
+#endif
+#ifndef SENSOR_MGR_POLL_BUDGET_US
+  #define SENSOR_MGR_POLL_BUDGET_US  20000   // How long may one service pass run?
+#endif
+#define SENSOR_MAX_PERIOD_MS         1800000 // Deadlines are in micros(), and must stay within half its wrap.
+#define SENSOR_MGR_MIN_TICK_MS       5       // Shortest wait between service passes.
+#define SENSOR_MGR_MAX_TICK_MS       1001    // Longest wait between service passes.
+
 
 /* Sensors can automatically report their values. */
 enum class SensorReporting : uint8_t {
@@ -214,6 +230,19 @@ class SensorWrapper {
     inline bool isCalibrated() {    return (MANUVR_SENSOR_FLAG_CALIBRATED == (_flags & MANUVR_SENSOR_FLAG_CALIBRATED));  };
 
     inline const char* sensorName() {          return name;  };
+
+    /* How often should the SensorManager read this sensor? */
+    inline uint32_t samplePeriod() {           return _period_ms;  };
+    void samplePeriod(uint32_t ms);
+
+    /* Timing of the reads done by the SensorManager. */
+    inline uint32_t readCount() {              return _read_count;      };
+    inline uint32_t readMicrosLast() {         return _read_us_last;    };
+    inline uint32_t readMicrosMax() {          return _read_us_max;     };
+    inline uint32_t readMicrosMean() {
+      return (_read_count ? (uint32_t) (_read_us_total / _read_count) : 0);
+    };
+
     void printSensorSummary(StringBuilder*);
     void printSensorDataDefs(StringBuilder*);
     void printSensorData(StringBuilder*);
@@ -280,6 +309,7 @@ class SensorWrapper {
 
 
   private:
+    friend class SensorManager;
     UUID uuid;             // A cross-platform unique ID for this sensor.
     const char*    name;   // This is the name of the sensor.
     SensorManager* _sm         = nullptr;
@@ -288,6 +318,17 @@ class SensorWrapper {
     long           updated_at  = 0;       // When was the last update?
     uint8_t        _flags      = 0;       // Holds elementary state and capability info.
 
+    /* Polling state. Owned by the SensorManager. */
+    uint32_t       _period_ms     = SENSOR_DEFAULT_PERIOD_MS;
+    uint32_t       _next_due      = 0;    // micros() at which the next read is due.
+    int32_t        _poll_idx      = -1;   // Our slot in the manager's poll heap. -1 if absent.
+    uint32_t       _read_count    = 0;
+    uint32_t       _read_us_last  = 0;
+    uint32_t       _read_us_max   = 0;
+    uint64_t       _read_us_total = 0;
+
+    void _note_read(uint32_t us);
+
     void insert_datum(SensorDatum*);
     SensorError mark_dirty(uint8_t);   // Marks a specific datum in this sensor as dirty.
 };
@@ -325,6 +366,10 @@ class SensorManager : public EventReceiver
 
     void printSensorList(StringBuilder*);
 
+    /* How long may a single service pass spend reading sensors? */
+    inline uint32_t pollBudget() {             return _poll_budget_us;  };
+    inline void     pollBudget(uint32_t us) {  _poll_budget_us = us;    };
+
 
   protected:
     int8_t attached();      // This is called from the base notify().
@@ -333,8 +378,31 @@ class SensorManager : public EventReceiver
   private:
     PriorityQueue<SensorWrapper*> _sensors;    // SensorWrappers we service.
     ManuvrMsg _sensor_report;  // Schedule
+    SensorWrapper** _poll_heap      = nullptr;  // Sensors, in a binary min-heap keyed on deadline.
+    uint32_t        _poll_heap_size = 0;
+    uint32_t        _poll_heap_cap  = 0;
+    uint32_t        _poll_budget_us = SENSOR_MGR_POLL_BUDGET_US;
+    uint32_t        _passes         = 0;        // How many service passes have we run?
+    uint32_t        _overruns       = 0;        // How many passes ran out of budget?
+    uint32_t        _pass_us_max    = 0;        // Longest pass we've run.
 
     int _service_sensors();
+    void _reschedule_service();
+
+    /* Poll heap management. */
+    friend class SensorWrapper;
+    int8_t _poll_insert(SensorWrapper*);
+    void   _poll_remove(SensorWrapper*);
+    void   _poll_rekey(SensorWrapper*);
+    void   _poll_sift_up(uint32_t);
+    void   _poll_sift_down(uint32_t);
+    inline void _poll_place(uint32_t idx, SensorWrapper* s) {
+      _poll_heap[idx] = s;
+      s->_poll_idx = (int32_t) idx;
+    };
+    /* Wrap-safe deadline comparison. True if a is due before b. */
+    inline static bool _poll_earlier(uint32_t a, uint32_t b) {  return ((int32_t) (a - b) < 0);  };
+
     int _report_sensors();
 
     int _init_sensor_by_index(uint8_t);
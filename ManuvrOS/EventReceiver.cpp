@@ -183,6 +183,16 @@ int8_t EventReceiver::callback_proc(ManuvrMsg* event) {
 }
 
 
+/**
+* By default, an EventReceiver hears every broadcast.
+*
+* @return nullptr, which the Kernel takes to mean "all message codes".
+*/
+const uint16_t* EventReceiver::msgCodesOfInterest() {
+  return nullptr;
+}
+
+
 /**
 * This is the function that is called to notify this class of an event.
 * This particular function is the base notify() method for all downstream
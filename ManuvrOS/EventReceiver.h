@@ -77,6 +77,19 @@ Lifecycle:
         /* These are intended to be overridden. */
         virtual int8_t callback_proc(ManuvrMsg*);
 
+        /**
+        * Receivers that only care about a few message codes should override this
+        *   to return a list of those codes, terminated by MANUVR_MSG_UNDEFINED.
+        * The Kernel will then only call notify() for those codes (plus the ones
+        *   handled by the base notify()). The default (nullptr) means "everything",
+        *   which is how legacy receivers behave.
+        * The list is read when the Kernel rebuilds its dispatch table, and must
+        *   outlive the subscription.
+        *
+        * @return  A terminated list of message codes, or nullptr for all codes.
+        */
+        virtual const uint16_t* msgCodesOfInterest();
+
         /**
         *
         * @return  1 if action was taken, 0 if not, -1 on error.
@@ -168,6 +181,14 @@ Lifecycle:
         uint8_t     _class_state   = (DEFAULT_CLASS_VERBOSITY & MANUVR_ER_FLAG_VERBOSITY_MASK);
         uint8_t     _extnd_state   = 0;  // This is here for use by the extending class.
 
+        #if defined(MANUVR_EVENT_PROFILER)
+          // The Kernel's profiler attributes the cost of notify() to us here.
+          uint32_t  _prof_notify_calls  = 0;   // How many timed calls to notify()?
+          uint32_t  _prof_notify_us     = 0;   // Total microseconds spent in notify().
+          uint32_t  _prof_notify_max_us = 0;   // The most expensive single call.
+          friend class Kernel;
+        #endif
+
         inline void _mark_attached() {   _class_state |= MANUVR_ER_FLAG_ATTACHED;  };
     };
   }
@@ -41,9 +41,17 @@ limitations under the License.
 * Static members and initializers should be located here.
 *******************************************************************************/
 uint32_t    Kernel::lagged_schedules = 0;
+uint8_t     Kernel::_sleeping        = 0;
 Kernel*     Kernel::INSTANCE         = nullptr;
 BufferPipe* Kernel::_logger          = nullptr;  // The logger slot.
-PriorityQueue<ManuvrMsg*> Kernel::isr_exec_queue;
+MPSCRing<ManuvrMsg*, EVENT_MANAGER_INGRESS_DEPTH> Kernel::_ingress;
+#if defined(__BUILD_HAS_PTHREADS)
+  pthread_t                Kernel::_owner;
+  pthread_mutex_t          Kernel::_overflow_lock = PTHREAD_MUTEX_INITIALIZER;
+  PriorityQueue<ManuvrMsg*> Kernel::_overflow;
+  uint32_t                 Kernel::_overflow_count = 0;
+  pthread_mutex_t          Kernel::_sched_lock     = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 
 /* Duty-cycle calculation. */
@@ -190,21 +198,24 @@ void Kernel::nextTick(BufferPipe* p) {
 /**
 * Vanilla constructor.
 */
-Kernel::Kernel() : EventReceiver("Kernel"), _msg_prealloc(EVENT_MANAGER_PREALLOC_COUNT, _preallocation_pool) {
+Kernel::Kernel() : EventReceiver("Kernel"),
+  _msg_slab(sizeof(ManuvrMsg), EVENT_MANAGER_SLAB_CHUNK, EVENT_MANAGER_SLAB_MAX_CHUNKS, _preallocation_pool, EVENT_MANAGER_PREALLOC_COUNT) {
   INSTANCE             = this;  // For singleton reference.
+  #if defined(__BUILD_HAS_PTHREADS)
+    _owner = pthread_self();    // Until procIdleFlags() says otherwise.
+  #endif
   max_events_per_loop  = 2;
   max_idle_count       = 100;
   consequtive_idles    = max_idle_count;
-
-  for (int i = 0; i < EVENT_MANAGER_PREALLOC_COUNT; i++) {
-    /* We carved out a space in our allocation for a pool of events. Ideally, this would be enough
-        for most of the load, most of the time. If the preallocation ends up being insufficient to
-        meet demand, new Events will be created on the heap. But the events that we are dealing
-        with here are special. They should remain circulating (or in standby) for the lifetime of
-        this class. */
-    //_msg_prealloc.wipe(&_preallocation_pool[i]);
+  for (int i = 0; i < KERNEL_PRIORITY_BANDS; i++) {
+    _band_quota[i] = 0;     // No band quotas by default.
   }
 
+  /* We carved out a space in our allocation for a pool of events. Ideally, this would be enough
+      for most of the load, most of the time. If the preallocation ends up being insufficient to
+      meet demand, the slab grows in chunks, and returns them when we idle. Only when the slab
+      is at its limit will new Events be created on the heap. */
+
   #if defined(MANUVR_DEBUG)
     profiler(true);          // spend time and memory measuring performance.
   #else
@@ -220,10 +231,17 @@ Kernel::Kernel() : EventReceiver("Kernel"), _msg_prealloc(EVENT_MANAGER_PREALLOC
 Kernel::~Kernel() {
   ManuvrMsg* temp = schedules.dequeue();
   while (temp) {
+    _sched_disarm(temp);
     temp->decRefs();
     reclaim_event(temp);
     temp = schedules.dequeue();
   }
+  if (nullptr != _sched_heap) {
+    free(_sched_heap);
+    _sched_heap      = nullptr;
+    _sched_heap_cap  = 0;
+  }
+  _dispatch_free();
 }
 
 
@@ -299,6 +317,7 @@ int8_t Kernel::subscribe(EventReceiver *client) {
 
   client->setVerbosity((int8_t)DEFAULT_CLASS_VERBOSITY);
   int8_t return_value = subscribers.insert(client);
+  _dispatch_dirty(true);
   if (erAttached()) {
     // This subscriber is joining us after bootup. Call its attached() fxn to cause it to init.
     client->attached();
@@ -323,6 +342,7 @@ int8_t Kernel::subscribe(EventReceiver *client, uint8_t priority) {
 
   client->setVerbosity((int8_t)DEFAULT_CLASS_VERBOSITY);
   int8_t return_value = subscribers.insert(client, priority);
+  _dispatch_dirty(true);
   if (erAttached()) {
     // This subscriber is joining us after bootup. Call its attached() fxn to cause it to init.
     client->attached();
@@ -340,7 +360,133 @@ int8_t Kernel::subscribe(EventReceiver *client, uint8_t priority) {
 */
 int8_t Kernel::unsubscribe(EventReceiver *client) {
   if (nullptr == client) return -1;
-  return (subscribers.remove(client) ? 0 : -1);
+  if (subscribers.remove(client)) {
+    // The client may be on its way to destruction, and we might be in the middle
+    //   of a broadcast. Scrub it from the dispatch table now, and rebuild later.
+    _dispatch_forget(client);
+    _dispatch_dirty(true);
+    return 0;
+  }
+  return -1;
+}
+
+
+/**
+* Returns the list of receivers that should be notified about the given code.
+*
+* @param  code  The message code being broadcast.
+* @return The dispatch list. Never nullptr.
+*/
+ERDispatchList* Kernel::_dispatch_list(uint16_t code) {
+  std::map<uint16_t, ERDispatchList*>::iterator it = _dispatch_table.find(code);
+  return ((it != _dispatch_table.end()) ? it->second : &_dispatch_wildcard);
+}
+
+
+/**
+* Releases all memory held by the dispatch table.
+*/
+void Kernel::_dispatch_free() {
+  std::map<uint16_t, ERDispatchList*>::iterator it;
+  for (it = _dispatch_table.begin(); it != _dispatch_table.end(); it++) {
+    if (nullptr != it->second->receivers) free(it->second->receivers);
+    free(it->second);
+  }
+  _dispatch_table.clear();
+  if (nullptr != _dispatch_wildcard.receivers) free(_dispatch_wildcard.receivers);
+  _dispatch_wildcard.receivers = nullptr;
+  _dispatch_wildcard.count     = 0;
+}
+
+
+/**
+* Nulls-out any reference to the given receiver in the dispatch table without
+*   changing the shape of the table. This is safe to call during a broadcast.
+*
+* @param  er  The receiver to forget.
+*/
+void Kernel::_dispatch_forget(EventReceiver* er) {
+  std::map<uint16_t, ERDispatchList*>::iterator it;
+  for (it = _dispatch_table.begin(); it != _dispatch_table.end(); it++) {
+    for (uint16_t i = 0; i < it->second->count; i++) {
+      if (er == it->second->receivers[i]) it->second->receivers[i] = nullptr;
+    }
+  }
+  for (uint16_t i = 0; i < _dispatch_wildcard.count; i++) {
+    if (er == _dispatch_wildcard.receivers[i]) _dispatch_wildcard.receivers[i] = nullptr;
+  }
+}
+
+
+/**
+* Rebuilds the code-indexed dispatch table from the subscriber list. Every code
+*   named by any receiver gets a list containing (in subscription order) the
+*   receivers that named it, plus all of the wildcard receivers. Codes that
+*   nobody named fall through to the wildcard list.
+* This is only called between broadcasts, so it is safe to free the old table.
+*/
+void Kernel::_dispatch_rebuild() {
+  /* These codes are handled by the base EventReceiver::notify(). Everyone hears them. */
+  const uint16_t base_codes[] = {
+    MANUVR_MSG_SYS_BOOT_COMPLETED, MANUVR_MSG_SYS_CONF_LOAD, MANUVR_MSG_UNDEFINED
+  };
+  _dispatch_free();
+  _dispatch_dirty(false);
+
+  const int sub_count = subscribers.size();
+  if (0 == sub_count) return;
+  EventReceiver** subs = (EventReceiver**) alloca(sub_count * sizeof(EventReceiver*));
+  const uint16_t** interests = (const uint16_t**) alloca(sub_count * sizeof(uint16_t*));
+  uint16_t wildcards = 0;
+  for (int i = 0; i < sub_count; i++) {
+    subs[i]      = subscribers.get(i);
+    interests[i] = subs[i]->msgCodesOfInterest();
+    if (nullptr == interests[i]) wildcards++;
+  }
+
+  _dispatch_wildcard.receivers = (EventReceiver**) malloc(strict_max(wildcards, (uint16_t) 1) * sizeof(EventReceiver*));
+  for (int i = 0; i < sub_count; i++) {
+    if (nullptr == interests[i]) {
+      _dispatch_wildcard.receivers[_dispatch_wildcard.count++] = subs[i];
+    }
+  }
+
+  // First pass: count the receivers for every code that anyone named.
+  std::map<uint16_t, uint16_t> code_counts;
+  for (int i = 0; i < sub_count; i++) {
+    if (nullptr != interests[i]) {
+      for (const uint16_t* c = interests[i]; MANUVR_MSG_UNDEFINED != *c; c++) {
+        code_counts[*c]++;
+      }
+      for (const uint16_t* c = base_codes; MANUVR_MSG_UNDEFINED != *c; c++) {
+        code_counts[*c]++;
+      }
+    }
+  }
+
+  // Second pass: fill the lists in subscription order.
+  std::map<uint16_t, uint16_t>::iterator it;
+  for (it = code_counts.begin(); it != code_counts.end(); it++) {
+    const uint16_t code = it->first;
+    ERDispatchList* nu = (ERDispatchList*) malloc(sizeof(ERDispatchList));
+    nu->count     = 0;
+    nu->receivers = (EventReceiver**) malloc((it->second + wildcards) * sizeof(EventReceiver*));
+    for (int i = 0; i < sub_count; i++) {
+      bool interested = (nullptr == interests[i]);
+      if (!interested) {
+        for (const uint16_t* c = base_codes; !interested && (MANUVR_MSG_UNDEFINED != *c); c++) {
+          interested = (code == *c);
+        }
+        for (const uint16_t* c = interests[i]; !interested && (MANUVR_MSG_UNDEFINED != *c); c++) {
+          interested = (code == *c);
+        }
+      }
+      if (interested) {
+        nu->receivers[nu->count++] = subs[i];
+      }
+    }
+    _dispatch_table[code] = nu;
+  }
 }
 
 
@@ -362,26 +508,33 @@ EventReceiver* Kernel::getSubscriberByName(const char* search_str) {
 
 int8_t Kernel::registerCallbacks(uint16_t msgCode, listenerFxnPtr ca, listenerFxnPtr cb, uint32_t options) {
   if (ca != nullptr) {
-    PriorityQueue<listenerFxnPtr> *ca_queue = ca_listeners[msgCode];
-    if (nullptr == ca_queue) {
-      ca_queue = new PriorityQueue<listenerFxnPtr>();
-      ca_listeners[msgCode] = ca_queue;
-    }
-    ca_queue->insert(ca);
+    if (ca_listeners.add(msgCode, ca)) return -1;
   }
 
   if (cb != nullptr) {
-    PriorityQueue<listenerFxnPtr> *cb_queue = cb_listeners[msgCode];
-    if (nullptr == cb_queue) {
-      cb_queue = new PriorityQueue<listenerFxnPtr>();
-      cb_listeners[msgCode] = cb_queue;
-    }
-    cb_queue->insert(cb);
+    if (cb_listeners.add(msgCode, cb)) return -1;
   }
   return options%255;
 }
 
 
+/**
+* Removes listeners that were added by registerCallbacks(). Either function
+*   parameter may be null. Safe to call from within a listener.
+*
+* @param  msgCode  The message code the listeners were registered against.
+* @param  ca       The call-ahead to remove.
+* @param  cb       The callback to remove.
+* @return 0 on success, -1 if a given listener was not found.
+*/
+int8_t Kernel::unregisterCallbacks(uint16_t msgCode, listenerFxnPtr ca, listenerFxnPtr cb) {
+  int8_t return_value = 0;
+  if ((nullptr != ca) && ca_listeners.remove(msgCode, ca)) return_value = -1;
+  if ((nullptr != cb) && cb_listeners.remove(msgCode, cb)) return_value = -1;
+  return return_value;
+}
+
+
 
 
 /*******************************************************************************
@@ -397,7 +550,7 @@ int8_t Kernel::registerCallbacks(uint16_t msgCode, listenerFxnPtr ca, listenerFx
 */
 int8_t Kernel::raiseEvent(uint16_t code, EventReceiver* ori) {
   // We are creating a new Event. Try to snatch a prealloc'd one and fall back to malloc if needed.
-  ManuvrMsg* nu = INSTANCE->_msg_prealloc.take();
+  ManuvrMsg* nu = INSTANCE->_msg_take();
   if (nu) {
     nu->repurpose(code, ori);
   }
@@ -409,45 +562,115 @@ int8_t Kernel::raiseEvent(uint16_t code, EventReceiver* ori) {
 * Used to add a pre-formed event to the idle queue. Use this when a sophisticated event
 *   needs to be formed elsewhere and passed in. Kernel will only insert it into the
 *   queue in this case.
+* This is safe to call from any thread. On the Kernel's own thread, the event is
+*   validated and inserted before we return, and any failure is reported. From
+*   other threads, the event goes through the ingress ring (or the overflow list,
+*   if the ring is full) and is validated when the Kernel drains it.
 *
 * @param   event  The event to be inserted into the idle queue.
-* @return  -1 on failure, and 0 on success.
+* @return  0 on success, or the validate_insertion() failure code if we are on
+*            the Kernel's thread. Off the Kernel's thread, this cannot fail.
 */
 int8_t Kernel::staticRaiseEvent(ManuvrMsg* active_runnable) {
-  int8_t return_value = INSTANCE->validate_insertion(active_runnable);
-  if (0 == return_value) {
-    INSTANCE->update_maximum_queue_depth();   // Check the queue depth
-    #if defined (__BUILD_HAS_THREADS)
-      if (INSTANCE->_thread_id) wakeThread(INSTANCE->_thread_id);
-    #endif
-    return return_value;
+  if (nullptr == active_runnable) return -1;
+  active_runnable->_enqueued_us = micros();   // Queue latency is measured from here.
+  #if defined(__BUILD_HAS_PTHREADS)
+    if (pthread_equal(_owner, pthread_self())) {
+      return INSTANCE->_insert_now(active_runnable);
+    }
+    if (!_ingress.push(active_runnable)) {
+      // The ring is full. Rather than hand the event back to a caller that
+      //   probably won't check, hold it until the Kernel gets to it.
+      pthread_mutex_lock(&_overflow_lock);
+      _overflow.insert(active_runnable);
+      __atomic_add_fetch(&_overflow_count, 1, __ATOMIC_RELEASE);
+      pthread_mutex_unlock(&_overflow_lock);
+    }
+  #else
+    // No threads. Anything that isn't an ISR is the Kernel's context.
+    return INSTANCE->_insert_now(active_runnable);
+  #endif
+  // The push must be visible before we check whether the Kernel is asleep.
+  //   _wait_for_work() does the mirror-image of this.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&_sleeping, __ATOMIC_RELAXED)) kernelWake();
+  #if defined (__BUILD_HAS_THREADS)
+    if (INSTANCE->_thread_id) wakeThread(INSTANCE->_thread_id);
+  #endif
+  return 0;
+}
+
+
+/**
+* Removes an event from the exec_queue before it runs.
+* Events that are still in the ingress ring cannot be aborted.
+*
+* @param   event  The event to be removed from the idle queue.
+* @return  true if the given event was aborted, false otherwise.
+*/
+bool Kernel::abortEvent(ManuvrMsg* event) {
+  INSTANCE->_aging.remove(event);
+  for (uint8_t i = 0; i < INSTANCE->_held_count; i++) {
+    if (event == INSTANCE->_held[i]) {
+      // Set aside by a band quota during the present call.
+      INSTANCE->_held_count--;
+      for (; i < INSTANCE->_held_count; i++) INSTANCE->_held[i] = INSTANCE->_held[i + 1];
+      return true;
+    }
   }
-  INSTANCE->insertion_denials++;
+  return INSTANCE->exec_queue.remove(event);
+}
+
 
-  if (-1 == return_value) {
-    // We can't discover anything about a NULL event. Serious problems upstream.
-    return return_value;
+/**
+* Raise an event from an ISR. The ingress ring is lock-free, so this is the
+*   only path that is safe from interrupt context. Nothing is validated here.
+*
+* @param   event  The event to be inserted into the idle queue.
+* @return  0 on success, -1 on NULL event, -5 if the ingress ring is full. In
+*            the latter case, the caller retains ownership of the event.
+*/
+int8_t Kernel::isrRaiseEvent(ManuvrMsg* event) {
+  if (nullptr == event) return -1;
+  event->_enqueued_us = micros();
+  if (!_ingress.push(event)) return -5;
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&_sleeping, __ATOMIC_RELAXED)) kernelWake();
+  return 0;
+}
+
+
+/**
+* Validates an event and puts it in the exec_queue. Only the Kernel's thread
+*   may call this. Events that fail validation are reclaimed, as appropriate.
+*
+* @param   event  The event to be inserted.
+* @return  0 on success, or the validate_insertion() failure code.
+*/
+int8_t Kernel::_insert_now(ManuvrMsg* active_runnable) {
+  int8_t vi_res = validate_insertion(active_runnable);
+  if (0 == vi_res) {
+    update_maximum_queue_depth();   // Check the queue depth
+    return 0;
   }
+  insertion_denials++;
 
   #if defined(MANUVR_DEBUG)
-    if (INSTANCE->getVerbosity() > 5) {
+    if ((-1 != vi_res) && (getVerbosity() > 5)) {
       StringBuilder output;
       output.concatf(
         "Kernel::validate_insertion() failed (%d) for MSG code %s\n",
-        return_value,
+        vi_res,
         ManuvrMsg::getMsgTypeString(active_runnable->eventCode())
       );
-
-      if (INSTANCE->getVerbosity() > 6) {
+      if (getVerbosity() > 6) {
         active_runnable->printDebug(&output);
       }
       Kernel::log(&output);
     }
   #endif
 
-  switch (return_value) {
-    case 0:    // Clear for insertion.
-      break;
+  switch (vi_res) {
     case -1:   // NULL runnable! How?!?!
     case -3:   // Pointer idempotency. THIS EXACT runnable is already enqueue.
       // So don't reclaim it.
@@ -455,43 +678,34 @@ int8_t Kernel::staticRaiseEvent(ManuvrMsg* active_runnable) {
     case -2:   // UNDEFINED event. This shall not stand, man....
     case -4:   // DEPRECATED: Message-level idempotency.
     default:   // Should never occur.
-      INSTANCE->reclaim_event(active_runnable);
+      reclaim_event(active_runnable);
       break;
   }
-  return return_value;
+  return vi_res;
 }
 
 
 /**
-* Used to add a pre-formed event to the idle queue. Use this when a sophisticated event
-*   needs to be formed elsewhere and passed in. Kernel will only insert it into the
-*   queue in this case.
+* Moves everything in the ingress ring into the exec_queue, in priority order.
+* Only the Kernel's thread may call this.
 *
-* @param   event  The event to be removed from the idle queue.
-* @return  true if the given event was aborted, false otherwise.
+* @return the number of events that were accepted.
 */
-bool Kernel::abortEvent(ManuvrMsg* event) {
-  if (!INSTANCE->exec_queue.remove(event)) {
-    // Didn't find it? Check  the isr_queue...
-    if (!INSTANCE->isr_exec_queue.remove(event)) {
-      return false;
-    }
+int Kernel::_ingress_drain() {
+  int return_value = 0;
+  ManuvrMsg* active_runnable = nullptr;
+  while (_ingress.pop(&active_runnable)) {
+    if (0 == _insert_now(active_runnable)) return_value++;
   }
-  return true;
-}
-
-
-// TODO: It would be bettter to put a semaphore on the exec_queue and set it in the idle loop.
-//       That way, we could check for it here, and have the (probable) possibility of not incurring
-//       the cost for merging these two queues if we don't have to.
-//             ---J. Ian Lindsay   Fri Jul 03 16:54:14 MST 2015
-int8_t Kernel::isrRaiseEvent(ManuvrMsg* event) {
-  int return_value = -1;
-  maskableInterrupts(false);
-  return_value = isr_exec_queue.insertIfAbsent(event, event->priority());
-  maskableInterrupts(true);
-  #if defined (__BUILD_HAS_THREADS)
-    if (INSTANCE->_thread_id) wakeThread(INSTANCE->_thread_id);
+  #if defined(__BUILD_HAS_PTHREADS)
+    if (__atomic_load_n(&_overflow_count, __ATOMIC_ACQUIRE)) {
+      pthread_mutex_lock(&_overflow_lock);
+      while (nullptr != (active_runnable = _overflow.dequeue())) {
+        __atomic_sub_fetch(&_overflow_count, 1, __ATOMIC_RELEASE);
+        if (0 == _insert_now(active_runnable)) return_value++;
+      }
+      pthread_mutex_unlock(&_overflow_lock);
+    }
   #endif
   return return_value;
 }
@@ -530,7 +744,7 @@ ManuvrMsg* Kernel::returnEvent(uint16_t code, EventReceiver* er) {
   if (nullptr == er) {
     er = (EventReceiver*) INSTANCE;
   }
-  ManuvrMsg* return_value = INSTANCE->_msg_prealloc.take();
+  ManuvrMsg* return_value = INSTANCE->_msg_take();
   if (return_value) {
     return_value->repurpose(code, er);
   }
@@ -553,7 +767,7 @@ int8_t Kernel::validate_insertion(ManuvrMsg* event) {
     return -2;  // No undefined events.
   }
 
-  if (exec_queue.contains(event)) {
+  if (exec_queue.contains(event) || _is_held(event)) {
     // Bail out with error, because this event (which is status-bearing) cannot be in the
     //   queue more than once.
     return -3;
@@ -561,6 +775,7 @@ int8_t Kernel::validate_insertion(ManuvrMsg* event) {
 
   // Go ahead and insert.
   INSTANCE->exec_queue.insert(event, event->priority());
+  if (_dispatch_max_age_us) _aging.insert(event);   // Appended. Oldest stays first.
   return 0;
 }
 
@@ -574,58 +789,54 @@ int8_t Kernel::validate_insertion(ManuvrMsg* event) {
 void Kernel::reclaim_event(ManuvrMsg* obj) {
   if (obj) {
     if (0 == obj->refCount()) {
-      // No outstanding references.
-      if (_msg_prealloc.inPool(obj)) {
-        obj->clearArgs();         // Wipe the Msg...
-      }
-      // Return it to the preallocate pool. If this message was heap-allocated,
-      //   it will be deleted by the pool manager.
-      _msg_prealloc.give(obj);
+      // No outstanding references. If this message was heap-allocated, it
+      //   will be deleted. Otherwise, it goes back to the slab.
+      _msg_give(obj);
     }
   }
 }
 
 
+/**
+* Allocates a message. From the slab if possible, and the heap if not.
+*
+* @return A freshly-constructed message, or nullptr if we are out of memory.
+*/
+ManuvrMsg* Kernel::_msg_take() {
+  void* mem = _msg_slab.take();
+  return ((nullptr != mem) ? new (mem) ManuvrMsg() : new ManuvrMsg());
+}
+
+
+/**
+* Destroys a message, and frees its memory to wherever it came from. The
+*   message's Arguments go back to their own slab as it is destroyed.
+*
+* @param  obj  The message to free.
+*/
+void Kernel::_msg_give(ManuvrMsg* obj) {
+  if (_msg_slab.contains(obj)) {
+    obj->~ManuvrMsg();
+    _msg_slab.give(obj);
+  }
+  else {
+    delete obj;
+  }
+}
+
+
 /*******************************************************************************
 * Kernel operation...                                                          *
 *******************************************************************************/
 
 // This is the splice into v2's style of event handling (callaheads).
 int8_t Kernel::procCallAheads(ManuvrMsg* active_runnable) {
-  int8_t return_value = 0;
-  std::map<uint16_t, PriorityQueue<listenerFxnPtr>*>::iterator it = ca_listeners.find(active_runnable->eventCode());
-  if (it != ca_listeners.end()) {
-    PriorityQueue<listenerFxnPtr> *ca_queue = ca_listeners[active_runnable->eventCode()];
-    if (nullptr != ca_queue) {
-      listenerFxnPtr current_fxn;
-      for (int i = 0; i < ca_queue->size(); i++) {
-        current_fxn = ca_queue->recycle();  // TODO: This is ugly for many reasons.
-        if (current_fxn(active_runnable)) {
-          return_value++;
-        }
-      }
-    }
-  }
-  return return_value;
+  return (int8_t) ca_listeners.fire(active_runnable->eventCode(), active_runnable);
 }
 
 // This is the splice into v2's style of event handling (callbacks).
 int8_t Kernel::procCallBacks(ManuvrMsg* active_runnable) {
-  int8_t return_value = 0;
-  std::map<uint16_t, PriorityQueue<listenerFxnPtr>*>::iterator it = cb_listeners.find(active_runnable->eventCode());
-  if (it != cb_listeners.end()) {
-    PriorityQueue<listenerFxnPtr>* cb_queue = cb_listeners[active_runnable->eventCode()];
-    if (cb_queue) {
-      listenerFxnPtr current_fxn;
-      for (int i = 0; i < cb_queue->size(); i++) {
-        current_fxn = cb_queue->recycle();  // TODO: This is ugly for many reasons.
-        if (current_fxn(active_runnable)) {
-          return_value++;
-        }
-      }
-    }
-  }
-  return return_value;
+  return (int8_t) cb_listeners.fire(active_runnable->eventCode(), active_runnable);
 }
 
 
@@ -664,62 +875,38 @@ int8_t Kernel::procIdleFlags() {
   ManuvrMsg* active_runnable = nullptr;  // Our short-term focus.
   uint8_t activity_count    = 0;     // Incremented whenever a subscriber reacts to an event.
 
+  #if defined(__BUILD_HAS_PTHREADS)
+    _owner = pthread_self();   // Whoever runs this loop is the Kernel's thread.
+  #endif
   serviceSchedules();   // Look for scheduled events and proc them.
 
-  globalIRQDisable();
-  while (isr_exec_queue.size() > 0) {
-    active_runnable = isr_exec_queue.dequeue();
+  _ingress_drain();   // Merge anything raised since last time.
+  if (_dispatch_max_age_us) _promote_aged_events();
 
-    switch (validate_insertion(active_runnable)) {
-      case 0:    // Clear for insertion.
-        break;
-      case -1:   // NULL runnable! How?!?!
-        break;
-      case -2:   // UNDEFINED event. This shall not stand, man....
-        break;
-      case -3:   // Pointer idempotency. THIS EXACT runnable is already enqueue.
-        break;
-      default:   // Should never occur.
-        break;
-    }
-  }
-  globalIRQEnable();
-
-  active_runnable = nullptr;   // Pedantic...
+  uint8_t band_counts[KERNEL_PRIORITY_BANDS];   // Events run this call, by band.
+  memset(band_counts, 0, sizeof(band_counts));
 
   /* As long as we have an open event and we aren't yet at our proc ceiling... */
   while (exec_queue.hasNext() && should_run_another_event(return_value, call_start_us)) {
+    active_runnable = _dispatch_next(band_counts);  // Grab the Event and remove it in the same call.
+    if (nullptr == active_runnable) {
+      break;   // Everything that is waiting belongs to a band that has spent its quota.
+    }
     if (idle()) {
       platform.wakeHook();
       _idle(false);
     }
-    active_runnable = exec_queue.dequeue();       // Grab the Event and remove it in the same call.
     msg_code_local = active_runnable->eventCode();  // This gets used after the life of the event.
 
     current_event = active_runnable;
 
     #if defined(MANUVR_EVENT_PROFILER)
-      StopWatch* profiler_item = nullptr;
-      if (_profiler_enabled()) {
-        int cost_size = event_costs.size();
-        int i = 0;
-        while ((nullptr == profiler_item) && (i < cost_size)) {
-          StopWatch* tmp_stopwatch = event_costs.get(i++);
-          if (tmp_stopwatch->tag() == msg_code_local) {
-            profiler_item = tmp_stopwatch;
-            break;
-          }
-        }
-        if (nullptr == profiler_item) {
-          // If we don't yet have a stopwatch for this message type...
-          profiler_item = new StopWatch(msg_code_local);    // ...create one with the MSG code...
-          event_costs.insert(profiler_item, 1);     // ...and insert it for the future.
-        }
-        else {
-          // If we already have a profiler item for this code...
-          event_costs.incrementPriority(profiler_item);
-        }
-        profiler_item->markStart();
+      const bool profiling = _profiler_enabled();
+      MsgCostRecord* profiler_item = nullptr;
+      uint32_t profiler_start = 0;
+      if (profiling) {
+        profiler_item  = _msg_cost_record(msg_code_local);  // No allocation. May be nullptr.
+        profiler_start = micros();
       }
     #endif  //MANUVR_EVENT_PROFILER
 
@@ -729,9 +916,26 @@ int8_t Kernel::procIdleFlags() {
       activity_count += active_runnable->execute();
     }
     else {
-      for (int i = 0; i < subscribers.size(); i++) {
-        EventReceiver* subscriber = subscribers.get(i);
-        switch (subscriber->notify(active_runnable)) {
+      if (_dispatch_dirty()) _dispatch_rebuild();
+      ERDispatchList* d_list = _dispatch_list(msg_code_local);
+      notify_calls_saved += (subscribers.size() - d_list->count);
+      for (uint16_t i = 0; i < d_list->count; i++) {
+        EventReceiver* subscriber = d_list->receivers[i];
+        if (nullptr == subscriber) continue;   // Unsubscribed mid-broadcast.
+        notify_calls++;
+        #if defined(MANUVR_EVENT_PROFILER)
+          const uint32_t notify_start = (profiling ? micros() : 0);
+          const int8_t notify_ret = subscriber->notify(active_runnable);
+          if (profiling) {
+            const uint32_t notify_us = wrap_accounted_delta(notify_start, micros());
+            subscriber->_prof_notify_calls++;
+            subscriber->_prof_notify_us += notify_us;
+            if (notify_us > subscriber->_prof_notify_max_us) subscriber->_prof_notify_max_us = notify_us;
+          }
+        #else
+          const int8_t notify_ret = subscriber->notify(active_runnable);
+        #endif  //MANUVR_EVENT_PROFILER
+        switch (notify_ret) {
           case -1:  // The subscriber choked. Figure out why. Technically, this is action. Case fall-through...
             subscriber->printDebug(&local_log);
           default:   // The subscriber acted.
@@ -745,7 +949,7 @@ int8_t Kernel::procIdleFlags() {
 
     #if defined(MANUVR_EVENT_PROFILER)
       if (nullptr != profiler_item) {
-        profiler_item->markStop();
+        _note_msg_cost(profiler_item, wrap_accounted_delta(profiler_start, micros()));
       }
     #endif  //MANUVR_EVENT_PROFILER
 
@@ -765,6 +969,7 @@ int8_t Kernel::procIdleFlags() {
         #ifdef MANUVR_DEBUG
         if (getVerbosity() > 6) local_log.concatf("Recycling %s.\n", active_runnable->getMsgTypeString());
         #endif
+        active_runnable->_enqueued_us = micros();
         vi_res = validate_insertion(active_runnable);
         switch (vi_res) {
           case -1:   // NULL runnable! How?!?!
@@ -811,7 +1016,9 @@ int8_t Kernel::procIdleFlags() {
     }
     total_events++;
     return_value++;   // We just serviced an Event.
+    _ingress_drain();   // Pick up anything the last event raised.
   }
+  _restore_held();
 
   if (_pending_pipes()) {
     BufferPipe* _temp_io = _pipe_io_pend.dequeue();
@@ -849,6 +1056,9 @@ int8_t Kernel::procIdleFlags() {
         if (!idle()) {
           platform.idleHook();
           _idle(true);
+          // Demand has passed. Give back whatever memory the burst took.
+          _msg_slab.trim();
+          Argument::trimArena();
         }
         break;
       case 1:
@@ -863,6 +1073,150 @@ int8_t Kernel::procIdleFlags() {
     }
   }
   else {}  // there was a problem. Do nothing.
+
+  _wait_for_work(0 == return_value);
+  return return_value;
+}
+
+
+/**
+* Chooses the next event to run, and removes it from the exec_queue.
+* Ordinarily, this is the head of the queue. But if the head's priority band
+*   has spent its quota for this call, it is set aside until the end of the
+*   call, and we look at the new head. So each event is examined once per call,
+*   rather than the queue being walked by index for every dispatch. Events that
+*   have outlived the max queue age ignore quotas.
+* At most KERNEL_DISPATCH_HOLD events are set aside per call. Anything that is
+*   eligible but lies behind that many ineligible events waits for the next call.
+*
+* @param  band_counts  How many events from each band have run during this call.
+* @return The event to run, or nullptr if quotas forbid running anything more.
+*/
+ManuvrMsg* Kernel::_dispatch_next(uint8_t* band_counts) {
+  const uint32_t now = micros();
+  while (exec_queue.hasNext()) {
+    ManuvrMsg* candidate = exec_queue.get(0);
+    const uint8_t  band   = _priority_band(candidate->priority());
+    const uint32_t waited = wrap_accounted_delta(candidate->_enqueued_us, now);
+    const bool aged = (_dispatch_max_age_us && (waited >= _dispatch_max_age_us));
+    if (aged || (0 == _band_quota[band]) || (band_counts[band] < _band_quota[band])) {
+      exec_queue.dequeue();
+      _aging.remove(candidate);   // Usually at (or near) the head, if present.
+      band_counts[band]++;
+
+      uint8_t bucket = 0;
+      for (uint32_t w = waited; (w >>= 1) && (bucket < (KERNEL_LATENCY_BUCKETS - 1));) {
+        bucket++;
+      }
+      _queue_lat_hist[band][bucket]++;
+      return candidate;
+    }
+    if (_held_count >= KERNEL_DISPATCH_HOLD) {
+      break;
+    }
+    _held[_held_count++] = exec_queue.dequeue();
+  }
+  _quota_deferrals++;
+  return nullptr;
+}
+
+
+/**
+* Returns the events that _dispatch_next() set aside to the exec_queue. They
+*   keep their order relative to one another, and to everything they were
+*   ahead of. An event of equal priority that was raised during this call will
+*   now be ahead of them.
+*/
+void Kernel::_restore_held() {
+  for (uint8_t i = 0; i < _held_count; i++) {
+    exec_queue.insert(_held[i], _held[i]->priority());
+  }
+  _held_count = 0;
+}
+
+
+/**
+* Was the given event set aside by a band quota during the present call?
+*
+* @param  event  The event in question.
+* @return true if so.
+*/
+bool Kernel::_is_held(ManuvrMsg* event) {
+  for (uint8_t i = 0; i < _held_count; i++) {
+    if (event == _held[i]) return true;
+  }
+  return false;
+}
+
+
+/**
+* Any event that has waited longer than the max queue age is moved to the front
+*   of the queue, so that bulk traffic cannot hold it indefinitely.
+* _aging lists queued events in about the order that they were raised, so we need
+*   only look at its head: once the oldest event hasn't aged, none has. Each event
+*   leaves _aging when it is promoted, run, or aborted.
+*/
+void Kernel::_promote_aged_events() {
+  const uint32_t now = micros();
+  uint8_t promoted = 0;
+  while (_aging.hasNext() && (promoted < KERNEL_AGING_BATCH)) {
+    ManuvrMsg* oldest = _aging.get(0);
+    if (wrap_accounted_delta(oldest->_enqueued_us, now) < _dispatch_max_age_us) {
+      break;
+    }
+    _aging.dequeue();
+    if (EVENT_PRIORITY_HIGHEST > oldest->priority()) {
+      // Re-queueing doesn't change the event's own priority, and hence its band.
+      exec_queue.remove(oldest);
+      exec_queue.insert(oldest, EVENT_PRIORITY_HIGHEST);
+      _aged_promotions++;
+      promoted++;
+    }
+  }
+}
+
+
+/**
+* Hands the CPU back to the platform until there is something for us to do.
+* Where the platform can block (Linux), this sleeps until another thread raises
+*   an event, or the next schedule comes due. Elsewhere, it returns at once.
+* Either way, the platform gets the chance to advance our scheduler.
+*
+* @param  may_sleep  Pass false if we know there is more work to do.
+*/
+void Kernel::_wait_for_work(bool may_sleep) {
+  uint32_t wait_ms = 0;
+  if (may_sleep && !_pending_pipes() && !exec_queue.hasNext()) {
+    __atomic_store_n(&_sleeping, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bool nothing_raised = _ingress.empty();
+    #if defined(__BUILD_HAS_PTHREADS)
+      nothing_raised = nothing_raised && (0 == __atomic_load_n(&_overflow_count, __ATOMIC_ACQUIRE));
+    #endif
+    if (nothing_raised) {
+      // Nobody raised anything before they could see that we are asleep.
+      wait_ms = _ms_until_next_schedule();
+    }
+  }
+  kernelWait(wait_ms);
+  __atomic_store_n(&_sleeping, 0, __ATOMIC_RELAXED);
+}
+
+
+/**
+* How long can we wait before the next schedule comes due?
+*
+* @return Milliseconds until the next deadline, capped at KERNEL_MAX_IDLE_WAIT_MS.
+*/
+uint32_t Kernel::_ms_until_next_schedule() {
+  uint32_t return_value = KERNEL_MAX_IDLE_WAIT_MS;
+  _sched_take();
+  if (0 < _sched_heap_size) {
+    const uint32_t now = _sched_clock + _ms_elapsed;
+    const uint32_t due = _sched_heap[0]->_sched_deadline;
+    return_value = _sched_earlier(now, due) ? strict_min((uint32_t) (due - now), return_value) : 0;
+  }
+  _sched_give();
   return return_value;
 }
 
@@ -893,13 +1247,157 @@ void Kernel::profiler(bool enabled) {
   max_events_p_loop  = 0;
   max_idle_loop_time = 0;
   insertion_denials  = 0;
+  _clear_latency_stats();
 
   #if defined(MANUVR_EVENT_PROFILER)
-    while (event_costs.hasNext()) delete event_costs.dequeue();
+    _clear_msg_costs();
   #endif   // MANUVR_EVENT_PROFILER
 }
 
 
+#if defined(MANUVR_EVENT_PROFILER)
+/**
+* Empties the profiler's table, and the notify() costs of all subscribers.
+*/
+void Kernel::_clear_msg_costs() {
+  memset(_msg_costs, 0, sizeof(_msg_costs));   // Zero is MANUVR_MSG_UNDEFINED.
+  _msg_costs_untracked = 0;
+  for (int i = 0; i < subscribers.size(); i++) {
+    EventReceiver* er = subscribers.get(i);
+    er->_prof_notify_calls  = 0;
+    er->_prof_notify_us     = 0;
+    er->_prof_notify_max_us = 0;
+  }
+}
+
+
+/**
+* Finds (or claims) the profiler record for the given message code.
+* The table is fixed-size and open-addressed, so this never allocates.
+*
+* @param  code  The message code.
+* @return The record, or nullptr if the table is full.
+*/
+MsgCostRecord* Kernel::_msg_cost_record(uint16_t code) {
+  uint32_t i = (((uint32_t) code * 2654435761u) >> 16) & (KERNEL_PROFILER_SLOTS - 1);
+  for (int probes = 0; probes < KERNEL_PROFILER_SLOTS; probes++) {
+    MsgCostRecord* rec = &_msg_costs[i];
+    if (code == rec->code) return rec;
+    if (MANUVR_MSG_UNDEFINED == rec->code) {
+      rec->code   = code;
+      rec->min_us = 0xFFFFFFFF;
+      return rec;
+    }
+    i = (i + 1) & (KERNEL_PROFILER_SLOTS - 1);
+  }
+  _msg_costs_untracked++;
+  return nullptr;
+}
+
+
+/**
+* Folds a single run time into a profiler record.
+*
+* @param  rec  The record.
+* @param  us   How long the event took to run.
+*/
+void Kernel::_note_msg_cost(MsgCostRecord* rec, uint32_t us) {
+  rec->executions++;
+  rec->total_us += us;
+  if (us < rec->min_us) rec->min_us = us;
+  if (us > rec->max_us) rec->max_us = us;
+  uint8_t bucket = 0;
+  while ((us >>= 1) && (bucket < (KERNEL_PROFILER_BUCKETS - 1))) bucket++;
+  rec->hist[bucket]++;
+}
+
+
+/**
+* Reads a percentile from a record's histogram. The answer is an upper bound.
+*
+* @param  rec         The record.
+* @param  percentile  0-100.
+* @return Microseconds.
+*/
+uint32_t Kernel::_msg_cost_percentile(MsgCostRecord* rec, uint8_t percentile) {
+  if (0 == rec->executions) return 0;
+  const uint32_t target = (uint32_t) ((((uint64_t) rec->executions * strict_min(percentile, (uint8_t) 100)) + 99) / 100);
+  uint32_t seen = 0;
+  for (int i = 0; i < KERNEL_PROFILER_BUCKETS; i++) {
+    seen += rec->hist[i];
+    if (seen >= target) return strict_min((uint32_t) (2 << i), rec->max_us);
+  }
+  return rec->max_us;
+}
+#endif   // MANUVR_EVENT_PROFILER
+
+
+/**
+* Zeroes the queue latency histograms, and the counters that go with them.
+*/
+void Kernel::_clear_latency_stats() {
+  _aged_promotions = 0;
+  _quota_deferrals = 0;
+  memset(_queue_lat_hist, 0, sizeof(_queue_lat_hist));
+}
+
+
+/**
+* Sets the maximum number of events from the given priority band that may run
+*   in a single call to procIdleFlags(). Zero means no quota.
+*
+* @param  band   The priority band.
+* @param  quota  The number of events.
+* @return 0 on success, -1 if there is no such band.
+*/
+int8_t Kernel::bandQuota(uint8_t band, uint8_t quota) {
+  if (band >= KERNEL_PRIORITY_BANDS) return -1;
+  _band_quota[band] = quota;
+  return 0;
+}
+
+
+/**
+* How long did events in the given band wait in the queue?
+* Resolution is a power of two, so the return value is an upper bound.
+*
+* @param  band        The priority band.
+* @param  percentile  0-100.
+* @return The latency in microseconds, or 0 if there is no data.
+*/
+uint32_t Kernel::queueLatency(uint8_t band, uint8_t percentile) {
+  if (band >= KERNEL_PRIORITY_BANDS) return 0;
+  uint32_t total = 0;
+  for (int i = 0; i < KERNEL_LATENCY_BUCKETS; i++) {
+    total += _queue_lat_hist[band][i];
+  }
+  if (0 == total) return 0;
+  const uint32_t target = (uint32_t) ((((uint64_t) total * strict_min(percentile, (uint8_t) 100)) + 99) / 100);
+  uint32_t seen = 0;
+  for (int i = 0; i < KERNEL_LATENCY_BUCKETS; i++) {
+    seen += _queue_lat_hist[band][i];
+    if (seen >= target) return (2 << i);
+  }
+  return (2 << (KERNEL_LATENCY_BUCKETS - 1));
+}
+
+
+/**
+* Print the dispatch policy to the provided buffer.
+*
+* @param   StringBuilder*  The buffer that this fxn will write output into.
+*/
+void Kernel::printDispatchPolicy(StringBuilder* output) {
+  output->concat("-- Dispatch policy:\n");
+  output->concatf("   Events per call:   %d\n", max_events_per_loop);
+  output->concatf("   Time budget:       %lu us%s\n", (unsigned long) _dispatch_budget_us, (_dispatch_budget_us ? "" : " (no limit)"));
+  output->concatf("   Max queue age:     %lu us%s\n", (unsigned long) _dispatch_max_age_us, (_dispatch_max_age_us ? "" : " (aging off)"));
+  for (int i = 0; i < KERNEL_PRIORITY_BANDS; i++) {
+    output->concatf("   Band %d quota:      %u\n", i, _band_quota[i]);
+  }
+}
+
+
 // TODO: This never worked terribly well. Need to tap the timer
 //   and profile to do it correctly. Still better than nothing.
 float Kernel::cpu_usage() {
@@ -916,25 +1414,29 @@ void Kernel::printProfiler(StringBuilder* output) {
   if (nullptr == output) return;
   if (getVerbosity() > 4) {
     output->concatf("-- Queue depth        \t%d\n", exec_queue.size());
-    output->concatf("-- ISR depth          \t%d\n", isr_exec_queue.size());
-
-    #if defined(MANUVR_DEBUG)
-      output->concat("-- Preallocd ");
-      _msg_prealloc.printDebug(output);
-    #endif
+    output->concatf("-- Ingress depth      \t%lu / %lu\n", (unsigned long) _ingress.count(), (unsigned long) _ingress.capacity());
+    output->concatf("-- Ingress drops      \t%lu\n", (unsigned long) _ingress.drops());
 
     if (total_events) {
-      output->concatf("\t Hits:     \t%.3f\%\n", (double)(1-(_msg_prealloc.starves() / total_events)) * 100);
+      output->concatf("-- Msg slab hits:     \t%.3f\%\n", (1.0 - (_msg_slab.fallbacks() / (double) total_events)) * 100);
     }
   }
 
-  output->concatf("-- total_events       \t%u\n", (unsigned long) total_events);
-  output->concatf("-- total_events_dead  \t%u\n", (unsigned long) total_events_dead);
-  output->concatf("-- max_queue_depth    \t%u\n", (unsigned long) max_queue_depth);
-  output->concatf("-- total_loops        \t%u\n", (unsigned long) total_loops);
-  output->concatf("-- max_idle_loop_time \t%u\n", (unsigned long) max_idle_loop_time);
-  output->concatf("-- max_events_p_loop  \t%u\n", (unsigned long) max_events_p_loop);
+  output->concatf("-- total_events       \t%lu\n", (unsigned long) total_events);
+  output->concatf("-- total_events_dead  \t%lu\n", (unsigned long) total_events_dead);
+  output->concatf("-- max_queue_depth    \t%lu\n", (unsigned long) max_queue_depth);
+  output->concatf("-- total_loops        \t%lu\n", (unsigned long) total_loops);
+  output->concatf("-- max_idle_loop_time \t%lu\n", (unsigned long) max_idle_loop_time);
+  output->concatf("-- max_events_p_loop  \t%lu\n", (unsigned long) max_events_p_loop);
+  output->concatf("-- notify() calls     \t%lu\n", (unsigned long) notify_calls);
+  output->concatf("-- notify() saved     \t%lu\n", (unsigned long) notify_calls_saved);
   output->concatf("-- Pending pipes:     \t%d\n", _pipe_io_pend.size());
+  output->concatf("-- Aged promotions    \t%lu\n", (unsigned long) _aged_promotions);
+  output->concatf("-- Quota deferrals    \t%lu\n", (unsigned long) _quota_deferrals);
+  output->concat("-- Queue latency (us, upper bound):\n");
+  for (int i = 0; i < KERNEL_PRIORITY_BANDS; i++) {
+    output->concatf("   Band %d:  p50 %8lu   p99 %8lu\n", i, (unsigned long) queueLatency(i, 50), (unsigned long) queueLatency(i, 99));
+  }
 
   if (_profiler_enabled()) {
     output->concat("-- Profiler:\n");
@@ -942,13 +1444,33 @@ void Kernel::printProfiler(StringBuilder* output) {
     output->concatf("   Kernel duty cycle: %.3f\n", dutyCycle());
 
     #if defined(MANUVR_EVENT_PROFILER)
-      StopWatch* profiler_item;
-      int x = event_costs.size();
+      output->concat("\t                  Execd      Min       Mean      p99       Max   (us)\n");
+      for (int i = 0; i < KERNEL_PROFILER_SLOTS; i++) {
+        MsgCostRecord* rec = &_msg_costs[i];
+        if (0 == rec->executions) continue;
+        output->concatf("\t%-16s %7lu %9lu %9lu %9lu %9lu\n",
+          ManuvrMsg::getMsgTypeString(rec->code),
+          (unsigned long) rec->executions,
+          (unsigned long) rec->min_us,
+          (unsigned long) (rec->total_us / rec->executions),
+          (unsigned long) _msg_cost_percentile(rec, 99),
+          (unsigned long) rec->max_us
+        );
+      }
+      if (_msg_costs_untracked) {
+        output->concatf("\t(%lu events untracked: table full)\n", (unsigned long) _msg_costs_untracked);
+      }
 
-      StopWatch::printDebugHeader(output);
-      for (int i = 0; i < x; i++) {
-        profiler_item = event_costs.get(i);
-        profiler_item->printDebug(ManuvrMsg::getMsgTypeString(profiler_item->tag()), output);
+      output->concat("-- notify() cost by receiver:\n");
+      for (int i = 0; i < subscribers.size(); i++) {
+        EventReceiver* er = subscribers.get(i);
+        if (0 == er->_prof_notify_calls) continue;
+        output->concatf("\t%-16s %7lu calls   mean %6lu us   max %6lu us\n",
+          er->getReceiverName(),
+          (unsigned long) er->_prof_notify_calls,
+          (unsigned long) (er->_prof_notify_us / er->_prof_notify_calls),
+          (unsigned long) er->_prof_notify_max_us
+        );
       }
     #endif   // MANUVR_EVENT_PROFILER
   }
@@ -972,6 +1494,62 @@ void Kernel::printProfiler(StringBuilder* output) {
 }
 
 
+/**
+* Writes the profiler's data to the provided buffer as a single JSON object,
+*   for consumption by tooling rather than people.
+* Times are in microseconds. Histogram bucket i counts runs shorter than 2^(i+1).
+*
+* @param   StringBuilder*  The buffer that this fxn will write output into.
+*/
+void Kernel::exportProfiler(StringBuilder* output) {
+  if (nullptr == output) return;
+  output->concatf("{\"events\":%lu,\"dead\":%lu,\"loops\":%lu,\"notify_calls\":%lu",
+    (unsigned long) total_events,
+    (unsigned long) total_events_dead,
+    (unsigned long) total_loops,
+    (unsigned long) notify_calls
+  );
+  #if defined(MANUVR_EVENT_PROFILER)
+    output->concatf(",\"untracked\":%lu,\"msgs\":[", (unsigned long) _msg_costs_untracked);
+    bool first = true;
+    for (int i = 0; i < KERNEL_PROFILER_SLOTS; i++) {
+      MsgCostRecord* rec = &_msg_costs[i];
+      if (0 == rec->executions) continue;
+      output->concatf("%s{\"code\":%u,\"label\":\"%s\",\"n\":%lu,\"min\":%lu,\"mean\":%lu,\"max\":%lu,\"hist\":[",
+        (first ? "" : ","),
+        rec->code,
+        ManuvrMsg::getMsgTypeString(rec->code),
+        (unsigned long) rec->executions,
+        (unsigned long) rec->min_us,
+        (unsigned long) (rec->total_us / rec->executions),
+        (unsigned long) rec->max_us
+      );
+      for (int b = 0; b < KERNEL_PROFILER_BUCKETS; b++) {
+        output->concatf("%s%lu", (b ? "," : ""), (unsigned long) rec->hist[b]);
+      }
+      output->concat("]}");
+      first = false;
+    }
+    output->concat("],\"receivers\":[");
+    first = true;
+    for (int i = 0; i < subscribers.size(); i++) {
+      EventReceiver* er = subscribers.get(i);
+      if (0 == er->_prof_notify_calls) continue;
+      output->concatf("%s{\"name\":\"%s\",\"calls\":%lu,\"total\":%lu,\"max\":%lu}",
+        (first ? "" : ","),
+        er->getReceiverName(),
+        (unsigned long) er->_prof_notify_calls,
+        (unsigned long) er->_prof_notify_us,
+        (unsigned long) er->_prof_notify_max_us
+      );
+      first = false;
+    }
+    output->concat("]");
+  #endif   // MANUVR_EVENT_PROFILER
+  output->concat("}\n");
+}
+
+
 /**
 * Debug support method. This fxn is only present in debug builds.
 *
@@ -979,12 +1557,19 @@ void Kernel::printProfiler(StringBuilder* output) {
 */
 void Kernel::printScheduler(StringBuilder* output) {
   output->concat("-- SCHEDULER\n");
-  output->concatf("-- _ms_elapsed         %u\n", (unsigned long) _ms_elapsed);
+  output->concatf("-- _ms_elapsed         %lu\n", (unsigned long) _ms_elapsed);
+  output->concatf("-- Scheduler clock:    %lu\n", (unsigned long) _sched_clock);
+  _sched_take();
+  output->concatf("-- Armed schedules:    %lu\n", (unsigned long) _sched_heap_size);
+  if (_sched_heap_size > 0) {
+    output->concatf("-- Next deadline in:   %d\n", (int32_t) (_sched_heap[0]->_sched_deadline - _sched_clock));
+  }
+  _sched_give();
   output->concatf("-- Total schedules:    %d\n-- Active schedules:   %d\n\n", schedules.size(), countActiveSchedules());
-  if (lagged_schedules)    output->concatf("-- Lagged schedules:   %u\n", (unsigned long) lagged_schedules);
-  if (_skips_observed)     output->concatf("-- Scheduler skips:    %u\n", (unsigned long) _skips_observed);
+  if (lagged_schedules)    output->concatf("-- Lagged schedules:   %lu\n", (unsigned long) lagged_schedules);
+  if (_skips_observed)     output->concatf("-- Scheduler skips:    %lu\n", (unsigned long) _skips_observed);
   if (_er_flag(MKERNEL_FLAG_SKIP_FAILSAFE)) {
-    output->concatf("-- %u skips before fail-to-bootloader.\n", (unsigned long) MAXIMUM_SEQUENTIAL_SKIPS);
+    output->concatf("-- %lu skips before fail-to-bootloader.\n", (unsigned long) MAXIMUM_SEQUENTIAL_SKIPS);
   }
 
   #if defined(MANUVR_DEBUG)
@@ -1008,10 +1593,16 @@ void Kernel::printDebug(StringBuilder* output) {
   if (subscribers.size() > 0) {
     output->concatf("-- Subscribers: (%d total):\n", subscribers.size());
     for (int i = 0; i < subscribers.size(); i++) {
-      output->concatf("\t %d: %s\n", i, subscribers.get(i)->getReceiverName());
+      EventReceiver* er = subscribers.get(i);
+      output->concatf("\t %d: %s%s\n", i, er->getReceiverName(), (nullptr == er->msgCodesOfInterest()) ? "  (all codes)" : "");
     }
     output->concat("\n");
   }
+  output->concatf("-- Dispatch table:      %lu codes\n", (unsigned long) _dispatch_table.size());
+  output->concat("-- Msg slab:\n");
+  _msg_slab.printDebug(output);
+  output->concat("-- Argument slab:\n");
+  Argument::printArena(output);
 }
 
 
@@ -1081,6 +1672,29 @@ int8_t Kernel::callback_proc(ManuvrMsg* event) {
 
 
 
+/**
+* The Kernel only acts on a handful of broadcast codes.
+*
+* @return A list of message codes, terminated by MANUVR_MSG_UNDEFINED.
+*/
+const uint16_t* Kernel::msgCodesOfInterest() {
+  static const uint16_t codes[] = {
+    MANUVR_MSG_SYS_REBOOT,
+    MANUVR_MSG_SYS_SHUTDOWN,
+    MANUVR_MSG_SYS_BOOTLOADER,
+    MANUVR_MSG_LEGEND_MESSAGES,
+    MANUVR_MSG_SYS_CONF_SAVE,
+    #if defined (__BUILD_HAS_THREADS)
+      MANUVR_MSG_CREATED_THREAD_ID,
+      MANUVR_MSG_DESTROYED_THREAD_ID,
+      MANUVR_MSG_UNBLOCK_THREAD,
+    #endif
+    MANUVR_MSG_UNDEFINED
+  };
+  return codes;
+}
+
+
 int8_t Kernel::notify(ManuvrMsg* active_runnable) {
   int8_t return_value = 0;
 
@@ -1180,6 +1794,8 @@ ManuvrMsg* Kernel::createSchedule(uint32_t sch_period, int16_t recurrence, bool
         return_value->isScheduled(true);
         return_value->incRefs();
         schedules.insert(return_value);
+        _sched_arm(return_value, true);
+        _sched_wake();
       }
     }
   }
@@ -1201,6 +1817,8 @@ ManuvrMsg* Kernel::createSchedule(uint32_t sch_period, int16_t recurrence, bool
       return_value->isScheduled(true);
       return_value->incRefs();
       schedules.insert(return_value);
+      _sched_arm(return_value, true);
+      _sched_wake();
     }
   }
   return return_value;
@@ -1245,6 +1863,7 @@ void Kernel::advanceScheduler(unsigned int ms_elapsed) {
 bool Kernel::removeSchedule(ManuvrMsg* obj) {
   if (obj) {
     if (obj != current_event) {
+      _sched_disarm(obj);
       obj->isScheduled(false);
       obj->decRefs();
       schedules.remove(obj);
@@ -1265,6 +1884,8 @@ bool Kernel::addSchedule(ManuvrMsg* obj) {
       obj->isScheduled(true);
       obj->incRefs();
       schedules.insert(obj);
+      _sched_arm(obj, true);
+      _sched_wake();
     }
     return true;
   }
@@ -1277,38 +1898,55 @@ bool Kernel::addSchedule(ManuvrMsg* obj) {
 *  tasks into idle CPU time. If many scheduled items have fired, function
 *  will churn through all of them. The presumption is that they are
 *  latency-sensitive.
+* Only schedules that are due are visited. Everything else sits in the heap
+*  until the scheduler clock passes its deadline.
 */
 int Kernel::serviceSchedules() {
   if (!platform.booted() || (0 == _ms_elapsed)) return -1;
   int return_value = 0;
   uint32_t mse = _ms_elapsed;  // Concurrency....
   _ms_elapsed = 0;
-
-  int x = schedules.size();
-  for (int i = 0; i < x; i++) {
-    ManuvrMsg* current = schedules.recycle();
+  _sched_take();
+  _sched_clock += mse;
+
+  while ((_sched_heap_size > 0) && !_sched_earlier(_sched_clock, _sched_heap[0]->_sched_deadline)) {
+    ManuvrMsg* current = _sched_heap[0];
+    // Give the schedule the time it has waited since it was armed. This is
+    //   always enough to make it fire, and preserves the jitter accounting.
+    const uint32_t overshoot = _sched_clock - current->_sched_deadline;
+    _sched_give();  // Nothing below may hold the lock across a callout.
     if (current->scheduleEnabled()) {
-      switch (current->applyTime(mse)) {
+      switch (current->applyTime(current->_sched_ttw + overshoot)) {
         case 1:   // Schedule should be exec'd and retained.
           Kernel::staticRaiseEvent(current);
+          _sched_arm(current, true);
           break;
         case -1:  // Schedule should be dropped and executed.
           Kernel::staticRaiseEvent(current);
         case -2:  // Schedule should be dropped without execution.
           removeSchedule(current);
-          x--;
           break;
         case 0:   // Nominal outcome. No action.
         default:  // Nonsense.
+          _sched_arm(current, true);
           break;
       }
+      return_value++;
     }
     else if (current->shouldFire()) {
       // If the schedule was one-shot without being enabled.
       current->shouldFire(false);    // Mark it as serviced.
+      _sched_disarm(current);
       Kernel::staticRaiseEvent(current);
+      return_value++;
+    }
+    else {
+      // Nothing about this schedule is pending. It shouldn't be armed.
+      _sched_disarm(current);
     }
+    _sched_take();
   }
+  _sched_give();
 
   // We just ran a loop. Punch the bistable swtich.
   _skip_detected(false);
@@ -1318,6 +1956,203 @@ int Kernel::serviceSchedules() {
 }
 
 
+/**
+* Code that may be reached from a transport's thread can use this to decide
+*   whether it may touch Kernel-owned state directly.
+*
+* @return true if the caller is the Kernel's thread. Always true on builds
+*           without threads.
+*/
+bool Kernel::onKernelThread() {
+  #if defined(__BUILD_HAS_PTHREADS)
+    return (0 != pthread_equal(_owner, pthread_self()));
+  #else
+    return true;
+  #endif
+}
+
+
+/**
+* Called by ManuvrMsg when any of a schedule's timing parameters change, so
+*   that its position in the heap remains truthful. Safe to call from any
+*   thread.
+*
+* If called from some other thread, a sleeping Kernel is woken. See _sched_wake().
+*
+* @param  obj     The schedule that changed.
+* @param  retime  If false, an armed schedule keeps whatever time it has left,
+*                   unless its TTW is now shorter than that.
+*/
+void Kernel::rekeySchedule(ManuvrMsg* obj, bool retime) {
+  if ((nullptr != INSTANCE) && (nullptr != obj)) {
+    INSTANCE->_sched_arm(obj, retime);
+    _sched_wake();
+  }
+}
+
+
+/**
+* A schedule was armed or re-timed. If that happened on some other thread, the
+*   Kernel may be asleep on a deadline that is no longer the soonest. Wake it,
+*   so that it can re-time its wait. As with staticRaiseEvent(),
+*   _wait_for_work() does the mirror-image of this.
+*/
+void Kernel::_sched_wake() {
+  #if defined(__BUILD_HAS_PTHREADS)
+    if (!pthread_equal(_owner, pthread_self())) {
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (__atomic_load_n(&_sleeping, __ATOMIC_RELAXED)) kernelWake();
+    }
+  #endif
+}
+
+
+/**
+* How long until the given schedule fires? For an armed schedule, this is
+*   measured against its deadline, since its TTW is only refreshed when it is
+*   (re)armed.
+*
+* @param  obj  The schedule in question.
+* @return Milliseconds until the schedule fires.
+*/
+uint32_t Kernel::scheduleRemaining(ManuvrMsg* obj) {
+  uint32_t return_value = obj->_sched_ttw;
+  if (nullptr != INSTANCE) {
+    _sched_take();
+    if (0 <= obj->_sched_heap_idx) {
+      const int32_t left = (int32_t) (obj->_sched_deadline - INSTANCE->_sched_clock);
+      return_value = (left > 0) ? (uint32_t) left : 0;
+    }
+    _sched_give();
+  }
+  return return_value;
+}
+
+
+void Kernel::_sched_take() {
+  #if defined(__BUILD_HAS_PTHREADS)
+    pthread_mutex_lock(&_sched_lock);
+  #endif
+}
+
+
+void Kernel::_sched_give() {
+  #if defined(__BUILD_HAS_PTHREADS)
+    pthread_mutex_unlock(&_sched_lock);
+  #endif
+}
+
+
+void Kernel::_sched_arm(ManuvrMsg* obj, bool retime) {
+  _sched_take();
+  _sched_arm_locked(obj, retime);
+  _sched_give();
+}
+
+
+void Kernel::_sched_disarm(ManuvrMsg* obj) {
+  _sched_take();
+  _sched_disarm_locked(obj);
+  _sched_give();
+}
+
+
+/**
+* Computes the deadline for the given schedule from its state, and places it
+*   in the heap accordingly. Schedules that have nothing pending are removed
+*   from the heap, but remain in the schedules list.
+* Caller must hold the schedule lock.
+*
+* @param  obj     The schedule to (re)arm.
+* @param  retime  Start the schedule's TTW over from now?
+*/
+void Kernel::_sched_arm_locked(ManuvrMsg* obj, bool retime) {
+  if (obj->shouldFire()) {
+    obj->_sched_deadline = _sched_clock;   // Next tick.
+  }
+  else if (obj->scheduleEnabled()) {
+    if (!retime && (0 <= obj->_sched_heap_idx)) {
+      // Already counting down. Don't lose the time it has already waited.
+      const int32_t left = (int32_t) (obj->_sched_deadline - _sched_clock);
+      const uint32_t remaining = (left > 0) ? (uint32_t) left : 0;
+      if (remaining < obj->_sched_ttw) obj->_sched_ttw = remaining;
+    }
+    obj->_sched_deadline = _sched_clock + obj->_sched_ttw;
+  }
+  else {
+    _sched_disarm_locked(obj);
+    return;
+  }
+
+  if (obj->_sched_heap_idx < 0) {
+    if (_sched_heap_size == _sched_heap_cap) {
+      // Grow the heap geometrically. This is the only allocation the scheduler does.
+      uint32_t nu_cap = (0 == _sched_heap_cap) ? 16 : (_sched_heap_cap << 1);
+      ManuvrMsg** nu_heap = (ManuvrMsg**) realloc(_sched_heap, nu_cap * sizeof(ManuvrMsg*));
+      if (nullptr == nu_heap) return;   // Schedule will not run. Nothing else we can do.
+      _sched_heap     = nu_heap;
+      _sched_heap_cap = nu_cap;
+    }
+    _sched_place(_sched_heap_size, obj);
+    _sched_sift_up(_sched_heap_size++);
+  }
+  else {
+    // Already armed. The deadline might have moved in either direction.
+    uint32_t idx = (uint32_t) obj->_sched_heap_idx;
+    _sched_sift_up(idx);
+    _sched_sift_down((uint32_t) obj->_sched_heap_idx);
+  }
+}
+
+
+/**
+* Removes the given schedule from the heap, if it is there.
+* Caller must hold the schedule lock.
+*
+* @param  obj  The schedule to disarm.
+*/
+void Kernel::_sched_disarm_locked(ManuvrMsg* obj) {
+  if (obj->_sched_heap_idx < 0) return;
+  uint32_t idx = (uint32_t) obj->_sched_heap_idx;
+  obj->_sched_heap_idx = -1;
+  if (--_sched_heap_size != idx) {
+    // Backfill the hole with the last element and restore the heap property.
+    ManuvrMsg* moved = _sched_heap[_sched_heap_size];
+    _sched_place(idx, moved);
+    _sched_sift_up(idx);
+    _sched_sift_down((uint32_t) moved->_sched_heap_idx);
+  }
+}
+
+
+void Kernel::_sched_sift_up(uint32_t idx) {
+  ManuvrMsg* obj = _sched_heap[idx];
+  while (idx > 0) {
+    uint32_t parent = (idx - 1) >> 1;
+    if (!_sched_earlier(obj->_sched_deadline, _sched_heap[parent]->_sched_deadline)) break;
+    _sched_place(idx, _sched_heap[parent]);
+    idx = parent;
+  }
+  _sched_place(idx, obj);
+}
+
+
+void Kernel::_sched_sift_down(uint32_t idx) {
+  ManuvrMsg* obj = _sched_heap[idx];
+  while (true) {
+    uint32_t child = (idx << 1) + 1;
+    if (child >= _sched_heap_size) break;
+    if (((child + 1) < _sched_heap_size) && _sched_earlier(_sched_heap[child + 1]->_sched_deadline, _sched_heap[child]->_sched_deadline)) {
+      child++;
+    }
+    if (!_sched_earlier(_sched_heap[child]->_sched_deadline, obj->_sched_deadline)) break;
+    _sched_place(idx, _sched_heap[child]);
+    idx = child;
+  }
+  _sched_place(idx, obj);
+}
+
+
 #if defined(MANUVR_CONSOLE_SUPPORT)
 /*******************************************************************************
 * Console I/O
@@ -1334,12 +2169,14 @@ static const ConsoleCommand console_cmds[] = {
   { "i1", "Build" },
   { "i2", "Profiler" },
   { "i3", "Platform" },
+  { "i4", "Profiler (JSON)" },
   { "i5", "Scheduler" },
   { "i6", "Supported notions of identity" },
   { "i7", "Our Identity" },
   #if defined(__HAS_CRYPT_WRAPPER)
     { "c", "Cryptoburrito" },
   #endif //__HAS_CRYPT_WRAPPER
+  { "d", "Dispatch policy" },
   { "P", "Enable profiling" },
   { "p", "Disable profiling" },
   { "b", "Reboot" },
@@ -1387,6 +2224,27 @@ void Kernel::consoleCmdProc(StringBuilder* input) {
       profiler('P' == c);
       break;
 
+    case 'd':    // Dispatch policy.
+      if (input->count() > 2) {
+        const char* param = (const char*) input->position(1);
+        temp_int = input->position_as_int(2);
+        switch (*param) {
+          case 'n':   maxEventsPerLoop((int8_t) temp_int);   break;
+          case 'b':   dispatchBudget((uint32_t) temp_int);   break;
+          case 'a':   dispatchMaxAge((uint32_t) temp_int);   break;
+          case 'q':
+            if (bandQuota((uint8_t) temp_int, (uint8_t) ((input->count() > 3) ? input->position_as_int(3) : 0))) {
+              local_log.concatf("No such priority band: %d\n", temp_int);
+            }
+            break;
+          default:
+            local_log.concat("Usage: d [n <events> | b <us> | a <us> | q <band> <quota>]\n");
+            break;
+        }
+      }
+      printDispatchPolicy(&local_log);
+      break;
+
     case 'y':    // Power mode.
       {
         ManuvrMsg* event = returnEvent(MANUVR_MSG_SYS_POWER_MODE);
@@ -1432,6 +2290,10 @@ void Kernel::consoleCmdProc(StringBuilder* input) {
           platform.printDebug(&local_log);
           break;
 
+        case 4:
+          exportProfiler(&local_log);
+          break;
+
         case 5:
           printScheduler(&local_log);
           break;
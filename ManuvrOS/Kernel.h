@@ -36,12 +36,14 @@ limitations under the License.
   #include "Utilities.h"
   #include "EnumeratedTypeCodes.h"
   #include "PriorityQueue.h"
-  #include "ElementPool.h"
   #include "StringBuilder.h"
   #include "AbstractPlatform.h"
   #include "StopWatch.h"
 
   #include <EventReceiver.h>
+  #include <DataStructures/MPSCRing.h>
+  #include <DataStructures/ListenerTable.h>
+  #include <DataStructures/Slab.h>
   #ifdef MANUVR_CONSOLE_SUPPORT
     #include <XenoSession/Console/ConsoleInterface.h>
   #endif
@@ -56,6 +58,34 @@ limitations under the License.
   #define MKERNEL_FLAG_SKIP_FAILSAFE 0x04    // Too many skips will send us to the bootloader.
   #define MKERNEL_FLAG_PENDING_PIPE  0x08    // There is Pipe I/O pending.
   #define MKERNEL_FLAG_IDLE          0x10    // The kernel is idle.
+  #define MKERNEL_FLAG_DISPATCH_DIRTY 0x20   // The subscriber dispatch table needs rebuilding.
+
+  /*
+  * For the sake of the dispatch policy, event priorities are grouped into bands.
+  *   Band 0: Above EVENT_PRIORITY_DEFAULT. Latency-critical.
+  *   Band 1: Above EVENT_PRIORITY_LOWEST.
+  *   Band 2: EVENT_PRIORITY_LOWEST. Bulk traffic.
+  */
+  #define KERNEL_PRIORITY_BANDS      3
+  #define KERNEL_DISPATCH_HOLD      16    // Events per call that band quotas may set aside.
+  #define KERNEL_AGING_BATCH         8    // Most aged events promoted per call.
+  #define KERNEL_LATENCY_BUCKETS    24    // Log2 buckets of queue latency, in microseconds.
+  #define KERNEL_PROFILER_BUCKETS   16    // Log2 buckets of event run time, in microseconds.
+
+  #if defined(MANUVR_EVENT_PROFILER)
+    /* The profiler's record of what it costs to run a given message code. */
+    typedef struct {
+      uint16_t code;         // MANUVR_MSG_UNDEFINED marks an empty slot.
+      uint32_t executions;   // How many times has this code run?
+      uint32_t min_us;       // Cheapest run.
+      uint32_t max_us;       // Most expensive run.
+      uint64_t total_us;     // Sum of all runs. Mean is derived from this.
+      uint32_t hist[KERNEL_PROFILER_BUCKETS];
+    } MsgCostRecord;
+
+    // The table is probed with a mask, rather than a modulus.
+    static_assert((KERNEL_PROFILER_SLOTS > 0) && (0 == (KERNEL_PROFILER_SLOTS & (KERNEL_PROFILER_SLOTS - 1))), "KERNEL_PROFILER_SLOTS must be a power of two.");
+  #endif
 
 
   #ifdef __cplusplus
@@ -76,6 +106,17 @@ limitations under the License.
   *
   ****************************************************************************************************/
 
+  /*
+  * A flat list of the EventReceivers that should be notified of a given message
+  *   code, in subscription-priority order. Slots are set to nullptr if a receiver
+  *   unsubscribes while the list might be in use.
+  */
+  typedef struct er_dispatch_list_t {
+    uint16_t        count;      // How many slots are in the list?
+    EventReceiver** receivers;  // The receivers themselves.
+  } ERDispatchList;
+
+
   /*
   * This class is the machinery that handles Events. It should probably only be instantiated once.
   */
@@ -118,6 +159,8 @@ limitations under the License.
       inline int8_t on(uint16_t msgCode, listenerFxnPtr cb, uint32_t options) {
         return registerCallbacks(msgCode, nullptr, cb, options);
       };
+      /* Safe to call from within a listener. */
+      int8_t unregisterCallbacks(uint16_t msgCode, listenerFxnPtr ca, listenerFxnPtr cb);
 
 
       // TODO: These members were ingested from the Scheduler.
@@ -139,6 +182,7 @@ limitations under the License.
       * These are the core functions of the kernel that must be called from outside.
       */
       int8_t procIdleFlags();                  // Execute pending Msgs.
+      int serviceSchedules();                  // Prep any schedules that have come due for exec.
       void advanceScheduler(unsigned int);     // Push all scheduled Msgs forward by one tick.
       inline void advanceScheduler() {   advanceScheduler(MANUVR_PLATFORM_TIMER_PERIOD_MS);  };
 
@@ -150,17 +194,41 @@ limitations under the License.
 
       void profiler(bool enabled);
       void printProfiler(StringBuilder*);
+      void exportProfiler(StringBuilder*);
 
+      /*
+      * Dispatch policy. Zero disables the time budget, aging, or a band quota.
+      *   At least one event runs per call, so zero events per call means one.
+      */
       inline void maxEventsPerLoop(int8_t nu) { max_events_per_loop = (nu > 0) ? nu : 1; }
       inline int8_t maxEventsPerLoop() {        return max_events_per_loop; }
-      inline int queueSize() {                  return INSTANCE->exec_queue.size();     }
-      inline bool containsPreformedEvent(ManuvrMsg* event) {   return exec_queue.contains(event);  };
+      inline void dispatchBudget(uint32_t us) {  _dispatch_budget_us = us;     };
+      inline uint32_t dispatchBudget() {         return _dispatch_budget_us;   };
+      inline void dispatchMaxAge(uint32_t us) {
+        _dispatch_max_age_us = us;
+        if (0 == us) _aging.clear();   // Nothing to track.
+      };
+      inline uint32_t dispatchMaxAge() {         return _dispatch_max_age_us;  };
+      int8_t bandQuota(uint8_t band, uint8_t quota);
+      inline uint8_t bandQuota(uint8_t band) {   return ((band < KERNEL_PRIORITY_BANDS) ? _band_quota[band] : 0);  };
+      void printDispatchPolicy(StringBuilder*);
+      uint32_t queueLatency(uint8_t band, uint8_t percentile);
+
+      inline int queueSize() {
+        #if defined(__BUILD_HAS_PTHREADS)
+          return (INSTANCE->exec_queue.size() + INSTANCE->_held_count + _ingress.count() + __atomic_load_n(&_overflow_count, __ATOMIC_ACQUIRE));
+        #else
+          return (INSTANCE->exec_queue.size() + INSTANCE->_held_count + _ingress.count());
+        #endif
+      }
+      inline bool containsPreformedEvent(ManuvrMsg* event) {   return (exec_queue.contains(event) || _is_held(event));  };
       inline bool idle() {                     return (_er_flag(MKERNEL_FLAG_IDLE));              };
 
       /* Overrides from EventReceiver
          Just gracefully fall into those when needed. */
       int8_t notify(ManuvrMsg*);
       int8_t callback_proc(ManuvrMsg*);
+      const uint16_t* msgCodesOfInterest();
       void printDebug(StringBuilder*);
 
 
@@ -180,6 +248,9 @@ limitations under the License.
       static bool   abortEvent(ManuvrMsg* event);
       static int8_t isrRaiseEvent(ManuvrMsg* event);
       static void   nextTick(BufferPipe*);
+      static void   rekeySchedule(ManuvrMsg*, bool retime);
+      static uint32_t scheduleRemaining(ManuvrMsg*);
+      static bool   onKernelThread();  // Is the caller the thread that runs procIdleFlags()?
 
       /* Returns a preallocated ManuvrMsg. */
       static ManuvrMsg* returnEvent(uint16_t event_code);
@@ -188,17 +259,25 @@ limitations under the License.
 
 
     private:
-      ManuvrMsg _preallocation_pool[EVENT_MANAGER_PREALLOC_COUNT];
+      alignas(ManuvrMsg) uint8_t _preallocation_pool[EVENT_MANAGER_PREALLOC_COUNT * sizeof(ManuvrMsg)];
       ManuvrMsg* current_event = nullptr;  // The presently-executing event.
-      ElementPool<ManuvrMsg>           _msg_prealloc; // This is the listing of pre-allocated Msgs.
+      Slab                             _msg_slab;     // Msgs come from here. Starts with the preallocation.
       PriorityQueue<ManuvrMsg*>        exec_queue;    // Msgs that are pending execution.
       PriorityQueue<ManuvrMsg*>        schedules;     // These are Msgs scheduled to be run.
+      PriorityQueue<ManuvrMsg*>        _aging;        // Queued Msgs, oldest first. Kept only while aging is on.
+      ManuvrMsg* _held[KERNEL_DISPATCH_HOLD];         // Msgs that band quotas set aside during this call.
+      uint8_t    _held_count = 0;
+      ManuvrMsg** _sched_heap      = nullptr;  // Armed schedules. Binary min-heap keyed on deadline.
+      uint32_t    _sched_heap_size = 0;        // How many schedules are armed?
+      uint32_t    _sched_heap_cap  = 0;        // How many slots are allocated in the heap?
+      uint32_t    _sched_clock     = 0;        // Scheduler time (ms). Advanced by serviceSchedules().
 
       PriorityQueue<BufferPipe*>       _pipe_io_pend; // Pending BufferPipe transfers that wish to be async.
-      PriorityQueue<StopWatch*>        event_costs;   // Message code is the priority. Calculates average cost in uS.
       PriorityQueue<EventReceiver*>    subscribers;   // Our manifest of EventReceivers we service.
-      std::map<uint16_t, PriorityQueue<listenerFxnPtr>*> ca_listeners;  // Call-ahead listeners.
-      std::map<uint16_t, PriorityQueue<listenerFxnPtr>*> cb_listeners;  // Call-back listeners.
+      ListenerTable<ManuvrMsg*>        ca_listeners;  // Call-ahead listeners.
+      ListenerTable<ManuvrMsg*>        cb_listeners;  // Call-back listeners.
+      std::map<uint16_t, ERDispatchList*> _dispatch_table;     // Receivers that declared interest, by code.
+      ERDispatchList _dispatch_wildcard = {0, nullptr};       // Receivers that want every code.
 
       uint32_t _ms_elapsed        = 0; // How much time has passed since we serviced our schedules?
       uint32_t _skips_observed    = 0; // How many sequential scheduler skips have we noticed?
@@ -213,24 +292,82 @@ limitations under the License.
       uint16_t consequtive_idles;      // How many consecutive idle loops?
       uint16_t max_idle_count;         // How many consecutive idle loops before we act?
       uint32_t insertion_denials;      // How many times have we rejected events?
+      uint32_t notify_calls       = 0; // How many times have we called notify() on a broadcast?
+      uint32_t notify_calls_saved = 0; // How many notify() calls did the dispatch table spare us?
 
 
       uint8_t  max_events_p_loop;     // What is the most events we've handled in a single loop?
       int8_t   max_events_per_loop;
 
+      /* Dispatch policy and its measurement. */
+      uint32_t _dispatch_budget_us  = KERNEL_DISPATCH_BUDGET_US;   // Per-call time budget.
+      uint32_t _dispatch_max_age_us = KERNEL_DISPATCH_MAX_AGE_US;  // Queue age that overrides priority.
+      uint32_t _aged_promotions     = 0;   // How many events were run early because of their age?
+      uint32_t _quota_deferrals     = 0;   // How many calls ended with work deferred by band quotas?
+      uint8_t  _band_quota[KERNEL_PRIORITY_BANDS];   // Max events per call, by band.
+      uint32_t _queue_lat_hist[KERNEL_PRIORITY_BANDS][KERNEL_LATENCY_BUCKETS];
+
+      #if defined(MANUVR_EVENT_PROFILER)
+        MsgCostRecord _msg_costs[KERNEL_PROFILER_SLOTS];   // Open-addressed by message code.
+        uint32_t      _msg_costs_untracked = 0;   // Events that found the table full.
+        MsgCostRecord* _msg_cost_record(uint16_t code);
+        void _clear_msg_costs();
+        static void _note_msg_cost(MsgCostRecord*, uint32_t us);
+        static uint32_t _msg_cost_percentile(MsgCostRecord*, uint8_t percentile);
+      #endif
+
       int8_t procCallAheads(ManuvrMsg* active_event);
       int8_t procCallBacks(ManuvrMsg* active_event);
 
+      /* Subscriber dispatch table. */
+      ERDispatchList* _dispatch_list(uint16_t code);
+      void _dispatch_rebuild();
+      void _dispatch_free();
+      void _dispatch_forget(EventReceiver*);
+
       unsigned int countActiveSchedules();  // How many active schedules are present?
-      int serviceSchedules();         // Prep any schedules that have come due for exec.
+
+      /* Schedule heap management. */
+      void _sched_arm(ManuvrMsg*, bool retime);  // (Re)compute the deadline and position of a schedule.
+      void _sched_disarm(ManuvrMsg*);   // Remove a schedule from the heap.
+      void _sched_arm_locked(ManuvrMsg*, bool retime);
+      void _sched_disarm_locked(ManuvrMsg*);
+      void _sched_sift_up(uint32_t);
+      void _sched_sift_down(uint32_t);
+      inline void _sched_place(uint32_t idx, ManuvrMsg* obj) {
+        _sched_heap[idx] = obj;
+        obj->_sched_heap_idx = (int32_t) idx;
+      };
+      /* Wrap-safe deadline comparison. True if a is due before b. */
+      inline static bool _sched_earlier(uint32_t a, uint32_t b) {  return ((int32_t) (a - b) < 0);  };
 
       int8_t validate_insertion(ManuvrMsg*);
+      ManuvrMsg* _dispatch_next(uint8_t* band_counts);
+      void   _promote_aged_events();
+      void   _restore_held();
+      bool   _is_held(ManuvrMsg*);
+      void   _clear_latency_stats();
+      int    _ingress_drain();
+      int8_t _insert_now(ManuvrMsg*);
+      void     _wait_for_work(bool may_sleep);
+      uint32_t _ms_until_next_schedule();
       void reclaim_event(ManuvrMsg*);
+      ManuvrMsg* _msg_take();
+      void       _msg_give(ManuvrMsg*);
       inline void update_maximum_queue_depth() {   max_queue_depth = (exec_queue.size() > (int) max_queue_depth) ? exec_queue.size() : max_queue_depth;   };
 
 
-      /*  */
-      inline bool should_run_another_event(int8_t loops, uint32_t begin) {     return (max_events_per_loop ? ((int8_t) max_events_per_loop > loops) : ((micros() - begin) < 1200));   };
+      /* The first event always runs. Beyond that, the policy's count and time limits apply. */
+      inline bool should_run_another_event(int8_t loops, uint32_t begin) {
+        if (0 == loops) return true;
+        if (loops >= max_events_per_loop) return false;
+        return ((0 == _dispatch_budget_us) || (wrap_accounted_delta(begin, micros()) < _dispatch_budget_us));
+      };
+
+      /* Which priority band does the given event priority belong to? */
+      inline static uint8_t _priority_band(uint8_t pri) {
+        return ((pri > EVENT_PRIORITY_DEFAULT) ? 0 : ((pri > EVENT_PRIORITY_LOWEST) ? 1 : 2));
+      };
 
       inline bool _profiler_enabled() {         return (_er_flag(MKERNEL_FLAG_PROFILING));            };
       inline void _profiler_enabled(bool nu) {  return (_er_set_flag(MKERNEL_FLAG_PROFILING, nu));    };
@@ -238,10 +375,25 @@ limitations under the License.
       inline void _skip_detected(bool nu) {     return (_er_set_flag(MKERNEL_FLAG_SKIP_DETECT, nu));  };
       inline bool _pending_pipes() {            return (_er_flag(MKERNEL_FLAG_PENDING_PIPE));         };
       inline void _pending_pipes(bool nu) {     return (_er_set_flag(MKERNEL_FLAG_PENDING_PIPE, nu)); };
+      inline bool _dispatch_dirty() {           return (_er_flag(MKERNEL_FLAG_DISPATCH_DIRTY));         };
+      inline void _dispatch_dirty(bool nu) {    return (_er_set_flag(MKERNEL_FLAG_DISPATCH_DIRTY, nu)); };
       void _idle(bool nu);
 
       static Kernel*     INSTANCE;
-      static PriorityQueue<ManuvrMsg*> isr_exec_queue;   // Events that have been raised from ISRs.
+      static MPSCRing<ManuvrMsg*, EVENT_MANAGER_INGRESS_DEPTH> _ingress;  // Events raised from any thread or ISR.
+      static uint8_t _sleeping;   // Non-zero while the Kernel may be blocked in kernelWait().
+      #if defined(__BUILD_HAS_PTHREADS)
+        static pthread_t                 _owner;           // The thread that runs procIdleFlags().
+        static pthread_mutex_t           _overflow_lock;
+        static PriorityQueue<ManuvrMsg*> _overflow;        // Events raised while the ring was full.
+        static uint32_t                  _overflow_count;
+        static pthread_mutex_t           _sched_lock;      // Guards the schedule heap and clock.
+      #endif
+
+      /* Schedules may be rekeyed from any thread. */
+      static void _sched_take();
+      static void _sched_give();
+      static void _sched_wake();
 
       static unsigned long _millis_idle;
       static unsigned long _millis_working;
@@ -26,6 +26,7 @@ limitations under the License.
 #include "ManuvrMsg.h"
 #include <string.h>
 #include <Kernel.h>
+#include <Platform/Platform.h>
 
 extern inline double   parseDoubleFromchars(unsigned char *input);
 extern inline float    parseFloatFromchars(unsigned char *input);
@@ -46,6 +47,47 @@ extern inline uint16_t parseUint16Fromchars(unsigned char *input);
 // Runtime manifest of Msg definitions.
 std::map<uint16_t, const MessageTypeDef*> ManuvrMsg::message_defs_extended;
 
+// Hashed indices over all known Msg definitions. Built lazily, and on registration.
+MsgDefIndex* ManuvrMsg::_def_idx     = nullptr;
+uint32_t     ManuvrMsg::_def_readers = 0;
+bool         ManuvrMsg::_def_locked  = false;
+
+/* Hash functions for the definition indices. */
+static inline uint32_t _def_hash_code(uint16_t code) {
+  return ((uint32_t) code * 2654435761u) >> 16;   // Knuth multiplicative.
+}
+
+static inline uint32_t _def_hash_label(const char* label) {
+  uint32_t h = 2166136261u;                       // FNV-1a
+  while (*label) {
+    h = (h ^ (uint8_t) *label++) * 16777619u;
+  }
+  return h;
+}
+
+/*
+* Places a definition into an index that other threads may be probing. Slots
+*   only ever go from empty to full, so a reader sees either nothing, or a
+*   complete definition. Where a code (or label) is already present, the
+*   existing entry wins.
+*/
+static void _def_index_place(MsgDefIndex* idx, const MessageTypeDef* def) {
+  uint32_t i = _def_hash_code(def->msg_type_code) & idx->mask;
+  while ((nullptr != idx->code[i]) && (idx->code[i]->msg_type_code != def->msg_type_code)) {
+    i = (i + 1) & idx->mask;
+  }
+  if (nullptr == idx->code[i]) __atomic_store_n(&idx->code[i], def, __ATOMIC_RELEASE);
+
+  if (nullptr != def->debug_label) {
+    i = _def_hash_label(def->debug_label) & idx->mask;
+    while ((nullptr != idx->label[i]) && (0 != strcmp(idx->label[i]->debug_label, def->debug_label))) {
+      i = (i + 1) & idx->mask;
+    }
+    if (nullptr == idx->label[i]) __atomic_store_n(&idx->label[i], def, __ATOMIC_RELEASE);
+  }
+  idx->count++;
+}
+
 // Generic argument def for a message with no args.
 const unsigned char ManuvrMsg::MSG_ARGS_NONE[] = {0};
 
@@ -62,16 +104,38 @@ bool ManuvrMsg::isExportable(const MessageTypeDef* message_def) {
 /**
 * Called by other classes to add their event definitions to the runtime
 *   manifest.
+* May be called from any thread. New definitions are added to the live index
+*   in place. Definitions that are already registered are skipped, so calling
+*   this again with the same array costs nothing. The index is only rebuilt if
+*   it must grow, or if a definition replaces a different one (and then only
+*   once per call).
 *
 * @param  MessageTypeDef[]  An array of MessageTypeDefs to add.
 * @param  int  The number of MessageTypeDefs in the array.
 * @return 0 on success. Non-zero otherwise.
 */
 int8_t ManuvrMsg::registerMessages(const MessageTypeDef defs[], int mes_count) {
+  int8_t return_value = 0;
+  bool   replaced     = false;
+  _def_lock();
   for (int i = 0; i < mes_count; i++) {
-    message_defs_extended[defs[i].msg_type_code] = &defs[i];
+    const MessageTypeDef*& slot = message_defs_extended[defs[i].msg_type_code];
+    if (&defs[i] == slot) continue;   // Already have this exact def.
+    if (nullptr != slot) {
+      // The index may hold the old def under its code and label. Start over,
+      //   but only after every def in this call is in the map.
+      replaced = true;
+    }
+    slot = &defs[i];
+    if (!replaced && (nullptr != _def_idx)) {
+      return_value = _def_index_add(&defs[i]);
+    }
   }
-  return 0;
+  if (replaced && (nullptr != _def_idx)) {
+    return_value = _def_index_rebuild();
+  }
+  _def_unlock();
+  return return_value;
 }
 
 /**
@@ -82,7 +146,119 @@ int8_t ManuvrMsg::registerMessages(const MessageTypeDef defs[], int mes_count) {
 * @return 0 on success. Non-zero otherwise.
 */
 int8_t ManuvrMsg::registerMessage(MessageTypeDef* nu_def) {
-  message_defs_extended[nu_def->msg_type_code] = nu_def;
+  return registerMessages(nu_def, 1);
+}
+
+
+/**
+* Takes and releases the spinlock that guards registration and the extended
+*   defs. Holders are brief, but might be preempted, so waiters yield.
+*/
+void ManuvrMsg::_def_lock() {
+  while (__atomic_test_and_set(&_def_locked, __ATOMIC_ACQUIRE)) {
+    yieldThread();
+  }
+}
+
+void ManuvrMsg::_def_unlock() {
+  __atomic_clear(&_def_locked, __ATOMIC_RELEASE);
+}
+
+
+/**
+* Gives the live index, building it on first use. A non-null return counts the
+*   caller as a reader of that index until it calls _def_index_done(), and the
+*   index will not be freed before then. Must not be called with the def lock
+*   held.
+*
+* @return The index, or nullptr if it could not be allocated (lookups will
+*           fall back to scanning).
+*/
+MsgDefIndex* ManuvrMsg::_def_index() {
+  __atomic_add_fetch(&_def_readers, 1, __ATOMIC_SEQ_CST);
+  MsgDefIndex* idx = __atomic_load_n(&_def_idx, __ATOMIC_SEQ_CST);
+  if (nullptr == idx) {
+    // A rebuild waits for readers under the lock. So we can't be one while we
+    //   wait for it.
+    __atomic_sub_fetch(&_def_readers, 1, __ATOMIC_RELEASE);
+    _def_lock();
+    if (nullptr == _def_idx) _def_index_rebuild();
+    _def_unlock();
+    __atomic_add_fetch(&_def_readers, 1, __ATOMIC_SEQ_CST);
+    idx = __atomic_load_n(&_def_idx, __ATOMIC_SEQ_CST);
+    if (nullptr == idx) _def_index_done();
+  }
+  return idx;
+}
+
+/**
+* Marks the end of a lookup that was given an index by _def_index().
+*/
+void ManuvrMsg::_def_index_done() {
+  __atomic_sub_fetch(&_def_readers, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+* Builds new code and label indices over the static and extended defs, and
+*   publishes them. Both tables are open-addressed with linear probing, and are
+*   kept at no more than half-full. Where a code (or label) is defined more
+*   than once, the static definition wins, as it always has.
+* Must be called with the def lock held. The index being replaced is freed once
+*   no lookup is still probing it. Lookups are short, and rebuilds are rare: it
+*   happens when the index doubles, or when a def is replaced.
+*
+* @return 0 on success. -1 on allocation failure (lookups will fall back to scanning).
+*/
+int8_t ManuvrMsg::_def_index_rebuild() {
+  const uint32_t def_count = TOTAL_MSG_DEFS + message_defs_extended.size();
+  uint32_t cap = 16;
+  while (cap < (def_count << 1)) cap <<= 1;
+
+  MsgDefIndex* nu = nullptr;
+  if (cap <= 0x8000) {
+    // One allocation holds the struct and both tables.
+    const size_t sz = sizeof(MsgDefIndex) + (2 * cap * sizeof(MessageTypeDef*));
+    nu = (MsgDefIndex*) malloc(sz);
+  }
+  if (nullptr != nu) {
+    memset(nu, 0, sizeof(MsgDefIndex) + (2 * cap * sizeof(MessageTypeDef*)));
+    nu->mask  = cap - 1;
+    nu->code  = (const MessageTypeDef**) (nu + 1);
+    nu->label = nu->code + cap;
+
+    for (uint32_t n = 0; n < TOTAL_MSG_DEFS; n++) {
+      _def_index_place(nu, &message_defs[n]);
+    }
+    std::map<uint16_t, const MessageTypeDef*>::iterator it;
+    for (it = message_defs_extended.begin(); it != message_defs_extended.end(); it++) {
+      if (nullptr != it->second) _def_index_place(nu, it->second);
+    }
+  }
+
+  MsgDefIndex* old = __atomic_exchange_n(&_def_idx, nu, __ATOMIC_SEQ_CST);
+  if (nullptr != old) {
+    // Anyone who counted themselves in after the exchange got the new index.
+    while (0 != __atomic_load_n(&_def_readers, __ATOMIC_SEQ_CST)) {
+      yieldThread();
+    }
+    free(old);
+  }
+  return (nullptr != nu) ? 0 : -1;
+}
+
+
+/**
+* Adds a single def to the live index, unless that would take it past
+*   half-full. Must be called with the def lock held.
+*
+* @return 0 on success. -1 on allocation failure.
+*/
+int8_t ManuvrMsg::_def_index_add(const MessageTypeDef* def) {
+  if (((_def_idx->count + 1) << 1) > (_def_idx->mask + 1)) {
+    return _def_index_rebuild();
+  }
+  _def_index_place(_def_idx, def);
   return 0;
 }
 
@@ -120,19 +296,7 @@ int8_t ManuvrMsg::registerMessage(uint16_t tc, uint16_t tf, const char* lab, con
 * @return a pointer to the human-readable label for this Msg code. Never nullptr.
 */
 const char* ManuvrMsg::getMsgTypeString(uint16_t code) {
-  for (int i = 0; i < TOTAL_MSG_DEFS; i++) {
-    if (ManuvrMsg::message_defs[i].msg_type_code == code) {
-      return ManuvrMsg::message_defs[i].debug_label;
-    }
-  }
-
-  // Didn't find it there. Search in the extended defs...
-  const MessageTypeDef* temp_type_def = message_defs_extended[code];
-  if ( temp_type_def) {
-    return temp_type_def->debug_label;
-  }
-  // If we've come this far, we don't know what the caller is asking for. Return the default.
-  return ManuvrMsg::message_defs[0].debug_label;
+  return lookupMsgDefByCode(code)->debug_label;
 }
 
 
@@ -144,29 +308,64 @@ const char* ManuvrMsg::getMsgTypeString(uint16_t code) {
 * @return a pointer to the MessageTypeDef for this Msg code. Never nullptr.
 */
 const MessageTypeDef* ManuvrMsg::lookupMsgDefByCode(uint16_t code) {
+  MsgDefIndex* idx = _def_index();
+  if (nullptr != idx) {
+    uint32_t i = _def_hash_code(code) & idx->mask;
+    const MessageTypeDef* def;
+    while (nullptr != (def = __atomic_load_n(&idx->code[i], __ATOMIC_ACQUIRE))) {
+      if (def->msg_type_code == code) {
+        break;
+      }
+      i = (i + 1) & idx->mask;
+    }
+    _def_index_done();
+    return (nullptr != def) ? def : &ManuvrMsg::message_defs[0];
+  }
+
+  // No index. Do it the slow way.
   for (int i = 0; i < TOTAL_MSG_DEFS; i++) {
     if (ManuvrMsg::message_defs[i].msg_type_code == code) {
       return &ManuvrMsg::message_defs[i];
     }
   }
-  // Didn't find it there. Search in the extended defs...
-  const MessageTypeDef* temp_type_def = message_defs_extended[code];
-  if (temp_type_def) {
-    return temp_type_def;
+  // Didn't find it there. Search in the extended defs. If it isn't there
+  //   either, we don't know what the caller is asking for. Return the default.
+  const MessageTypeDef* return_value = &ManuvrMsg::message_defs[0];
+  _def_lock();
+  std::map<uint16_t, const MessageTypeDef*>::iterator it = message_defs_extended.find(code);
+  if ((it != message_defs_extended.end()) && (nullptr != it->second)) {
+    return_value = it->second;
   }
-  // If we've come this far, we don't know what the caller is asking for. Return the default.
-  return &ManuvrMsg::message_defs[0];
+  _def_unlock();
+  return return_value;
 }
 
 
 /**
 * This will never return NULL. It will at least return the defintion for the
 *   UNDEFINED Msg.
+* An exact match is found by hash. Failing that, we fall back to the old
+*   behavior of looking for any known label within the given string.
 *
 * @param  char*  The message label by which to lookup the message identity.
 * @return a pointer to the MessageTypeDef for this Msg code. Never nullptr.
 */
 const MessageTypeDef* ManuvrMsg::lookupMsgDefByLabel(char* label) {
+  if (nullptr == label) return &ManuvrMsg::message_defs[0];
+  MsgDefIndex* idx = _def_index();
+  if (nullptr != idx) {
+    uint32_t i = _def_hash_label(label) & idx->mask;
+    const MessageTypeDef* def;
+    while (nullptr != (def = __atomic_load_n(&idx->label[i], __ATOMIC_ACQUIRE))) {
+      if (0 == strcmp(def->debug_label, label)) {
+        break;
+      }
+      i = (i + 1) & idx->mask;
+    }
+    _def_index_done();
+    if (nullptr != def) return def;
+  }
+
   for (int i = 1; i < TOTAL_MSG_DEFS; i++) {
     // TODO: Yuck... have to import string.h for JUST THIS. Re-implement inline....
     if (strstr(label, ManuvrMsg::message_defs[i].debug_label)) {
@@ -174,17 +373,21 @@ const MessageTypeDef* ManuvrMsg::lookupMsgDefByLabel(char* label) {
     }
   }
 
-  // Didn't find it there. Search in the extended defs...
+  // Didn't find it there. Search in the extended defs. If it isn't there
+  //   either, we don't know what the caller is asking for. Return the default.
+  const MessageTypeDef* return_value = &ManuvrMsg::message_defs[0];
   const MessageTypeDef* temp_type_def;
   std::map<uint16_t, const MessageTypeDef*>::iterator it;
+  _def_lock();
   for (it = message_defs_extended.begin(); it != message_defs_extended.end(); it++) {
     temp_type_def = it->second;
-    if (strstr(label, temp_type_def->debug_label)) {
-      return temp_type_def;
+    if ((nullptr != temp_type_def) && strstr(label, temp_type_def->debug_label)) {
+      return_value = temp_type_def;
+      break;
     }
   }
-  // If we've come this far, we don't know what the caller is asking for. Return the default.
-  return &ManuvrMsg::message_defs[0];
+  _def_unlock();
+  return return_value;
 }
 
 
@@ -230,6 +433,7 @@ int8_t ManuvrMsg::getMsgLegend(StringBuilder* output) {
   }
 
   std::map<uint16_t, const MessageTypeDef*>::iterator it;
+  _def_lock();
   for (it = message_defs_extended.begin(); it != message_defs_extended.end(); it++) {
     temp_def = it->second;
 
@@ -251,6 +455,7 @@ int8_t ManuvrMsg::getMsgLegend(StringBuilder* output) {
 
 
   }
+  _def_unlock();
   return 1;
 }
 
@@ -423,68 +628,66 @@ uint8_t ManuvrMsg::inflateArgumentsFromBuffer(uint8_t* buffer, int len) {
     // TODO: This can almost collapse into the Argument class.
     switch (IntToTcode(*(uint8_t*)arg_mode)) {
       case TCode::INT8:
-        nu_arg = new Argument((int8_t) *(buffer));
+        nu_arg = _new_arg((int8_t) *(buffer));
         len--;
         buffer++;
         break;
       case TCode::UINT8:
-        nu_arg = new Argument((uint8_t) *(buffer));
+        nu_arg = _new_arg((uint8_t) *(buffer));
         len--;
         buffer++;
         break;
       case TCode::INT16:
-        nu_arg = new Argument((int16_t) parseUint16Fromchars(buffer));
+        nu_arg = _new_arg((int16_t) parseUint16Fromchars(buffer));
         len = len - 2;
         buffer += 2;
         break;
       case TCode::UINT16:
-        nu_arg = new Argument(parseUint16Fromchars(buffer));
+        nu_arg = _new_arg(parseUint16Fromchars(buffer));
         len = len - 2;
         buffer += 2;
         break;
       case TCode::INT32:
-        nu_arg = new Argument((int32_t) parseUint32Fromchars(buffer));
+        nu_arg = _new_arg((int32_t) parseUint32Fromchars(buffer));
         len = len - 4;
         buffer += 4;
         break;
       case TCode::UINT32:
-        nu_arg = new Argument(parseUint32Fromchars(buffer));
+        nu_arg = _new_arg(parseUint32Fromchars(buffer));
         len = len - 4;
         buffer += 4;
         break;
       case TCode::FLOAT:
-        nu_arg = new Argument((float) parseUint32Fromchars(buffer));
+        nu_arg = _new_arg((float) parseUint32Fromchars(buffer));
         len = len - 4;
         buffer += 4;
         break;
       case TCode::VECT_4_FLOAT:
-        nu_arg = new Argument(new Vector4f(parseFloatFromchars(buffer + 0), parseFloatFromchars(buffer + 4), parseFloatFromchars(buffer + 8), parseFloatFromchars(buffer + 12)));
+        nu_arg = _new_arg(Vector4f(parseFloatFromchars(buffer + 0), parseFloatFromchars(buffer + 4), parseFloatFromchars(buffer + 8), parseFloatFromchars(buffer + 12)));
         len = len - 16;
         buffer += 16;
-        nu_arg->reapValue(true);
         break;
       case TCode::VECT_3_FLOAT:
-        nu_arg = new Argument(new Vector3f(parseFloatFromchars(buffer + 0), parseFloatFromchars(buffer + 4), parseFloatFromchars(buffer + 8)));
+        nu_arg = _new_arg(Vector3f(parseFloatFromchars(buffer + 0), parseFloatFromchars(buffer + 4), parseFloatFromchars(buffer + 8)));
         len = len - 12;
         buffer += 12;
-        nu_arg->reapValue(true);
         break;
       case TCode::VECT_3_UINT16:
-        nu_arg = new Argument(new Vector3ui16(parseUint16Fromchars(buffer + 0), parseUint16Fromchars(buffer + 2), parseUint16Fromchars(buffer + 4)));
+        nu_arg = _new_arg(Vector3ui16(parseUint16Fromchars(buffer + 0), parseUint16Fromchars(buffer + 2), parseUint16Fromchars(buffer + 4)));
         len = len - 6;
         buffer += 6;
-        nu_arg->reapValue(true);
         break;
       case TCode::VECT_3_INT16:
-        nu_arg = new Argument(new Vector3i16((int16_t) parseUint16Fromchars(buffer + 0), (int16_t) parseUint16Fromchars(buffer + 2), (int16_t) parseUint16Fromchars(buffer + 4)));
+        nu_arg = _new_arg(Vector3i16((int16_t) parseUint16Fromchars(buffer + 0), (int16_t) parseUint16Fromchars(buffer + 2), (int16_t) parseUint16Fromchars(buffer + 4)));
         len = len - 6;
         buffer += 6;
-        nu_arg->reapValue(true);
         break;
 
       // Variable-length types...
       case TCode::STR:
-        nu_arg = new Argument(strdup((const char*) buffer));
+        // The buffer isn't ours. Short strings are copied inline.
+        nu_arg = _new_arg((const char*) buffer);
+        nu_arg->copyValue();
         buffer = buffer + nu_arg->length();
         len    = len - nu_arg->length();
         break;
@@ -601,18 +804,58 @@ int8_t ManuvrMsg::clearArgs() {
   if (_args) {
     Argument* tmp = _args;
     _args = nullptr;
-    delete tmp;
+    if (_in_pool(tmp)) {
+      tmp->~Argument();   // Our pool is not the heap.
+    }
+    else {
+      delete tmp;
+    }
   }
+  #if (MANUVR_MSG_ARG_POOL > 0)
+  _pool_used = 0;
+  #endif
   return 0;
 }
 
 
+/**
+* @return true if the given Argument lives in our pool.
+*/
+bool ManuvrMsg::_in_pool(Argument* a) {
+  #if (MANUVR_MSG_ARG_POOL > 0)
+  const uint8_t* p = (const uint8_t*) a;
+  return ((p >= _arg_pool) && (p < (_arg_pool + sizeof(_arg_pool))));
+  #else
+  return false;
+  #endif
+}
+
+
 /**
 * Returns the Argument* we carry, and then we placidly forget about it.
 *
 * @return nullptr if there were no Arguments, or the Arguments if there were.
 */
 Argument* ManuvrMsg::takeArgs() {
+  #if (MANUVR_MSG_ARG_POOL > 0)
+  // Arguments in our pool can't outlive us, so they are moved to the slab.
+  // Any index on the chain points at them, so those go first. An index is
+  //   only ever held by the Argument that was searched, which might be any.
+  for (Argument* a = _args; nullptr != a; a = a->_next) a->dropIndex();
+  Argument** link = &_args;
+  while (nullptr != *link) {
+    Argument* a = *link;
+    if (_in_pool(a)) {
+      Argument* nu = new Argument();
+      a->_move_to(nu);
+      a->~Argument();
+      *link = nu;
+      a = nu;
+    }
+    link = &a->_next;
+  }
+  _pool_used = 0;
+  #endif
   Argument* ret = _args;
   _args = nullptr;
   return ret;
@@ -686,16 +929,11 @@ const char* ManuvrMsg::getArgTypeString(uint8_t idx) {
 int ManuvrMsg::serialize(StringBuilder* output) {
   if (output == nullptr) return -1;
   int return_value = 0;
-  int delta_len = 0;
-  Argument* current_arg = _args;
-  while (current_arg) {
-    delta_len = current_arg->serialize_raw(output);
-    if (delta_len < 0) {
-      return delta_len;
-    }
-    else {
-      return_value++;
-    }
+  if (nullptr != _args) {
+    // serialize_raw() writes the whole chain in one piece.
+    int8_t ret = _args->serialize_raw(output);
+    if (ret < 0) return ret;
+    return_value = _args->argCount();
   }
   return return_value;
 }
@@ -833,7 +1071,7 @@ void ManuvrMsg::printDebug(StringBuilder *output) {
   if (isScheduled()) {
     output->concatf("\t [%p] Schedule \n\t --------------------------------\n", this);
     output->concatf("\t Enabled       \t%s\n", (scheduleEnabled() ? YES_STR : NO_STR));
-    output->concatf("\t Time-till-fire\t%u\n", _sched_ttw);
+    output->concatf("\t Time-till-fire\t%u\n", Kernel::scheduleRemaining(this));
     output->concatf("\t Period        \t%u\n", _sched_period);
     output->concatf("\t Recurs?       \t%d\n", _sched_recurs);
     output->concatf("\t Exec pending: \t%s\n", (shouldFire() ? YES_STR : NO_STR));
@@ -932,6 +1170,7 @@ bool ManuvrMsg::alterSchedulePeriod(uint32_t nu_period) {
     _sched_period       = nu_period;
     _sched_ttw = nu_period;
     return_value  = true;
+    _sched_rekey(false);   // A running countdown only gets shorter.
   }
   return return_value;
 }
@@ -944,6 +1183,7 @@ bool ManuvrMsg::alterSchedulePeriod(uint32_t nu_period) {
 bool ManuvrMsg::alterScheduleRecurrence(int16_t recurrence) {
   shouldFire(false);
   _sched_recurs = recurrence;
+  _sched_rekey(false);
   return true;
 }
 
@@ -971,6 +1211,7 @@ bool ManuvrMsg::alterSchedule(uint32_t sch_p, int16_t sch_r, bool ac, FxnPointer
       _sched_ttw        = sch_p;
       schedule_callback = sch_cb;
       return_value      = true;
+      _sched_rekey(true);
     }
   }
   return return_value;
@@ -1058,7 +1299,8 @@ int8_t ManuvrMsg::applyTime(uint32_t mse) {
 /**
 * Call to (en/dis)able a given schedule.
 * Will reset the time_to_wait such that if the schedule is re-enabled,
-*   it doesn't fire sooner than expected.
+*   it doesn't fire sooner than expected. A schedule that is already counting
+*   down keeps its place.
 *
 * @param   bool Should this schedule be enabled?
 * @return  true, always.
@@ -1069,6 +1311,7 @@ bool ManuvrMsg::enableSchedule(bool en) {
     _sched_ttw = _sched_period;
   }
   scheduleEnabled(en);
+  _sched_rekey(false);   // Re-enabling a running schedule doesn't restart it.
   return true;
 }
 
@@ -1083,10 +1326,26 @@ bool ManuvrMsg::enableSchedule(bool en) {
 bool ManuvrMsg::delaySchedule(uint32_t by_ms) {
   _sched_ttw = by_ms;
   scheduleEnabled(true);
+  _sched_rekey(true);
   return true;
 }
 
 
+/**
+* Any change to the timing parameters of a schedule that the Kernel is holding
+*   must be reflected in the Kernel's schedule heap, since the Kernel no longer
+*   visits every schedule on every tick.
+*
+* @param  retime  Start the TTW over from now, rather than keeping the time
+*                   that has already elapsed?
+*/
+void ManuvrMsg::_sched_rekey(bool retime) {
+  if (isScheduled()) {
+    Kernel::rekeySchedule(this, retime);
+  }
+}
+
+
 
 /*******************************************************************************
 * Actually execute this runnable.                                              *
@@ -27,6 +27,7 @@ This class forms the foundation of internal events. It contains the identity of
 #define __MANUVR_MESSAGE_H__
 
 #include <map>
+#include <new>
 
 #include <DataStructures/Argument.h>
 
@@ -70,6 +71,19 @@ typedef struct msg_defin_t {
 } MessageTypeDef;
 
 
+/*
+* Open-addressed indices over every known message definition. The struct and
+*   both tables share one allocation. Once published, an index only ever
+*   gains entries. When it must grow, it is replaced by a bigger one.
+*/
+typedef struct msg_def_index_t {
+  uint32_t               mask;   // Capacity of both tables, minus one.
+  uint32_t               count;  // How many definitions have been placed?
+  const MessageTypeDef** code;   // Keyed by message code.
+  const MessageTypeDef** label;  // Keyed by hash of the label.
+} MsgDefIndex;
+
+
 /*
 * These are flag definitions for Message types.
 * They are constant for a given message type, and are not related to those
@@ -178,13 +192,14 @@ class ManuvrMsg {
     *   implementation details of Arguments. Might look ugly, but takes the CPU burden off of runtime
     *   and forces the compiler to deal with it.
     */
-    inline Argument* addArg(uint8_t val) {         return addArg(new Argument(val));  }
-    inline Argument* addArg(uint16_t val) {        return addArg(new Argument(val));  }
-    inline Argument* addArg(uint32_t val) {        return addArg(new Argument(val));  }
-    inline Argument* addArg(int8_t val) {          return addArg(new Argument(val));  }
-    inline Argument* addArg(int16_t val) {         return addArg(new Argument(val));  }
-    inline Argument* addArg(int32_t val) {         return addArg(new Argument(val));  }
-    inline Argument* addArg(float val) {           return addArg(new Argument(val));  }
+    inline Argument* addArg(uint8_t val) {         return addArg(_new_arg(val));  }
+    inline Argument* addArg(uint16_t val) {        return addArg(_new_arg(val));  }
+    inline Argument* addArg(uint32_t val) {        return addArg(_new_arg(val));  }
+    inline Argument* addArg(int8_t val) {          return addArg(_new_arg(val));  }
+    inline Argument* addArg(int16_t val) {         return addArg(_new_arg(val));  }
+    inline Argument* addArg(int32_t val) {         return addArg(_new_arg(val));  }
+    inline Argument* addArg(float val) {           return addArg(_new_arg(val));  }
+    inline Argument* addArg(double val) {          return addArg(_new_arg(val));  }
 
     //inline Argument* addArg(uint8_t *val) {        return addArg(new Argument(val));  }
     //inline Argument* addArg(uint16_t *val) {       return addArg(new Argument(val));  }
@@ -194,14 +209,18 @@ class ManuvrMsg {
     //inline Argument* addArg(int32_t *val) {        return addArg(new Argument(val));  }
     //inline Argument* addArg(float *val) {          return addArg(new Argument(val));  }
 
-    inline Argument* addArg(Vector3ui16 *val) {    return addArg(new Argument(val));  }
-    inline Argument* addArg(Vector3i16 *val) {     return addArg(new Argument(val));  }
-    inline Argument* addArg(Vector3f *val) {       return addArg(new Argument(val));  }
-    inline Argument* addArg(Vector4f *val) {       return addArg(new Argument(val));  }
-
-    inline Argument* addArg(void *val, int len) {  return addArg(new Argument(val, len));  }
-    inline Argument* addArg(const char *val) {     return addArg(new Argument(val));  }
-    inline Argument* addArg(StringBuilder *val) {  return addArg(new Argument(val));  }
+    inline Argument* addArg(Vector3ui16 *val) {    return addArg(_new_arg(val));  }
+    inline Argument* addArg(Vector3i16 *val) {     return addArg(_new_arg(val));  }
+    inline Argument* addArg(Vector3f *val) {       return addArg(_new_arg(val));  }
+    inline Argument* addArg(Vector4f *val) {       return addArg(_new_arg(val));  }
+    inline Argument* addArg(const Vector3ui16& val) {  return addArg(_new_arg(val));  }
+    inline Argument* addArg(const Vector3i16& val) {   return addArg(_new_arg(val));  }
+    inline Argument* addArg(const Vector3f& val) {     return addArg(_new_arg(val));  }
+    inline Argument* addArg(const Vector4f& val) {     return addArg(_new_arg(val));  }
+
+    inline Argument* addArg(void *val, int len) {  return addArg(_new_arg(val, len));  }
+    inline Argument* addArg(const char *val) {     return addArg(_new_arg(val));  }
+    inline Argument* addArg(StringBuilder *val) {  return addArg(_new_arg(val));  }
     //inline Argument* addArg(BufferPipe *val) {     return addArg(new Argument(val));  }
     //inline Argument* addArg(EventReceiver *val) {  return addArg(new Argument(val));  }
     //inline Argument* addArg(ManuvrXport *val) {    return addArg(new Argument(val));  }
@@ -299,7 +318,7 @@ class ManuvrMsg {
     * All schedule members are treated normally, so if the schedule recurs,
     *   it will be re-timed after next-tick, with a decremented recur counter.
     */
-    inline void fireNow() { shouldFire(true); };
+    inline void fireNow() { shouldFire(true); _sched_rekey(false); };
 
     /**
     * Is the schedule pending execution ahread of schedule (next tick)?
@@ -400,17 +419,40 @@ class ManuvrMsg {
     int16_t        _sched_recurs       = 0;        // See Note 2.
     uint32_t       _sched_period       = 0;        // How often does this schedule execute?
     uint32_t       _sched_ttw          = 0;        // How much longer until the schedule fires?
+    uint32_t       _sched_deadline     = 0;        // Kernel clock value at which this schedule is due.
+    int32_t        _sched_heap_idx     = -1;       // Position in the Kernel's schedule heap. -1 if not armed.
+    uint32_t       _enqueued_us        = 0;        // micros() at the time this message was raised.
+
+    #if (MANUVR_MSG_ARG_POOL > 0)
+    /* Our first few Arguments live here, and die with us. */
+    alignas(Argument) uint8_t _arg_pool[MANUVR_MSG_ARG_POOL * sizeof(Argument)];
+    uint8_t        _pool_used          = 0;
+    #endif
 
     #if defined(MANUVR_EVENT_PROFILER)
     StopWatch* prof_data = nullptr;  // If this schedule is being profiled, the ref will be here.
     #endif
 
     int8_t getArgAs(uint8_t idx, void *dat);
+    bool   _in_pool(Argument*);
+    void   _sched_rekey(bool retime);   // Informs the Kernel that our timing parameters changed.
     int8_t writePointerArgAs(uint8_t idx, void *trg_buf);
 
     char* is_valid_argument_buffer(int len);
     int   collect_valid_grammatical_forms(int, LinkedList<char*>*);
 
+    /* Constructs an Argument in our pool if there is room, or on the slab if not. */
+    template <typename... T> inline Argument* _new_arg(T... vals) {
+      #if (MANUVR_MSG_ARG_POOL > 0)
+      if (_pool_used < MANUVR_MSG_ARG_POOL) {
+        Argument* a = ::new (&_arg_pool[_pool_used++ * sizeof(Argument)]) Argument(vals...);
+        a->_alter_flags(true, MANUVR_ARG_FLAG_ARENA);
+        return a;
+      }
+      #endif
+      return new Argument(vals...);
+    };
+
     inline void scheduleEnabled(bool en) {
       _flags = (en) ? (_flags | MANUVR_MSG_FLAG_SCHED_ENABLED) : (_flags & ~(MANUVR_MSG_FLAG_SCHED_ENABLED));
     };
@@ -418,6 +460,21 @@ class ManuvrMsg {
 
     // Where runtime-loaded message defs go.
     static std::map<uint16_t, const MessageTypeDef*> message_defs_extended;
+
+    /* Indices over both the static and extended defs. */
+    static MsgDefIndex* _def_idx;      // Published atomically. Read without a lock.
+    static uint32_t     _def_readers;  // Lookups probing an index right now.
+    static bool         _def_locked;   // Spinlock for registration, and the extended defs.
+
+    static MsgDefIndex* _def_index();
+    static void         _def_index_done();
+    static int8_t       _def_index_rebuild();
+    static int8_t       _def_index_add(const MessageTypeDef*);
+    static void         _def_lock();
+    static void         _def_unlock();
+
+    /* The Kernel owns the schedule heap, and needs to see our deadline and heap position. */
+    friend class Kernel;
 };
 
 #endif   // __MANUVR_MESSAGE_H__
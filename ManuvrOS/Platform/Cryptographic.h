@@ -104,6 +104,25 @@ int get_digest_output_length(Hashes);
 const char* get_digest_label(Hashes);
 int8_t wrapped_hash(uint8_t* in, size_t in_len, uint8_t* out, Hashes h);
 
+/*
+* Incremental digests. The context keeps the back-end's state between calls, so
+*   a digest can be fed from many buffers (or a fragmented StringBuilder), and
+*   the context can be restarted for the next digest without being set up again.
+*/
+typedef struct {
+  #if defined(WITH_MBEDTLS)
+    mbedtls_md_context_t ctx;
+  #endif
+  Hashes               h;
+} HashContext;
+
+int8_t wrapped_hash_init(HashContext*, Hashes);
+int8_t wrapped_hash_start(HashContext*);
+int8_t wrapped_hash_update(HashContext*, uint8_t* in, size_t in_len);
+int8_t wrapped_hash_update_sb(HashContext*, StringBuilder*);
+int8_t wrapped_hash_finish(HashContext*, uint8_t* out);
+void   wrapped_hash_free(HashContext*);
+
 // Now some inline definitions to mask the back-end API where it can be done
 //   transparently...
 inline Hashes* list_supported_digests() {
@@ -323,6 +342,29 @@ typedef int (*wrapped_sauth_operation)(
   Cipher ci,
   uint32_t opts
 );
+
+/*
+* A keyed symmetric cipher. The key schedule is expanded once, when the context
+*   is initialized, instead of for every buffer. The direction (OP_ENCRYPT or
+*   OP_DECRYPT) is fixed at that time.
+*/
+typedef struct {
+  Cipher   ci;
+  uint32_t opts;
+  union {
+    #if defined(MBEDTLS_AES_C)
+      mbedtls_aes_context      aes;
+    #endif
+    #if defined(MBEDTLS_BLOWFISH_C)
+      mbedtls_blowfish_context blowfish;
+    #endif
+    uint8_t none;
+  } k;
+} CipherContext;
+
+int  wrapped_sym_cipher_init(CipherContext*, Cipher, uint8_t* key, int key_len, uint32_t opts);
+int  wrapped_sym_cipher_update(CipherContext*, uint8_t* in, int in_len, uint8_t* out, int out_len, uint8_t* iv);
+void wrapped_sym_cipher_free(CipherContext*);
 #endif  //__BUILD_HAS_SYMMETRIC
 
 
@@ -467,6 +509,27 @@ inline CryptoKey* list_supported_curves() {
 
 int wrapped_sign_verify(Cipher, CryptoKey, Hashes, uint8_t* msg, int msg_len, uint8_t* sig, size_t* sig_len, uint8_t* key, int key_len, uint32_t opts);
 
+#if defined(__BUILD_HAS_ASYMMETRIC)
+/*
+* A parsed asymmetric key. Parsing costs more than the verify it precedes, so
+*   callers that use the same key repeatedly should hold one of these.
+* A context may be used by one thread at a time. The back-end caches
+*   per-key values in it as it works.
+*/
+typedef struct {
+  #if defined(WITH_MBEDTLS)
+    mbedtls_pk_context ctx;
+  #endif
+  Cipher    c;
+  CryptoKey k;
+  uint32_t  opts;   // OP_SIGN if the private half was loaded, OP_VERIFY if the public.
+} PKContext;
+
+int  wrapped_pk_init(PKContext*, Cipher, CryptoKey, uint8_t* key, int key_len, uint32_t opts);
+int  wrapped_pk_sign_verify(PKContext*, Hashes, uint8_t* msg, int msg_len, uint8_t* sig, size_t* sig_len);
+void wrapped_pk_free(PKContext*);
+#endif  //__BUILD_HAS_ASYMMETRIC
+
 
 /*******************************************************************************
 * Randomness                                                                   *
@@ -26,6 +26,7 @@ MbedTLS support assumes that we have a local copy of the mbedTLS source tree
 
 #include "../Cryptographic.h"
 #include <Platform/Platform.h>
+#include <StringBuilder.h>
 
 #if defined(WITH_MBEDTLS)
 
@@ -305,6 +306,39 @@ int cryptographic_rng_init() {
 }
 
 
+/**
+* Operations that need a DRBG share this one, which is seeded from the entropy
+*   pool on first use, and reseeds itself thereafter. Seeding happens once,
+*   under a lock. Like the entropy pool, the DRBG itself is not guarded against
+*   concurrent use.
+*
+* @return The DRBG, or nullptr if it could not be seeded.
+*/
+static mbedtls_ctr_drbg_context* _shared_drbg() {
+  static mbedtls_ctr_drbg_context drbg;
+  static bool seeded = false;
+  #if defined(__BUILD_HAS_PTHREADS)
+    static pthread_mutex_t seed_lock = PTHREAD_MUTEX_INITIALIZER;
+    if (__atomic_load_n(&seeded, __ATOMIC_ACQUIRE)) return &drbg;
+    pthread_mutex_lock(&seed_lock);
+  #endif
+  if (!seeded) {
+    uint32_t pers = randomUInt32();
+    mbedtls_ctr_drbg_init(&drbg);
+    if (0 == mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, (const uint8_t*) &pers, 4)) {
+      __atomic_store_n(&seeded, true, __ATOMIC_RELEASE);
+    }
+    else {
+      mbedtls_ctr_drbg_free(&drbg);   // The next caller will try again.
+    }
+  }
+  #if defined(__BUILD_HAS_PTHREADS)
+    pthread_mutex_unlock(&seed_lock);
+  #endif
+  return (seeded ? &drbg : nullptr);
+}
+
+
 
 /*******************************************************************************
 * Message digest and Hash                                                      *
@@ -330,30 +364,48 @@ int cryptographic_rng_init() {
 //  }
 int8_t __attribute__((weak)) wrapped_hash(uint8_t* in, size_t in_len, uint8_t* out, Hashes h) {
   int8_t return_value = -1;
-  const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type((mbedtls_md_type_t)h);
-
-  if (NULL != md_info) {
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    switch (mbedtls_md_setup(&ctx, md_info, 0)) {
-      case 0:
-        if (0 == mbedtls_md_starts(&ctx)) {
-          // Start feeding data...
-          if (0 == mbedtls_md_update(&ctx, in, in_len)) {
-            if (0 == mbedtls_md_finish(&ctx, out)) {
-              return_value = 0;
-            }
-            else {
-              Kernel::log("hash(): Failed during finish.\n");
-            }
-          }
-          else {
-            Kernel::log("hash(): Failed during digest.\n");
-          }
+  HashContext ctx;
+  if (0 == wrapped_hash_init(&ctx, h)) {
+    if (0 == wrapped_hash_start(&ctx)) {
+      // Start feeding data...
+      if (0 == wrapped_hash_update(&ctx, in, in_len)) {
+        if (0 == wrapped_hash_finish(&ctx, out)) {
+          return_value = 0;
         }
         else {
-          Kernel::log("hash(): Bad input data.\n");
+          Kernel::log("hash(): Failed during finish.\n");
         }
+      }
+      else {
+        Kernel::log("hash(): Failed during digest.\n");
+      }
+    }
+    else {
+      Kernel::log("hash(): Bad input data.\n");
+    }
+  }
+  wrapped_hash_free(&ctx);
+  return return_value;
+}
+
+
+/**
+* Sets up a context for incremental digests. The context must be passed to
+*   wrapped_hash_free() when it is no longer needed, even if this call fails.
+*
+* @param HashContext* The context to set up.
+* @param Hashes       The digest algorithm it will compute.
+* @return 0 on success. Non-zero otherwise.
+*/
+int8_t __attribute__((weak)) wrapped_hash_init(HashContext* hctx, Hashes h) {
+  int8_t return_value = -1;
+  const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type((mbedtls_md_type_t)h);
+  mbedtls_md_init(&hctx->ctx);
+  hctx->h = h;
+  if (NULL != md_info) {
+    switch (mbedtls_md_setup(&hctx->ctx, md_info, 0)) {
+      case 0:
+        return_value = 0;
         break;
       case MBEDTLS_ERR_MD_BAD_INPUT_DATA:
         Kernel::log("hash(): Bad parameters.\n");
@@ -364,12 +416,75 @@ int8_t __attribute__((weak)) wrapped_hash(uint8_t* in, size_t in_len, uint8_t* o
       default:
         break;
     }
-    mbedtls_md_free(&ctx);
   }
   return return_value;
 }
 
 
+/**
+* Begins (or restarts) a digest. Whatever was fed to the context before is
+*   forgotten.
+*
+* @return 0 on success. Non-zero otherwise.
+*/
+int8_t __attribute__((weak)) wrapped_hash_start(HashContext* hctx) {
+  return (0 == mbedtls_md_starts(&hctx->ctx)) ? 0 : -1;
+}
+
+
+/**
+* Feeds a buffer to a digest in progress.
+*
+* @return 0 on success. Non-zero otherwise.
+*/
+int8_t __attribute__((weak)) wrapped_hash_update(HashContext* hctx, uint8_t* in, size_t in_len) {
+  return (0 == mbedtls_md_update(&hctx->ctx, in, in_len)) ? 0 : -1;
+}
+
+
+/**
+* Feeds the contents of a StringBuilder to a digest in progress, a fragment at
+*   a time, so that the buffer is not collapsed (and copied) to do it.
+*
+* @return 0 on success. Non-zero otherwise.
+*/
+int8_t __attribute__((weak)) wrapped_hash_update_sb(HashContext* hctx, StringBuilder* in) {
+  const int frags = in->count();
+  if (0 == frags) {
+    // Either empty, or already flat.
+    return (0 < in->length()) ? wrapped_hash_update(hctx, in->string(), in->length()) : 0;
+  }
+  for (int i = 0; i < frags; i++) {
+    int frag_len = 0;
+    uint8_t* frag = in->position(i, &frag_len);
+    if ((nullptr != frag) && (0 < frag_len)) {
+      if (0 != mbedtls_md_update(&hctx->ctx, frag, frag_len)) return -1;
+    }
+  }
+  return 0;
+}
+
+
+/**
+* Writes the digest out. The context may then be restarted with
+*   wrapped_hash_start().
+* NOTE: We assume that the caller has the foresight to allocate a large-enough output buffer.
+*
+* @return 0 on success. Non-zero otherwise.
+*/
+int8_t __attribute__((weak)) wrapped_hash_finish(HashContext* hctx, uint8_t* out) {
+  return (0 == mbedtls_md_finish(&hctx->ctx, out)) ? 0 : -1;
+}
+
+
+/**
+* Releases whatever the back-end allocated for the context.
+*/
+void __attribute__((weak)) wrapped_hash_free(HashContext* hctx) {
+  mbedtls_md_free(&hctx->ctx);
+}
+
+
 
 /*******************************************************************************
 * Symmetric ciphers                                                            *
@@ -397,68 +512,169 @@ int __attribute__((weak)) wrapped_sym_cipher(uint8_t* in, int in_len, uint8_t* o
   }
   int8_t ret = -1;
   switch (ci) {
-    #if defined(MBEDTLS_AES_C)
-      case Cipher::SYM_AES_256_CBC:
-      case Cipher::SYM_AES_192_CBC:
-      case Cipher::SYM_AES_128_CBC:
-        {
-          mbedtls_aes_context ctx;
-          if (opts & OP_ENCRYPT) {
-            mbedtls_aes_setkey_enc(&ctx, key, (unsigned int) key_len);
-          }
-          else {
-            mbedtls_aes_setkey_dec(&ctx, key, (unsigned int) key_len);
-          }
-          ret = mbedtls_aes_crypt_cbc(&ctx, _cipher_opcode(ci, opts), in_len, iv, in, out);
-          mbedtls_aes_free(&ctx);
-        }
-        break;
-    #endif
-
     #if defined(MBEDTLS_RSA_C)
       case Cipher::ASYM_RSA:
         {
-          mbedtls_ctr_drbg_context ctr_drbg;
-          mbedtls_ctr_drbg_init(&ctr_drbg);
+          mbedtls_ctr_drbg_context* ctr_drbg = _shared_drbg();
           size_t olen = 0;
           mbedtls_pk_context ctx;
           mbedtls_pk_init(&ctx);
-          if (opts & OP_ENCRYPT) {
-            ret = mbedtls_pk_encrypt(&ctx, in, in_len, out, &olen, out_len, mbedtls_ctr_drbg_random, &ctr_drbg);
-          }
-          else {
-            ret = mbedtls_pk_decrypt(&ctx, in, in_len, out, &olen, out_len, mbedtls_ctr_drbg_random, &ctr_drbg);
+          if (nullptr != ctr_drbg) {
+            if (opts & OP_ENCRYPT) {
+              ret = mbedtls_pk_parse_public_key(&ctx, key, key_len);
+              if (0 == ret) {
+                ret = mbedtls_pk_encrypt(&ctx, in, in_len, out, &olen, out_len, mbedtls_ctr_drbg_random, ctr_drbg);
+              }
+            }
+            else {
+              ret = mbedtls_pk_parse_key(&ctx, key, key_len, nullptr, 0);
+              if (0 == ret) {
+                ret = mbedtls_pk_decrypt(&ctx, in, in_len, out, &olen, out_len, mbedtls_ctr_drbg_random, ctr_drbg);
+              }
+            }
           }
           mbedtls_pk_free(&ctx);
         }
         break;
     #endif
 
+    default:
+      {
+        CipherContext ctx;
+        if (0 == wrapped_sym_cipher_init(&ctx, ci, key, key_len, opts)) {
+          ret = wrapped_sym_cipher_update(&ctx, in, in_len, out, out_len, iv);
+        }
+        wrapped_sym_cipher_free(&ctx);
+      }
+      break;
+  }
+  return ret;
+}
+
+
+/**
+* Keys a symmetric cipher context. The key schedule is expanded here, and the
+*   context can then be used for any number of buffers. The context must be
+*   passed to wrapped_sym_cipher_free() when it is no longer needed, even if
+*   this call fails.
+*
+* @param CipherContext* The context to set up.
+* @param Cipher         The cipher.
+* @param uint8_t*       Buffer containing the symmetric key.
+* @param int            Length of the key, in bits.
+* @param uint32_t       OP_ENCRYPT or OP_DECRYPT.
+* @return 0 on success. Non-zero otherwise.
+*/
+int __attribute__((weak)) wrapped_sym_cipher_init(CipherContext* cctx, Cipher ci, uint8_t* key, int key_len, uint32_t opts) {
+  int ret = -1;
+  cctx->ci   = ci;
+  cctx->opts = opts;
+  switch (ci) {
+    #if defined(MBEDTLS_AES_C)
+      case Cipher::SYM_AES_256_CBC:
+      case Cipher::SYM_AES_192_CBC:
+      case Cipher::SYM_AES_128_CBC:
+        mbedtls_aes_init(&cctx->k.aes);
+        if (opts & OP_ENCRYPT) {
+          ret = mbedtls_aes_setkey_enc(&cctx->k.aes, key, (unsigned int) key_len);
+        }
+        else {
+          ret = mbedtls_aes_setkey_dec(&cctx->k.aes, key, (unsigned int) key_len);
+        }
+        break;
+    #endif
+
     #if defined(MBEDTLS_BLOWFISH_C)
       case Cipher::SYM_BLOWFISH_CBC:
-        {
-          mbedtls_blowfish_context ctx;
-          mbedtls_blowfish_setkey(&ctx, key, key_len);
-          ret = mbedtls_blowfish_crypt_cbc(&ctx, _cipher_opcode(ci, opts), in_len, iv, in, out);
-          mbedtls_blowfish_free(&ctx);
-        }
+        mbedtls_blowfish_init(&cctx->k.blowfish);
+        ret = mbedtls_blowfish_setkey(&cctx->k.blowfish, key, key_len);
         break;
     #endif
 
     #if defined(WRAPPED_SYM_NULL)
       case Cipher::SYM_NULL:
-        memcpy(out, in, in_len);
         ret = 0;
         break;
     #endif
 
     default:
+      cctx->ci = Cipher::NONE;
       break;
   }
   return ret;
 }
 
 
+/**
+* Runs a buffer through a keyed cipher context. For chaining modes, the IV is
+*   updated in place, so consecutive calls continue the chain.
+*
+* @param CipherContext* A context set up by wrapped_sym_cipher_init().
+* @param uint8_t*       Buffer containing the input.
+* @param int            Length of the input.
+* @param uint8_t*       Target buffer for the output.
+* @param int            Length of output.
+* @param uint8_t*       IV. Caller's responsibility to use correct size.
+* @return 0 on success. Non-zero otherwise.
+*/
+int __attribute__((weak)) wrapped_sym_cipher_update(CipherContext* cctx, uint8_t* in, int in_len, uint8_t* out, int out_len, uint8_t* iv) {
+  int ret = -1;
+  if (out_len < in_len) return ret;
+  switch (cctx->ci) {
+    #if defined(MBEDTLS_AES_C)
+      case Cipher::SYM_AES_256_CBC:
+      case Cipher::SYM_AES_192_CBC:
+      case Cipher::SYM_AES_128_CBC:
+        ret = mbedtls_aes_crypt_cbc(&cctx->k.aes, _cipher_opcode(cctx->ci, cctx->opts), in_len, iv, in, out);
+        break;
+    #endif
+
+    #if defined(MBEDTLS_BLOWFISH_C)
+      case Cipher::SYM_BLOWFISH_CBC:
+        ret = mbedtls_blowfish_crypt_cbc(&cctx->k.blowfish, _cipher_opcode(cctx->ci, cctx->opts), in_len, iv, in, out);
+        break;
+    #endif
+
+    #if defined(WRAPPED_SYM_NULL)
+      case Cipher::SYM_NULL:
+        memmove(out, in, in_len);
+        ret = 0;
+        break;
+    #endif
+
+    default:
+      break;
+  }
+  return ret;
+}
+
+
+/**
+* Wipes the expanded key, and releases the context.
+*/
+void __attribute__((weak)) wrapped_sym_cipher_free(CipherContext* cctx) {
+  switch (cctx->ci) {
+    #if defined(MBEDTLS_AES_C)
+      case Cipher::SYM_AES_256_CBC:
+      case Cipher::SYM_AES_192_CBC:
+      case Cipher::SYM_AES_128_CBC:
+        mbedtls_aes_free(&cctx->k.aes);
+        break;
+    #endif
+
+    #if defined(MBEDTLS_BLOWFISH_C)
+      case Cipher::SYM_BLOWFISH_CBC:
+        mbedtls_blowfish_free(&cctx->k.blowfish);
+        break;
+    #endif
+
+    default:
+      break;
+  }
+  cctx->ci = Cipher::NONE;
+}
+
+
 
 /*******************************************************************************
 * Asymmetric ciphers                                                           *
@@ -597,6 +813,79 @@ int __attribute__((weak)) wrapped_sign_verify(Cipher c, CryptoKey k, Hashes h, u
     // If overriden by user implementation.
     return _s_v_overrides[k](c, k, h, msg, msg_len, sig, sig_len, key, key_len, opts);
   }
+  PKContext ctx;
+  int ret = wrapped_pk_init(&ctx, c, k, key, key_len, opts);
+  if (0 == ret) {
+    ret = wrapped_pk_sign_verify(&ctx, h, msg, msg_len, sig, sig_len);
+  }
+  wrapped_pk_free(&ctx);
+  return ret;
+}
+
+
+/**
+* Parses a key into a context that can be used for any number of sign or
+*   verify operations. The context must be passed to wrapped_pk_free() when it
+*   is no longer needed, even if this call fails.
+* Implementations provided by the user do not work from parsed keys, and so
+*   will cause this call to fail. Use wrapped_sign_verify() for those.
+*
+* @param PKContext* The context to set up.
+* @param Cipher     Algorithm class
+* @param CryptoKey  Key parameters
+* @param uint8_t*   Buffer holding the key...
+* @param int        ...and its length.
+* @param uint32_t   OP_SIGN to load a private key, OP_VERIFY to load a public key.
+* @return 0 on success. Non-zero otherwise.
+*/
+int __attribute__((weak)) wrapped_pk_init(PKContext* pctx, Cipher c, CryptoKey k, uint8_t* key, int key_len, uint32_t opts) {
+  int ret = -1;
+  mbedtls_pk_init(&pctx->ctx);
+  pctx->c    = c;
+  pctx->k    = k;
+  pctx->opts = opts;
+  if (keygen_deferred_handling(k)) {
+    return ret;
+  }
+  switch (c) {
+    #if defined(WRAPPED_ASYM_RSA)
+      case Cipher::ASYM_RSA:
+    #endif
+    #if defined(MBEDTLS_ECDSA_C)
+      case Cipher::ASYM_ECDSA:
+    #endif
+    #if defined(MBEDTLS_ECP_C)
+      case Cipher::ASYM_ECKEY:
+    #endif
+      if (opts & OP_SIGN) {
+        ret = mbedtls_pk_parse_key(&pctx->ctx, key, key_len, nullptr, 0);
+      }
+      else {
+        ret = mbedtls_pk_parse_public_key(&pctx->ctx, key, key_len);
+      }
+      break;
+    default:
+      break;
+  }
+  return ret;
+}
+
+
+/**
+* Signs or verifies with a parsed key. Which of the two is decided by the key
+*   that the context was set up with.
+* Signing draws from the shared DRBG, and so should only be done from one
+*   thread. Verification may be done concurrently on distinct contexts.
+*
+* @param PKContext* A context set up by wrapped_pk_init().
+* @param Hashes     Digest alg to use.
+* @param uint8_t*   Buffer to be signed/verified...
+* @param int        ...and its length.
+* @param uint8_t*   Buffer to hold signature...
+* @param int*       ...and its length.
+* @return 0 if the operation completed successfully.
+*/
+int __attribute__((weak)) wrapped_pk_sign_verify(PKContext* pctx, Hashes h, uint8_t* msg, int msg_len, uint8_t* sig, size_t* sig_len) {
   int ret = -1;   // Failure by default.
 
   uint8_t* hash;
@@ -616,110 +905,36 @@ int __attribute__((weak)) wrapped_sign_verify(Cipher c, CryptoKey k, Hashes h, u
   }
 
   if (0 == ret) {
-    // If we are here, the hashing operation worked. Now we case-off on key/algo.
-    mbedtls_pk_context k_ctx;
-    mbedtls_pk_init(&k_ctx);
-    uint32_t pers = randomUInt32();
-    mbedtls_ctr_drbg_context ctr_drbg;
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-    ret = mbedtls_ctr_drbg_seed(
-      &ctr_drbg, mbedtls_entropy_func, &entropy,
-      (const uint8_t*) &pers, 4
-    );
-    if (0 == ret) {
-      switch (c) {
-        #if defined(WRAPPED_ASYM_RSA)
-          case Cipher::ASYM_RSA:
-            //ret = mbedtls_pk_setup(&k_ctx, mbedtls_pk_info_from_type(MBEDTLS_PK_RSA));
-            if (opts & OP_SIGN) {
-              ret = mbedtls_pk_setup(&k_ctx, mbedtls_pk_info_from_type(MBEDTLS_PK_RSA));
-              if (0 == ret) {
-                ret = mbedtls_pk_parse_key(&k_ctx, key, key_len, nullptr, 0);
-                if (0 == ret) {
-                  ret = mbedtls_pk_sign(
-                    &k_ctx,
-                    (mbedtls_md_type_t) h, hash, hashlen,
-                    sig, sig_len,
-                    mbedtls_ctr_drbg_random, &ctr_drbg
-                  );
-                }
-              }
-            }
-            else {
-              ret = mbedtls_pk_parse_public_key(&k_ctx, key, key_len);
-              if (0 == ret) {
-                ret = mbedtls_pk_verify(
-                  &k_ctx,
-                  (mbedtls_md_type_t) h, hash, hashlen,
-                  sig, *sig_len
-                );
-              }
-            }
-            break;
-        #endif
-        #if defined(MBEDTLS_ECDSA_C)
-          case Cipher::ASYM_ECDSA:
-            if (opts & OP_SIGN) {
-              ret = mbedtls_pk_setup(&k_ctx, mbedtls_pk_info_from_type(MBEDTLS_PK_ECDSA));
-              if (0 == ret) {
-                ret = mbedtls_pk_parse_key(&k_ctx, key, key_len, nullptr, 0);
-                if (0 == ret) {
-                  ret = mbedtls_pk_sign(
-                    &k_ctx,
-                    (mbedtls_md_type_t) h, hash, hashlen,
-                    sig, sig_len,
-                    mbedtls_ctr_drbg_random, &ctr_drbg
-                  );
-                }
-              }
-            }
-            else {
-              ret = mbedtls_pk_parse_public_key(&k_ctx, key, key_len);
-              if (0 == ret) {
-                ret = mbedtls_pk_verify(
-                  &k_ctx,
-                  (mbedtls_md_type_t) h, hash, hashlen,
-                  sig, *sig_len
-                );
-              }
-            }
-            break;
-        #endif
-        #if defined(MBEDTLS_ECP_C)
-          case Cipher::ASYM_ECKEY:
-            if (opts & OP_SIGN) {
-              ret = mbedtls_pk_setup(&k_ctx, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY));
-              if (0 == ret) {
-                ret = mbedtls_pk_parse_key(&k_ctx, key, key_len, nullptr, 0);
-                if (0 == ret) {
-                  ret = mbedtls_pk_sign(
-                    &k_ctx,
-                    (mbedtls_md_type_t) h, hash, hashlen,
-                    sig, sig_len,
-                    mbedtls_ctr_drbg_random, &ctr_drbg
-                  );
-                }
-              }
-            }
-            else {
-              ret = mbedtls_pk_parse_public_key(&k_ctx, key, key_len);
-              if (0 == ret) {
-                ret = mbedtls_pk_verify(
-                  &k_ctx,
-                  (mbedtls_md_type_t) h, hash, hashlen,
-                  sig, *sig_len
-                );
-              }
-            }
-            break;
-        #endif
-        default:
-          break;
+    // If we are here, the hashing operation worked. Only signing needs the DRBG.
+    if (pctx->opts & OP_SIGN) {
+      mbedtls_ctr_drbg_context* ctr_drbg = _shared_drbg();
+      ret = -1;
+      if (nullptr != ctr_drbg) {
+        ret = mbedtls_pk_sign(
+          &pctx->ctx,
+          (mbedtls_md_type_t) h, hash, hashlen,
+          sig, sig_len,
+          mbedtls_ctr_drbg_random, ctr_drbg
+        );
       }
     }
+    else {
+      ret = mbedtls_pk_verify(
+        &pctx->ctx,
+        (mbedtls_md_type_t) h, hash, hashlen,
+        sig, *sig_len
+      );
+    }
   }
-
   return ret;
 }
 
+
+/**
+* Releases the parsed key.
+*/
+void __attribute__((weak)) wrapped_pk_free(PKContext* pctx) {
+  mbedtls_pk_free(&pctx->ctx);
+}
+
 #endif   // WITH_MBEDTLS
@@ -131,6 +131,11 @@ IdentityPubKey::IdentityPubKey(uint8_t* buf, uint16_t len) : Identity((const cha
 
 
 IdentityPubKey::~IdentityPubKey() {
+  if (nullptr != _verify_ctx) {
+    wrapped_pk_free(_verify_ctx);
+    free(_verify_ctx);
+    _verify_ctx = nullptr;
+  }
 }
 
 
@@ -225,11 +230,30 @@ int8_t IdentityPubKey::sign(uint8_t* in, size_t in_len, uint8_t* out, size_t* ou
 }
 
 
+/*
+* The public key is parsed once, on the first call. If the back-end can't give
+*   us a parsed key (because the algorithm is provided by the user, perhaps),
+*   every call goes through the stateless path.
+*/
 int8_t IdentityPubKey::verify(uint8_t* in, size_t in_len, uint8_t* out, size_t* out_len) {
-  if (_sig_size && out_len && (_sig_size <= *out_len)) {
-    int ret = wrapped_sign_verify(_cipher, _key_type, _digest,
-      in, in_len, out, out_len, _pub, _pub_size, OP_VERIFY
-    );
+  // Signatures may be shorter than the largest our key can make (DER-encoded
+  //   ECDSA signatures usually are), but not longer.
+  if (_sig_size && out_len && (*out_len <= _sig_size)) {
+    if ((nullptr == _verify_ctx) && (0 < _pub_size)) {
+      _verify_ctx = (PKContext*) malloc(sizeof(PKContext));
+      if (nullptr != _verify_ctx) {
+        if (0 != wrapped_pk_init(_verify_ctx, _cipher, _key_type, _pub, _pub_size, OP_VERIFY)) {
+          wrapped_pk_free(_verify_ctx);
+          free(_verify_ctx);
+          _verify_ctx = nullptr;
+        }
+      }
+    }
+    int ret = (nullptr != _verify_ctx) ?
+      wrapped_pk_sign_verify(_verify_ctx, _digest, in, in_len, out, out_len) :
+      wrapped_sign_verify(_cipher, _key_type, _digest,
+        in, in_len, out, out_len, _pub, _pub_size, OP_VERIFY
+      );
     if (0 == ret) {
       return 0;
     }
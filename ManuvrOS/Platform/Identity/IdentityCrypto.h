@@ -60,6 +60,10 @@ class IdentityPubKey : public Identity {
     Hashes    _digest      = Hashes::NONE;
 
   private:
+    // The public key, parsed on first verify() and kept for the life of the
+    //   identity. Only one thread may verify() against a given identity at once.
+    PKContext* _verify_ctx = nullptr;
+
     static const size_t _SERIALIZED_LEN;
 };
 #endif  // __BUILD_HAS_ASYMMETRIC
@@ -0,0 +1,432 @@
+/*
+File:   IdentityVerifier.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "../Cryptographic.h"
+
+#if defined(__HAS_CRYPT_WRAPPER)
+#include "IdentityVerifier.h"
+
+#if defined(__BUILD_HAS_ASYMMETRIC)
+#include <stdlib.h>
+#include <Kernel.h>
+#include <Platform/Platform.h>
+
+#if defined(__MANUVR_LINUX)
+  #include <pthread.h>
+  #include <signal.h>
+#endif
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+uint32_t IdentityVerifier::_batches   = 0;
+uint32_t IdentityVerifier::_verified  = 0;
+uint32_t IdentityVerifier::_rejected  = 0;
+uint64_t IdentityVerifier::_busy_us   = 0;
+uint32_t IdentityVerifier::_last_rate = 0;
+
+const MessageTypeDef message_defs_ident_verifier[] = {
+  {  MANUVR_MSG_IDENT_VERIFIED,  0x0000,  "IDENT_VERIFIED",  ManuvrMsg::MSG_ARGS_NONE }, // A batch of verifications is finished.
+};
+
+// How many jobs does a worker take from its queue at once?
+#define IDENT_VERIFY_TAKE  16
+
+#if defined(__MANUVR_LINUX)
+/*
+* Each worker has its own queue, so that all of an identity's jobs are run by
+*   the same thread. The queue is a ring of job pointers that grows as needed.
+*/
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  VerifyJob**     q;
+  uint32_t        head;
+  uint32_t        count;
+  uint32_t        cap;
+  unsigned long   thread_id;
+} VerifyWorker;
+
+static VerifyWorker   _workers[IDENT_VERIFY_WORKERS];
+static pthread_once_t _verifier_once = PTHREAD_ONCE_INIT;
+
+
+/*
+* Which worker runs jobs for the given identity?
+*/
+static inline uint32_t _worker_for(IdentityPubKey* ident) {
+  return ((uint32_t) ((((uintptr_t) ident) >> 4) * 0x9E3779B1) >> 16) % IDENT_VERIFY_WORKERS;
+}
+
+
+/*
+* Appends a job to a worker's queue. Caller must hold the worker's lock.
+*
+* @return 0 on success, -1 if the queue could not grow.
+*/
+static int8_t _worker_push(VerifyWorker* w, VerifyJob* job) {
+  if (w->count == w->cap) {
+    const uint32_t n_cap = (0 == w->cap) ? 64 : (w->cap << 1);
+    VerifyJob** n_q = (VerifyJob**) malloc(n_cap * sizeof(VerifyJob*));
+    if (nullptr == n_q) return -1;
+    for (uint32_t i = 0; i < w->count; i++) {
+      n_q[i] = w->q[(w->head + i) % w->cap];
+    }
+    if (w->q) free(w->q);
+    w->q    = n_q;
+    w->cap  = n_cap;
+    w->head = 0;
+  }
+  w->q[(w->head + w->count) % w->cap] = job;
+  w->count++;
+  return 0;
+}
+#else
+static bool _verifier_ready = false;
+#endif  // __MANUVR_LINUX
+
+
+/*******************************************************************************
+* VerifyBatch                                                                  *
+*******************************************************************************/
+
+/**
+* Constructor.
+*
+* @param target The EventReceiver that should be told when the batch finishes.
+*/
+VerifyBatch::VerifyBatch(EventReceiver* target) : _target(target), _relay(this) {
+}
+
+
+/**
+* Destructor. If the batch is in flight, we wait for it to land. So a batch in
+*   flight must never be destroyed from the Kernel's thread.
+*/
+VerifyBatch::~VerifyBatch() {
+  _settle();
+  if (nullptr != _jobs) {
+    free(_jobs);
+    _jobs = nullptr;
+  }
+  _count = 0;
+  _cap   = 0;
+}
+
+
+/**
+* Adds a tuple to the batch. None of the buffers are copied, and they must
+*   remain valid until the batch is finished.
+*
+* @return 0 on success, -1 if the batch is in flight or we are out of memory.
+*/
+int8_t VerifyBatch::add(IdentityPubKey* ident, uint8_t* msg, size_t msg_len, uint8_t* sig, size_t sig_len) {
+  if (inFlight() || (nullptr == ident)) return -1;
+  if (_count == _cap) {
+    const uint32_t n_cap = (0 == _cap) ? 16 : (_cap << 1);
+    VerifyJob* n_jobs = (VerifyJob*) realloc(_jobs, n_cap * sizeof(VerifyJob));
+    if (nullptr == n_jobs) return -1;
+    _jobs = n_jobs;
+    _cap  = n_cap;
+  }
+  VerifyJob* job = &_jobs[_count++];
+  job->ident   = ident;
+  job->msg     = msg;
+  job->msg_len = msg_len;
+  job->sig     = sig;
+  job->sig_len = sig_len;
+  job->batch   = this;
+  job->result  = -1;
+  return 0;
+}
+
+
+/**
+* Empties the batch so that it can be reused. Its memory is kept.
+*
+* @return 0 on success, -1 if the batch is in flight.
+*/
+int8_t VerifyBatch::clear() {
+  if (inFlight()) return -1;
+  _count  = 0;
+  _passed = 0;
+  return 0;
+}
+
+
+/**
+* @return The rate at which the finished batch was checked.
+*/
+uint32_t VerifyBatch::verifiesPerSecond() {
+  const uint32_t elapsed = elapsedMicros();
+  return (0 < elapsed) ? (uint32_t) (((uint64_t) _count * 1000000) / elapsed) : 0;
+}
+
+
+/**
+* A batch stays in flight until the Kernel is finished with its event.
+*
+* @return true if the batch is in flight.
+*/
+bool VerifyBatch::inFlight() {
+  return (0 < __atomic_load_n(&_remaining, __ATOMIC_ACQUIRE));
+}
+
+
+/*
+* Called as each tuple is checked, possibly from many threads at once.
+*
+* @return true if the tuple was the last one outstanding.
+*/
+bool VerifyBatch::_job_done(VerifyJob* job) {
+  if (0 == job->result) {
+    __atomic_add_fetch(&_passed, 1, __ATOMIC_RELAXED);
+  }
+  // The last count is the finisher's hold, and is not dropped here.
+  return (1 == __atomic_sub_fetch(&_remaining, 1, __ATOMIC_ACQ_REL));
+}
+
+
+/*
+* Drops the finisher's hold. After this, the batch belongs to its owner again,
+*   and whoever called this must not touch it.
+*/
+void VerifyBatch::_release() {
+  __atomic_sub_fetch(&_remaining, 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+* Waits for the batch to land, if it is in flight.
+*/
+void VerifyBatch::_settle() {
+  while (inFlight()) {
+    yieldThread();
+  }
+}
+
+
+/*
+* The Kernel calls this once the batch's event has been delivered, and it will
+*   touch neither the batch nor this relay again. The event is its own to reap.
+*/
+int8_t VerifyBatch::Relay::callback_proc(ManuvrMsg* event) {
+  _batch->_release();
+  return EVENT_CALLBACK_RETURN_REAP;
+}
+
+
+/*******************************************************************************
+* IdentityVerifier                                                             *
+*******************************************************************************/
+
+/**
+* Registers our message, and starts the workers. Runs exactly once.
+*/
+void IdentityVerifier::_init() {
+  int mes_count = sizeof(message_defs_ident_verifier) / sizeof(MessageTypeDef);
+  ManuvrMsg::registerMessages(message_defs_ident_verifier, mes_count);
+  #if defined(__MANUVR_LINUX)
+    for (int i = 0; i < IDENT_VERIFY_WORKERS; i++) {
+      VerifyWorker* w = &_workers[i];
+      pthread_mutex_init(&w->lock, nullptr);
+      pthread_cond_init(&w->cond, nullptr);
+      w->q         = nullptr;
+      w->head      = 0;
+      w->count     = 0;
+      w->cap       = 0;
+      w->thread_id = 0;
+      ManuvrThreadOptions _t_opts;
+      _t_opts.thread_name = (char*) "ident_verify";
+      _t_opts.stack_sz    = 32768;   // An RSA verify needs a deep stack.
+      if (createThread(&w->thread_id, nullptr, _worker_loop, (void*) w, &_t_opts)) {
+        Kernel::log("IdentityVerifier: Failed to create worker thread.\n");
+      }
+    }
+  #else
+    _verifier_ready = true;
+  #endif
+}
+
+
+#if defined(__MANUVR_LINUX)
+/**
+* A worker's thread. Takes jobs from its queue a handful at a time, and runs them.
+*/
+void* IdentityVerifier::_worker_loop(void* arg) {
+  VerifyWorker* w = (VerifyWorker*) arg;
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGQUIT);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+  VerifyJob* taken[IDENT_VERIFY_TAKE];
+  while (platform.platformState() <= MANUVR_INIT_STATE_NOMINAL) {
+    uint32_t n = 0;
+    pthread_mutex_lock(&w->lock);
+    if (0 == w->count) {
+      // Wake up now and then to notice shutdown.
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += 100000000;
+      if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&w->cond, &w->lock, &until);
+    }
+    while ((n < IDENT_VERIFY_TAKE) && (0 < w->count)) {
+      taken[n++] = w->q[w->head];
+      w->head = (w->head + 1) % w->cap;
+      w->count--;
+    }
+    pthread_mutex_unlock(&w->lock);
+    for (uint32_t i = 0; i < n; i++) {
+      _run(taken[i]);
+    }
+  }
+  return nullptr;
+}
+#endif  // __MANUVR_LINUX
+
+
+/*
+* Checks one tuple, and finishes its batch if it was the last.
+*/
+void IdentityVerifier::_run(VerifyJob* job) {
+  VerifyBatch* batch = job->batch;
+  size_t sig_len = job->sig_len;
+  job->result = job->ident->verify(job->msg, job->msg_len, job->sig, &sig_len);
+  if (batch->_job_done(job)) {
+    _finished(batch);
+  }
+}
+
+
+/*
+* Accounts for a finished batch, and tells its target. The event belongs to the
+*   Kernel, and the batch's relay is its originator. So the batch is held in
+*   flight until the Kernel is finished with the event, and we must not touch
+*   the batch once it is raised.
+*/
+void IdentityVerifier::_finished(VerifyBatch* batch) {
+  batch->_end_us = micros();
+  __atomic_add_fetch(&_batches,  1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&_verified, batch->size(),   __ATOMIC_RELAXED);
+  __atomic_add_fetch(&_rejected, batch->failed(), __ATOMIC_RELAXED);
+  __atomic_add_fetch(&_busy_us,  batch->elapsedMicros(), __ATOMIC_RELAXED);
+  _last_rate = batch->verifiesPerSecond();
+  ManuvrMsg* done = Kernel::returnEvent(MANUVR_MSG_IDENT_VERIFIED, &batch->_relay);
+  if (nullptr != done) {
+    done->specific_target = batch->_target;
+  }
+  if (0 != Kernel::staticRaiseEvent(done)) {
+    // Refused outright. Nothing will call the relay, so let go now.
+    batch->_release();
+  }
+}
+
+
+/**
+* Begins checking a batch. On linux, this returns immediately, and the batch's
+*   event is raised from a worker thread when it is finished. Elsewhere, the
+*   batch is checked before this returns.
+*
+* @param  batch  The batch to check. Must not be empty, or already in flight.
+* @return 0 on success, -1 on failure.
+*/
+int8_t IdentityVerifier::submit(VerifyBatch* batch) {
+  if ((nullptr == batch) || batch->inFlight() || (0 == batch->size())) {
+    return -1;
+  }
+  const uint32_t count = batch->size();
+  batch->_passed    = 0;
+  batch->_remaining = count + 1;   // One more for the finisher's hold.
+  batch->_start_us  = micros();
+
+  #if defined(__MANUVR_LINUX)
+    pthread_once(&_verifier_once, _init);
+    // Tally each worker's share first, so that we can stop touching the batch
+    //   as soon as the last job is queued. From that point, it may finish.
+    uint32_t share[IDENT_VERIFY_WORKERS] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+      share[_worker_for(batch->job(i)->ident)]++;
+    }
+    uint32_t queued = 0;
+    for (uint32_t w_idx = 0; (w_idx < IDENT_VERIFY_WORKERS) && (queued < count); w_idx++) {
+      if (0 == share[w_idx]) continue;
+      VerifyWorker* w = &_workers[w_idx];
+      uint32_t left = share[w_idx];
+      pthread_mutex_lock(&w->lock);
+      for (uint32_t i = 0; (i < count) && (0 < left); i++) {
+        VerifyJob* job = batch->job(i);
+        if (w_idx == _worker_for(job->ident)) {
+          left--;
+          if (0 != _worker_push(w, job)) {
+            // We can't queue it. The worker may be using the same identity,
+            //   so we can't check it here either. It fails.
+            job->result = -1;
+            if (batch->_job_done(job)) _finished(batch);
+          }
+        }
+      }
+      queued += share[w_idx];
+      pthread_cond_signal(&w->cond);
+      pthread_mutex_unlock(&w->lock);
+    }
+  #else
+    if (!_verifier_ready) _init();
+    for (uint32_t i = 0; i < count; i++) {
+      _run(batch->job(i));
+    }
+  #endif
+  return 0;
+}
+
+
+/**
+* Debug support method.
+*
+* @param output The buffer to receive the output.
+*/
+void IdentityVerifier::printDebug(StringBuilder* output) {
+  output->concatf("-- IdentityVerifier (%d workers)\n", IDENT_VERIFY_WORKERS);
+  output->concatf("\t Batches           %u\n", _batches);
+  output->concatf("\t Verified          %u\n", _verified);
+  output->concatf("\t Rejected          %u\n", _rejected);
+  if (0 < _busy_us) {
+    output->concatf("\t Verifies/sec      %u (last batch %u)\n", (uint32_t) (((uint64_t) _verified * 1000000) / _busy_us), _last_rate);
+  }
+}
+
+#endif  // __BUILD_HAS_ASYMMETRIC
+#endif  // __HAS_CRYPT_WRAPPER
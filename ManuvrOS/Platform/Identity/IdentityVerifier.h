@@ -0,0 +1,144 @@
+/*
+File:   IdentityVerifier.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Batched signature verification against IdentityPubKey.
+
+A VerifyBatch collects (identity, message, signature) tuples. Once submitted,
+  the tuples are spread over IDENT_VERIFY_WORKERS threads, and an event
+  (MANUVR_MSG_IDENT_VERIFIED) is raised to the batch's target when the last of
+  them is checked. The target can then read the result of each tuple from
+  the batch. raised() tells which batch a given event is for.
+The batch stays in flight until the Kernel is finished with that event. Only
+  then may it be cleared, resubmitted, or destroyed. So a target that wants to
+  reuse the batch should do so after its notify() has returned.
+
+Every tuple for a given identity goes to the same worker, because an
+  identity's parsed key may only be used by one thread at a time. The caller
+  should not verify() against an identity that is in a batch in flight.
+
+This is threaded on linux only. Elsewhere, submit() verifies the batch before
+  it returns, and the event is raised all the same.
+*/
+
+#ifndef __MANUVR_IDENTITY_VERIFIER_H__
+#define __MANUVR_IDENTITY_VERIFIER_H__
+
+#include <Platform/Identity.h>
+#include <ManuvrMsg/ManuvrMsg.h>
+#include <EventReceiver.h>
+
+#if defined(__BUILD_HAS_ASYMMETRIC)
+
+#define MANUVR_MSG_IDENT_VERIFIED   0x9060  // A batch of signature verifications is finished.
+
+// How many verification threads should we run?
+#ifndef IDENT_VERIFY_WORKERS
+  #define IDENT_VERIFY_WORKERS 4
+#endif
+
+class VerifyBatch;
+class IdentityVerifier;
+
+/*
+* One signature to be checked.
+*/
+typedef struct {
+  IdentityPubKey* ident;
+  uint8_t*        msg;
+  size_t          msg_len;
+  uint8_t*        sig;
+  size_t          sig_len;
+  VerifyBatch*    batch;
+  int8_t          result;     // 0 if the signature is good. Only valid once the batch is finished.
+                              // -1 if it is bad, or could not be queued for want of memory.
+} VerifyJob;
+
+
+class VerifyBatch {
+  public:
+    VerifyBatch(EventReceiver* target);
+    ~VerifyBatch();
+
+    int8_t add(IdentityPubKey*, uint8_t* msg, size_t msg_len, uint8_t* sig, size_t sig_len);
+    int8_t clear();
+
+    uint32_t verifiesPerSecond();
+    bool     inFlight();
+
+    inline uint32_t   size() {         return _count;                    };
+    inline VerifyJob* job(uint32_t i) {  return &_jobs[i];               };
+    inline uint32_t   passed() {       return _passed;                   };
+    inline uint32_t   failed() {       return (_count - _passed);        };
+    inline uint32_t   elapsedMicros() {  return (uint32_t) (_end_us - _start_us);  };
+    inline bool       raised(ManuvrMsg* m) {  return m->isOriginator(&_relay);  };
+
+
+  private:
+    /* Lets go of the batch once the Kernel is finished with its event. */
+    class Relay : public EventReceiver {
+      public:
+        Relay(VerifyBatch* b) : EventReceiver("VerifyBatch"), _batch(b) {};
+        int8_t callback_proc(ManuvrMsg*);
+
+      private:
+        VerifyBatch* _batch;
+    };
+
+    friend class IdentityVerifier;
+    VerifyJob*    _jobs      = nullptr;
+    uint32_t      _count     = 0;
+    uint32_t      _cap       = 0;
+    uint32_t      _remaining = 0;   // Tuples not yet checked, plus the finisher's hold.
+    uint32_t      _passed    = 0;
+    unsigned long _start_us  = 0;
+    unsigned long _end_us    = 0;
+    EventReceiver* _target;
+    Relay         _relay;
+
+    bool _job_done(VerifyJob*);
+    void _release();
+    void _settle();
+};
+
+
+class IdentityVerifier {
+  public:
+    static int8_t submit(VerifyBatch*);
+
+    static void printDebug(StringBuilder*);
+
+
+  private:
+    static uint32_t      _batches;     // How many batches have we finished?
+    static uint32_t      _verified;    // How many tuples have we checked?
+    static uint32_t      _rejected;    // How many of those failed?
+    static uint64_t      _busy_us;     // Sum of wall time spent on finished batches.
+    static uint32_t      _last_rate;   // Verifies per second of the last finished batch.
+
+    static void  _init();
+    static void  _run(VerifyJob*);
+    static void  _finished(VerifyBatch*);
+    #if defined(__MANUVR_LINUX)
+      static void* _worker_loop(void*);
+    #endif
+};
+
+#endif  // __BUILD_HAS_ASYMMETRIC
+#endif  // __MANUVR_IDENTITY_VERIFIER_H__
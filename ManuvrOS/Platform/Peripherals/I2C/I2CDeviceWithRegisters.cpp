@@ -282,19 +282,22 @@ int8_t I2CDeviceWithRegisters::syncRegisters() {
   DeviceRegister *temp = nullptr;
   int8_t return_value = I2C_ERR_SLAVE_NO_ERROR;
   unsigned int count = reg_defs.count();
-  for (unsigned int i = 0; i < count; i++) {
+  unsigned int i = 0;
+  while (i < count) {
+    uint16_t len = 0;
+    unsigned int run = _burst_from(i, false, &len);
     temp = reg_defs.get(i);
     if (temp) {   // Safety-check that an out-of-bounds reg wasn't in the list...
-      return_value = readRegister(temp);
-      #ifdef MANUVR_DEBUG
-      if (return_value != I2C_ERR_SLAVE_NO_ERROR) {
+      if (!readX(temp->addr, len, (uint8_t*) temp->val)) {
+        return_value = I2C_ERR_SLAVE_BUS_FAULT;
+        #ifdef MANUVR_DEBUG
         StringBuilder output;
         output.concatf("Failed to read from register %d\n", temp->addr);
         Kernel::log(&output);
+        #endif
       }
-      #endif
     }
-    return_value = I2C_ERR_SLAVE_UNDEFD_REG;
+    i += run;
   }
   return return_value;
 }
@@ -329,11 +332,25 @@ int8_t I2CDeviceWithRegisters::writeDirtyRegisters() {
   int8_t return_value = I2C_ERR_SLAVE_NO_ERROR;
   DeviceRegister *temp = nullptr;
   unsigned int count = reg_defs.count();
-  for (unsigned int i = 0; i < count; i++) {
+  unsigned int i = 0;
+  while (i < count) {
+    unsigned int run = 1;
     temp = reg_defs.get(i);
-    if (temp->dirty) {
+    if (temp->dirty && !temp->op_pending) {   // Skip what is already on its way out.
       if (temp->writable) {
-        return_value = writeRegister(temp);
+        uint16_t len = 0;
+        run = _burst_from(i, true, &len);
+        if (1 == run) {
+          return_value = writeRegister(temp);
+        }
+        else if (writeX(temp->addr, len, (uint8_t*) temp->val)) {
+          for (unsigned int n = 0; n < run; n++) {
+            reg_defs.get(i + n)->op_pending = true;
+          }
+        }
+        else {
+          return_value = I2C_ERR_SLAVE_BUS_FAULT;
+        }
         if (return_value != I2C_ERR_SLAVE_NO_ERROR) {
           #ifdef MANUVR_DEBUG
           StringBuilder output;
@@ -351,11 +368,43 @@ int8_t I2CDeviceWithRegisters::writeDirtyRegisters() {
         #endif
       }
     }
+    i += run;
   }
   return return_value;
 }
 
 
+/*
+* Finds the run of registers, starting at the given index, that can be moved
+*   in one transfer. A register joins the run if it follows the last one both
+*   on the device and in memory. For writes, it must also be dirty, writable,
+*   and not already on its way out.
+*
+* @param  idx        The index (in reg_defs) of the first register.
+* @param  for_write  Are we building a write?
+* @param  len        Receives the length of the run in bytes.
+* @return The number of registers in the run. Never less than one.
+*/
+unsigned int I2CDeviceWithRegisters::_burst_from(unsigned int idx, bool for_write, uint16_t* len) {
+  DeviceRegister* prev = reg_defs.get(idx);
+  unsigned int run = 1;
+  *len = prev->len;
+  if (multi_access_support) {
+    const unsigned int count = reg_defs.count();
+    while ((idx + run) < count) {
+      DeviceRegister* nxt = reg_defs.get(idx + run);
+      if ((nxt->addr != (prev->addr + prev->len)) || (nxt->val != (prev->val + prev->len))) break;
+      if ((*len + nxt->len) > I2C_MAX_BURST_LEN) break;
+      if (for_write && !(nxt->dirty && nxt->writable && !nxt->op_pending)) break;
+      *len += nxt->len;
+      prev = nxt;
+      run++;
+    }
+  }
+  return run;
+}
+
+
 /*******************************************************************************
 * ___     _       _                      These members are mandatory overrides
 *  |   / / \ o   | \  _     o  _  _      for implementing I/O callbacks. They
@@ -374,9 +423,16 @@ int8_t I2CDeviceWithRegisters::io_op_callback(BusOp* _op) {
 
   if (completed) {
     DeviceRegister* reg = getRegisterByBaseAddress(completed->sub_addr);
-    reg->op_pending = false;
-    if (!completed->hasFault()) {
-      if (reg) {
+    // A burst covers every register from sub_addr until the length is spent.
+    int remaining = multi_access_support ? completed->bufferLen() : 0;
+    if (nullptr == reg) {
+      #ifdef MANUVR_DEBUG
+      Kernel::log("I2CDeviceWithRegisters::io_op_callback(): register lookup failed.\n");
+      #endif
+    }
+    while (reg) {
+      reg->op_pending = false;
+      if (!completed->hasFault()) {
         switch (completed->get_opcode()) {
           case BusOpcode::RX:
             reg->unread = true;
@@ -392,13 +448,10 @@ int8_t I2CDeviceWithRegisters::io_op_callback(BusOp* _op) {
             break;
         }
       }
-      else {
-        #ifdef MANUVR_DEBUG
-        Kernel::log("I2CDeviceWithRegisters::io_op_callback(): register lookup failed.\n");
-        #endif
-      }
+      remaining -= reg->len;
+      reg = (0 < remaining) ? getRegisterByBaseAddress(reg->addr + reg->len) : nullptr;
     }
-    else {
+    if (completed->hasFault()) {
       #ifdef MANUVR_DEBUG
       Kernel::log("I2CDeviceWithRegisters::io_op_callback(): i2c operation errored.\n");
       #endif
@@ -37,6 +37,11 @@ This file is the tortured result of growing pains since the beginning of
 #ifndef __PLATFORM_I2C_EXTENSION_H__
 #define __PLATFORM_I2C_EXTENSION_H__
 
+/* The longest burst that register coalescing will build. */
+#ifndef I2C_MAX_BURST_LEN
+  #define I2C_MAX_BURST_LEN  32
+#endif
+
 /*
 * This class is an extension of I2CDevice for the special (most common) case where the
 *   device being represented has an internal register set. This extended class just takes
@@ -53,7 +58,14 @@ class I2CDeviceWithRegisters : public I2CDevice {
 
   protected:
     RingBuffer<DeviceRegister*> reg_defs;      // Here is where registers will be enumerated.
-    bool      multi_access_support = false;    // TODO: Make this happen! Depends on _pooled_reg_mem.
+
+    /*
+    * Set this if the device auto-increments its register pointer. Registers
+    *   that are adjacent both on the device and in _pooled_reg_mem (which is
+    *   the case if they were defined in address order) will then be moved
+    *   in a single burst by syncRegisters() and writeDirtyRegisters().
+    */
+    bool      multi_access_support = false;
 
 
     // Callback for requested operation completion.
@@ -99,6 +111,8 @@ class I2CDeviceWithRegisters : public I2CDevice {
   private:
     uint8_t* _pooled_reg_mem  = nullptr;
 
+    unsigned int _burst_from(unsigned int idx, bool for_write, uint16_t* len);
+
     int8_t writeRegister(DeviceRegister* reg);
     int8_t readRegister(DeviceRegister* reg);
 };
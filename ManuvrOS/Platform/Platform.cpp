@@ -574,6 +574,19 @@ int wakeThread(unsigned long _thread_id) {
 }
 
 
+#if !defined(__MANUVR_LINUX)
+/*
+* Platforms that drive the scheduler from a timer ISR have nothing to do here.
+*/
+int kernelWait(uint32_t max_ms) {
+  return 0;
+}
+
+void kernelWake() {
+}
+#endif
+
+
 /**
 * Wrapper for causing threads to sleep. This is NOT intended to be used as a delay
 *   mechanism, although that use-case will work. It is more for the sake of not
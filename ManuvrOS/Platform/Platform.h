@@ -361,6 +361,14 @@ int createThread(unsigned long*, void*, ThreadFxnPtr, void*, ManuvrThreadOptions
 int deleteThread(unsigned long*);
 int wakeThread(unsigned long);
 
+/*
+* Kernel sleep and wake. kernelWait() advances the scheduler, and blocks for up
+*   to the given number of milliseconds, or until kernelWake() is called from
+*   any thread. Platforms that can't block return immediately.
+*/
+int  kernelWait(uint32_t max_ms);
+void kernelWake();
+
 #if defined(__BUILD_HAS_PTHREADS)
   inline int  yieldThread() {    return pthread_yield();   };
   inline void suspendThread() {  sleep_millis(100);        };   // TODO
@@ -6,6 +6,7 @@
 #include <Kernel.h>
 
 #if defined(CONFIG_MANUVR_I2C)
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
@@ -15,79 +16,206 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include "I2CSimBus.h"
 
+/*
+* Transfers are done with I2C_RDWR, which takes a list of messages, each with
+*   its own slave address, and runs them as one transaction with repeated
+*   STARTs between them. So there is no I2C_SLAVE ioctl when we change
+*   devices, a register read is a single call, and any BusOps that are
+*   waiting when the worker wakes are moved together in one call.
+*/
+#ifndef I2C_RDWR_MAX_OPS
+  #define I2C_RDWR_MAX_OPS  16   // BusOps packed into one I2C_RDWR. Two messages each at most.
+#endif
+
+#ifndef I2C_RDWR_SCRATCH_BYTES
+  #define I2C_RDWR_SCRATCH_BYTES  64   // Sub-addresses and write payloads for one packed I2C_RDWR.
+#endif
+
+static_assert(I2C_RDWR_SCRATCH_BYTES >= I2C_RDWR_MAX_OPS, "I2C_RDWR_SCRATCH_BYTES must hold a sub-address for every op.");
+
+/* Values passed to I2CBusOp::advance() by the worker thread. */
+#define I2C_RDWR_STATUS_RUN    0x00   // Do the transfer, alone.
+#define I2C_RDWR_STATUS_DONE   0x01   // The transfer was done in a batch.
+#define I2C_RDWR_STATUS_FAIL   0x02   // The transfer was tried and failed.
 
 int open_bus_handle = -1;        //TODO: This is a hack. Re-work it.
-int8_t  last_used_bus_addr = 0;  //TODO: This is a hack. Re-work it.
 pthread_t _thread_id = 0;
 
+/* BusOps that have begun, but have not been moved. Guarded by _i2c_lock. */
+static pthread_mutex_t _i2c_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  _i2c_cond = PTHREAD_COND_INITIALIZER;
+static I2CBusOp*       _pending[I2C_RDWR_MAX_OPS];
+static unsigned int    _pending_count = 0;
 
-I2CBusOp* _threaded_op = nullptr;
+/* Stats. Written only by the worker thread. */
+static uint32_t _stat_rdwr_calls = 0;   // How many I2C_RDWR calls have we made?
+static uint32_t _stat_rdwr_ops   = 0;   // How many BusOps did they carry?
+static uint32_t _stat_batch_max  = 0;   // Most BusOps in one call.
+static uint32_t _stat_batch_faults = 0; // Batches that failed, faulting every op in them.
 
-void* i2c_worker_thread(void* arg) {
-  //I2CAdapter* adapter = (I2CAdapter*) arg;
-  while (!platform.nominalState()) {
-    sleep_millis(80);
+
+/*
+* Hands a list of messages to the kernel, or to the simulator.
+*
+* @return The number of messages transferred, or -1 on failure.
+*/
+static int _i2c_rdwr(struct i2c_msg* msgs, unsigned int count) {
+  _stat_rdwr_calls++;
+  if (I2CSimBus::enabled()) {
+    return I2CSimBus::transfer(msgs, count);
   }
-  while (platform.nominalState()) {
-    if (_threaded_op) {
-      _threaded_op->advance(0);
-      _threaded_op = nullptr;
-      yieldThread();
-    }
-    else {
-      suspendThread();
-    }
+  struct i2c_rdwr_ioctl_data xfer = { msgs, count };
+  return ioctl(open_bus_handle, I2C_RDWR, &xfer);
+}
+
+
+/*
+* How many bytes of scratch will the given BusOp need to be packed?
+*/
+static int _scratch_len(I2CBusOp* op) {
+  return (BusOpcode::TX == op->get_opcode()) ? (op->bufferLen() + 1) : 1;
+}
+
+
+/*
+* Writes the messages for a single BusOp into msgs.
+* RX is a write of the sub-address, then a read with a repeated START.
+* TX is the sub-address and the payload in one write.
+*
+* @param  op       The BusOp to pack.
+* @param  msgs     Room for at least two messages.
+* @param  scratch  Room for _scratch_len(op) bytes. Must outlive the transfer.
+* @return The number of messages written, or -1 if the op can't be expressed.
+*/
+static int _pack_op(I2CBusOp* op, struct i2c_msg* msgs, uint8_t* scratch) {
+  const uint16_t addr = (uint16_t) (op->dev_addr & 0x7F);
+  scratch[0] = (uint8_t) (op->sub_addr & 0x00FF);
+  switch (op->get_opcode()) {
+    case BusOpcode::RX:
+      msgs[0] = { addr, 0, 1, scratch };
+      msgs[1] = { addr, I2C_M_RD, (uint16_t) op->bufferLen(), op->buffer() };
+      return 2;
+    case BusOpcode::TX:
+      for (int i = 0; i < op->bufferLen(); i++) scratch[i + 1] = *(op->buffer() + i);
+      msgs[0] = { addr, 0, (uint16_t) (op->bufferLen() + 1), scratch };
+      return 1;
+    case BusOpcode::TX_CMD:
+      msgs[0] = { addr, 0, 1, scratch };
+      return 1;
+    default:
+      return -1;
   }
-  return nullptr;
 }
 
 
 /*
-* Private function that will switch the addressed i2c device via ioctl. This
-*   function is meaningless on anything but a linux system, in which case it
-*   will always return true;
-* On a linux system, this will only return true if the ioctl call succeeded.
+* Moves the given BusOps in a single I2C_RDWR. If that fails, we can't know how
+*   far it got, and the ops ahead of the failure may already have changed their
+*   devices (reading a FIFO or a latched status register clears it). So nothing
+*   is replayed. Every op in a failed transfer is faulted, and whoever issued
+*   it decides whether to try again.
+* A write too long for the scratch space is run by itself, after the others.
 */
-bool switch_device(I2CAdapter* adapter, uint8_t nu_addr) {
-  bool return_value = false;
-  unsigned short timeout = 10000;
-  if (nu_addr != last_used_bus_addr) {
-    if (open_bus_handle < 0) {
-      // If the bus is either uninitiallized or not idle, decline
-      // to switch the device. Return false;
-      #ifdef MANUVR_DEBUG
-      Kernel::log("i2c bus is not online, so won't switch device. Failing....\n");
-      #endif
-      return return_value;
+static void _run_packed(I2CBusOp** ops, unsigned int count) {
+  if (1 == count) {
+    ops[0]->advance(I2C_RDWR_STATUS_RUN);
+    return;
+  }
+
+  struct i2c_msg msgs[I2C_RDWR_MAX_OPS * 2];
+  uint8_t   scratch[I2C_RDWR_SCRATCH_BYTES];
+  I2CBusOp* alone     = nullptr;
+  unsigned int msg_count = 0;
+  unsigned int packed    = 0;
+  int offset = 0;
+
+  for (unsigned int i = 0; i < count; i++) {
+    if ((offset + _scratch_len(ops[i])) > (int) sizeof(scratch)) {
+      alone  = ops[i];   // Only ever the last op. See _run_batch().
+      ops[i] = nullptr;
+      continue;
+    }
+    int n = _pack_op(ops[i], &msgs[msg_count], &scratch[offset]);
+    if (n < 0) {
+      ops[i]->advance(I2C_RDWR_STATUS_FAIL);
+      ops[i] = nullptr;
     }
     else {
-      while (adapter->busError() && (timeout > 0)) { timeout--; }
-      if (adapter->busError()) {
-        #ifdef MANUVR_DEBUG
-        Kernel::log("i2c bus was held for too long. Failing....\n");
-        #endif
-        return return_value;
-      }
+      msg_count += n;
+      offset    += _scratch_len(ops[i]);
+      packed++;
+    }
+  }
 
-      if (ioctl(open_bus_handle, I2C_SLAVE, nu_addr) >= 0) {
-        last_used_bus_addr = nu_addr;
-        return_value = true;
-      }
-      else {
-        #ifdef MANUVR_DEBUG
-        StringBuilder local_log;
-        local_log.concatf("Failed to acquire bus access and/or talk to slave at %d.\n", nu_addr);
-        Kernel::log(&local_log);
-        #endif
-        adapter->busError(true);
+  if (0 < msg_count) {
+    const bool ok = (_i2c_rdwr(msgs, msg_count) == (int) msg_count);
+    if (!ok) _stat_batch_faults++;
+    else {
+      _stat_rdwr_ops += packed;
+      if (packed > _stat_batch_max) _stat_batch_max = packed;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+      if (nullptr != ops[i]) {
+        ops[i]->advance(ok ? I2C_RDWR_STATUS_DONE : I2C_RDWR_STATUS_FAIL);
       }
     }
   }
-  else {
-    return_value = true;
+  if (nullptr != alone) alone->advance(I2C_RDWR_STATUS_RUN);
+}
+
+
+/*
+* Packs the given BusOps into as few transfers as we safely can, in order.
+* The bus stops at the first message that fails, and every op in a failed
+*   transfer is faulted. So a write is only ever the last op in a transfer,
+*   and no transfer leaves more than one write in doubt.
+*/
+static void _run_batch(I2CBusOp** ops, unsigned int count) {
+  unsigned int start = 0;
+  while (start < count) {
+    unsigned int end = start;
+    while (((end + 1) < count) && (BusOpcode::RX == ops[end]->get_opcode())) end++;
+    _run_packed(&ops[start], (end - start) + 1);
+    start = end + 1;
   }
-  return return_value;
+}
+
+
+void* i2c_worker_thread(void* arg) {
+  //I2CAdapter* adapter = (I2CAdapter*) arg;
+  I2CBusOp* batch[I2C_RDWR_MAX_OPS];
+  while (!platform.nominalState()) {
+    sleep_millis(80);
+  }
+  while (platform.nominalState()) {
+    unsigned int count = 0;
+    pthread_mutex_lock(&_i2c_lock);
+    if (0 == _pending_count) {
+      // Wake up now and then to notice shutdown.
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += 100000000;
+      if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&_i2c_cond, &_i2c_lock, &until);
+    }
+    count = _pending_count;
+    for (unsigned int i = 0; i < count; i++) batch[i] = _pending[i];
+    _pending_count = 0;
+    pthread_mutex_unlock(&_i2c_lock);
+
+    if (count) {
+      _run_batch(batch, count);
+      yieldThread();
+    }
+  }
+  return nullptr;
 }
 
 
@@ -101,7 +229,12 @@ bool switch_device(I2CAdapter* adapter, uint8_t nu_addr) {
 int8_t I2CAdapter::bus_init() {
   char *filename = (char *) alloca(24);
   *filename = 0;
-  if (sprintf(filename, "/dev/i2c-%d", adapterNumber()) > 0) {
+  if (I2CSimBus::enabled()) {
+    // No device node. Transfers go to the in-process simulator.
+    createThread(&_thread_id, nullptr, i2c_worker_thread, (void*) this, nullptr);
+    busOnline(true);
+  }
+  else if (sprintf(filename, "/dev/i2c-%d", adapterNumber()) > 0) {
     open_bus_handle = open(filename, O_RDWR);
     if (open_bus_handle < 0) {
       // TODO?
@@ -134,6 +267,7 @@ int8_t I2CAdapter::bus_deinit() {
     Kernel::log("Closing the open i2c bus...\n");
     #endif
     close(open_bus_handle);
+    open_bus_handle = -1;
   }
   return 0;
 }
@@ -141,6 +275,12 @@ int8_t I2CAdapter::bus_deinit() {
 
 void I2CAdapter::printHardwareState(StringBuilder* output) {
   output->concatf("-- I2C%d (%sline)\n", adapterNumber(), (_adapter_flag(I2C_BUS_FLAG_BUS_ONLINE)?"on":"OFF"));
+  output->concatf("\tI2C_RDWR calls      %u\n", _stat_rdwr_calls);
+  output->concatf("\tBatched ops         %u (max %u per call)\n", _stat_rdwr_ops, _stat_batch_max);
+  output->concatf("\tFailed batches      %u\n", _stat_batch_faults);
+  if (I2CSimBus::enabled()) {
+    I2CSimBus::printDebug(output);
+  }
 }
 
 
@@ -164,32 +304,37 @@ int8_t I2CAdapter::generateStop() {
 *******************************************************************************/
 
 XferFault I2CBusOp::begin() {
-  if (nullptr == _threaded_op) {
-    if (device) {
-      switch (device->adapterNumber()) {
-        case 0:
-        case 1:
-          if ((nullptr == callback) || (0 == callback->io_op_callahead(this))) {
-            set_state(XferState::INITIATE);
-            _threaded_op = this;
+  if (device) {
+    switch (device->adapterNumber()) {
+      case 0:
+      case 1:
+        if ((nullptr == callback) || (0 == callback->io_op_callahead(this))) {
+          bool queued = false;
+          set_state(XferState::INITIATE);
+          pthread_mutex_lock(&_i2c_lock);
+          if (_pending_count < I2C_RDWR_MAX_OPS) {
+            _pending[_pending_count++] = this;
+            queued = true;
+            pthread_cond_signal(&_i2c_cond);
+          }
+          pthread_mutex_unlock(&_i2c_lock);
+          if (queued) {
             //device->wake();  // TODO: Forgot what this was responsible for.
             return XferFault::NONE;
           }
-          else {
-            abort(XferFault::IO_RECALL);
-          }
-          break;
-        default:
-          abort(XferFault::BAD_PARAM);
-          break;
-      }
-    }
-    else {
-      abort(XferFault::DEV_NOT_FOUND);
+          abort(XferFault::BUS_BUSY);
+        }
+        else {
+          abort(XferFault::IO_RECALL);
+        }
+        break;
+      default:
+        abort(XferFault::BAD_PARAM);
+        break;
     }
   }
   else {
-    abort(XferFault::BUS_BUSY);
+    abort(XferFault::DEV_NOT_FOUND);
   }
 
   return getFault();
@@ -197,61 +342,47 @@ XferFault I2CBusOp::begin() {
 
 
 /*
-* Linux doesn't have a concept of interrupt, but we might call this
-*   from an I/O thread.
+* Linux doesn't have a concept of interrupt, but the I/O thread calls this
+*   with one of the I2C_RDWR_STATUS_* values. If the transfer was already
+*   done as part of a batch, we only need to finish up. Otherwise, the
+*   transfer is done here, by itself.
 */
 XferFault I2CBusOp::advance(uint32_t status_reg) {
   set_state(XferState::ADDR);
+  switch (status_reg) {
+    case I2C_RDWR_STATUS_DONE:
+      markComplete();
+      return getFault();
+    case I2C_RDWR_STATUS_FAIL:
+      abort(XferFault::BUS_FAULT);
+      return getFault();
+    default:
+      break;
+  }
+
   if (device->generateStart()) {
     // Failure to generate START condition.
     abort(XferFault::BUS_BUSY);
     return getFault();
   }
 
-  if (!switch_device(device, dev_addr)) {
+  struct i2c_msg msgs[2];
+  uint8_t scratch[_scratch_len(this)];
+  int msg_count = _pack_op(this, msgs, scratch);
+  if (msg_count < 0) {
     abort(XferFault::BUS_FAULT);
-    return getFault();
   }
-
-  if (get_opcode() == BusOpcode::RX) {
-    uint8_t sa = (uint8_t) (sub_addr & 0x00FF);
-
-    if (write(open_bus_handle, &sa, 1) == 1) {
-      if (read(open_bus_handle, _buf, _buf_len) == _buf_len) {
-        markComplete();
-      }
-      else {
-        abort(XferFault::BUS_FAULT);
-      }
-    }
-    else {
-      abort(XferFault::BUS_FAULT);
-    }
-  }
-  else if (get_opcode() == BusOpcode::TX) {
-    uint8_t buffer[_buf_len + 1];
-    buffer[0] = (uint8_t) (sub_addr & 0x00FF);
-
-    for (int i = 0; i < _buf_len; i++) buffer[i + 1] = *(_buf + i);
-
-    if (write(open_bus_handle, &buffer, _buf_len+1) == _buf_len+1) {
-      markComplete();
-    }
-    else {
-      abort(XferFault::BUS_FAULT);
-    }
-  }
-  else if (get_opcode() == BusOpcode::TX_CMD) {
-    uint8_t buffer[_buf_len + 1];
-    buffer[0] = (uint8_t) (sub_addr & 0x00FF);
-    if (write(open_bus_handle, &buffer, 1) == 1) {
-      markComplete();
-    }
-    else {
-      abort(XferFault::BUS_FAULT);
-    }
+  else if (_i2c_rdwr(msgs, (unsigned int) msg_count) == msg_count) {
+    _stat_rdwr_ops++;
+    if (0 == _stat_batch_max) _stat_batch_max = 1;
+    markComplete();
   }
   else {
+    #ifdef MANUVR_DEBUG
+    StringBuilder local_log;
+    local_log.concatf("I2C_RDWR failed for slave at 0x%02x (errno %d).\n", dev_addr, errno);
+    Kernel::log(&local_log);
+    #endif
     abort(XferFault::BUS_FAULT);
   }
 
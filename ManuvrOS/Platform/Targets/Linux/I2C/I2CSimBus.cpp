@@ -0,0 +1,137 @@
+/*
+File:   I2CSimBus.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "I2CSimBus.h"
+
+#if defined(CONFIG_MANUVR_I2C)
+#include <errno.h>
+#include <linux/i2c.h>
+
+I2CSimSlave* I2CSimBus::_slaves[I2C_SIM_MAX_SLAVES] = {};
+bool         I2CSimBus::_enabled   = false;
+uint32_t     I2CSimBus::_transfers = 0;
+uint32_t     I2CSimBus::_messages  = 0;
+uint32_t     I2CSimBus::_bytes     = 0;
+uint32_t     I2CSimBus::_bus_us    = 0;
+
+
+/**
+* @param  slave  The simulated slave to put on the bus.
+* @return 0 on success, -1 if the address is taken or the bus is full.
+*/
+int8_t I2CSimBus::attach(I2CSimSlave* slave) {
+  if ((nullptr == slave) || (nullptr != _find(slave->addr))) return -1;
+  for (int i = 0; i < I2C_SIM_MAX_SLAVES; i++) {
+    if (nullptr == _slaves[i]) {
+      _slaves[i] = slave;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+
+/**
+* @param  slave  The simulated slave to take off the bus.
+* @return 0 on success, -1 if it wasn't there.
+*/
+int8_t I2CSimBus::detach(I2CSimSlave* slave) {
+  for (int i = 0; i < I2C_SIM_MAX_SLAVES; i++) {
+    if (slave == _slaves[i]) {
+      _slaves[i] = nullptr;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+
+void I2CSimBus::resetStats() {
+  _transfers = 0;
+  _messages  = 0;
+  _bytes     = 0;
+  _bus_us    = 0;
+}
+
+
+I2CSimSlave* I2CSimBus::_find(uint8_t addr) {
+  for (int i = 0; i < I2C_SIM_MAX_SLAVES; i++) {
+    if ((nullptr != _slaves[i]) && (addr == _slaves[i]->addr)) {
+      return _slaves[i];
+    }
+  }
+  return nullptr;
+}
+
+
+/**
+* Runs a combined transaction against the simulated slaves. As with the real
+*   ioctl, the messages are run in order with repeated STARTs between them,
+*   and a NAK from any slave ends the transaction.
+*
+* @param  msgs   The messages that make up the transaction.
+* @param  count  How many messages there are.
+* @return The number of messages run, or -1 with errno set on failure.
+*/
+int I2CSimBus::transfer(struct i2c_msg* msgs, unsigned int count) {
+  _transfers++;
+  _bus_us += I2C_SIM_XFER_US;
+  for (unsigned int i = 0; i < count; i++) {
+    struct i2c_msg* m = &msgs[i];
+    _messages++;
+    _bus_us += I2C_SIM_START_US + I2C_SIM_BYTE_US;   // START and address byte.
+    I2CSimSlave* slave = _find((uint8_t) m->addr);
+    if (nullptr == slave) {
+      errno = ENXIO;   // Nobody ACK'd the address.
+      return -1;
+    }
+    if (m->flags & I2C_M_RD) {
+      for (unsigned int n = 0; n < m->len; n++) {
+        m->buf[n] = slave->regs[slave->ptr++];
+      }
+    }
+    else if (m->len > 0) {
+      slave->ptr = m->buf[0];
+      for (unsigned int n = 1; n < m->len; n++) {
+        slave->regs[slave->ptr++] = m->buf[n];
+      }
+    }
+    _bytes  += m->len;
+    _bus_us += m->len * I2C_SIM_BYTE_US;
+  }
+  return (int) count;
+}
+
+
+void I2CSimBus::printDebug(StringBuilder* output) {
+  output->concatf("-- I2CSimBus (%sabled)\n", (_enabled ? "en" : "dis"));
+  output->concatf("\ttransfers   %u\n", _transfers);
+  output->concatf("\tmessages    %u\n", _messages);
+  output->concatf("\tbytes       %u\n", _bytes);
+  output->concatf("\tbus time    %u us\n", _bus_us);
+  for (int i = 0; i < I2C_SIM_MAX_SLAVES; i++) {
+    if (nullptr != _slaves[i]) {
+      output->concatf("\tslave 0x%02x  ptr 0x%02x\n", _slaves[i]->addr, _slaves[i]->ptr);
+    }
+  }
+}
+
+#endif  // CONFIG_MANUVR_I2C
@@ -0,0 +1,94 @@
+/*
+File:   I2CSimBus.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+An in-process stand-in for /dev/i2c-N, so that the linux I2CAdapter can be
+  exercised without hardware.
+
+If the simulator is enabled before the adapter's bus_init(), the adapter
+  hands its I2C_RDWR transactions here instead of to the kernel. Each
+  attached slave is a 256-byte register file with an auto-incrementing
+  register pointer, which is how most register-mapped parts behave.
+
+Nothing here sleeps. Instead, the time that each transaction would have held
+  a real bus is tallied, so that tests can compare the cost of different
+  ways of moving the same data.
+*/
+
+#ifndef __MANUVR_LINUX_I2C_SIM_BUS_H__
+#define __MANUVR_LINUX_I2C_SIM_BUS_H__
+
+#include <inttypes.h>
+#include <StringBuilder.h>
+
+#if defined(CONFIG_MANUVR_I2C)
+
+struct i2c_msg;
+
+#define I2C_SIM_MAX_SLAVES   8
+
+/* Default bus timing, in microseconds. Roughly 100kHz with a syscall per transaction. */
+#define I2C_SIM_XFER_US     50   // Fixed cost of a transaction (the ioctl itself).
+#define I2C_SIM_START_US    10   // Each START or repeated START.
+#define I2C_SIM_BYTE_US     90   // Each byte on the wire, address bytes included.
+
+/*
+* One simulated slave device.
+*/
+typedef struct {
+  uint8_t  addr;        // 7-bit slave address.
+  uint8_t  ptr;         // Register pointer. Set by the first byte of a write.
+  uint8_t  regs[256];   // The register file.
+} I2CSimSlave;
+
+
+class I2CSimBus {
+  public:
+    static int8_t attach(I2CSimSlave*);
+    static int8_t detach(I2CSimSlave*);
+
+    /* The linux I2CAdapter checks this when it opens the bus. */
+    static inline void enable(bool x) {   _enabled = x;     };
+    static inline bool enabled() {        return _enabled;  };
+
+    /* Takes the place of ioctl(fd, I2C_RDWR, ...). Same return convention. */
+    static int transfer(struct i2c_msg* msgs, unsigned int count);
+
+    static inline uint32_t transfers() {  return _transfers;  };  // Transactions (ioctls).
+    static inline uint32_t messages() {   return _messages;   };  // Messages (STARTs).
+    static inline uint32_t bytes() {      return _bytes;      };  // Payload bytes moved.
+    static inline uint32_t busMicros() {  return _bus_us;     };  // Simulated bus time.
+    static void resetStats();
+
+    static void printDebug(StringBuilder*);
+
+
+  private:
+    static I2CSimSlave* _slaves[I2C_SIM_MAX_SLAVES];
+    static bool         _enabled;
+    static uint32_t     _transfers;
+    static uint32_t     _messages;
+    static uint32_t     _bytes;
+    static uint32_t     _bus_us;
+
+    static I2CSimSlave* _find(uint8_t addr);
+};
+
+#endif  // CONFIG_MANUVR_I2C
+#endif  // __MANUVR_LINUX_I2C_SIM_BUS_H__
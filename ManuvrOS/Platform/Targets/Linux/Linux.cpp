@@ -22,6 +22,9 @@ This file forms the catch-all for linux platforms that have no support.
 */
 
 #include <sys/time.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <poll.h>
 #include <unistd.h>
 #include <signal.h>
 
@@ -36,6 +39,10 @@ This file forms the catch-all for linux platforms that have no support.
 #include <Transports/StandardIO/StandardIO.h>
 #include <XenoSession/Console/ManuvrConsole.h>
 
+#if defined(MANUVR_SUPPORT_TCPSOCKET) || defined(MANUVR_SUPPORT_UDP)
+  #include <Transports/ManuvrSocket/SocketReactor.h>
+#endif
+
 
 /****************************************************************************************************
 * The code under this block is special on this platform, and will not be available elsewhere.       *
@@ -43,36 +50,87 @@ This file forms the catch-all for linux platforms that have no support.
 volatile Kernel* __kernel = nullptr;
 
 
-struct itimerval _interval              = {0};
-struct sigaction _signal_action_SIGALRM = {0};
-
 static uint32_t _last_millis = 0;
 
 char* _binary_name = nullptr;
 static int   _main_pid    = 0;
 
-bool set_linux_interval_timer() {
-  _last_millis = millis();
-  _interval.it_value.tv_sec      = 0;
-  _interval.it_value.tv_usec     = MANUVR_PLATFORM_TIMER_PERIOD_MS * 1000;
-  _interval.it_interval.tv_sec   = 0;
-  _interval.it_interval.tv_usec  = MANUVR_PLATFORM_TIMER_PERIOD_MS * 1000;
+/*
+* The Kernel's thread sleeps in poll() on these two descriptors.
+* The eventfd is written by anyone who raises an event while the Kernel sleeps.
+* The timerfd is armed for the next schedule deadline.
+*/
+static int _kernel_wake_fd  = -1;
+static int _kernel_timer_fd = -1;
+
+bool init_kernel_wait() {
+  _last_millis     = millis();
+  _kernel_wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  _kernel_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if ((0 > _kernel_wake_fd) || (0 > _kernel_timer_fd)) {
+    Kernel::log("Failed to create the kernel's wait descriptors.");
+    return false;
+  }
+  return true;
+}
+
 
-  int err = setitimer(ITIMER_VIRTUAL, &_interval, nullptr);
-  if (err) {
-    Kernel::log("Failed to enable interval timer.");
+/*
+* Advance the scheduler by however much wall-clock time has passed.
+*/
+static void linux_advance_scheduler() {
+  uint32_t _this_millis = millis();
+  if (_this_millis != _last_millis) {
+    ((Kernel*)__kernel)->advanceScheduler(_this_millis - _last_millis);
+    _last_millis = _this_millis;
   }
-  return (0 == err);
 }
 
-bool unset_linux_interval_timer() {
-  // TODO: We ultimately need to be retaining the values in the struct, as well as
-  //   the current system time to calculate the delta in case we get re-enabled.
-  _interval.it_value.tv_sec      = 0;
-  _interval.it_value.tv_usec     = 0;
-  _interval.it_interval.tv_sec   = 0;
-  _interval.it_interval.tv_usec  = 0;
-  return true;
+
+/**
+* Called by the Kernel at the end of every loop. We advance the scheduler from
+*   the monotonic clock, and if the Kernel has nothing to do, we block until it
+*   does.
+*
+* @param  max_ms  The longest we may block. Zero means "don't block".
+* @return 1 if we were woken by kernelWake(), 0 otherwise.
+*/
+int kernelWait(uint32_t max_ms) {
+  int return_value = 0;
+  if ((0 < max_ms) && (0 <= _kernel_wake_fd)) {
+    struct itimerspec _its = {{0, 0}, {(time_t) (max_ms / 1000), (long) ((max_ms % 1000) * 1000000L)}};
+    timerfd_settime(_kernel_timer_fd, 0, &_its, nullptr);
+
+    struct pollfd _fds[2] = {
+      { _kernel_wake_fd,  POLLIN, 0 },
+      { _kernel_timer_fd, POLLIN, 0 }
+    };
+    if (0 < poll(_fds, 2, -1)) {   // EINTR is just a spurious wake.
+      uint64_t _drain;
+      if (_fds[0].revents & POLLIN) {
+        if (sizeof(_drain) == read(_kernel_wake_fd, &_drain, sizeof(_drain))) {
+          return_value = 1;
+        }
+      }
+      if (_fds[1].revents & POLLIN) {
+        (void) read(_kernel_timer_fd, &_drain, sizeof(_drain));
+      }
+    }
+  }
+  linux_advance_scheduler();
+  return return_value;
+}
+
+
+/**
+* Wakes the Kernel if it is blocked in kernelWait(). Safe from any thread, and
+*   from signal handlers.
+*/
+void kernelWake() {
+  if (0 <= _kernel_wake_fd) {
+    const uint64_t _one = 1;
+    (void) write(_kernel_wake_fd, &_one, sizeof(_one));
+  }
 }
 
 
@@ -123,13 +181,6 @@ void sig_handler(int signo) {
   //}
 }
 
-void linux_timer_handler(int sig_num) {
-  unsigned long _this_millis = millis();
-  ((Kernel*)__kernel)->advanceScheduler(_this_millis - _last_millis);
-  _last_millis = _this_millis;
-}
-
-
 // The parent process should call this function to set the callback address to its signal handlers.
 //     Returns 1 on success, 0 on failure.
 // TODO: Convert all other signals over to sigaction().
@@ -161,12 +212,6 @@ int initSigHandlers() {
     return_value = 0;
   }
 
-  _signal_action_SIGALRM.sa_handler   = &linux_timer_handler;
-  if (sigaction(SIGVTALRM, &_signal_action_SIGALRM, nullptr)) {
-    Kernel::log("Failed to bind to SIGVTALRM.");
-    return_value = 0;
-  }
-
   return return_value;
 }
 
@@ -293,7 +338,6 @@ static void* dev_urandom_reader(void*) {
       rng_level = _random_pool_w_ptr - _random_pool_r_ptr;
       if (rng_level == PLATFORM_RNG_CARRY_CAPACITY) {
         // We have filled our entropy pool. Sleep.
-        // TODO: Implement wakeThread() and this can go way higher.
         sleep_millis(10);
       }
       else {
@@ -500,14 +544,12 @@ uint32_t millis() {
 // TODO: Perhaps raise the nice value?
 // At minimum, turn off the periodic timer, since this is what would happen on
 //   other platforms.
+// The scheduler is advanced by the Kernel's own thread in kernelWait(), so there
+//   is no timer to hold off.
 void globalIRQEnable() {
-  // TODO: Need to stack the time remaining.
-  //set_linux_interval_timer();
 }
 
 void globalIRQDisable() {
-  // TODO: Need to unstack the time remaining and fire any schedules.
-  //unset_linux_interval_timer();
 }
 
 
@@ -517,6 +559,9 @@ void globalIRQDisable() {
 *******************************************************************************/
 void LinuxPlatform::_close_open_threads() {
   _set_init_state(MANUVR_INIT_STATE_HALTED);
+  #if defined(MANUVR_SUPPORT_TCPSOCKET) || defined(MANUVR_SUPPORT_UDP)
+    SocketReactor::shutdown();   // The shards would otherwise wait on epoll forever.
+  #endif
   if (rng_thread_id) {
     if (0 == deleteThread(&rng_thread_id)) {
     }
@@ -686,6 +731,5 @@ int8_t LinuxPlatform::platformPreInit(Argument* root_config) {
 *   internal system sanity.
 */
 int8_t LinuxPlatform::platformPostInit() {
-  set_linux_interval_timer();
-  return 0;
+  return (init_kernel_wait() ? 0 : -1);
 }
@@ -19,9 +19,20 @@ limitations under the License.
 
 
 Data-persistence layer for linux.
-Implemented as a JSON object within a single file. This feature therefore
-  requires MANUVR_JSON. In the future, it may be made to operate on some
-  other encoding, be run through a cryptographic pipe, etc.
+Implemented as an append-only log of CRC-framed key-value records within a
+  single file. See the header for the particulars.
+
+Record layout (host byte-order):
+  uint32  CRC32 of everything that follows it in the record.
+  uint32  Value length.
+  uint16  Magic (LS_RECORD_MAGIC).
+  uint8   Key length.
+  uint8   Record flags.
+  ...     Key (not terminated).
+  ...     Value.
+
+A record that fails its CRC (or is cut short) marks the end of the log. It is
+  assumed to be a write that was torn by a crash, and is truncated at mount.
 */
 
 #include "LinuxStorage.h"
@@ -30,10 +41,29 @@ Implemented as a JSON object within a single file. This feature therefore
 #include <Platform/Platform.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <pthread.h>
 
 // We want this definition isolated to the compilation unit.
 #define STORAGE_PROPS (PL_FLAG_USES_FILESYSTEM | PL_FLAG_BLOCK_ACCESS)
 
+#define LS_RECORD_MAGIC      0x4C53
+#define LS_RECORD_HDR_LEN    12
+#define LS_RECORD_TOMBSTONE  0x01   // The key was erased.
+
+typedef struct __attribute__((packed)) {
+  uint32_t crc;
+  uint32_t val_len;
+  uint16_t magic;
+  uint8_t  key_len;
+  uint8_t  flags;
+} LSRecordHeader;
+
 
 /*******************************************************************************
 *      _______.___________.    ___   .___________. __    ______     _______.
@@ -46,6 +76,46 @@ Implemented as a JSON object within a single file. This feature therefore
 * Static members and initializers should be located here.
 *******************************************************************************/
 
+const MessageTypeDef message_defs_linux_storage[] = {
+  {  MANUVR_MSG_STORAGE_SYNC,   0x0000,  "STORAGE_SYNC",  ManuvrMsg::MSG_ARGS_NONE }, // Batched writes are due.
+};
+
+static uint32_t _crc_table[256];
+
+/* Builds the CRC32 (IEEE 802.3) table. Runs once. */
+static void _crc_init() {
+  if (0 != _crc_table[1]) return;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+    }
+    _crc_table[i] = c;
+  }
+}
+
+/* Continues a CRC32 over the given buffer. Start with a crc of zero. */
+static uint32_t _crc32(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc = _crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/* FNV-1a, for the index. */
+static uint32_t _key_hash(const char* key, uint8_t key_len) {
+  uint32_t h = 2166136261u;
+  for (uint8_t i = 0; i < key_len; i++) {
+    h = (h ^ (uint8_t) key[i]) * 16777619u;
+  }
+  return h;
+}
+
+static inline uint32_t _rec_len(uint8_t key_len, uint32_t val_len) {
+  return (LS_RECORD_HDR_LEN + key_len + val_len);
+}
+
 
 /*******************************************************************************
 *   ___ _              ___      _ _              _      _
@@ -58,6 +128,10 @@ Implemented as a JSON object within a single file. This feature therefore
 
 LinuxStorage::LinuxStorage(Argument* opts) : EventReceiver("LinuxStorage"), Storage() {
   _pl_set_flag(true, STORAGE_PROPS);
+  _crc_init();
+  pthread_mutex_init(&_log_lock, nullptr);
+  int mes_count = sizeof(message_defs_linux_storage) / sizeof(MessageTypeDef);
+  ManuvrMsg::registerMessages(message_defs_linux_storage, mes_count);
   if (nullptr != opts) {
     char* str = nullptr;
     if (0 == opts->getValueAs("store_path", &str)) {
@@ -73,10 +147,28 @@ LinuxStorage::LinuxStorage(Argument* opts) : EventReceiver("LinuxStorage"), Stor
 
 
 LinuxStorage::~LinuxStorage() {
+  if (_sync_timer.isScheduled()) {
+    _sync_timer.enableSchedule(false);
+    platform.kernel()->removeSchedule(&_sync_timer);
+  }
+  pthread_mutex_lock(&_log_lock);
+  _unmap_log();
+  if (0 <= _fd) {
+    _sync();
+    close(_fd);
+    _fd = -1;
+  }
+  _index_clear();
+  if (nullptr != _idx) {
+    free(_idx);
+    _idx = nullptr;
+  }
   if (nullptr != _filename) {
     free(_filename);
     _filename = nullptr;
   }
+  pthread_mutex_unlock(&_log_lock);
+  pthread_mutex_destroy(&_log_lock);
 }
 
 
@@ -88,114 +180,645 @@ LinuxStorage::~LinuxStorage() {
 * Storage interface.
 ********************************************************************************/
 uint64_t LinuxStorage::freeSpace() {
-  // TODO: Need a sophisticated apparatus to find this accurately.
-  // What partition is _filename on?
-  // How much space free on it?
-  // Cap to arbitrary maximum value for now.
-  return ((2 << 16) - _disk_buffer.length());
+  uint64_t ret = 0;
+  struct statvfs fs_stat;
+  pthread_mutex_lock(&_log_lock);
+  if ((0 <= _fd) && (0 == fstatvfs(_fd, &fs_stat))) {
+    // Records are addressed with 32-bit offsets. Don't promise more than that.
+    uint64_t avail = (uint64_t) fs_stat.f_bavail * fs_stat.f_frsize;
+    uint64_t addressable = 0xFFFFFFFF - _log_size;
+    ret = ((avail < addressable) ? avail : addressable);
+  }
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
 }
 
+
 StorageErr LinuxStorage::wipe() {
-  _disk_buffer.clear();
-  _disk_buffer.concat('\0');
-  return _save_file(&_disk_buffer);
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (0 < _views) {
+    ret = StorageErr::BUSY;   // Truncation would pull the pages out from under them.
+  }
+  else if (0 <= _fd) {
+    ret = StorageErr::NOT_WRITABLE;
+    if (0 == ftruncate(_fd, 0)) {
+      _map_gen++;
+      _index_clear();
+      _log_size = 0;
+      _garbage  = 0;
+      _unsynced = 1;   // Make certain that the truncation is committed.
+      ret = _sync();
+    }
+  }
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
 }
 
-//StorageErr LinuxStorage::flush() {
-//  if (_filename) {
-//    if (0 < _disk_buffer.length()) {
-//      return _save_file(&_disk_buffer);
-//    }
-//  }
-//  return 0;
-//}
+
+/**
+* Commits any batched writes to the medium.
+*
+* @return StorageErr::NONE on success.
+*/
+StorageErr LinuxStorage::flush() {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (0 <= _fd) ret = _sync();
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
+}
 
 
 StorageErr LinuxStorage::persistentWrite(const char* key, uint8_t* buf, unsigned int len, uint16_t flags) {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
   if (isMounted()) {
-    _disk_buffer.clear();
-    _disk_buffer.concat(buf, len);
-    return _save_file(&_disk_buffer);
+    ret = _write(key, buf, len, 0, flags);
   }
-  return StorageErr::NOT_MOUNTED;
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
 }
 
 
 StorageErr LinuxStorage::persistentRead(const char* key, uint8_t* buf, uint* len, uint16_t flags) {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
   if (isMounted()) {
-    uint max_l = _disk_buffer.length();
-    uint r_len = (max_l > *len) ? *len : max_l;
-    uint8_t* d_buf = _disk_buffer.string();
-    for (uint i = 0; i < r_len; i++) {
-      *(buf+i) = *(d_buf+i);
-    }
-    for (uint i = r_len; i < *len; i++) {
-      *(buf+i) = 0;  // Zero the  unused buffer, for safety.
+    int idx = _index_of(key);
+    ret = StorageErr::KEY_NOT_FOUND;
+    if (0 <= idx) {
+      uint r_len = (_idx[idx].val_len > *len) ? *len : _idx[idx].val_len;
+      ret = _read_at(_idx[idx].offset + LS_RECORD_HDR_LEN + _idx[idx].key_len, buf, r_len);
+      if (StorageErr::NONE == ret) {
+        for (uint i = r_len; i < *len; i++) {
+          *(buf+i) = 0;  // Zero the  unused buffer, for safety.
+        }
+        *len = r_len;
+      }
     }
-    *len = r_len;
-    return StorageErr::NONE;
   }
-  return StorageErr::NOT_MOUNTED;
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
+}
+
+
+StorageErr LinuxStorage::persistentWrite(const char* key, StringBuilder* buf, uint16_t flags) {
+  uint8_t* str = buf->string();   // Collapses the buffer before we take the lock.
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (isMounted()) {
+    ret = _write(key, str, buf->length(), 0, flags);
+  }
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
 }
 
 
 StorageErr LinuxStorage::persistentRead(const char* key, StringBuilder* out, uint16_t flags) {
+  uint8_t*   v_buf = nullptr;
+  uint32_t   v_len = 0;
+  StorageErr ret   = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
   if (isMounted()) {
-    out->concat(&_disk_buffer);
-    //return _disk_buffer.length();
-    return StorageErr::NONE;
+    int idx = _index_of(key);
+    ret = StorageErr::KEY_NOT_FOUND;
+    if (0 <= idx) {
+      // The caller wants to own the value. This is where the copy happens.
+      const uint32_t v_off = _idx[idx].offset + LS_RECORD_HDR_LEN + _idx[idx].key_len;
+      v_len = _idx[idx].val_len;
+      ret   = StorageErr::NONE;
+      if (0 < v_len) {
+        v_buf = (uint8_t*) malloc(v_len);
+        ret = (nullptr == v_buf) ? StorageErr::UNSPECIFIED : _read_at(v_off, v_buf, v_len);
+      }
+    }
+  }
+  pthread_mutex_unlock(&_log_lock);
+  if (nullptr != v_buf) {
+    if (StorageErr::NONE == ret) {
+      out->concatHandoff(v_buf, v_len);
+    }
+    else {
+      free(v_buf);
+    }
   }
-  return StorageErr::NOT_MOUNTED;
+  return ret;
 }
 
 
 /**
-* Open the file write-only and save the buffer. Clobbering the file's contents.
+* Zero-copy read. Points the caller at the value as it sits in the mapped log.
+* The view is read-only, and is valid until the caller passes it back to
+*   releaseView(). Until then, the mapping is held in place.
+*
+* @param  key  The key to look up. nullptr for the default key.
+* @param  ptr  Set to the start of the value.
+* @param  len  Set to the length of the value.
+* @return StorageErr::NONE on success, KEY_NOT_FOUND, or BUSY if the log is
+*           not mapped, or has outgrown a mapping that other views are holding
+*           (in which case persistentRead() still works).
 */
-StorageErr LinuxStorage::_save_file(StringBuilder* b) {
-  StorageErr return_value = StorageErr::BAD_PARAM;  // Fail by default.
-  if (_filename) {
-    return_value = StorageErr::NOT_READABLE;
-    int fd = open(_filename, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
-    if (fd >= 0) {
-      _pl_set_flag(true, PL_FLAG_BUSY_WRITE);
-      int len = b->length();
-      StringBuilder buf(b->string(), len);  // Buffer is now locally-scoped.
-      int q = write(fd, buf.string(), len);
-      if (len == q) {
-        return_value = StorageErr::NONE;
+StorageErr LinuxStorage::persistentView(const char* key, const uint8_t** ptr, uint32_t* len) {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (isMounted()) {
+    int idx = _index_of(key);
+    ret = StorageErr::KEY_NOT_FOUND;
+    if (0 <= idx) {
+      const uint8_t* v = _map_at(_idx[idx].offset + LS_RECORD_HDR_LEN + _idx[idx].key_len, _idx[idx].val_len);
+      ret = StorageErr::BUSY;
+      if (nullptr != v) {
+        *ptr = v;
+        *len = _idx[idx].val_len;
+        _views++;
+        ret  = StorageErr::NONE;
       }
-      close(fd);
-      _pl_set_flag(false, PL_FLAG_BUSY_WRITE);
     }
   }
-  return return_value;
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
+}
+
+
+/**
+* Hands back a view given by persistentView(). Once every view is released,
+*   the log may be remapped, compacted, or wiped again.
+*/
+void LinuxStorage::releaseView() {
+  pthread_mutex_lock(&_log_lock);
+  if (0 < _views) _views--;
+  pthread_mutex_unlock(&_log_lock);
+}
+
+
+/**
+* Forgets a key. This is itself a write, and is batched like any other.
+*
+* @param  key  The key to forget.
+* @return StorageErr::NONE on success, or KEY_NOT_FOUND.
+*/
+StorageErr LinuxStorage::erase(const char* key) {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (isMounted()) {
+    ret = _write(key, nullptr, 0, LS_RECORD_TOMBSTONE, 0);
+  }
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
+}
+
+
+/**
+* Rewrites the log with only the newest record for each key. The new log is
+*   built beside the old one, and renamed over it once it is committed, so a
+*   crash at any point leaves one or the other intact.
+*
+* @return StorageErr::NONE on success, or BUSY if views are outstanding.
+*/
+StorageErr LinuxStorage::compact() {
+  StorageErr ret = StorageErr::NOT_MOUNTED;
+  pthread_mutex_lock(&_log_lock);
+  if (isMounted()) {
+    ret = _compact();
+  }
+  pthread_mutex_unlock(&_log_lock);
+  return ret;
+}
+
+
+/*******************************************************************************
+* Log management
+* Everything below is called with _log_lock held. Writers may be on any
+*   thread, while commits and compaction happen on the Kernel's.
+*******************************************************************************/
+
+StorageErr LinuxStorage::_compact() {
+  if (0 < _views) return StorageErr::BUSY;   // They are pointing into this log.
+  const int fn_len = strlen(_filename);
+  char tmp_name[fn_len + 9];
+  memcpy(tmp_name, _filename, fn_len);
+  memcpy(tmp_name + fn_len, ".compact", 9);
+
+  int nu_fd = open(tmp_name, O_CREAT | O_RDWR | O_TRUNC | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (0 > nu_fd) return StorageErr::NOT_WRITABLE;
+
+  StorageErr ret = StorageErr::NONE;
+  uint32_t nu_size = 0;
+  uint32_t* nu_offsets = (uint32_t*) malloc((_idx_count + 1) * sizeof(uint32_t));
+  _pl_set_flag(true, PL_FLAG_BUSY_WRITE);
+  for (uint32_t i = 0; (StorageErr::NONE == ret) && (i < _idx_count) && (nullptr != nu_offsets); i++) {
+    const uint32_t v_off = _idx[i].offset + LS_RECORD_HDR_LEN + _idx[i].key_len;
+    nu_offsets[i] = nu_size;
+    // Live values are written straight out of the mapping, when we have one.
+    const uint8_t* mapped = _map_at(v_off, _idx[i].val_len);
+    if (nullptr != mapped) {
+      ret = _append(nu_fd, &nu_size, _idx[i].key, _idx[i].key_len, (uint8_t*) mapped, _idx[i].val_len, 0);
+    }
+    else {
+      uint8_t* v_buf = (uint8_t*) malloc(_idx[i].val_len + 1);
+      if (nullptr == v_buf) {
+        ret = StorageErr::UNSPECIFIED;
+      }
+      else {
+        ret = _read_at(v_off, v_buf, _idx[i].val_len);
+        if (StorageErr::NONE == ret) {
+          ret = _append(nu_fd, &nu_size, _idx[i].key, _idx[i].key_len, v_buf, _idx[i].val_len, 0);
+        }
+        free(v_buf);
+      }
+    }
+  }
+  if (nullptr == nu_offsets) ret = StorageErr::UNSPECIFIED;
+
+  if ((StorageErr::NONE == ret) && (0 == fsync(nu_fd)) && (0 == rename(tmp_name, _filename))) {
+    _unmap_log();
+    close(_fd);
+    _fd = nu_fd;
+    for (uint32_t i = 0; i < _idx_count; i++) _idx[i].offset = nu_offsets[i];
+    _log_size = nu_size;
+    _garbage  = 0;
+    _unsynced = 0;
+    _compactions++;
+    _map_log(_log_size);
+  }
+  else {
+    close(nu_fd);
+    unlink(tmp_name);
+    if (StorageErr::NONE == ret) ret = StorageErr::NOT_WRITABLE;
+  }
+  _pl_set_flag(false, PL_FLAG_BUSY_WRITE);
+  if (nullptr != nu_offsets) free(nu_offsets);
+  return ret;
+}
+
+
+/**
+* Frames a record and appends it to the given log in a single write.
+*
+* @param  fd        The log.
+* @param  log_size  The log's length. Advanced on success.
+* @return StorageErr::NONE on success.
+*/
+StorageErr LinuxStorage::_append(int fd, uint32_t* log_size, const char* key, uint8_t key_len, uint8_t* buf, uint32_t len, uint8_t rec_flags) {
+  LSRecordHeader hdr;
+  hdr.val_len = len;
+  hdr.magic   = LS_RECORD_MAGIC;
+  hdr.key_len = key_len;
+  hdr.flags   = rec_flags;
+  uint32_t crc = _crc32(0, ((uint8_t*) &hdr) + sizeof(hdr.crc), LS_RECORD_HDR_LEN - sizeof(hdr.crc));
+  crc = _crc32(crc, (const uint8_t*) key, key_len);
+  hdr.crc = _crc32(crc, buf, len);
+
+  struct iovec iov[3];
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len  = LS_RECORD_HDR_LEN;
+  iov[1].iov_base = (void*) key;
+  iov[1].iov_len  = key_len;
+  iov[2].iov_base = buf;
+  iov[2].iov_len  = len;
+  const ssize_t expected = _rec_len(key_len, len);
+  ssize_t q = writev(fd, iov, (0 < len) ? 3 : 2);
+  if (expected != q) {
+    // Don't leave a torn record behind us.
+    if (0 < q) {
+      if (0 != ftruncate(fd, *log_size)) {}
+    }
+    return ((0 > q) && (ENOSPC == errno)) ? StorageErr::MEDIA_FULL : StorageErr::NOT_WRITABLE;
+  }
+  *log_size += expected;
+  return StorageErr::NONE;
+}
+
+
+/**
+* Appends a record to the log, and brings the index up to date.
+*
+* @return StorageErr::KEY_CLOBBERED if the key already had a value, NONE if not.
+*/
+StorageErr LinuxStorage::_write(const char* key, uint8_t* buf, uint32_t len, uint8_t rec_flags, uint16_t flags) {
+  if (nullptr == key) key = LINUX_STORAGE_DEFAULT_KEY;
+  const size_t key_len = strlen(key);
+  if ((0 == key_len) || (255 < key_len) || ((nullptr == buf) && (0 < len))) {
+    return StorageErr::BAD_PARAM;
+  }
+  const uint32_t hash = _key_hash(key, key_len);
+  const int existing  = _index_find(key, key_len, hash);
+  if ((LS_RECORD_TOMBSTONE & rec_flags) && (0 > existing)) {
+    return StorageErr::KEY_NOT_FOUND;
+  }
+
+  const uint32_t offset = _log_size;
+  _pl_set_flag(true, PL_FLAG_BUSY_WRITE);
+  StorageErr ret = _append(_fd, &_log_size, key, key_len, buf, len, rec_flags);
+  _pl_set_flag(false, PL_FLAG_BUSY_WRITE);
+  if (StorageErr::NONE != ret) return ret;
+  _writes++;
+  _unsynced += _rec_len(key_len, len);
+
+  if (LS_RECORD_TOMBSTONE & rec_flags) {
+    // Both the erased record and the tombstone itself are now garbage.
+    _garbage += _rec_len(_idx[existing].key_len, _idx[existing].val_len) + _rec_len(key_len, len);
+    _index_drop(existing);
+  }
+  else if (0 > _index_put(key, key_len, hash, offset, len)) {
+    return StorageErr::UNSPECIFIED;
+  }
+
+  if ((LINUX_STORAGE_FLAG_SYNC & flags) || (LINUX_STORAGE_SYNC_BYTES <= _unsynced)) {
+    ret = _sync();
+  }
+  if (((0 < _unsynced) || _should_compact()) && !_sync_timer.scheduleEnabled()) {
+    _sync_timer.delaySchedule(LINUX_STORAGE_SYNC_MS);
+  }
+  if (StorageErr::NONE != ret) return ret;
+  return ((0 <= existing) && !(LS_RECORD_TOMBSTONE & rec_flags)) ? StorageErr::KEY_CLOBBERED : StorageErr::NONE;
 }
 
 
 /**
-* Open the file read-only and fill the buffer.
+* Commits the log, if anything has been written since the last time.
+*
+* @return StorageErr::NONE on success.
 */
-StorageErr LinuxStorage::_load_file(StringBuilder* buf) {
-  if (_filename) {
-    int fd = open(_filename, O_RDONLY);
-    if (fd >= 0) {
-      int total_read = 0;
-      _pl_set_flag(true, PL_FLAG_BUSY_READ);
-      uint8_t* buffer = (uint8_t*) alloca(2048);
-      int r_len = read(fd, buffer, 2048);
-      while (0 < r_len) {
-        buf->concat(buffer, r_len);
-        total_read += r_len;
-        r_len = read(fd, buffer, 2048);
+StorageErr LinuxStorage::_sync() {
+  if (0 == _unsynced) return StorageErr::NONE;
+  if (0 != fdatasync(_fd)) return StorageErr::NOT_WRITABLE;
+  _unsynced = 0;
+  _syncs++;
+  return StorageErr::NONE;
+}
+
+
+bool LinuxStorage::_should_compact() {
+  if (0 < _views) return false;   // Wait for them to be released.
+  return ((LINUX_STORAGE_COMPACT_BYTES < _garbage) && ((_garbage << 1) > _log_size));
+}
+
+
+/**
+* Opens (or creates) the log, and builds the index from it.
+*/
+StorageErr LinuxStorage::_open_log() {
+  if (nullptr == _filename) return StorageErr::BAD_PARAM;
+  _fd = open(_filename, O_CREAT | O_RDWR | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (0 > _fd) return StorageErr::NOT_READABLE;
+  struct stat st;
+  _map_log((0 == fstat(_fd, &st)) ? (uint32_t) st.st_size : 0);
+  StorageErr ret = _scan_log();
+  if (StorageErr::NONE == ret) {
+    _pl_set_flag(true, PL_FLAG_MEDIUM_MOUNTED | PL_FLAG_MEDIUM_READABLE | PL_FLAG_MEDIUM_WRITABLE);
+  }
+  else {
+    _unmap_log();
+    close(_fd);
+    _fd = -1;
+  }
+  return ret;
+}
+
+
+/**
+* Walks the log from the start, indexing each record. The walk ends at the
+*   first record that is incomplete or fails its CRC, and the log is truncated
+*   there.
+* A file written by the old single-blob format is adopted as the value of the
+*   default key, and rewritten as a log. Legacy files too short to hold a
+*   header only ever held the marker written by wipe(), and are discarded.
+*/
+StorageErr LinuxStorage::_scan_log() {
+  uint32_t offset   = 0;
+  uint32_t buf_len  = 256;
+  uint8_t* rec_buf  = (uint8_t*) malloc(buf_len);
+  struct stat st;
+  if ((nullptr == rec_buf) || (0 != fstat(_fd, &st))) {
+    if (rec_buf) free(rec_buf);
+    return StorageErr::NOT_READABLE;
+  }
+  const uint32_t file_size = (uint32_t) st.st_size;
+  _index_clear();
+  _log_size = 0;
+  _garbage  = 0;
+
+  _pl_set_flag(true, PL_FLAG_BUSY_READ);
+  while ((offset + LS_RECORD_HDR_LEN) <= file_size) {
+    LSRecordHeader hdr;
+    if (StorageErr::NONE != _read_at(offset, &hdr, LS_RECORD_HDR_LEN)) break;
+    if (LS_RECORD_MAGIC != hdr.magic) break;
+    const uint32_t body_len = hdr.key_len + hdr.val_len;
+    if ((file_size - offset - LS_RECORD_HDR_LEN) < body_len) break;   // Torn.
+    // With the log mapped, the CRC is taken in place, and nothing is copied.
+    const uint8_t* body = _map_at(offset + LS_RECORD_HDR_LEN, body_len);
+    if (nullptr == body) {
+      if (body_len > buf_len) {
+        uint8_t* nu = (uint8_t*) realloc(rec_buf, body_len);
+        if (nullptr == nu) break;
+        rec_buf = nu;
+        buf_len = body_len;
+      }
+      if (StorageErr::NONE != _read_at(offset + LS_RECORD_HDR_LEN, rec_buf, body_len)) break;
+      body = rec_buf;
+    }
+    uint32_t crc = _crc32(0, ((uint8_t*) &hdr) + sizeof(hdr.crc), LS_RECORD_HDR_LEN - sizeof(hdr.crc));
+    if (hdr.crc != _crc32(crc, body, body_len)) break;
+
+    const char* key = (const char*) body;
+    const uint32_t hash = _key_hash(key, hdr.key_len);
+    const uint32_t rec_len = _rec_len(hdr.key_len, hdr.val_len);
+    if (LS_RECORD_TOMBSTONE & hdr.flags) {
+      int idx = _index_find(key, hdr.key_len, hash);
+      if (0 <= idx) {
+        _garbage += _rec_len(_idx[idx].key_len, _idx[idx].val_len);
+        _index_drop(idx);
       }
-      close(fd);
-      _pl_set_flag(false, PL_FLAG_BUSY_READ);
-      _pl_set_flag(true, PL_FLAG_MEDIUM_MOUNTED | PL_FLAG_MEDIUM_READABLE | PL_FLAG_MEDIUM_WRITABLE);
-      return StorageErr::NONE;
+      _garbage += rec_len;
+    }
+    else if (0 > _index_put(key, hdr.key_len, hash, offset, hdr.val_len)) {
+      break;
+    }
+    offset += rec_len;
+  }
+  _pl_set_flag(false, PL_FLAG_BUSY_READ);
+  _log_size = offset;
+
+  StorageErr ret = StorageErr::NONE;
+  uint16_t first_magic = 0;
+  if ((LS_RECORD_HDR_LEN <= file_size) && (0 == offset)) {
+    if (StorageErr::NONE != _read_at(offsetof(LSRecordHeader, magic), &first_magic, 2)) first_magic = 0;
+  }
+  if ((LS_RECORD_HDR_LEN <= file_size) && (0 == offset) && (LS_RECORD_MAGIC != first_magic)) {
+    // The file doesn't start with a record. This is the legacy format.
+    if (buf_len < file_size) {
+      uint8_t* nu = (uint8_t*) realloc(rec_buf, file_size);
+      if (nu) {
+        rec_buf = nu;
+        buf_len = file_size;
+      }
+    }
+    if ((buf_len >= file_size) && (StorageErr::NONE == _read_at(0, rec_buf, file_size))) {
+      const uint8_t key_len = strlen(LINUX_STORAGE_DEFAULT_KEY);
+      if (0 == ftruncate(_fd, 0)) {
+        ret = _append(_fd, &_log_size, LINUX_STORAGE_DEFAULT_KEY, key_len, rec_buf, file_size, 0);
+        if (StorageErr::NONE == ret) {
+          _index_put(LINUX_STORAGE_DEFAULT_KEY, key_len, _key_hash(LINUX_STORAGE_DEFAULT_KEY, key_len), 0, file_size);
+          _unsynced = _log_size;
+          ret = _sync();
+        }
+      }
+      else {
+        ret = StorageErr::NOT_WRITABLE;
+      }
+    }
+    else {
+      ret = StorageErr::NOT_READABLE;
     }
   }
-  return StorageErr::BAD_PARAM;
+  else if (offset < file_size) {
+    // A torn write. Everything after the last good record is discarded.
+    if (0 == ftruncate(_fd, offset)) {
+      _unsynced = 1;
+      _sync();
+    }
+  }
+  free(rec_buf);
+  return ret;
+}
+
+
+/*******************************************************************************
+* Mapping
+* The log is mapped read-only and shared, with room to spare beyond its end.
+*   Appends through the fd become visible in the mapping without remapping,
+*   so views survive writes. Only bytes below the end of the file are touched.
+*******************************************************************************/
+
+/**
+* (Re)maps the log, with room for at least min_len bytes.
+* If mapping fails (or is disabled), reads fall back to pread().
+*/
+void LinuxStorage::_map_log(uint32_t min_len) {
+  _unmap_log();
+  if ((0 == LINUX_STORAGE_MAP_BYTES) || (0 > _fd)) return;
+  size_t len = LINUX_STORAGE_MAP_BYTES;
+  while (len < ((size_t) min_len << 1)) len <<= 1;
+  void* m = mmap(nullptr, len, PROT_READ, MAP_SHARED, _fd, 0);
+  if (MAP_FAILED != m) {
+    _map     = (uint8_t*) m;
+    _map_len = len;
+  }
+}
+
+
+void LinuxStorage::_unmap_log() {
+  if (nullptr != _map) {
+    munmap(_map, _map_len);
+    _map     = nullptr;
+    _map_len = 0;
+    _map_gen++;
+  }
+}
+
+
+/**
+* @return A pointer into the mapping for the given range, or nullptr if the
+*           log isn't mapped, or has outgrown a mapping that views are holding.
+*           The caller must know that the range is within the file.
+*/
+const uint8_t* LinuxStorage::_map_at(uint32_t offset, uint32_t len) {
+  if (nullptr == _map) return nullptr;
+  if (((size_t) offset + len) > _map_len) {
+    if (0 < _views) return nullptr;   // Can't move it. Callers will pread().
+    _map_log(offset + len);   // The log outgrew the mapping.
+    if (nullptr == _map) return nullptr;
+  }
+  return (_map + offset);
+}
+
+
+/**
+* Copies the given range of the log, from the mapping if possible.
+*/
+StorageErr LinuxStorage::_read_at(uint32_t offset, void* dest, uint32_t len) {
+  const uint8_t* mapped = _map_at(offset, len);
+  if (nullptr != mapped) {
+    memcpy(dest, mapped, len);
+    return StorageErr::NONE;
+  }
+  _pl_set_flag(true, PL_FLAG_BUSY_READ);
+  ssize_t q = pread(_fd, dest, len, offset);
+  _pl_set_flag(false, PL_FLAG_BUSY_READ);
+  return (q == (ssize_t) len) ? StorageErr::NONE : StorageErr::NOT_READABLE;
+}
+
+
+/*******************************************************************************
+* Index
+* The index is a flat array, searched by hash. Stores are expected to hold
+*   tens of keys, not thousands.
+*******************************************************************************/
+
+/* Looks up a caller's key. nullptr means the default key. */
+int LinuxStorage::_index_of(const char* key) {
+  if (nullptr == key) key = LINUX_STORAGE_DEFAULT_KEY;
+  const uint8_t key_len = (uint8_t) strnlen(key, 255);
+  return _index_find(key, key_len, _key_hash(key, key_len));
+}
+
+
+int LinuxStorage::_index_find(const char* key, uint8_t key_len, uint32_t hash) {
+  for (uint32_t i = 0; i < _idx_count; i++) {
+    if ((hash == _idx[i].hash) && (key_len == _idx[i].key_len) && (0 == memcmp(key, _idx[i].key, key_len))) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+/**
+* Points the index at a new record for the given key. Any record it replaces
+*   is counted as garbage.
+*
+* @return 1 if an entry was replaced, 0 if one was added, -1 on allocation failure.
+*/
+int8_t LinuxStorage::_index_put(const char* key, uint8_t key_len, uint32_t hash, uint32_t offset, uint32_t val_len) {
+  int idx = _index_find(key, key_len, hash);
+  if (0 <= idx) {
+    _garbage += _rec_len(_idx[idx].key_len, _idx[idx].val_len);
+    _idx[idx].offset  = offset;
+    _idx[idx].val_len = val_len;
+    return 1;
+  }
+  if (_idx_count == _idx_cap) {
+    uint32_t nu_cap = (0 == _idx_cap) ? 16 : (_idx_cap << 1);
+    LSIndexEntry* nu = (LSIndexEntry*) realloc(_idx, nu_cap * sizeof(LSIndexEntry));
+    if (nullptr == nu) return -1;
+    _idx     = nu;
+    _idx_cap = nu_cap;
+  }
+  char* k = (char*) malloc(key_len + 1);
+  if (nullptr == k) return -1;
+  memcpy(k, key, key_len);
+  k[key_len] = '\0';
+  _idx[_idx_count].key     = k;
+  _idx[_idx_count].hash    = hash;
+  _idx[_idx_count].offset  = offset;
+  _idx[_idx_count].val_len = val_len;
+  _idx[_idx_count].key_len = key_len;
+  _idx_count++;
+  return 0;
+}
+
+
+void LinuxStorage::_index_drop(int idx) {
+  free(_idx[idx].key);
+  _idx[idx] = _idx[--_idx_count];   // Order doesn't matter.
+}
+
+
+void LinuxStorage::_index_clear() {
+  for (uint32_t i = 0; i < _idx_count; i++) free(_idx[i].key);
+  _idx_count = 0;
 }
 
 
@@ -220,12 +843,23 @@ StorageErr LinuxStorage::_load_file(StringBuilder* buf) {
 */
 int8_t LinuxStorage::attached() {
   if (EventReceiver::attached()) {
-    if (0 <= (int8_t) _load_file(&_disk_buffer)) {
-    }
-    else {
-      // Attempt to create the file.
-      wipe();
-      if (StorageErr::NONE == wipe()) _load_file(&_disk_buffer);
+    // Writes are committed by this one-shot schedule, which is re-armed by
+    //   the first write after each commit.
+    _sync_timer.repurpose(MANUVR_MSG_STORAGE_SYNC, (EventReceiver*) this);
+    _sync_timer.incRefs();
+    _sync_timer.specific_target = (EventReceiver*) this;
+    _sync_timer.alterScheduleRecurrence(0);
+    _sync_timer.alterSchedulePeriod(LINUX_STORAGE_SYNC_MS);
+    _sync_timer.autoClear(false);
+    _sync_timer.enableSchedule(false);
+    platform.kernel()->addSchedule(&_sync_timer);
+
+    pthread_mutex_lock(&_log_lock);
+    StorageErr ret = _open_log();
+    pthread_mutex_unlock(&_log_lock);
+    if (StorageErr::NONE != ret) {
+      local_log.concatf("LinuxStorage: Failed to open %s.\n", (nullptr == _filename ? "<unset>" : _filename));
+      flushLocalLog();
     }
     return 1;
   }
@@ -271,6 +905,17 @@ void LinuxStorage::printDebug(StringBuilder *output) {
   EventReceiver::printDebug(output);
   Storage::printStorage(output);
   output->concatf("-- _filename:           %s\n", (nullptr == _filename ? "<unset>" : _filename));
+  output->concatf("-- Keys:                %u\n", _idx_count);
+  output->concatf("-- Log size:            %u bytes (%u superseded)\n", _log_size, _garbage);
+  output->concatf("-- Awaiting commit:     %u bytes\n", _unsynced);
+  output->concatf("-- Writes/syncs:        %u / %u\n", _writes, _syncs);
+  output->concatf("-- Compactions:         %u\n", _compactions);
+  if (nullptr != _map) {
+    output->concatf("-- Mapped:              %lu bytes (generation %u, %u views)\n", (unsigned long) _map_len, _map_gen, _views);
+  }
+  else {
+    output->concat("-- Mapped:              no\n");
+  }
 }
 
 
@@ -282,6 +927,20 @@ int8_t LinuxStorage::notify(ManuvrMsg* active_event) {
 
   switch (active_event->eventCode()) {
     /* Things that only this class is likely to care about. */
+    case MANUVR_MSG_STORAGE_SYNC:
+      if (active_event == &_sync_timer) {
+        pthread_mutex_lock(&_log_lock);
+        if (StorageErr::NONE != _sync()) {
+          local_log.concat("LinuxStorage: Commit failed.\n");
+        }
+        // Compaction is done here, off the write path, so that writers never bear it.
+        if (_should_compact() && isMounted() && (StorageErr::NONE != _compact())) {
+          local_log.concat("LinuxStorage: Compaction failed.\n");
+        }
+        pthread_mutex_unlock(&_log_lock);
+        return_value++;
+      }
+      break;
     default:
       return_value += EventReceiver::notify(active_event);
       break;
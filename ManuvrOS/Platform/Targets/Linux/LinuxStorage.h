@@ -19,9 +19,26 @@ limitations under the License.
 
 
 Data-persistence layer for linux.
-Implemented as a CBOR object within a single file. This feature therefore
-  requires MANUVR_CBOR. In the future, it may be made to operate on some
-  other encoding, be run through a cryptographic pipe, etc.
+Implemented as an append-only log of key-value records within a single file.
+  Each record is CRC-framed, and an index of the newest record for each key
+  is kept in memory. A write costs one append, regardless of how large the
+  store is. fsync() is batched, and superseded records are compacted away
+  when they come to dominate the log.
+The log is guarded by a mutex, so writes may come from any thread, while
+  commits and compaction happen on the Kernel's.
+
+The log is also mapped read-only into memory, so that reads and the replay at
+  mount don't copy through a buffer. persistentView() returns a pointer to a
+  value within the mapping, and counts it as outstanding until the caller
+  hands it back with releaseView(). While any view is outstanding, the log is
+  never remapped, compacted, or wiped (those return BUSY, or fall back to
+  pread()), so a view stays good no matter what other threads write. Callers
+  that need the value for longer should use persistentRead(), which copies.
+  Views must all be released before the LinuxStorage is destroyed.
+
+Callers that pass no key get LINUX_STORAGE_DEFAULT_KEY, which is where the
+  platform keeps its CBOR-encoded configuration. This feature therefore
+  requires MANUVR_CBOR.
 */
 
 #ifndef __MANUVR_LINUX_STORAGE_H__
@@ -29,11 +46,44 @@ Implemented as a CBOR object within a single file. This feature therefore
 
 #include <EventReceiver.h>
 #include <Storage.h>
+#include <pthread.h>
 
 #ifndef MANUVR_CBOR
   #error The LinuxStorage class requires MANUVR_CBOR be enabled.
 #endif
 
+#define MANUVR_MSG_STORAGE_SYNC     0x9050  // Batched writes are due to be committed.
+
+// The key used when the caller gives none.
+#ifndef LINUX_STORAGE_DEFAULT_KEY
+  #define LINUX_STORAGE_DEFAULT_KEY  "conf"
+#endif
+
+// Writes are committed to the medium at most this long after they are made...
+#ifndef LINUX_STORAGE_SYNC_MS
+  #define LINUX_STORAGE_SYNC_MS      250
+#endif
+
+// ...or as soon as this many bytes are waiting, whichever comes first.
+#ifndef LINUX_STORAGE_SYNC_BYTES
+  #define LINUX_STORAGE_SYNC_BYTES   65536
+#endif
+
+// The log is compacted when superseded records exceed this many bytes, and
+//   make up more than half of the log.
+#ifndef LINUX_STORAGE_COMPACT_BYTES
+  #define LINUX_STORAGE_COMPACT_BYTES  16384
+#endif
+
+// How much address space to map for the log at first. The mapping grows if
+//   the log outgrows it. 0 disables mapping, and reads go through pread().
+#ifndef LINUX_STORAGE_MAP_BYTES
+  #define LINUX_STORAGE_MAP_BYTES    (16 * 1024 * 1024)
+#endif
+
+// Passed in the flags of persistentWrite() to commit before returning.
+#define LINUX_STORAGE_FLAG_SYNC      0x0001
+
 class LinuxStorage : public EventReceiver, public Storage {
   public:
     LinuxStorage(Argument*);
@@ -42,7 +92,7 @@ class LinuxStorage : public EventReceiver, public Storage {
     /* Overrides from Storage. */
     uint64_t   freeSpace();     // How many bytes are availible for use?
     StorageErr wipe();          // Call to wipe the data store.
-    //StorageErr flush();             // Blocks until commit completes.
+    StorageErr flush();         // Blocks until commit completes.
 
     /* Raw buffer API. Might have more overhead on some platforms. */
     StorageErr persistentWrite(const char*, uint8_t*, unsigned int, uint16_t);
@@ -52,6 +102,18 @@ class LinuxStorage : public EventReceiver, public Storage {
     StorageErr persistentWrite(const char*, StringBuilder*, uint16_t);
     StorageErr persistentRead(const char*, StringBuilder*, uint16_t);
 
+    StorageErr erase(const char*);  // Forget a key.
+    StorageErr compact();           // Rewrite the log with only live records.
+
+    /* Zero-copy read. See the notes at the top of this file. */
+    StorageErr persistentView(const char*, const uint8_t**, uint32_t*);
+    void       releaseView();
+
+    inline uint32_t keyCount() {    return _idx_count;   };
+    inline uint32_t mapGeneration() {  return _map_gen;  };
+    inline uint32_t logSize() {     return _log_size;    };
+    inline uint32_t garbage() {     return _garbage;     };
+
 
     /* Overrides from EventReceiver */
     void printDebug(StringBuilder*);
@@ -64,11 +126,51 @@ class LinuxStorage : public EventReceiver, public Storage {
 
 
   private:
-    char*          _filename   = nullptr;
-    StringBuilder  _disk_buffer;
+    /* Where the newest record for a key lives in the log. */
+    typedef struct {
+      char*    key;
+      uint32_t hash;
+      uint32_t offset;    // Of the record's header.
+      uint32_t val_len;
+      uint8_t  key_len;
+    } LSIndexEntry;
 
-    StorageErr _save_file(StringBuilder* b);
-    StorageErr _load_file(StringBuilder* b);
+    char*          _filename   = nullptr;
+    int            _fd         = -1;
+    LSIndexEntry*  _idx        = nullptr;
+    uint32_t       _idx_count  = 0;
+    uint32_t       _idx_cap    = 0;
+    uint32_t       _log_size   = 0;   // Bytes of valid log.
+    uint32_t       _garbage    = 0;   // Bytes of superseded records.
+    uint32_t       _unsynced   = 0;   // Bytes written since the last fsync().
+    uint32_t       _writes     = 0;
+    uint32_t       _syncs      = 0;
+    uint32_t       _compactions = 0;
+    uint8_t*       _map        = nullptr;   // Read-only mapping of the log.
+    size_t         _map_len    = 0;
+    uint32_t       _map_gen    = 0;         // Bumped whenever the mapping is replaced.
+    uint32_t       _views      = 0;         // Views handed out, and not yet released.
+    ManuvrMsg      _sync_timer;
+    pthread_mutex_t _log_lock;              // Guards the log, its mapping, and the index.
+
+    StorageErr _open_log();
+    StorageErr _scan_log();
+    StorageErr _append(int fd, uint32_t* log_size, const char* key, uint8_t key_len, uint8_t* buf, uint32_t len, uint8_t rec_flags);
+    StorageErr _write(const char* key, uint8_t* buf, uint32_t len, uint8_t rec_flags, uint16_t flags);
+    StorageErr _sync();
+    StorageErr _compact();
+    bool       _should_compact();
+    int        _index_of(const char* key);
+
+    void           _map_log(uint32_t min_len);
+    void           _unmap_log();
+    const uint8_t* _map_at(uint32_t offset, uint32_t len);
+    StorageErr     _read_at(uint32_t offset, void* dest, uint32_t len);
+
+    int        _index_find(const char* key, uint8_t key_len, uint32_t hash);
+    int8_t     _index_put(const char* key, uint8_t key_len, uint32_t hash, uint32_t offset, uint32_t val_len);
+    void       _index_drop(int idx);
+    void       _index_clear();
 };
 
 #endif // __MANUVR_LINUX_STORAGE_H__
@@ -72,6 +72,71 @@
   #define EVENT_MANAGER_PREALLOC_COUNT 8
 #endif
 
+// When the preallocation runs dry, the Kernel's message slab grows by this many
+//   messages at a time, up to the given number of chunks. Beyond that, messages
+//   come from the heap. Idle chunks are returned to the heap when the Kernel idles.
+#ifndef EVENT_MANAGER_SLAB_CHUNK
+  #define EVENT_MANAGER_SLAB_CHUNK 16
+#endif
+#ifndef EVENT_MANAGER_SLAB_MAX_CHUNKS
+  #define EVENT_MANAGER_SLAB_MAX_CHUNKS 8
+#endif
+
+// Arguments are allocated from a slab of their own, with the same rules.
+#ifndef ARGUMENT_SLAB_CHUNK
+  #define ARGUMENT_SLAB_CHUNK 32
+#endif
+#ifndef ARGUMENT_SLAB_MAX_CHUNKS
+  #define ARGUMENT_SLAB_MAX_CHUNKS 8
+#endif
+
+// Keyed lookups that walk past this many Arguments build an index for the chain,
+//   and use it thereafter. Shorter walks aren't worth the memory.
+#ifndef ARGUMENT_INDEX_MIN_ARGS
+  #define ARGUMENT_INDEX_MIN_ARGS 8
+#endif
+
+// Values of up to this many bytes (doubles, vectors, short strings) are held
+//   inside the Argument itself, rather than on the heap.
+#ifndef ARGUMENT_INLINE_BYTES
+  #define ARGUMENT_INLINE_BYTES 16
+#endif
+
+// How many Arguments each message can hold in storage of its own. Arguments
+//   beyond this come from the Argument slab. Zero disables the pool.
+#ifndef MANUVR_MSG_ARG_POOL
+  #define MANUVR_MSG_ARG_POOL 3
+#endif
+
+// How many events may be waiting to enter the Kernel from other threads or ISRs?
+//   Must be a power of two.
+#ifndef EVENT_MANAGER_INGRESS_DEPTH
+  #define EVENT_MANAGER_INGRESS_DEPTH 128
+#endif
+
+// On platforms that can sleep, what is the longest the Kernel should block when
+//   it has no events and no schedules?
+#ifndef KERNEL_MAX_IDLE_WAIT_MS
+  #define KERNEL_MAX_IDLE_WAIT_MS 1000
+#endif
+
+// How many distinct message codes can the event profiler track? Power of two.
+#ifndef KERNEL_PROFILER_SLOTS
+  #define KERNEL_PROFILER_SLOTS 64
+#endif
+
+// How many microseconds may a single call to procIdleFlags() spend on events?
+//   Zero means no time budget. Adjustable at runtime.
+#ifndef KERNEL_DISPATCH_BUDGET_US
+  #define KERNEL_DISPATCH_BUDGET_US 1200
+#endif
+
+// How long may an event wait in the queue before it is run ahead of its
+//   priority, and in spite of its band quota? Zero disables aging.
+#ifndef KERNEL_DISPATCH_MAX_AGE_US
+  #define KERNEL_DISPATCH_MAX_AGE_US 0
+#endif
+
 #ifndef MAXIMUM_SEQUENTIAL_SKIPS
   #define MAXIMUM_SEQUENTIAL_SKIPS 20
 #endif
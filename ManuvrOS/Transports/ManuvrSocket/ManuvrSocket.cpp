@@ -36,6 +36,10 @@ Platforms that require it should be able to extend this driver for specific
 #include <Kernel.h>
 #include <Platform/Platform.h>
 
+#if defined(__MANUVR_LINUX)
+  #include <errno.h>
+#endif
+
 
 /*******************************************************************************
 *   ___ _              ___      _ _              _      _
@@ -75,6 +79,10 @@ ManuvrSocket::ManuvrSocket(const char* nom, const char* addr, int port, SocketOp
   read_abort_event.repurpose(MANUVR_MSG_XPORT_QUEUE_RDY, (EventReceiver*) this);
   read_abort_event.incRefs();
   read_abort_event.specific_target = (EventReceiver*) this;
+
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_init(&_tx_lock, nullptr);
+  #endif
 }
 
 
@@ -83,9 +91,15 @@ ManuvrSocket::ManuvrSocket(const char* nom, const char* addr, int port, SocketOp
 */
 ManuvrSocket::~ManuvrSocket() {
   if (_sock) {
+    #if defined(__MANUVR_LINUX)
+      if (reactorDriven()) SocketReactor::unwatch(this);
+    #endif
     close(_sock);  // Close the socket.
     _sock = 0;
   }
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_destroy(&_tx_lock);
+  #endif
   if (_addr) {
     free(_addr);
     _addr = nullptr;
@@ -95,6 +109,11 @@ ManuvrSocket::~ManuvrSocket() {
 
 /**
 * On linux, socket cleanup is fairly uniform...
+*
+* On linux, this may run on the reactor's thread (by way of hangup()) and on
+*   the Kernel's thread at the same time. The descriptor is only closed once,
+*   under the transmit lock, and whoever closes it has already waited out the
+*   reactor's callbacks for this socket.
 */
 int8_t ManuvrSocket::disconnect() {
   if (listening()) {
@@ -107,12 +126,145 @@ int8_t ManuvrSocket::disconnect() {
     connected(false);
   }
 
-  if (_sock) {
-    close(_sock);  // Close the socket.
-    _sock = 0;
-  }
+  #if defined(__MANUVR_LINUX)
+    if (reactorDriven()) {
+      // Once this returns, the reactor is done with us, even if the reactor
+      //   got here first. The flag stays set until the next attach.
+      SocketReactor::unwatch(this);
+    }
+    // Writers hold this lock while they use the descriptor.
+    pthread_mutex_lock(&_tx_lock);
+    if (0 < _sock) {
+      _tx_backlog.clear();
+      close(_sock);  // Close the socket.
+      _sock = 0;
+    }
+    pthread_mutex_unlock(&_tx_lock);
+  #else
+    if (_sock) {
+      close(_sock);  // Close the socket.
+      _sock = 0;
+    }
+  #endif
   ManuvrXport::disconnect();
   return 0;
 }
 
+
+#if defined(__MANUVR_LINUX)
+/*******************************************************************************
+* Reactor-driven I/O
+*******************************************************************************/
+
+/**
+* Makes our socket non-blocking, and hands it to the SocketReactor. This must
+*   be called before connected(true), so that no read thread is spawned.
+*
+* @return 0 on success, -1 on failure.
+*/
+int8_t ManuvrSocket::_reactor_attach() {
+  int flags = fcntl(_sock, F_GETFL, 0);
+  if ((0 > flags) || (0 > fcntl(_sock, F_SETFL, flags | O_NONBLOCK))) {
+    return -1;
+  }
+  set_xport_state(MANUVR_XPORT_FLAG_REACTOR_IO);
+  if (0 != SocketReactor::watch(this)) {
+    unset_xport_state(MANUVR_XPORT_FLAG_REACTOR_IO);
+    return -1;
+  }
+  return 0;
+}
+
+
+/**
+* The socket is readable. By default, we just read the port.
+*
+* @return -1 if the counterparty has gone away. 0 otherwise.
+*/
+int8_t ManuvrSocket::read_ready() {
+  return read_port();
+}
+
+
+/**
+* The socket is writable again. Push out as much of the backlog as it will take,
+*   and stop asking for writability once the backlog is empty.
+*
+* @return 0 on success, -1 on a hard error.
+*/
+int8_t ManuvrSocket::write_ready() {
+  int8_t return_value = 0;
+  pthread_mutex_lock(&_tx_lock);
+  while ((0 < _sock) && (0 < _tx_backlog.length())) {
+    ssize_t n = send(_sock, _tx_backlog.string(), _tx_backlog.length(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (0 < n) {
+      bytes_sent += n;
+      _tx_backlog.cull(n);
+    }
+    else {
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)) {
+        return_value = -1;
+      }
+      break;
+    }
+  }
+  if ((0 < _sock) && (0 == _tx_backlog.length())) {
+    SocketReactor::wantWrite(this, false);
+  }
+  pthread_mutex_unlock(&_tx_lock);
+  return return_value;
+}
+
+
+/**
+* The counterparty has gone away, or the socket failed.
+*/
+void ManuvrSocket::hangup() {
+  disconnect();
+}
+
+
+/**
+* Non-blocking write with backpressure. If the socket won't take everything,
+*   the remainder goes into a backlog that the reactor drains as the socket
+*   becomes writable. If the backlog is already full, the write is refused and
+*   the caller retains its buffer.
+*
+* @param  out      The buffer to send.
+* @param  out_len  The length of the buffer.
+* @return true if the bytes were sent or queued. false otherwise.
+*/
+bool ManuvrSocket::_nb_write(unsigned char* out, int out_len) {
+  bool return_value = false;
+  pthread_mutex_lock(&_tx_lock);
+  if (0 >= _sock) {
+    // Disconnected while the caller wasn't looking.
+  }
+  else if (0 == _tx_backlog.length()) {
+    ssize_t n = send(_sock, out, out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (0 > n) {
+      n = ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)) ? 0 : -1;
+    }
+    if (0 <= n) {
+      bytes_sent += n;
+      if (n < out_len) {
+        _tx_backlog.concat(out + n, out_len - n);
+        SocketReactor::wantWrite(this, true);
+      }
+      return_value = true;
+    }
+  }
+  else if ((_tx_backlog.length() + out_len) <= SOCKET_TX_BACKLOG_LIMIT) {
+    // Preserve ordering behind the bytes already waiting.
+    _tx_backlog.concat(out, out_len);
+    return_value = true;
+  }
+  else {
+    _tx_refusals++;
+  }
+  pthread_mutex_unlock(&_tx_lock);
+  return return_value;
+}
+#endif  // __MANUVR_LINUX
+
 #endif  // Socket support?
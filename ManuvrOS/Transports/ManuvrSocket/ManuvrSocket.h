@@ -43,6 +43,8 @@ This is basically only for linux until it is needed in a smaller space.
   #include <sys/socket.h>
   #include <netinet/in.h>
   #include <arpa/inet.h>
+  #include <pthread.h>
+  #include "SocketReactor.h"
 #elif defined(__MANUVR_ESP32)
   #include "lwip/err.h"
   #include "lwip/sockets.h"
@@ -69,6 +71,18 @@ class ManuvrSocket : public ManuvrXport {
     inline int getSockID() {  return _sock; };
     virtual int8_t disconnect();
 
+    #if defined(__MANUVR_LINUX)
+      /*
+      * Called from the SocketReactor's thread when the socket is ready. Not the
+      *   Kernel's thread. See SocketReactor.h for what that asks of overrides.
+      */
+      virtual int8_t read_ready();    // Returns -1 if the socket should be hung up.
+      virtual int8_t write_ready();
+      virtual void   hangup();
+
+      inline int txBacklog() {   return _tx_backlog.length();   };
+    #endif
+
 
   protected:
     SocketOpts* _opts        = 0;
@@ -79,6 +93,15 @@ class ManuvrSocket : public ManuvrXport {
 
     ManuvrSocket(const char* nom, const char* addr, int port, SocketOpts* opts);
 
+    #if defined(__MANUVR_LINUX)
+      StringBuilder   _tx_backlog;       // Bytes the counterparty hasn't taken yet.
+      pthread_mutex_t _tx_lock;          // Guards the backlog between Kernel and reactor.
+      uint32_t        _tx_refusals = 0;  // Writes refused because the backlog was full.
+
+      int8_t _reactor_attach();
+      bool   _nb_write(unsigned char* out, int out_len);
+    #endif
+
 
   private:
 };
@@ -28,6 +28,10 @@ This is basically only for linux for now.
 #include "ManuvrTCP.h"
 #include <Kernel.h>
 
+#if defined(__MANUVR_LINUX)
+  #include <errno.h>
+#endif
+
 #if defined(MANUVR_SUPPORT_TCPSOCKET)
 
 
@@ -53,67 +57,7 @@ This is basically only for linux for now.
 *******************************************************************************/
 
 #if defined(__MANUVR_LINUX)
-  // TODO: Generallize into Manuvr threading abstraction.
-  // Threaded platforms will need this to compensate for a loss of ISR.
-  extern void* xport_read_handler(void* active_xport);
-
-
-  /*
-  * Since listening for connections on this transport involves blocking, we have a
-  *   thread dedicated to the task...
-  */
-  void* socket_listener_loop(void* active_xport) {
-    if (NULL != active_xport) {
-      sigset_t set;
-      sigemptyset(&set);
-      //sigaddset(&set, SIGIO);
-      sigaddset(&set, SIGQUIT);
-      sigaddset(&set, SIGHUP);
-      sigaddset(&set, SIGTERM);
-      sigaddset(&set, SIGVTALRM);
-      sigaddset(&set, SIGINT);
-      int s = pthread_sigmask(SIG_BLOCK, &set, NULL);
-
-      ManuvrTCP* listening_inst = (ManuvrTCP*) active_xport;
-      StringBuilder output;
-      if (0 != s) {
-        output.concatf("pthread_sigmask() returned an error: %d\n", s);
-        Kernel::log(&output);
-        return NULL;
-      }
-      int      cli_sock;
-      struct sockaddr_in cli_addr;
-      while (listening_inst->listening()) {
-        unsigned int clientlen = sizeof(cli_addr);
-
-        /* Wait for client connection */
-        if ((cli_sock = accept(listening_inst->getSockID(), (struct sockaddr *) &cli_addr, &clientlen)) < 0) {
-          output.concat("Failed to accept client connection.\n");
-        }
-        else {
-          ManuvrTCP* nu_connection = new ManuvrTCP(listening_inst, cli_sock, &cli_addr);
-          nu_connection->setPipeStrategy(listening_inst->getPipeStrategy());
-          platform.kernel()->subscribe((EventReceiver*) nu_connection);
-          output.concatf("TCP Client connected: %s\n", (char*) inet_ntoa(cli_addr.sin_addr));
-        }
-        Kernel::log(&output);
-
-        for (uint16_t i = 0; i < sizeof(cli_addr);  i++) {
-          // Zero the sockaddr structure for next use. The new transport
-          //   instance should have copied it by now.
-          *((uint8_t *) &cli_addr  + i) = 0;
-        }
-      }
-      // Close the listener...
-      // TODO: Is this all we need to do?   ---J. Ian Lindsay   Fri Jan 15 11:32:12 PST 2016
-      close(listening_inst->getSockID());
-    }
-    else {
-      Kernel::log("Tried to listen with a NULL transport.");
-    }
-
-    return NULL;
-  }
+  // On linux, the SocketReactor services our sockets. No threads needed here.
 #elif defined(__MANUVR_ESP32)
   // TODO: Generallize into Manuvr threading abstraction.
   /*
@@ -175,6 +119,12 @@ This is basically only for linux for now.
 */
 ManuvrTCP::ManuvrTCP(const char* addr, int port, SocketOpts* opts) : ManuvrSocket("ManuvrTCP", addr, port, opts) {
   set_xport_state(MANUVR_XPORT_FLAG_STREAM_ORIENTED);
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_init(&_accept_lock, nullptr);
+    _accept_event.repurpose(MANUVR_MSG_XPORT_CB_QUEUE_RDY, (EventReceiver*) this);
+    _accept_event.incRefs();
+    _accept_event.specific_target = (EventReceiver*) this;
+  #endif
 }
 
 /**
@@ -191,14 +141,17 @@ ManuvrTCP::ManuvrTCP(ManuvrTCP* listening_instance, int sock, struct sockaddr_in
   _sock = sock;
   _opts = listening_instance->_opts;
 
-  listening_instance->_connections.insert(this);  // TODO: This is starting to itch...
-
   for (uint16_t i = 0; i < sizeof(_sockaddr);  i++) {
     // Copy the sockaddr struct into this instance.
     *((uint8_t *) &_sockaddr + i) = *(((uint8_t*)nu_sockaddr) + i);
   }
 
-  connected(true);  // TODO: Possibly not true....
+  #if defined(__MANUVR_LINUX)
+    // The listener finishes the job from the Kernel's thread. See _adopt_accepted().
+  #else
+    listening_instance->_connections.insert(this);  // TODO: This is starting to itch...
+    connected(true);  // TODO: Possibly not true....
+  #endif
 }
 
 
@@ -206,6 +159,19 @@ ManuvrTCP::ManuvrTCP(ManuvrTCP* listening_instance, int sock, struct sockaddr_in
 * Destructor
 */
 ManuvrTCP::~ManuvrTCP() {
+  #if defined(__MANUVR_LINUX)
+    if (reactorDriven()) {
+      // Must happen before our overrides go away.
+      SocketReactor::unwatch(this);
+      unset_xport_state(MANUVR_XPORT_FLAG_REACTOR_IO);
+    }
+    pthread_mutex_lock(&_accept_lock);
+    while (_accepted.hasNext()) {
+      delete _accepted.dequeue();   // Never made it to the Kernel.
+    }
+    pthread_mutex_unlock(&_accept_lock);
+    pthread_mutex_destroy(&_accept_lock);
+  #endif
   platform.kernel()->unsubscribe((EventReceiver*) this);
 }
 
@@ -290,6 +256,11 @@ int8_t ManuvrTCP::connect() {
   }
 
   initialized(true);
+  #if defined(__MANUVR_LINUX)
+    if (_reactor_attach()) {
+      Kernel::log("Failed to hand a TCP socket to the reactor.\n");
+    }
+  #endif
   connected(true);
 
   return 0;
@@ -326,12 +297,19 @@ int8_t ManuvrTCP::listen() {
   }
 
   initialized(true);
-  ManuvrThreadOptions _t_opts;
-  _t_opts.thread_name = (char*) "tcp_listen";
-  _t_opts.stack_sz = 4096;
-
   listening(true);
-  createThread(&_thread_id, NULL, socket_listener_loop, (void*) this, &_t_opts);
+  #if defined(__MANUVR_LINUX)
+    if (_reactor_attach()) {
+      Kernel::log("Failed to hand the TCP listener to the reactor.\n");
+      listening(false);
+      return -1;
+    }
+  #else
+    ManuvrThreadOptions _t_opts;
+    _t_opts.thread_name = (char*) "tcp_listen";
+    _t_opts.stack_sz = 4096;
+    createThread(&_thread_id, NULL, socket_listener_loop, (void*) this, &_t_opts);
+  #endif
 
   local_log.concatf("TCP Now listening at %s:%d.\n", _addr, _port_number);
 
@@ -347,6 +325,111 @@ int8_t ManuvrTCP::reset() {
 
 
 
+#if defined(__MANUVR_LINUX)
+/**
+* Called from the reactor. A listener accepts connections, while a connection
+*   reads whatever the counterparty sent.
+*
+* @return -1 if the socket should be hung up. 0 otherwise.
+*/
+int8_t ManuvrTCP::read_ready() {
+  return (listening() ? accept_pending() : read_port());
+}
+
+
+/**
+* Accepts every pending connection on our listening socket.
+*
+* @return -1 if the listener failed. 0 otherwise.
+*/
+int8_t ManuvrTCP::accept_pending() {
+  struct sockaddr_in cli_addr;
+  socklen_t clientlen = sizeof(cli_addr);
+  while (listening()) {
+    memset((uint8_t *) &cli_addr, 0, sizeof(cli_addr));
+    int cli_sock = accept(_sock, (struct sockaddr *) &cli_addr, &clientlen);
+    if (0 > cli_sock) {
+      if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno) || (ECONNABORTED == errno)) {
+        return 0;
+      }
+      Kernel::log("Failed to accept client connection.\n");
+      return -1;
+    }
+    // Subscription and the rest of setup must happen on the Kernel's thread.
+    ManuvrTCP* nu_connection = new ManuvrTCP(this, cli_sock, &cli_addr);
+    pthread_mutex_lock(&_accept_lock);
+    _accepted.insert(nu_connection);
+    pthread_mutex_unlock(&_accept_lock);
+    Kernel::staticRaiseEvent(&_accept_event);
+  }
+  return 0;
+}
+
+
+/**
+* Takes connections that the reactor accepted, and puts them into service.
+*   Runs on the Kernel's thread. A new connection is subscribed and given our
+*   pipe strategy before the reactor can deliver anything that it reads.
+*/
+void ManuvrTCP::_adopt_accepted() {
+  pthread_mutex_lock(&_accept_lock);
+  ManuvrTCP* nu_connection = _accepted.dequeue();
+  pthread_mutex_unlock(&_accept_lock);
+  while (nullptr != nu_connection) {
+    nu_connection->setPipeStrategy(getPipeStrategy());
+    _connections.insert(nu_connection);
+    platform.kernel()->subscribe((EventReceiver*) nu_connection);
+    if (nu_connection->_reactor_attach()) {
+      Kernel::log("Failed to hand a TCP client to the reactor.\n");
+    }
+    nu_connection->connected(true);
+    if (getVerbosity() > 3) {
+      local_log.concatf("TCP Client connected: %s\n", (char*) inet_ntoa(nu_connection->_sockaddr.sin_addr));
+    }
+    pthread_mutex_lock(&_accept_lock);
+    nu_connection = _accepted.dequeue();
+    pthread_mutex_unlock(&_accept_lock);
+  }
+}
+
+
+/**
+* Reads everything the socket has for us, and passes it along the pipe.
+* The socket is non-blocking, so this returns as soon as the socket is drained.
+* Runs on the reactor's thread, so the pipe downstream sees bytes arrive from
+*   that thread. local_log belongs to the Kernel's thread, so we log directly.
+*
+* @return -1 if the counterparty has closed the connection. 0 otherwise.
+*/
+int8_t ManuvrTCP::read_port() {
+  if (!connected()) {
+    if (getVerbosity() > 1) {
+      Kernel::log("Somehow we are trying to read a port that is not marked as open.\n");
+    }
+    return -1;
+  }
+  uint8_t buf[SOCKET_READ_CHUNK];
+  while (connected()) {
+    ssize_t n = read(_sock, buf, SOCKET_READ_CHUNK);
+    if (0 < n) {
+      bytes_received += n;
+      BufferPipe::fromCounterparty(buf, n, MEM_MGMT_RESPONSIBLE_BEARER);
+    }
+    else if (0 == n) {
+      return -1;   // Orderly shutdown by the counterparty.
+    }
+    else if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {
+      break;
+    }
+    else if (EINTR != errno) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+#else
+
 int8_t ManuvrTCP::read_port() {
   if (connected()) {
     unsigned char *buf = (unsigned char *) alloca(256);
@@ -373,6 +456,7 @@ int8_t ManuvrTCP::read_port() {
   flushLocalLog();
   return 0;
 }
+#endif  // __MANUVR_LINUX
 
 
 /**
@@ -396,12 +480,17 @@ bool ManuvrTCP::write_port(unsigned char* out, int out_len) {
   }
 
   if (connected()) {
-    int bytes_written = (int) write(getSockID(), out, out_len);
-    bytes_sent += bytes_written;
-    if (bytes_written == out_len) {
-      return true;
-    }
-    Kernel::log("Failed to send bytes to client");
+    #if defined(__MANUVR_LINUX)
+      // Non-blocking. If the counterparty is too far behind, we refuse.
+      return _nb_write(out, out_len);
+    #else
+      int bytes_written = (int) write(getSockID(), out, out_len);
+      bytes_sent += bytes_written;
+      if (bytes_written == out_len) {
+        return true;
+      }
+      Kernel::log("Failed to send bytes to client");
+    #endif
   }
   return false;
 }
@@ -455,6 +544,10 @@ void ManuvrTCP::printDebug(StringBuilder *temp) {
   temp->concatf("-- _addr           %s:%d\n",  _addr, _port_number);
   temp->concatf("-- _opts           %p\n", _opts);
   temp->concatf("-- _sock           0x%08x\n", _sock);
+  #if defined(__MANUVR_LINUX)
+    temp->concatf("-- TX backlog      %d bytes (%u refused)\n", txBacklog(), _tx_refusals);
+    if (listening()) SocketReactor::printDebug(temp);
+  #endif
 }
 
 
@@ -495,6 +588,16 @@ int8_t ManuvrTCP::notify(ManuvrMsg* active_event) {
   int8_t return_value = 0;
 
   switch (active_event->eventCode()) {
+    #if defined(__MANUVR_LINUX)
+      case MANUVR_MSG_XPORT_CB_QUEUE_RDY:
+        if (&_accept_event == active_event) {
+          _adopt_accepted();
+          return_value++;
+          break;
+        }
+        return_value += ManuvrXport::notify(active_event);
+        break;
+    #endif
     default:
       return_value += ManuvrXport::notify(active_event);
       break;
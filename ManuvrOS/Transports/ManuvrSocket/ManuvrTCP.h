@@ -88,6 +88,10 @@ class ManuvrTCP : public ManuvrSocket
 
     bool write_port(unsigned char* out, int out_len);
 
+    #if defined(__MANUVR_LINUX)
+      int8_t read_ready();   // Override from ManuvrSocket.
+    #endif
+
 
   protected:
     int8_t attached();
@@ -95,6 +99,15 @@ class ManuvrTCP : public ManuvrSocket
 
   private:
     LinkedList<ManuvrTCP*> _connections;   // A list of client connections.
+
+    #if defined(__MANUVR_LINUX)
+      PriorityQueue<ManuvrTCP*> _accepted;  // Accepted on the reactor. Waiting for the Kernel.
+      pthread_mutex_t _accept_lock;         // Guards _accepted.
+      ManuvrMsg       _accept_event;        // Tells our Kernel-side that _accepted needs attention.
+
+      int8_t accept_pending();
+      void   _adopt_accepted();
+    #endif
 };
 
 #endif  // __MANUVR_TCP_SOCKET_H__
@@ -20,12 +20,22 @@ limitations under the License.
 
 This class implements a crude UDP connector.
 
+Counterparties are tracked by address and port, each with its own UDPPipe.
+  Pipes for peers that fall silent are reclaimed by a periodic sweep, and
+  kept for reuse by the next new peer.
+On linux, datagrams are moved in batches with recvmmsg()/sendmmsg().
+
 */
 
 #if defined(MANUVR_SUPPORT_UDP)
 
 #include <StringBuilder.h>
 #include "ManuvrUDP.h"
+#include <Platform/Platform.h>
+
+#if defined(__MANUVR_LINUX)
+  #include <errno.h>
+#endif
 
 
 /*******************************************************************************
@@ -50,7 +60,9 @@ This class implements a crude UDP connector.
 *   executes under an ISR. Keep it brief...
 *******************************************************************************/
 
-#if defined(__BUILD_HAS_THREADS)
+#if defined(__MANUVR_LINUX)
+  // On linux, the SocketReactor services our sockets. No threads needed here.
+#elif defined(__BUILD_HAS_THREADS)
 
   /*
   * Since listening for connections on this transport involves blocking, we have a
@@ -114,11 +126,7 @@ This class implements a crude UDP connector.
 * @param  port  A 16-bit port number.
 */
 ManuvrUDP::ManuvrUDP(const char* addr, int port) : ManuvrSocket("ManuvrUDP", addr, port, nullptr) {
-  set_xport_state(MANUVR_XPORT_FLAG_HAS_MULTICAST | MANUVR_XPORT_FLAG_CONNECTIONLESS);
-  _bp_set_flag(BPIPE_FLAG_PIPE_PACKETIZED, true);
-
-  // Per RFC1122: Minimum reassembly buffer is 576 bytes of effective MTU.
-  _xport_mtu = 576;
+  _init_udp();
 }
 
 
@@ -130,11 +138,7 @@ ManuvrUDP::ManuvrUDP(const char* addr, int port) : ManuvrSocket("ManuvrUDP", add
 * @param  opts  An options mask to pass to the underlying socket implentation.
 */
 ManuvrUDP::ManuvrUDP(const char* addr, int port, SocketOpts* opts) : ManuvrSocket("ManuvrUDP", addr, port, opts) {
-  set_xport_state(MANUVR_XPORT_FLAG_HAS_MULTICAST | MANUVR_XPORT_FLAG_CONNECTIONLESS);
-  _bp_set_flag(BPIPE_FLAG_PIPE_PACKETIZED, true);
-
-  // Per RFC1122: Minimum reassembly buffer is 576 bytes of effective MTU.
-  _xport_mtu = 576;
+  _init_udp();
 }
 
 
@@ -145,10 +149,44 @@ ManuvrUDP::ManuvrUDP(const char* addr, int port, SocketOpts* opts) : ManuvrSocke
 *   as appropriate.
 */
 ManuvrUDP::~ManuvrUDP() {
-  std::map<uint16_t, UDPPipe*>::iterator it;
-  for (it = _open_replies.begin(); it != _open_replies.end(); it++) {
-    delete it->second;
+  #if defined(__MANUVR_LINUX)
+    if (reactorDriven()) {
+      // Must happen before our overrides go away.
+      SocketReactor::unwatch(this);
+      unset_xport_state(MANUVR_XPORT_FLAG_REACTOR_IO);
+    }
+  #endif
+  if (read_abort_event.isScheduled()) {
+    platform.kernel()->removeSchedule(&read_abort_event);
+  }
+  _release_all();
+  while (0 < _pool_count) {
+    delete _pipe_pool[--_pool_count];
   }
+  if (_rx_bufs) {
+    free(_rx_bufs);
+    _rx_bufs = nullptr;
+  }
+  #if defined(__MANUVR_LINUX)
+    for (int i = 0; i < MANUVR_UDP_BATCH; i++) {
+      if (_tx_q[i].buf) free(_tx_q[i].buf);
+    }
+  #endif
+}
+
+
+/**
+* Setup common to both constructors.
+*/
+void ManuvrUDP::_init_udp() {
+  set_xport_state(MANUVR_XPORT_FLAG_HAS_MULTICAST | MANUVR_XPORT_FLAG_CONNECTIONLESS);
+  _bp_set_flag(BPIPE_FLAG_PIPE_PACKETIZED, true);
+
+  // Per RFC1122: Minimum reassembly buffer is 576 bytes of effective MTU.
+  _xport_mtu = 576;
+  #if defined(__MANUVR_LINUX)
+    memset(_tx_q, 0, sizeof(_tx_q));
+  #endif
 }
 
 
@@ -252,10 +290,25 @@ int8_t ManuvrUDP::fromCounterparty(StringBuilder* buf, int8_t mm) {
 * @return 0 on success. Negative value on failure.
 */
 int8_t ManuvrUDP::listen() {
-  if (0 < _sock) {
+  if (listening()) {
     Kernel::log("A UDP socket was told to listen when it already was. Doing nothing.");
     return -1;
   }
+  #if defined(__MANUVR_LINUX)
+    if ((0 < _sock) && reactorDriven()) {
+      // Must not hold _tx_lock for this. The reactor may be waiting on it.
+      SocketReactor::unwatch(this);
+      unset_xport_state(MANUVR_XPORT_FLAG_REACTOR_IO);
+    }
+    // Writers open a socket of their own if they find none. Hold them off
+    //   until the bound socket is in place.
+    pthread_mutex_lock(&_tx_lock);
+  #endif
+  if (0 < _sock) {
+    // We sent before we listened. Trade the ephemeral socket for a bound one.
+    close(_sock);
+    _sock = 0;
+  }
 
   _sockaddr.sin_family      = AF_INET;
   //_sockaddr.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -263,20 +316,26 @@ int8_t ManuvrUDP::listen() {
   _sockaddr.sin_port        = htons(_port_number);
 
   _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);    // Open the socket...
-  if (-1 == _sock) {
-    Kernel::log("Failed to bind the UDP server socket.\n");
-    return -1;
-  }
-
-  /* Bind the server socket */
-  if (bind(_sock, (struct sockaddr *) &_sockaddr, sizeof(_sockaddr))) {
+  const bool bound = (-1 != _sock) && (0 == bind(_sock, (struct sockaddr *) &_sockaddr, sizeof(_sockaddr)));
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_unlock(&_tx_lock);
+  #endif
+  if (!bound) {
     Kernel::log("Failed to bind the UDP server socket.\n");
     return -1;
   }
 
   //initialized(true);
-  createThread(&_thread_id, nullptr, _udp_socket_listener_loop, (void*) this, nullptr);
   listening(true);
+  #if defined(__MANUVR_LINUX)
+    if (_reactor_attach()) {
+      Kernel::log("Failed to hand the UDP socket to the reactor.\n");
+      listening(false);
+      return -1;
+    }
+  #else
+    createThread(&_thread_id, nullptr, _udp_socket_listener_loop, (void*) this, nullptr);
+  #endif
   local_log.concatf("UDP Now listening at %s:%d.\n", _addr, _port_number);
 
   flushLocalLog();
@@ -284,85 +343,188 @@ int8_t ManuvrUDP::listen() {
 }
 
 
+#if defined(__MANUVR_LINUX)
+/**
+* Called from the reactor. Reads every datagram that is waiting.
+* A batch that comes back short means the socket is drained, so we don't spend
+*   a syscall to discover EAGAIN. Replies made while the batch was dispatched
+*   are held, and leave together at the end.
+* A datagram socket is never hung up for lack of data.
+*
+* @return 0 always.
+*/
+int8_t ManuvrUDP::read_ready() {
+  uint32_t before;
+  __atomic_store_n(&_dispatching, true, __ATOMIC_RELEASE);
+  do {
+    before = _rx_dgrams;
+  } while ((0 == read_port()) && (MANUVR_UDP_BATCH == (_rx_dgrams - before)));
+  __atomic_store_n(&_dispatching, false, __ATOMIC_RELEASE);
+  flushDatagrams();
+  return 0;
+}
+
+
+/**
+* Called from the reactor when the socket will take more datagrams.
+*
+* @return 0 always.
+*/
+int8_t ManuvrUDP::write_ready() {
+  pthread_mutex_lock(&_tx_lock);
+  _flush_tx();
+  if (0 == _tx_count) SocketReactor::wantWrite(this, false);
+  pthread_mutex_unlock(&_tx_lock);
+  return 0;
+}
+#endif
+
+
 /**
 * Read data from UDP port.
+* On linux, this takes up to MANUVR_UDP_BATCH datagrams with one syscall.
 *
-* NOTE: Blocks. So only call from within a thread.
-* TODO: ALL OF THIS RUNS IN A THREAD. IT IS NOT SAFE AS IT STANDS.
+* NOTE: Blocks for the first datagram unless the reactor has made the socket
+*   non-blocking.
 *
 * @return 0 on success. Negative value on failure.
 */
 int8_t ManuvrUDP::read_port() {
   int8_t return_value = -1;
-  unsigned char buf[_xport_mtu];
-  struct sockaddr_in cli_addr;
-  for (uint16_t i = 0; i < sizeof(cli_addr); i++) {
-    *((uint8_t *) &cli_addr  + i) = 0;   // Zero the sockaddr structure for use.
-  }
-
-  unsigned int clientlen = sizeof(cli_addr);
-  int n = recvfrom(getSockID(), buf, _xport_mtu, 0, (struct sockaddr*) &cli_addr, &clientlen);
-  if (-1 == n) {
-    local_log.concat("Failed to read UDP packet.\n");
-  }
-  else if (n > 0) {
-    // We received a packet. Send it further away.
-    bytes_received += n;   // Log the bytes.
-    if (getVerbosity() > 6) {
-      local_log.concatf("UDP read %d bytes from counterparty (%s).\n", n, (const char*) inet_ntoa(cli_addr.sin_addr));
+  if (nullptr == _rx_bufs) {
+    _rx_bufs = (uint8_t*) malloc(MANUVR_UDP_BATCH * _xport_mtu);
+    if (nullptr == _rx_bufs) return -1;
+  }
+
+  #if defined(__MANUVR_LINUX)
+    struct mmsghdr     msgs[MANUVR_UDP_BATCH];
+    struct iovec       iovs[MANUVR_UDP_BATCH];
+    struct sockaddr_in addrs[MANUVR_UDP_BATCH];
+    memset(msgs,  0, sizeof(msgs));
+    memset(addrs, 0, sizeof(addrs));
+    for (int i = 0; i < MANUVR_UDP_BATCH; i++) {
+      iovs[i].iov_base = _rx_bufs + (i * _xport_mtu);
+      iovs[i].iov_len  = _xport_mtu;
+      msgs[i].msg_hdr.msg_iov     = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen  = 1;
+      msgs[i].msg_hdr.msg_name    = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    }
+
+    int n = recvmmsg(getSockID(), msgs, MANUVR_UDP_BATCH, MSG_WAITFORONE, nullptr);
+    if (-1 == n) {
+      // Being drained is not a failure.
+      if ((EAGAIN != errno) && (EWOULDBLOCK != errno)) {
+        local_log.concat("Failed to read UDP packet.\n");
+      }
     }
-    UDPPipe* related_pipe = _open_replies[cli_addr.sin_port];
-    if (nullptr == related_pipe) {
-      // Non-existence. Create...
-      related_pipe = new UDPPipe(this, cli_addr.sin_addr.s_addr, cli_addr.sin_port);
-      if (_pipe_strategy) related_pipe->setPipeStrategy(_pipe_strategy);
-
-      if (MEM_MGMT_RESPONSIBLE_BEARER == ((BufferPipe*)related_pipe)->fromCounterparty(buf, n, MEM_MGMT_RESPONSIBLE_BEARER)) {
-        // The pipe copied the buffer. Success.
-        // Since we don't have a pipe, we create one and realize that there will
-        //   be nothing on the other side to take the buffer. So we only broadcast
-        //   a system-wide message if mem-mgmt responsibility for the buffer was
-        //   accepted by the bearer.
-        _open_replies[cli_addr.sin_port] = related_pipe;
-        ManuvrMsg* event = Kernel::returnEvent(MANUVR_MSG_XPORT_RECEIVE);
-        // Because we allocated the pipe, we must clean it up if it is not taken.
-        event->setOriginator((EventReceiver*) this);
-        //event->addArg(related_pipe);   // Add the newly-minted pipe.
-        // Convey the transport. This is optional, but helps downstream classes
-        //   make choices about binding to the BufferPipe.
-        //event->addArg((ManuvrXport*) this);
-        Kernel::staticRaiseEvent(event);
+    else if (n > 0) {
+      for (int i = 0; i < n; i++) {
+        _dispatch((uint8_t*) iovs[i].iov_base, msgs[i].msg_len, &addrs[i]);
+      }
+      _rx_calls++;
+      _rx_dgrams += n;
+      return_value = 0;
+    }
+  #else
+    struct sockaddr_in cli_addr;
+    memset(&cli_addr, 0, sizeof(cli_addr));
+    unsigned int clientlen = sizeof(cli_addr);
+    int n = recvfrom(getSockID(), _rx_bufs, _xport_mtu, 0, (struct sockaddr*) &cli_addr, &clientlen);
+    if (-1 == n) {
+      local_log.concat("Failed to read UDP packet.\n");
+    }
+    else if (n > 0) {
+      _dispatch(_rx_bufs, n, &cli_addr);
+      _rx_calls++;
+      _rx_dgrams++;
+      return_value = 0;
+    }
+  #endif
+  flushLocalLog();
+  return return_value;
+}
+
+
+/**
+* Hands a received datagram to the pipe for its counterparty. If there isn't
+*   one, a pipe is taken (from the pool, if possible), and the rest of the
+*   system is told about it.
+*
+* @param  buf  The datagram.
+* @param  len  Its length.
+* @param  src  Where it came from.
+*/
+void ManuvrUDP::_dispatch(uint8_t* buf, int len, struct sockaddr_in* src) {
+  const uint32_t ip   = src->sin_addr.s_addr;
+  const uint16_t port = ntohs(src->sin_port);
+  bytes_received += len;   // Log the bytes.
+  if (getVerbosity() > 6) {
+    local_log.concatf("UDP read %d bytes from counterparty (%s:%u).\n", len, (const char*) inet_ntoa(src->sin_addr), port);
+  }
+
+  _peer_lock();
+  UDPPipe* related_pipe = _peer_find(ip, port);
+  const bool fresh = (nullptr == related_pipe);
+  if (fresh) {
+    related_pipe = _take_pipe(ip, port);
+    if ((nullptr != related_pipe) && !_peer_insert(related_pipe)) {
+      related_pipe->rebind(nullptr, 0, 0);
+      if (_pool_count < MANUVR_UDP_PIPE_POOL) {
+        _pipe_pool[_pool_count++] = related_pipe;
       }
       else {
-        if (getVerbosity() > 2) {
-          local_log.concat("UDPPipe failed to take the buffer. Dropping this created pipe:\n");
-          related_pipe->printDebug(&local_log);
-        }
         delete related_pipe;
       }
+      related_pipe = nullptr;
     }
-    else {
-      // We have a related pipe.
-      switch (((BufferPipe*)related_pipe)->fromCounterparty(buf, n, MEM_MGMT_RESPONSIBLE_BEARER)) {
-        case MEM_MGMT_RESPONSIBLE_BEARER:
-          // Success
-          break;
-        case MEM_MGMT_RESPONSIBLE_CREATOR:
-          if (getVerbosity() > 3) local_log.concat("UDPPipe took the buffer, but will probably fail (RESPONSIBLE_CREATOR).\n");
-        case MEM_MGMT_RESPONSIBLE_CALLER:
-        default:
-          break;
-      }
+  }
+  if (related_pipe) related_pipe->lastSeen(millis());
+  _peer_unlock();
 
-      if (!related_pipe->persistAfterReply()) {
-        if (getVerbosity() > 3) local_log.concat("Attempting orderly cleanup of UDPPipe.\n");
-        delete related_pipe;
+  if (nullptr == related_pipe) {
+    if (getVerbosity() > 2) local_log.concat("No room to track a new UDP peer. Dropping datagram.\n");
+    return;
+  }
+
+  if (fresh) {
+    if (_pipe_strategy) related_pipe->setPipeStrategy(_pipe_strategy);
+    if (MEM_MGMT_RESPONSIBLE_BEARER == ((BufferPipe*)related_pipe)->fromCounterparty(buf, len, MEM_MGMT_RESPONSIBLE_BEARER)) {
+      // The pipe copied the buffer. Success.
+      // Since we don't have a pipe, we create one and realize that there will
+      //   be nothing on the other side to take the buffer. So we only broadcast
+      //   a system-wide message if mem-mgmt responsibility for the buffer was
+      //   accepted by the bearer.
+      ManuvrMsg* event = Kernel::returnEvent(MANUVR_MSG_XPORT_RECEIVE);
+      // Because we allocated the pipe, we must clean it up if it is not taken.
+      event->setOriginator((EventReceiver*) this);
+      //event->addArg(related_pipe);   // Add the newly-minted pipe.
+      // Convey the transport. This is optional, but helps downstream classes
+      //   make choices about binding to the BufferPipe.
+      //event->addArg((ManuvrXport*) this);
+      Kernel::staticRaiseEvent(event);
+    }
+    else {
+      if (getVerbosity() > 2) {
+        local_log.concat("UDPPipe failed to take the buffer. Dropping this created pipe:\n");
+        related_pipe->printDebug(&local_log);
       }
+      _release_pipe(related_pipe);
+    }
+  }
+  else {
+    // We have a related pipe. It lives until the peer falls silent.
+    switch (((BufferPipe*)related_pipe)->fromCounterparty(buf, len, MEM_MGMT_RESPONSIBLE_BEARER)) {
+      case MEM_MGMT_RESPONSIBLE_BEARER:
+        // Success
+        break;
+      case MEM_MGMT_RESPONSIBLE_CREATOR:
+        if (getVerbosity() > 3) local_log.concat("UDPPipe took the buffer, but will probably fail (RESPONSIBLE_CREATOR).\n");
+      case MEM_MGMT_RESPONSIBLE_CALLER:
+      default:
+        break;
     }
-    return_value = 0;
   }
-  flushLocalLog();
-  return return_value;
 }
 
 
@@ -374,11 +536,7 @@ int8_t ManuvrUDP::read_port() {
 */
 int8_t ManuvrUDP::reset() {
   initialized(false);
-  std::map<uint16_t, UDPPipe*>::iterator it;
-  for (it = _open_replies.begin(); it != _open_replies.end(); it++) {
-    delete it->second;
-  }
-
+  _release_all();
   disconnect();
 
   initialized(true);
@@ -395,7 +553,12 @@ bool ManuvrUDP::write_port(unsigned char* out, int out_len) {
 
 
 /**
-* Does what it claims to do on linux.
+* Sends a datagram from our own socket, so that replies come back to us. If we
+*   are not listening, an unbound socket is opened the first time we send.
+*
+* On linux, the datagram is queued and sent with its neighbors by sendmmsg().
+*   Unless the caller asks us to hold it (or we are in the middle of
+*   dispatching a received batch), the queue is flushed before we return.
 *
 * @param  out     The buffer to send.
 * @param  out_len The size of the buffer.
@@ -405,62 +568,397 @@ bool ManuvrUDP::write_port(unsigned char* out, int out_len) {
 * @return false on error and true on success.
 */
 bool ManuvrUDP::write_datagram(unsigned char* out, int out_len, uint32_t addr, int port, uint32_t opts) {
-  struct sockaddr_in _tmp_sockaddr;
   bool return_value = false;
+  if ((0 >= out_len) || (out_len > (int) _xport_mtu)) {
+    if (getVerbosity() > 3) Kernel::log("Refusing to write a UDP datagram of unsendable size.\n");
+    return false;
+  }
 
-  int _client_sock = socket(PF_INET, SOCK_DGRAM, 0);
-
-  _tmp_sockaddr.sin_family      = AF_INET;
-  _tmp_sockaddr.sin_port        = htons(port);
-  _tmp_sockaddr.sin_addr.s_addr = addr;
-  memset(_tmp_sockaddr.sin_zero, '\0', sizeof(_tmp_sockaddr.sin_zero));
+  #if defined(__MANUVR_LINUX)
+    // Writers may be on any thread. The lock makes sure they open only one socket.
+    pthread_mutex_lock(&_tx_lock);
+    if ((0 == _sock) && !_open_client_sock()) {
+      pthread_mutex_unlock(&_tx_lock);
+      return false;
+    }
+    if (MANUVR_UDP_BATCH == _tx_count) _flush_tx();
+    if (MANUVR_UDP_BATCH > _tx_count) {
+      UDPOutbound* dg = &_tx_q[_tx_count];
+      if (dg->cap < out_len) {
+        uint8_t* nu = (uint8_t*) realloc(dg->buf, _xport_mtu);
+        if (nu) {
+          dg->buf = nu;
+          dg->cap = _xport_mtu;
+        }
+      }
+      if (dg->cap >= out_len) {
+        memcpy(dg->buf, out, out_len);
+        dg->len = out_len;
+        memset(&dg->addr, 0, sizeof(dg->addr));
+        dg->addr.sin_family      = AF_INET;
+        dg->addr.sin_port        = htons(port);
+        dg->addr.sin_addr.s_addr = addr;
+        _tx_count++;
+        return_value = true;
+        if (!(__atomic_load_n(&_dispatching, __ATOMIC_ACQUIRE) || (opts & MANUVR_UDP_WRITE_HOLD)) || (MANUVR_UDP_BATCH == _tx_count)) {
+          _flush_tx();
+        }
+      }
+    }
+    else if (getVerbosity() > 3) {
+      Kernel::log("Failed to write a UDP datagram. Send queue is full.\n");
+    }
+    pthread_mutex_unlock(&_tx_lock);
+  #else
+    if ((0 == _sock) && !_open_client_sock()) {
+      return false;
+    }
+    struct sockaddr_in _tmp_sockaddr;
+    memset(&_tmp_sockaddr, 0, sizeof(_tmp_sockaddr));
+    _tmp_sockaddr.sin_family      = AF_INET;
+    _tmp_sockaddr.sin_port        = htons(port);
+    _tmp_sockaddr.sin_addr.s_addr = addr;
 
-  if (-1 != _client_sock) {
-    int result = sendto(_client_sock, out, out_len, 0, (const sockaddr*) &_tmp_sockaddr, sizeof(_tmp_sockaddr));
+    int result = sendto(_sock, out, out_len, 0, (const sockaddr*) &_tmp_sockaddr, sizeof(_tmp_sockaddr));
     if (-1 < result) {
       bytes_sent += result;
+      _tx_calls++;
+      _tx_dgrams++;
+      return_value = true;
+    }
+    else if (getVerbosity() > 3) {
+      Kernel::log("Failed to write a UDP datagram because of sentto().\n");
+    }
+  #endif
+  return return_value;
+}
 
-      UDPPipe* related_pipe = _open_replies[_tmp_sockaddr.sin_port];
-      if (nullptr == related_pipe) {
-        // Non-existence. Create...
-        related_pipe = new UDPPipe(this, _tmp_sockaddr.sin_addr.s_addr, _tmp_sockaddr.sin_port);
-        _open_replies[_tmp_sockaddr.sin_port] = related_pipe;
-      }
 
-      // TODO: We must receive from the socket before we can send again...
-      char buffer[_xport_mtu];
-      buffer[0] = '\0';
-      int _rec_bytes = recvfrom(_client_sock, buffer, _xport_mtu, 0, nullptr, nullptr);
-      Kernel::log(buffer);
-      return_value = true;
+/**
+* Opens the ephemeral socket that we send from if we aren't listening. On
+*   linux, the caller must hold _tx_lock.
+*
+* @return true if the socket is ready to use.
+*/
+bool ManuvrUDP::_open_client_sock() {
+  _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (-1 == _sock) {
+    _sock = 0;
+    if (getVerbosity() > 3) Kernel::log("Failed to write a UDP datagram. No client socket.\n");
+    return false;
+  }
+  #if defined(__MANUVR_LINUX)
+    // Replies will arrive on our ephemeral port.
+    if (_reactor_attach()) {
+      Kernel::log("Failed to hand the UDP socket to the reactor.\n");
+    }
+  #endif
+  return true;
+}
+
+
+/**
+* Sends any datagrams that were held by write_datagram().
+*
+* @return The number of datagrams still waiting on the socket.
+*/
+int ManuvrUDP::flushDatagrams() {
+  int return_value = 0;
+  #if defined(__MANUVR_LINUX)
+    pthread_mutex_lock(&_tx_lock);
+    if (0 < _tx_count) _flush_tx();
+    return_value = _tx_count;
+    pthread_mutex_unlock(&_tx_lock);
+  #endif
+  return return_value;
+}
+
+
+#if defined(__MANUVR_LINUX)
+/**
+* Hands the send queue to the kernel in a single sendmmsg(). Whatever the socket
+*   would not take stays queued (in order), and the reactor is asked to tell us
+*   when there is room.
+* A datagram that the kernel rejects outright is dropped, lest it wedge the
+*   queue.
+*
+* Must be called with _tx_lock held.
+*
+* @return The number of datagrams sent.
+*/
+int ManuvrUDP::_flush_tx() {
+  struct mmsghdr msgs[MANUVR_UDP_BATCH];
+  struct iovec   iovs[MANUVR_UDP_BATCH];
+  if ((0 == _tx_count) || (0 == _sock)) return 0;
+
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < _tx_count; i++) {
+    iovs[i].iov_base = _tx_q[i].buf;
+    iovs[i].iov_len  = _tx_q[i].len;
+    msgs[i].msg_hdr.msg_iov     = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &_tx_q[i].addr;
+    msgs[i].msg_hdr.msg_namelen = sizeof(_tx_q[i].addr);
+  }
+
+  int sent = sendmmsg(_sock, msgs, _tx_count, MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (0 > sent) {
+    if ((EAGAIN == errno) || (EWOULDBLOCK == errno)) {
+      sent = 0;
     }
     else {
-      if (getVerbosity() > 3) Kernel::log("Failed to write a UDP datagram because of sentto().\n");
+      if (getVerbosity() > 3) local_log.concatf("UDP dropped a datagram: %s\n", strerror(errno));
+      sent = 1;   // Drop the head of the queue.
     }
   }
   else {
-    if (getVerbosity() > 3) Kernel::log("Failed to write a UDP datagram. No client socket.\n");
+    _tx_calls++;
+    _tx_dgrams += sent;
+    for (int i = 0; i < sent; i++) bytes_sent += msgs[i].msg_len;
   }
 
-  return return_value;
+  if (0 < sent) {
+    // Rotate the sent slots to the back, so their buffers are kept.
+    UDPOutbound done[MANUVR_UDP_BATCH];
+    memcpy(done, _tx_q, sent * sizeof(UDPOutbound));
+    memmove(_tx_q, &_tx_q[sent], (_tx_count - sent) * sizeof(UDPOutbound));
+    memcpy(&_tx_q[_tx_count - sent], done, sent * sizeof(UDPOutbound));
+    _tx_count -= sent;
+  }
+  if ((0 < _tx_count) && reactorDriven()) {
+    SocketReactor::wantWrite(this, true);
+  }
+  return sent;
 }
+#endif
 
 
 /**
 * UDP pipes call this during their destructors to cause the
 *   issuing class to clean up references.
 *
-* @param  buf    A pointer to the buffer.
-* @param  len    How long the buffer is.
-* @param  mm     A declaration of memory-management responsibility.
-* @return A declaration of memory-management responsibility.
+* @param  _dead_walking  The pipe being destroyed.
+* @return 0 always.
 */
 int8_t ManuvrUDP::udpPipeDestroyCallback(UDPPipe* _dead_walking) {
-  _open_replies.erase(_dead_walking->getPort());
+  _peer_lock();
+  _peer_remove(_dead_walking);
+  _peer_unlock();
   return 0;
 }
 
 
+/**
+* Looks up the pipe for the given counterparty.
+*
+* @param  addr  The counterparty's IP as a network-order 32-bit unsigned.
+* @param  port  The counterparty's port in native order.
+* @return The pipe, or nullptr if we have none.
+*/
+UDPPipe* ManuvrUDP::peer(uint32_t addr, uint16_t port) {
+  _peer_lock();
+  UDPPipe* return_value = _peer_find(addr, port);
+  _peer_unlock();
+  return return_value;
+}
+
+
+
+/*******************************************************************************
+* Peer table and pipe pool
+*******************************************************************************/
+
+/**
+* Gives a pipe bound to the given counterparty. Reuses a pooled pipe if there
+*   is one. Must be called with the peer lock held.
+*
+* @return A pipe, or nullptr on allocation failure.
+*/
+UDPPipe* ManuvrUDP::_take_pipe(uint32_t ip, uint16_t port) {
+  UDPPipe* return_value = (0 < _pool_count) ? _pipe_pool[--_pool_count] : new UDPPipe();
+  if (return_value) return_value->rebind(this, ip, port);
+  return return_value;
+}
+
+
+/**
+* Forgets the pipe's counterparty, and returns the pipe to the pool (or the
+*   heap, if the pool is full or the pipe can't be recycled).
+*/
+void ManuvrUDP::_release_pipe(UDPPipe* p) {
+  _peer_lock();
+  _peer_remove(p);
+  _peer_unlock();
+  _recycle_pipe(p);
+}
+
+
+/**
+* Returns a pipe that is no longer in the peer table to the pool (or the
+*   heap, if the pool is full or the pipe can't be recycled).
+*/
+void ManuvrUDP::_recycle_pipe(UDPPipe* p) {
+  bool pooled = false;
+  if (p->recycle()) {   // Detaches it from us, as well as its far-side.
+    _peer_lock();
+    pooled = (_pool_count < MANUVR_UDP_PIPE_POOL);
+    if (pooled) _pipe_pool[_pool_count++] = p;
+    _peer_unlock();
+  }
+  if (!pooled) delete p;
+}
+
+
+/**
+* Destroys every pipe in the table, and the table itself. The pool is left
+*   alone.
+*/
+void ManuvrUDP::_release_all() {
+  _peer_lock();
+  UDPPeer* old = _peers;
+  const uint32_t old_size = (nullptr != _peers) ? (_peer_mask + 1) : 0;
+  _peers      = nullptr;
+  _peer_mask  = 0;
+  _peer_count = 0;
+  _peer_unlock();
+
+  // With the table gone, the destroy callbacks have nothing to remove.
+  for (uint32_t r = 0; r < old_size; r++) {
+    if (nullptr != old[r].pipe) delete old[r].pipe;
+  }
+  if (old) free(old);
+}
+
+
+/**
+* Reclaims the pipes of peers that have been silent for longer than
+*   MANUVR_UDP_PEER_TIMEOUT. Pipes marked persistent are left alone.
+*
+* @param  now  The current value of millis().
+*/
+void ManuvrUDP::_expire_peers(uint32_t now) {
+  UDPPipe* idle[MANUVR_UDP_PIPE_POOL];
+  int idle_count = 0;
+
+  // The reactor may be holding a pipe it found during a batch. Nothing is
+  //   reclaimed until it is done. Whatever we skip now, the next sweep finds.
+  if (__atomic_load_n(&_dispatching, __ATOMIC_ACQUIRE)) return;
+
+  // Dispatch stamps lastSeen under this same lock, so a pipe it has found is
+  //   never stale here, and a pipe we take out of the table can't be found.
+  _peer_lock();
+  const uint32_t size = (nullptr != _peers) ? (_peer_mask + 1) : 0;
+  for (uint32_t r = 0; (r < size) && (idle_count < MANUVR_UDP_PIPE_POOL); r++) {
+    UDPPipe* p = _peers[r].pipe;
+    if ((nullptr != p) && !p->persistAfterReply() && ((int32_t) (now - p->lastSeen()) > MANUVR_UDP_PEER_TIMEOUT)) {
+      idle[idle_count++] = p;
+    }
+  }
+  for (int i = 0; i < idle_count; i++) _peer_remove(idle[i]);
+  _peer_unlock();
+
+  // Whatever doesn't fit in this sweep will be caught by the next one.
+  for (int i = 0; i < idle_count; i++) {
+    if (getVerbosity() > 5) {
+      local_log.concat("Reclaiming pipe for a silent UDP peer.\n");
+    }
+    _recycle_pipe(idle[i]);
+    _expired++;
+  }
+}
+
+
+/**
+* Must be called with the peer lock held.
+*
+* @return The pipe for the given counterparty, or nullptr if there is none.
+*/
+UDPPipe* ManuvrUDP::_peer_find(uint32_t ip, uint16_t port) {
+  if (nullptr == _peers) return nullptr;
+  uint32_t i = _peer_home(ip, port);
+  while (nullptr != _peers[i].pipe) {
+    if ((_peers[i].ip == ip) && (_peers[i].port == port)) {
+      return _peers[i].pipe;
+    }
+    i = (i + 1) & _peer_mask;
+  }
+  return nullptr;
+}
+
+
+/**
+* Adds a pipe to the table under its counterparty. Grows the table to keep the
+*   load below 3/4. Must be called with the peer lock held.
+*
+* @return false on allocation failure.
+*/
+bool ManuvrUDP::_peer_insert(UDPPipe* p) {
+  if ((nullptr == _peers) || (((_peer_count + 1) * 4) > ((_peer_mask + 1) * 3))) {
+    if (!_peer_grow()) return false;
+  }
+  uint32_t i = _peer_home(p->getIP(), p->getPort());
+  while (nullptr != _peers[i].pipe) i = (i + 1) & _peer_mask;
+  _peers[i].ip   = p->getIP();
+  _peers[i].port = p->getPort();
+  _peers[i].pipe = p;
+  _peer_count++;
+  return true;
+}
+
+
+/**
+* Removes a pipe from the table, if it is there. Entries after it in the probe
+*   sequence are shifted back, so that no tombstones are needed.
+* Must be called with the peer lock held.
+*/
+void ManuvrUDP::_peer_remove(UDPPipe* p) {
+  if (nullptr == _peers) return;
+  uint32_t i = _peer_home(p->getIP(), p->getPort());
+  while (p != _peers[i].pipe) {
+    if (nullptr == _peers[i].pipe) return;   // Not here.
+    i = (i + 1) & _peer_mask;
+  }
+  _peers[i].pipe = nullptr;
+  _peer_count--;
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & _peer_mask;
+    if (nullptr == _peers[j].pipe) break;
+    const uint32_t k = _peer_home(_peers[j].ip, _peers[j].port);
+    // If the entry's home lies cyclically within (i, j], it must stay where it is.
+    if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) continue;
+    _peers[i] = _peers[j];
+    _peers[j].pipe = nullptr;
+    i = j;
+  }
+}
+
+
+/**
+* Doubles the size of the peer table (starting at 16), and rehashes.
+*
+* @return false on allocation failure.
+*/
+bool ManuvrUDP::_peer_grow() {
+  const uint32_t old_size = (nullptr != _peers) ? (_peer_mask + 1) : 0;
+  const uint32_t nu_size  = (old_size) ? (old_size * 2) : 16;
+  UDPPeer* nu = (UDPPeer*) calloc(nu_size, sizeof(UDPPeer));
+  if (nullptr == nu) return false;
+  UDPPeer* old = _peers;
+  _peers     = nu;
+  _peer_mask = nu_size - 1;
+  for (uint32_t r = 0; r < old_size; r++) {
+    if (nullptr != old[r].pipe) {
+      uint32_t i = _peer_home(old[r].ip, old[r].port);
+      while (nullptr != _peers[i].pipe) i = (i + 1) & _peer_mask;
+      _peers[i] = old[r];
+    }
+  }
+  if (old) free(old);
+  return true;
+}
+
+
 
 /*******************************************************************************
 * ######## ##     ## ######## ##    ## ########  ######
@@ -484,12 +982,11 @@ int8_t ManuvrUDP::attached() {
   if (EventReceiver::attached()) {
     // Because this is not a stream-oriented transport, the timeout value is used
     //   to periodically flush our connection cache.
-    read_abort_event.alterScheduleRecurrence(0);
-    read_abort_event.alterSchedulePeriod(300);
+    read_abort_event.alterScheduleRecurrence(-1);
+    read_abort_event.alterSchedulePeriod(MANUVR_UDP_SWEEP_PERIOD);
     read_abort_event.autoClear(false);
-    read_abort_event.enableSchedule(false);
-    read_abort_event.enableSchedule(false);
-    //platform.kernel()->addSchedule(&read_abort_event);
+    read_abort_event.enableSchedule(true);
+    platform.kernel()->addSchedule(&read_abort_event);
     listen();
     return 1;
   }
@@ -508,16 +1005,48 @@ void ManuvrUDP::printDebug(StringBuilder* output) {
   output->concatf("-- _addr           %s:%d\n",  _addr, _port_number);
   output->concatf("-- _opts           %p\n", _opts);
   output->concatf("-- _sock           0x%08x\n", _sock);
-
-  output->concatf("--\n-- _open_replies \n");
-  std::map<uint16_t, UDPPipe*>::iterator it;
-  for (it = _open_replies.begin(); it != _open_replies.end(); it++) {
-    it->second->printDebug(output);
+  output->concatf("-- Pooled pipes    %u\n", _pool_count);
+  output->concatf("-- Expired peers   %u\n", _expired);
+  output->concatf("-- rx datagrams    %u in %u calls\n", _rx_dgrams, _rx_calls);
+  output->concatf("-- tx datagrams    %u in %u calls\n", _tx_dgrams, _tx_calls);
+
+  output->concatf("--\n-- Peers (%u)\n", _peer_count);
+  _peer_lock();
+  const uint32_t size = (nullptr != _peers) ? (_peer_mask + 1) : 0;
+  for (uint32_t r = 0; r < size; r++) {
+    if (nullptr != _peers[r].pipe) _peers[r].pipe->printDebug(output);
   }
+  _peer_unlock();
   output->concat("\n");
 }
 
 
+/**
+* The read_abort_event comes here on a schedule. We use it to sweep for silent
+*   peers, and to push out anything left in the send queue.
+*
+* @param  active_event  The event that is being serviced.
+* @return The number of actions taken in response to the event.
+*/
+int8_t ManuvrUDP::notify(ManuvrMsg* active_event) {
+  int8_t return_value = 0;
+
+  switch (active_event->eventCode()) {
+    case MANUVR_MSG_XPORT_QUEUE_RDY:
+      _expire_peers(millis());
+      flushDatagrams();
+      return_value++;
+      break;
+    default:
+      return_value += ManuvrXport::notify(active_event);
+      break;
+  }
+
+  flushLocalLog();
+  return return_value;
+}
+
+
 /**
 * If we find ourselves in this fxn, it means an event that this class built (the argument)
 *   has been serviced and we are now getting the chance to see the results. The argument
@@ -550,7 +1079,7 @@ int8_t ManuvrUDP::callback_proc(ManuvrMsg* event) {
             // The pipe was NOT taken. Clean it up.
             if (0 == event->getArgAs(&tmp_pipe)) {
               // We rely on the UDPPipe to call us back to trigger a cleanup of
-              //   the entry in _open_replies.
+              //   the entry in the peer table.
               delete (UDPPipe*) tmp_pipe;  // TODO: Any safer way?
             }
             break;
@@ -75,6 +75,29 @@ This is basically only for linux until it is needed in a smaller space.
 
 #define MANUVR_UDP_FLAG_PERSIST       0x01  // Keep this pipe alive until explicit close.
 
+// Options to write_datagram().
+#define MANUVR_UDP_WRITE_HOLD   0x00000001  // Hold the datagram for a batched send.
+
+// How many datagrams may we move with a single syscall?
+#ifndef MANUVR_UDP_BATCH
+  #define MANUVR_UDP_BATCH          16
+#endif
+
+// How many idle UDPPipes do we keep for reuse?
+#ifndef MANUVR_UDP_PIPE_POOL
+  #define MANUVR_UDP_PIPE_POOL      16
+#endif
+
+// How long (in ms) may a peer be silent before its pipe is reclaimed?
+#ifndef MANUVR_UDP_PEER_TIMEOUT
+  #define MANUVR_UDP_PEER_TIMEOUT   30000
+#endif
+
+// How often (in ms) do we look for silent peers?
+#ifndef MANUVR_UDP_SWEEP_PERIOD
+  #define MANUVR_UDP_SWEEP_PERIOD   1000
+#endif
+
 class ManuvrUDP;
 
 /*
@@ -96,13 +119,20 @@ class UDPPipe : public BufferPipe {
     void printDebug(StringBuilder*);
     int takeAccumulator(StringBuilder*);
 
+    void rebind(ManuvrUDP*, uint32_t, uint16_t);
+    bool recycle();
+
     /* Is this transport used for non-session purposes? IE, GPS? */
     inline bool persistAfterReply() {         return (_udpflags & MANUVR_UDP_FLAG_PERSIST);  };
     inline void persistAfterReply(bool en) {
       _udpflags = (en) ? (_udpflags | MANUVR_UDP_FLAG_PERSIST) : (_udpflags & ~(MANUVR_UDP_FLAG_PERSIST));
     };
 
-    inline uint16_t getPort() {   return _port;   };
+    inline uint32_t getIP() {     return _ip;     };
+    inline uint16_t getPort() {   return _port;   };   // Native order.
+
+    inline uint32_t lastSeen() {           return _last_seen;   };
+    inline void     lastSeen(uint32_t x) { _last_seen = x;      };
 
 
   protected:
@@ -114,6 +144,7 @@ class UDPPipe : public BufferPipe {
     uint32_t      _ip;
     uint16_t      _port;
     uint16_t      _udpflags;
+    uint32_t      _last_seen = 0; // millis() when a datagram last arrived.
     StringBuilder _accumulator;   // Holds an incoming packet prior to setFar().
 };
 
@@ -142,6 +173,7 @@ class ManuvrUDP : public ManuvrSocket
 
     /* Overrides from EventReceiver */
     void printDebug(StringBuilder*);
+    int8_t notify(ManuvrMsg*);
     int8_t callback_proc(ManuvrMsg*);
 
     int8_t connect();
@@ -151,6 +183,20 @@ class ManuvrUDP : public ManuvrSocket
 
     bool write_port(unsigned char* out, int out_len);
     int8_t udpPipeDestroyCallback(UDPPipe*);
+    int  flushDatagrams();
+
+    UDPPipe* peer(uint32_t addr, uint16_t port);
+
+    inline uint32_t peerCount() {     return _peer_count;  };
+    inline uint32_t rxSyscalls() {    return _rx_calls;    };
+    inline uint32_t rxDatagrams() {   return _rx_dgrams;   };
+    inline uint32_t txSyscalls() {    return _tx_calls;    };
+    inline uint32_t txDatagrams() {   return _tx_dgrams;   };
+
+    #if defined(__MANUVR_LINUX)
+      int8_t read_ready();   // Override from ManuvrSocket.
+      int8_t write_ready();  // Override from ManuvrSocket.
+    #endif
 
     bool write_datagram(unsigned char* out, int out_len, uint32_t addr, int port, uint32_t opts);
     inline bool write_datagram(unsigned char* out, int out_len, uint32_t addr, int port) {
@@ -169,8 +215,62 @@ class ManuvrUDP : public ManuvrSocket
 
 
   private:
-    // We index our spawned UDPPipes by counterparty port number.
-    std::map<uint16_t, UDPPipe*> _open_replies;
+    /*
+    * Our spawned UDPPipes are indexed by counterparty address and port, in an
+    *   open-addressed table. An empty slot has no pipe.
+    */
+    typedef struct {
+      uint32_t ip;       // Network order.
+      uint16_t port;     // Native order.
+      UDPPipe* pipe;
+    } UDPPeer;
+
+    /* A datagram held for a batched send. The buffer is kept between uses. */
+    typedef struct {
+      struct sockaddr_in addr;
+      uint8_t* buf;
+      int      len;
+      int      cap;
+    } UDPOutbound;
+
+    UDPPeer*    _peers       = nullptr;
+    uint32_t    _peer_mask   = 0;
+    uint32_t    _peer_count  = 0;
+    UDPPipe*    _pipe_pool[MANUVR_UDP_PIPE_POOL];
+    uint8_t     _pool_count  = 0;
+    bool        _peer_locked = false;   // Spinlock for the table and the pool.
+    bool        _dispatching = false;   // Replies are held while we work through a batch. Atomic.
+    uint32_t    _expired     = 0;       // Peers reclaimed for silence.
+    uint32_t    _rx_calls    = 0;       // Receive syscalls that returned datagrams.
+    uint32_t    _rx_dgrams   = 0;       // Counted after dispatch.
+    uint32_t    _tx_calls    = 0;
+    uint32_t    _tx_dgrams   = 0;
+    uint8_t*    _rx_bufs     = nullptr; // MANUVR_UDP_BATCH buffers of _xport_mtu bytes.
+    #if defined(__MANUVR_LINUX)
+      UDPOutbound _tx_q[MANUVR_UDP_BATCH];  // Guarded by _tx_lock.
+      uint8_t     _tx_count  = 0;
+    #endif
+
+    void     _init_udp();
+    void     _dispatch(uint8_t* buf, int len, struct sockaddr_in* src);
+    int      _flush_tx();
+    bool     _open_client_sock();
+    UDPPipe* _take_pipe(uint32_t ip, uint16_t port);
+    void     _release_pipe(UDPPipe*);
+    void     _recycle_pipe(UDPPipe*);
+    void     _release_all();
+    void     _expire_peers(uint32_t now);
+    UDPPipe* _peer_find(uint32_t ip, uint16_t port);
+    bool     _peer_insert(UDPPipe*);
+    void     _peer_remove(UDPPipe*);
+    bool     _peer_grow();
+
+    inline uint32_t _peer_home(uint32_t ip, uint16_t port) {
+      const uint32_t h = (ip * 0x9E3779B1) ^ (port * 0x85EBCA77);
+      return ((h ^ (h >> 15)) & _peer_mask);
+    };
+    inline void _peer_lock() {     while (__atomic_test_and_set(&_peer_locked, __ATOMIC_ACQUIRE)) {}  };
+    inline void _peer_unlock() {   __atomic_clear(&_peer_locked, __ATOMIC_RELEASE);                  };
 };
 
 
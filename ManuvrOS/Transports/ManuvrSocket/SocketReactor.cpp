@@ -0,0 +1,303 @@
+/*
+File:   SocketReactor.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <CommonConstants.h>
+#include "SocketReactor.h"
+#include "ManuvrSocket.h"
+
+#if defined(__MANUVR_LINUX) && (defined(MANUVR_SUPPORT_TCPSOCKET) || defined(MANUVR_SUPPORT_UDP))
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <Kernel.h>
+#include <Platform/Platform.h>
+
+
+/*******************************************************************************
+*      _______.___________.    ___   .___________. __    ______     _______.
+*     /       |           |   /   \  |           ||  |  /      |   /       |
+*    |   (----`---|  |----`  /  ^  \ `---|  |----`|  | |  ,----'  |   (----`
+*     \   \       |  |      /  /_\  \    |  |     |  | |  |        \   \
+* .----)   |      |  |     /  _____  \   |  |     |  | |  `----.----)   |
+* |_______/       |__|    /__/     \__\  |__|     |__|  \______|_______/
+*
+* Static members and initializers should be located here.
+*******************************************************************************/
+int           SocketReactor::_epoll_fds[SOCKET_REACTOR_SHARDS];
+int           SocketReactor::_wake_fds[SOCKET_REACTOR_SHARDS];
+unsigned long SocketReactor::_shard_threads[SOCKET_REACTOR_SHARDS];
+ReactorSlot*  SocketReactor::_slots      = nullptr;
+uint32_t      SocketReactor::_slot_count = 0;
+uint32_t      SocketReactor::_watched    = 0;
+uint32_t      SocketReactor::_dispatches = 0;
+uint32_t      SocketReactor::_stale      = 0;
+bool          SocketReactor::_started    = false;
+
+static pthread_once_t  _reactor_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _slot_lock    = PTHREAD_MUTEX_INITIALIZER;   // Guards the slot table.
+
+/* Each shard holds its lock for as long as it is inside a socket's callbacks. */
+static pthread_mutex_t _dispatch_locks[SOCKET_REACTOR_SHARDS];
+
+/* The handle we give epoll for a shard's wake eventfd. No descriptor is this large. */
+#define SOCKET_REACTOR_WAKE_HANDLE  0xFFFFFFFFFFFFFFFFULL
+
+/* The descriptor and generation of a slot, as we give them to epoll. */
+static inline uint64_t _handle(int fd, uint32_t gen) {
+  return ((((uint64_t) gen) << 32) | (uint32_t) fd);
+}
+
+
+/**
+* Creates the epoll sets and their threads. Runs exactly once.
+*/
+void SocketReactor::_init() {
+  for (int i = 0; i < SOCKET_REACTOR_SHARDS; i++) {
+    _shard_threads[i] = 0;
+    pthread_mutex_init(&_dispatch_locks[i], nullptr);
+    _wake_fds[i]  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _epoll_fds[i] = epoll_create1(EPOLL_CLOEXEC);
+    if (0 > _epoll_fds[i]) {
+      Kernel::log("SocketReactor: Failed to create epoll set.\n");
+      continue;
+    }
+    if (0 <= _wake_fds[i]) {
+      struct epoll_event ev;
+      ev.events   = EPOLLIN;
+      ev.data.u64 = SOCKET_REACTOR_WAKE_HANDLE;
+      if (epoll_ctl(_epoll_fds[i], EPOLL_CTL_ADD, _wake_fds[i], &ev)) {
+        Kernel::log("SocketReactor: Failed to watch the wake eventfd.\n");
+      }
+    }
+    ManuvrThreadOptions _t_opts;
+    _t_opts.thread_name = (char*) "sock_reactor";
+    if (createThread(&_shard_threads[i], nullptr, _shard_loop, (void*) &_epoll_fds[i], &_t_opts)) {
+      Kernel::log("SocketReactor: Failed to create shard thread.\n");
+    }
+  }
+  __atomic_store_n(&_started, true, __ATOMIC_RELEASE);
+}
+
+
+/**
+* A shard's thread. Waits on its epoll set, and hands readiness to the sockets.
+*/
+void* SocketReactor::_shard_loop(void* arg) {
+  const int epfd  = *((int*) arg);
+  const int shard = (int) (((int*) arg) - &_epoll_fds[0]);
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGQUIT);
+  sigaddset(&set, SIGHUP);
+  sigaddset(&set, SIGTERM);
+  sigaddset(&set, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+  struct epoll_event evs[SOCKET_REACTOR_MAX_EVENTS];
+  while (platform.platformState() <= MANUVR_INIT_STATE_NOMINAL) {
+    int n = epoll_wait(epfd, evs, SOCKET_REACTOR_MAX_EVENTS, -1);
+    for (int i = 0; i < n; i++) {
+      const uint32_t ev = evs[i].events;
+      if (SOCKET_REACTOR_WAKE_HANDLE == evs[i].data.u64) {
+        // Nothing to service. We only needed to re-check the platform state.
+        uint64_t count;
+        if (read(_wake_fds[shard], &count, sizeof(count))) {}
+        continue;
+      }
+      __atomic_add_fetch(&_dispatches, 1, __ATOMIC_RELAXED);
+      pthread_mutex_lock(&_dispatch_locks[shard]);
+      // Anything unwatched since the wait returned is no longer in the table.
+      ManuvrSocket* sock = _claim(evs[i].data.u64);
+      if (nullptr != sock) {
+        if (ev & EPOLLOUT) {
+          sock->write_ready();
+        }
+        if ((ev & EPOLLIN) && (0 > sock->read_ready())) {
+          sock->hangup();
+        }
+        else if (ev & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+          sock->hangup();
+        }
+      }
+      else {
+        __atomic_add_fetch(&_stale, 1, __ATOMIC_RELAXED);
+      }
+      pthread_mutex_unlock(&_dispatch_locks[shard]);
+    }
+  }
+  return nullptr;
+}
+
+
+/**
+* Finds the socket named by an epoll handle.
+*
+* @param  handle  The descriptor and generation that we gave to epoll.
+* @return The socket, or nullptr if it has been unwatched since.
+*/
+ManuvrSocket* SocketReactor::_claim(uint64_t handle) {
+  const uint32_t fd  = (uint32_t) (handle & 0xFFFFFFFF);
+  const uint32_t gen = (uint32_t) (handle >> 32);
+  ManuvrSocket* return_value = nullptr;
+  pthread_mutex_lock(&_slot_lock);
+  if ((fd < _slot_count) && (gen == _slots[fd].gen)) {
+    return_value = _slots[fd].sock;
+  }
+  pthread_mutex_unlock(&_slot_lock);
+  return return_value;
+}
+
+
+/**
+* Updates the slot table, and then epoll. Caller must hold the slot lock.
+*
+* @param  sock    The socket in question.
+* @param  op      The epoll_ctl() operation.
+* @param  events  The events we want to hear about.
+* @return 0 on success, -1 on failure.
+*/
+int SocketReactor::_modify(ManuvrSocket* sock, int op, uint32_t events) {
+  const int fd = sock->getSockID();
+  if (0 >= fd) return -1;
+  if (EPOLL_CTL_ADD == op) {
+    if ((uint32_t) fd >= _slot_count) {
+      uint32_t nu_count = (0 == _slot_count) ? 64 : _slot_count;
+      while (nu_count <= (uint32_t) fd) nu_count <<= 1;
+      ReactorSlot* nu_slots = (ReactorSlot*) realloc(_slots, nu_count * sizeof(ReactorSlot));
+      if (nullptr == nu_slots) return -1;
+      memset(&nu_slots[_slot_count], 0, (nu_count - _slot_count) * sizeof(ReactorSlot));
+      _slots      = nu_slots;
+      _slot_count = nu_count;
+    }
+    _slots[fd].sock = sock;
+    _slots[fd].gen++;
+  }
+  else if (((uint32_t) fd >= _slot_count) || (sock != _slots[fd].sock)) {
+    return -1;   // Not ours.
+  }
+
+  struct epoll_event ev;
+  ev.events   = events;
+  ev.data.u64 = _handle(fd, _slots[fd].gen);
+  const int ret = epoll_ctl(_epoll_fds[fd % SOCKET_REACTOR_SHARDS], op, fd, &ev);
+  if ((EPOLL_CTL_DEL == op) || ((0 != ret) && (EPOLL_CTL_ADD == op))) {
+    _slots[fd].sock = nullptr;   // Events already taken from epoll are now stale.
+  }
+  return ret;
+}
+
+
+/**
+* Begin servicing a socket. The socket should already be non-blocking.
+*
+* @param  sock  The socket to watch.
+* @return 0 on success, -1 on failure.
+*/
+int8_t SocketReactor::watch(ManuvrSocket* sock) {
+  pthread_once(&_reactor_once, _init);
+  pthread_mutex_lock(&_slot_lock);
+  const int ret = _modify(sock, EPOLL_CTL_ADD, EPOLLIN | EPOLLRDHUP);
+  pthread_mutex_unlock(&_slot_lock);
+  if (0 == ret) {
+    __atomic_add_fetch(&_watched, 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  return -1;
+}
+
+
+/**
+* Stop servicing a socket. Must be called before the socket is closed.
+* If the socket's shard is in one of its callbacks, we wait for it to finish.
+*   Once this returns, the reactor holds no reference to the socket.
+*
+* The shard may have unwatched the socket itself (from hangup()), and still be
+*   inside that callback. So we wait out the shard even if the socket was not
+*   ours to remove. If the socket's descriptor is already gone, we can't know
+*   its shard, and wait out all of them.
+*
+* @param  sock  The socket to forget.
+* @return 0 on success, -1 if the socket was not being watched.
+*/
+int8_t SocketReactor::unwatch(ManuvrSocket* sock) {
+  const int fd = sock->getSockID();
+  pthread_mutex_lock(&_slot_lock);
+  const int ret = _modify(sock, EPOLL_CTL_DEL, 0);
+  pthread_mutex_unlock(&_slot_lock);
+  if (0 == ret) {
+    __atomic_sub_fetch(&_watched, 1, __ATOMIC_RELAXED);
+  }
+
+  for (int shard = 0; shard < SOCKET_REACTOR_SHARDS; shard++) {
+    if ((0 < fd) && (shard != (fd % SOCKET_REACTOR_SHARDS))) continue;
+    if (!pthread_equal(pthread_self(), (pthread_t) _shard_threads[shard])) {
+      // The shard can't find the socket anymore. Wait out any callback in progress.
+      pthread_mutex_lock(&_dispatch_locks[shard]);
+      pthread_mutex_unlock(&_dispatch_locks[shard]);
+    }
+  }
+  return (0 == ret) ? 0 : -1;
+}
+
+
+/**
+* Sockets with a transmit backlog ask to be told when they can write again.
+*
+* @param  sock  The socket in question.
+* @param  en    true to be notified of writability, false to stop.
+* @return 0 on success, -1 on failure.
+*/
+int8_t SocketReactor::wantWrite(ManuvrSocket* sock, bool en) {
+  pthread_mutex_lock(&_slot_lock);
+  const int ret = _modify(sock, EPOLL_CTL_MOD, EPOLLIN | EPOLLRDHUP | (en ? EPOLLOUT : 0));
+  pthread_mutex_unlock(&_slot_lock);
+  return (0 == ret) ? 0 : -1;
+}
+
+
+/**
+* Wakes every shard, so that each notices that the platform is leaving the
+*   NOMINAL state and returns. Call after the platform state has changed.
+*/
+void SocketReactor::shutdown() {
+  if (!__atomic_load_n(&_started, __ATOMIC_ACQUIRE)) return;
+  const uint64_t one = 1;
+  for (int i = 0; i < SOCKET_REACTOR_SHARDS; i++) {
+    if (0 <= _wake_fds[i]) {
+      if (write(_wake_fds[i], &one, sizeof(one))) {}
+    }
+  }
+}
+
+
+/**
+* Debug support method.
+*
+* @param   StringBuilder* The buffer into which this fxn should write its output.
+*/
+void SocketReactor::printDebug(StringBuilder* output) {
+  output->concatf("-- SocketReactor (%d shards)\n", SOCKET_REACTOR_SHARDS);
+  output->concatf("\t Watched sockets   %u\n", _watched);
+  output->concatf("\t Dispatches        %u\n", _dispatches);
+  output->concatf("\t Stale events      %u\n", _stale);
+}
+
+#endif  // __MANUVR_LINUX
@@ -0,0 +1,110 @@
+/*
+File:   SocketReactor.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A small epoll reactor that owns the readiness of every ManuvrSocket.
+
+Rather than a blocking thread per socket, we keep SOCKET_REACTOR_SHARDS
+  threads, each waiting on its own epoll set. Sockets are assigned to a shard
+  by descriptor, and all callbacks for a given socket happen on that shard's
+  thread. Listening sockets, connections, and datagram sockets are all
+  serviced the same way.
+
+The kernel hands us a descriptor and a generation rather than a pointer, so
+  readiness that was queued for a socket that has since been unwatched (or
+  whose descriptor was reused) is discarded. unwatch() does not return until
+  the shard is done with any callback that is running for that socket, so a
+  socket may be freed once unwatch() returns.
+
+Every socket callback (read_ready(), write_ready(), and hangup()) runs on
+  the shard's thread, not the Kernel's. So read_port() hands inbound bytes
+  to the pipe from the shard, and hangup() calls disconnect() from the shard
+  while the Kernel may be calling it too. disconnect() must therefore be safe
+  to call from both at once, and anything a callback touches that the Kernel
+  also touches needs a lock (or must be handed to the Kernel as an event).
+
+Each shard also watches an eventfd. shutdown() signals them all, so that the
+  shards notice the platform leaving the NOMINAL state without waiting for
+  socket traffic that may never come.
+
+This is linux-only. Elsewhere, sockets fall back to read threads.
+*/
+
+#ifndef __MANUVR_SOCKET_REACTOR_H__
+#define __MANUVR_SOCKET_REACTOR_H__
+
+#if defined(__MANUVR_LINUX)
+
+#include <inttypes.h>
+#include <StringBuilder.h>
+
+// How many reactor threads should we run?
+#ifndef SOCKET_REACTOR_SHARDS
+  #define SOCKET_REACTOR_SHARDS 1
+#endif
+
+// How many readiness events may a shard take from the kernel in one wait?
+#define SOCKET_REACTOR_MAX_EVENTS  64
+
+// How large a chunk do we read from a stream socket at once?
+#define SOCKET_READ_CHUNK        2048
+
+// How many bytes may queue behind a slow counterparty before we refuse writes?
+#ifndef SOCKET_TX_BACKLOG_LIMIT
+  #define SOCKET_TX_BACKLOG_LIMIT  65536
+#endif
+
+class ManuvrSocket;
+
+/* One registered descriptor. */
+typedef struct {
+  ManuvrSocket* sock;   // nullptr if the descriptor isn't watched.
+  uint32_t      gen;    // Bumped each time the slot is reused.
+} ReactorSlot;
+
+
+class SocketReactor {
+  public:
+    static int8_t watch(ManuvrSocket*);
+    static int8_t unwatch(ManuvrSocket*);
+    static int8_t wantWrite(ManuvrSocket*, bool);
+    static void   shutdown();
+
+    static void printDebug(StringBuilder*);
+
+
+  private:
+    static int           _epoll_fds[SOCKET_REACTOR_SHARDS];
+    static int           _wake_fds[SOCKET_REACTOR_SHARDS];
+    static unsigned long _shard_threads[SOCKET_REACTOR_SHARDS];
+    static ReactorSlot*  _slots;         // Indexed by descriptor.
+    static uint32_t      _slot_count;    // How many slots are allocated?
+    static uint32_t      _watched;       // How many sockets are presently registered?
+    static uint32_t      _dispatches;    // How many readiness events have we serviced?
+    static uint32_t      _stale;         // How many events named a socket that was gone?
+    static bool          _started;       // Have the shards been created?
+
+    static void  _init();
+    static void* _shard_loop(void*);
+    static int   _modify(ManuvrSocket*, int op, uint32_t events);
+    static ManuvrSocket* _claim(uint64_t handle);
+};
+
+#endif  // __MANUVR_LINUX
+#endif  // __MANUVR_SOCKET_REACTOR_H__
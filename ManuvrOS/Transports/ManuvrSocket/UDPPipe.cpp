@@ -70,6 +70,45 @@ UDPPipe::~UDPPipe() {
 }
 
 
+/**
+* Binds a fresh (or recycled) pipe to a counterparty.
+*
+* @param  udp   The transport that owns us.
+* @param  ip    The counterparty's IP as a network-order 32-bit unsigned.
+* @param  port  The counterparty's port in native order.
+*/
+void UDPPipe::rebind(ManuvrUDP* udp, uint32_t ip, uint16_t port) {
+  _ip        = ip;
+  _port      = port;
+  _udp       = udp;
+  _udpflags  = 0;
+  _last_seen = 0;
+  setPipeStrategy(nullptr);
+}
+
+
+/**
+* Returns this pipe to the state of being freshly-constructed, so that it can be
+*   rebound to another counterparty. Afterward, the pipe no longer refers to its
+*   transport.
+* A far-side that we built can only be torn down by our destructor, so a pipe
+*   that has one can't be recycled.
+*
+* @return true if the pipe may be reused. false if it should be deleted.
+*/
+bool UDPPipe::recycle() {
+  BufferPipe* f = far();
+  if (nullptr != f) {
+    if (_bp_flag(BPIPE_FLAG_WE_ALLOCD_FAR)) return false;
+    BufferPipe::toCounterparty(ManuvrPipeSignal::FAR_SIDE_DETACH, nullptr);
+    f->fromCounterparty(ManuvrPipeSignal::NEAR_SIDE_DETACH, nullptr);
+  }
+  _accumulator.clear();
+  rebind(nullptr, 0, 0);
+  return true;
+}
+
+
 /*******************************************************************************
 *  _       _   _        _
 * |_)    _|_ _|_ _  ._ |_) o ._   _
@@ -95,12 +134,14 @@ int8_t UDPPipe::toCounterparty(StringBuilder* buf, int8_t mm) {
       /* The system that allocated this buffer either...
           a) Did so with the intention that it never be free'd, or...
           b) Has a means of discovering when it is safe to free.  */
+      if (nullptr == _udp) return MEM_MGMT_RESPONSIBLE_ERROR;
       return (_udp->write_datagram(buf->string(), buf->length(), _ip, _port, 0) ? MEM_MGMT_RESPONSIBLE_CREATOR : MEM_MGMT_RESPONSIBLE_CALLER);
 
     case MEM_MGMT_RESPONSIBLE_BEARER:
       /* We are now the bearer. That means that by returning non-failure, the
           caller will expect _us_ to manage this memory.  */
       // TODO: Freeing the buffer? Let UDP do it?
+      if (nullptr == _udp) return MEM_MGMT_RESPONSIBLE_ERROR;
       return (_udp->write_datagram(buf->string(), buf->length(), _ip, _port, 0) ? MEM_MGMT_RESPONSIBLE_BEARER : MEM_MGMT_RESPONSIBLE_CALLER);
 
     default:
@@ -130,7 +171,7 @@ int8_t UDPPipe::fromCounterparty(StringBuilder* buf, int8_t mm) {
           caller will expect _us_ to manage this memory.  */
       if (haveFar()) {
         /* We are not the transport driver, and we do no transformation. */
-        return _far->fromCounterparty(buf, mm);
+        return far()->fromCounterparty(buf, mm);
       }
       else {
         _accumulator.concatHandoff(buf);
@@ -291,7 +291,7 @@ void ManuvrXport::connected(bool en) {
     if (_autoconnect_schedule) _autoconnect_schedule->enableSchedule(true);
   }
   #if defined (__BUILD_HAS_FREERTOS) || defined (__MANUVR_LINUX)
-    if (0 == _thread_id) {
+    if ((0 == _thread_id) && !reactorDriven()) {
       // If we are in a threaded environment, we will want a thread if there isn't one already.
       if (createThread(&_thread_id, nullptr, xport_read_handler, (void*) this, nullptr)) {
         Kernel::log("Failed to create transport read thread.\n");
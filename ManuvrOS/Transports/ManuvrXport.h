@@ -45,7 +45,7 @@ This driver is designed to give Manuvr platform-abstracted transports.
 #define MANUVR_XPORT_FLAG_BUSY             0x20000000  // The xport is moving something.
 #define MANUVR_XPORT_FLAG_STREAM_ORIENTED  0x10000000  // See note below.
 #define MANUVR_XPORT_FLAG_LISTENING        0x08000000  // We are listening for connections.
-#define MANUVR_XPORT_FLAG_RESERVED_1       0x04000000  //
+#define MANUVR_XPORT_FLAG_REACTOR_IO      0x04000000  // I/O readiness is driven externally. Don't spawn a read thread.
 #define MANUVR_XPORT_FLAG_RESERVED_2       0x02000000  //
 #define MANUVR_XPORT_FLAG_RESERVED_0       0x01000000  //
 #define MANUVR_XPORT_FLAG_ALWAYS_CONNECTED 0x00800000  // Serial ports.
@@ -115,6 +115,9 @@ class ManuvrXport : public EventReceiver, public BufferPipe {
     inline void autoConnect(bool en) {   autoConnect(en, XPORT_DEFAULT_AUTOCONNECT_PERIOD);  };
     void autoConnect(bool en, uint32_t _ac_period);
 
+    /* Is our I/O serviced by an external reactor rather than a read thread? */
+    inline bool reactorDriven() {           return (_xport_flags & MANUVR_XPORT_FLAG_REACTOR_IO);  };
+
     /* Members that deal with sessions. */
     inline bool streamOriented() {          return (_xport_flags & MANUVR_XPORT_FLAG_STREAM_ORIENTED);  };
 
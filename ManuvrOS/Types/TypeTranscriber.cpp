@@ -24,7 +24,15 @@ This is where we collect adapters and converters between type-representations.
 #include "TypeTranscriber.h"
 #include <DataStructures/Argument.h>
 #include <CommonConstants.h>
+#include <Platform/Identity.h>
 #include <stdlib.h>  // TODO: Cut free() and malloc().
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <new>
+#if defined(CONFIG_MANUVR_IMG_SUPPORT)
+  #include "Image/Image.h"
+#endif   // CONFIG_MANUVR_IMG_SUPPORT
 
 #if defined(MANUVR_CBOR)
 CBORArgListener::CBORArgListener(Argument** target) {    built = target;    }
@@ -141,4 +149,1139 @@ void CBORArgListener::on_extra_integer(long long value, int sign) {}
 void CBORArgListener::on_extra_tag(unsigned long long tag) {}
 void CBORArgListener::on_extra_special(unsigned long long tag) {}
 
+
+/*******************************************************************************
+* CBORArgDecoder
+*******************************************************************************/
+
+#define CBOR_WALK_SHORT    -1   // The item runs past the end of the buffer.
+#define CBOR_WALK_BAD      -2   // The item is malformed.
+#define CBOR_INTERN_SCAN   32   // How far back we look for a key to reuse.
+
+/* Payload is handed out in 8-byte steps, so that doubles are aligned. */
+static inline uint32_t _cbor_round(uint32_t len) {
+  return ((len + 7) & ~((uint32_t) 7));
+}
+
+/**
+* Reads the initial byte of a data item, and any argument that follows it.
+*
+* @return The length of the header, or CBOR_WALK_SHORT/CBOR_WALK_BAD.
+*/
+static int _cbor_head(const uint8_t* p, const uint8_t* end, uint8_t* major, uint8_t* ai, uint64_t* val) {
+  if (p >= end) return CBOR_WALK_SHORT;
+  *major = *p >> 5;
+  *ai    = *p & 0x1F;
+  *val   = *ai;
+  if (*ai < 24)  return 1;
+  if (31 == *ai) return 1;   // Indefinite length, or a break. The caller decides.
+  if (*ai > 27)  return CBOR_WALK_BAD;
+  const int n = 1 << (*ai - 24);
+  if ((end - p) < (1 + n)) return CBOR_WALK_SHORT;
+  *val = 0;
+  for (int i = 1; i <= n; i++) *val = (*val << 8) | p[i];
+  return (1 + n);
+}
+
+/**
+* Measures (and optionally copies out) a string, which may be chunked.
+*
+* @param  dest   Where to put the string's bytes. May be nullptr.
+* @param  total  Receives the length of the string.
+* @return The number of bytes the string occupies, or CBOR_WALK_SHORT/CBOR_WALK_BAD.
+*/
+static int _cbor_string(const uint8_t* p, const uint8_t* end, uint8_t* dest, uint32_t* total) {
+  uint8_t  major;
+  uint8_t  ai;
+  uint64_t val;
+  int h = _cbor_head(p, end, &major, &ai, &val);
+  if (h < 0) return h;
+  if (31 != ai) {
+    // The cap is checked first, so that a huge length can't keep us waiting.
+    if (val > 0xFFFE) return CBOR_WALK_BAD;   // Argument lengths are 16-bit.
+    if ((uint64_t) (end - (p + h)) < val) return CBOR_WALK_SHORT;
+    if (dest) memcpy(dest, p + h, val);
+    *total = (uint32_t) val;
+    return (h + (int) val);
+  }
+  // Indefinite: definite chunks of the same major type, ended by a break.
+  const uint8_t* c = p + 1;
+  uint32_t n = 0;
+  while (true) {
+    if (c >= end) return CBOR_WALK_SHORT;
+    if (0xFF == *c) break;
+    uint8_t  c_major;
+    uint8_t  c_ai;
+    uint64_t c_len;
+    int ch = _cbor_head(c, end, &c_major, &c_ai, &c_len);
+    if (ch < 0) return ch;
+    if ((c_major != major) || (31 == c_ai)) return CBOR_WALK_BAD;
+    if ((n + c_len) > 0xFFFE) return CBOR_WALK_BAD;
+    if ((uint64_t) (end - (c + ch)) < c_len) return CBOR_WALK_SHORT;
+    if (dest) memcpy(dest + n, c + ch, c_len);
+    n += (uint32_t) c_len;
+    c += ch + c_len;
+  }
+  *total = n;
+  return (int) ((c + 1) - p);
+}
+
+static float _cbor_half(uint16_t h) {
+  const int   exp  = (h >> 10) & 0x1F;
+  const int   mant = h & 0x3FF;
+  float f;
+  if (0 == exp)       f = ldexpf((float) mant, -24);
+  else if (31 == exp) f = (mant) ? NAN : INFINITY;
+  else                f = ldexpf((float) (mant + 1024), exp - 25);
+  return (h & 0x8000) ? -f : f;
+}
+
+
+CBORArgDecoder::CBORArgDecoder() {
+}
+
+CBORArgDecoder::~CBORArgDecoder() {
+  reset();
+}
+
+
+/**
+* Discards anything decoded but not taken, and any partial item.
+*/
+void CBORArgDecoder::reset() {
+  if (nullptr != _head) {
+    Argument* a = _head;
+    _head = nullptr;
+    delete a;
+  }
+  _tail  = nullptr;
+  _ready = 0;
+  if (nullptr != _partial) {
+    free(_partial);
+    _partial = nullptr;
+  }
+  _partial_len = 0;
+  _partial_cap = 0;
+}
+
+
+/**
+* Hands over everything decoded so far. The caller owns the chain, and deleting
+*   its head frees all of it.
+*
+* @return The chain, or nullptr if nothing complete has arrived.
+*/
+Argument* CBORArgDecoder::take() {
+  Argument* return_value = _head;
+  _head  = nullptr;
+  _tail  = nullptr;
+  _ready = 0;
+  return return_value;
+}
+
+
+/**
+* Feeds bytes to the decoder. Any number of items (or a fraction of one) may be
+*   passed at a time.
+*
+* @param  buf  The bytes.
+* @param  len  How many.
+* @return The number of Arguments decoded from this call, or -1 on malformed
+*           input, or an incomplete item longer than CBOR_DECODER_MAX_PENDING.
+*           In either case, the decoder is reset.
+*/
+int CBORArgDecoder::feed(const uint8_t* buf, unsigned int len) {
+  const uint8_t* src     = buf;
+  unsigned int   src_len = len;
+  if (0 < _partial_len) {
+    // We are holding the front of an item. Append, and decode from there.
+    if ((_partial_len + len) > _partial_cap) {
+      uint8_t* nu = (uint8_t*) realloc(_partial, _partial_len + len);
+      if (nullptr == nu) return -1;
+      _partial     = nu;
+      _partial_cap = _partial_len + len;
+    }
+    memcpy(_partial + _partial_len, buf, len);
+    _partial_len += len;
+    src     = _partial;
+    src_len = _partial_len;
+  }
+
+  int       consumed = 0;
+  uint32_t  count    = 0;
+  Argument* last     = nullptr;
+  Argument* batch    = _build(src, src_len, &consumed, &count, &last);
+  if (0 > consumed) {
+    reset();
+    return -1;
+  }
+  if (nullptr != batch) {
+    if (nullptr != _tail) _tail->_next = batch;
+    else                  _head = batch;
+    _tail   = last;
+    _ready += count;
+  }
+
+  // Whatever is left is the front of an item that hasn't fully arrived.
+  const unsigned int remaining = src_len - consumed;
+  if (remaining > CBOR_DECODER_MAX_PENDING) {
+    reset();
+    return -1;
+  }
+  if (src == _partial) {
+    memmove(_partial, _partial + consumed, remaining);
+    _partial_len = remaining;
+  }
+  else if (0 < remaining) {
+    if (remaining > _partial_cap) {
+      uint8_t* nu = (uint8_t*) realloc(_partial, remaining);
+      if (nullptr == nu) return -1;
+      _partial     = nu;
+      _partial_cap = remaining;
+    }
+    memcpy(_partial, buf + consumed, remaining);
+    _partial_len = remaining;
+  }
+  return (int) count;
+}
+
+
+/**
+* One-shot decode of every complete item in a buffer.
+*
+* @param  buf       The bytes.
+* @param  len       How many.
+* @param  consumed  If not nullptr, receives the number of bytes decoded, or -1
+*                     if the input was malformed.
+* @return The chain, or nullptr if no Arguments resulted.
+*/
+Argument* CBORArgDecoder::decode(const uint8_t* buf, unsigned int len, int* consumed) {
+  int       c     = 0;
+  uint32_t  count = 0;
+  Argument* last  = nullptr;
+  Argument* return_value = _build(buf, len, &c, &count, &last);
+  if (nullptr != consumed) *consumed = c;
+  return return_value;
+}
+
+
+/**
+* Sizes, allocates, and fills a block for every complete item in the buffer.
+*
+* @return The head of the block, or nullptr. *consumed is -1 on malformed input.
+*/
+Argument* CBORArgDecoder::_build(const uint8_t* buf, unsigned int len, int* consumed, uint32_t* count, Argument** last) {
+  CBORWalk w = {};
+  unsigned int offset = 0;
+  uint32_t     args   = 0;
+  uint32_t     bytes  = 0;
+  while (offset < len) {
+    const int r = _walk(&w, buf + offset, buf + len, 0);
+    if (CBOR_WALK_SHORT == r) break;   // Anything it counted is discarded.
+    if (0 > r) {
+      *consumed = -1;
+      return nullptr;
+    }
+    offset += r;
+    args    = w.args;
+    bytes   = w.bytes;
+  }
+  *consumed = (int) offset;
+  if (0 == args) return nullptr;
+
+  const uint32_t arr_len = _cbor_round(args * sizeof(Argument));
+  uint8_t* block = (uint8_t*) ::operator new(arr_len + bytes, std::nothrow);
+  if (nullptr == block) {
+    *consumed = -1;
+    return nullptr;
+  }
+  CBORWalk e = {};
+  e.emit = true;
+  e.arr  = (Argument*) block;
+  e.pool = block + arr_len;
+  unsigned int o = 0;
+  while (o < offset) {
+    o += _walk(&e, buf + o, buf + offset, 0);
+  }
+  *count = e.args;
+  *last  = &e.arr[e.args - 1];
+  return e.arr;
+}
+
+
+/**
+* Takes the next Argument slot, links it to the one before, and gives it the
+*   waiting key (if any). On the sizing pass, only counts.
+*
+* @return The Argument, or nullptr on the sizing pass.
+*/
+Argument* CBORArgDecoder::_place(CBORWalk* w, TCode code) {
+  if (!w->emit) {
+    if (nullptr != w->key) {
+      w->bytes += _cbor_round(w->key_len + 1);
+      w->key = nullptr;
+    }
+    w->args++;
+    return nullptr;
+  }
+  Argument* a = ::new (&w->arr[w->args]) Argument(code);
+  if (0 < w->args) {
+    w->arr[w->args - 1]._next = a;
+    a->_alter_flags(true, MANUVR_ARG_FLAG_ARENA);
+  }
+  if (nullptr != w->key) {
+    // Reuse the key if a recent Argument in this block already has it.
+    const char* k = nullptr;
+    const uint32_t floor = (w->args > CBOR_INTERN_SCAN) ? (w->args - CBOR_INTERN_SCAN) : 0;
+    for (uint32_t i = w->args; i > floor; i--) {
+      const char* c = w->arr[i - 1]._key;
+      if ((nullptr != c) && (0 == strncmp(c, (const char*) w->key, w->key_len)) && (0 == c[w->key_len])) {
+        k = c;
+        break;
+      }
+    }
+    if (nullptr == k) {
+      char* nu = (char*) _reserve(w, w->key_len + 1);
+      memcpy(nu, w->key, w->key_len);
+      nu[w->key_len] = 0;
+      k = nu;
+    }
+    a->_key = k;
+    w->key  = nullptr;
+  }
+  w->args++;
+  return a;
+}
+
+
+/**
+* Takes payload space. On the sizing pass, only counts.
+*/
+uint8_t* CBORArgDecoder::_reserve(CBORWalk* w, uint32_t len) {
+  uint8_t* return_value = (w->emit) ? (w->pool + w->bytes) : nullptr;
+  w->bytes += _cbor_round(len);
+  return return_value;
+}
+
+
+/**
+* Walks one data item (and everything inside it).
+*
+* @return The length of the item, or CBOR_WALK_SHORT/CBOR_WALK_BAD.
+*/
+int CBORArgDecoder::_walk(CBORWalk* w, const uint8_t* p, const uint8_t* end, uint8_t depth) {
+  if (depth > CBOR_DECODER_MAX_DEPTH) return CBOR_WALK_BAD;
+  uint8_t  major;
+  uint8_t  ai;
+  uint64_t val;
+  const int h = _cbor_head(p, end, &major, &ai, &val);
+  if (h < 0) return h;
+  const TCode tag = w->tag;   // A tag only reaches the item right after it.
+  w->tag = TCode::NONE;
+
+  switch (major) {
+    case 0:   // Unsigned integer.
+      if (31 == ai) return CBOR_WALK_BAD;
+      if (!w->skip && (val <= 0xFFFFFFFF)) {   // Wider values are ignored, as before.
+        Argument* a = _place(w, (val <= 0xFF) ? TCode::UINT8 : ((val <= 0xFFFF) ? TCode::UINT16 : TCode::UINT32));
+        if (a) a->target_mem = (void*)(uintptr_t) val;
+      }
+      return h;
+
+    case 1:   // Negative integer.
+      if (31 == ai) return CBOR_WALK_BAD;
+      if (!w->skip && (val <= 0x7FFFFFFF)) {
+        const int32_t v = -1 - (int32_t) val;
+        Argument* a = _place(w, (v >= -128) ? TCode::INT8 : ((v >= -32768) ? TCode::INT16 : TCode::INT32));
+        if (a) a->target_mem = (void*)(intptr_t) v;
+      }
+      return h;
+
+    case 2:   // Byte string.
+    case 3:   // Text string.
+      {
+        uint32_t n = 0;
+        const int r = _cbor_string(p, end, nullptr, &n);
+        if ((r < 0) || w->skip) return r;
+        if (3 == major) {
+          Argument* a = _place(w, TCode::STR);
+          uint8_t*  d = _reserve(w, n + 1);
+          if (a) {
+            _cbor_string(p, end, d, &n);
+            d[n] = 0;
+            a->target_mem = d;
+            a->len        = n + 1;
+          }
+          return r;
+        }
+        TCode code = TCode::BINARY;
+        if (TCode::NONE != tag) {
+          // Our vendor tag names the Manuvr type the bytes represent.
+          const TypeCodeDef* const def = getManuvrTypeDef(tag);
+          if (nullptr != def) {
+            const bool fixed = !(def->type_flags & TYPE_CODE_FLAG_VARIABLE_LENGTH);
+            if (fixed && (def->fixed_len != n)) return r;   // Dropped, as before.
+            code = tag;
+          }
+        }
+        Argument* a = _place(w, code);
+        if (nullptr == a) {
+          _reserve(w, n);   // Direct types won't use it, but we can't know that yet.
+        }
+        else if (a->isValueDirect() && (n <= sizeof(void*))) {
+          _cbor_string(p, end, (uint8_t*) &a->target_mem, &n);
+          a->len = n;
+        }
+        else {
+          uint8_t* d = _reserve(w, n);
+          _cbor_string(p, end, d, &n);
+          a->target_mem = d;
+          a->len        = n;
+        }
+        return r;
+      }
+
+    case 4:   // Array. Flattened into the chain.
+    case 5:   // Map. Each value gets the preceding text key.
+      {
+        const uint8_t* c = p + h;
+        const bool indefinite = (31 == ai);
+        for (uint64_t i = 0; indefinite || (i < val); i++) {
+          if (indefinite) {
+            if (c >= end) return CBOR_WALK_SHORT;
+            if (0xFF == *c) {
+              c++;
+              break;
+            }
+          }
+          if (5 == major) {
+            uint8_t  k_major;
+            uint8_t  k_ai;
+            uint64_t k_len;
+            const int kh = _cbor_head(c, end, &k_major, &k_ai, &k_len);
+            if (kh < 0) return kh;
+            if ((3 == k_major) && (31 != k_ai)) {
+              if (k_len > 0xFFFE) return CBOR_WALK_BAD;
+              if ((uint64_t) (end - (c + kh)) < k_len) return CBOR_WALK_SHORT;
+              w->key     = (w->skip) ? nullptr : (c + kh);
+              w->key_len = (uint32_t) k_len;
+              c += kh + k_len;
+            }
+            else {
+              // We only have use for text keys.
+              w->skip++;
+              const int r = _walk(w, c, end, depth + 1);
+              w->skip--;
+              if (r < 0) return r;
+              c += r;
+            }
+          }
+          const int r = _walk(w, c, end, depth + 1);
+          w->key = nullptr;   // An empty container doesn't pass its key along.
+          if (r < 0) return r;
+          c += r;
+        }
+        return (int) (c - p);
+      }
+
+    case 6:   // Tag.
+      {
+        if (31 == ai) return CBOR_WALK_BAD;
+        if (MANUVR_CBOR_VENDOR_TYPE == (val & 0xFFFFFF00)) {
+          w->tag = IntToTcode((uint8_t) (val & 0x000000FF));
+        }
+        const int r = _walk(w, p + h, end, depth + 1);
+        w->tag = TCode::NONE;
+        return (r < 0) ? r : (h + r);
+      }
+
+    case 7:   // Simple values and floats.
+    default:
+      if (31 == ai) return CBOR_WALK_BAD;   // A break with nothing to end.
+      if (w->skip) return h;
+      switch (ai) {
+        case 20:   // false
+        case 21:   // true
+          {
+            Argument* a = _place(w, TCode::INT32);
+            if (a) a->target_mem = (void*)(uintptr_t) (21 == ai);
+          }
+          break;
+        case 22:
+        case 23:
+          {
+            const char* str = (22 == ai) ? "<NULL>" : "<UNDEF>";
+            Argument* a = _place(w, TCode::STR);
+            if (a) {
+              a->target_mem = (void*) str;
+              a->len        = strlen(str) + 1;
+            }
+          }
+          break;
+        case 25:
+        case 26:
+          {
+            Argument* a = _place(w, TCode::FLOAT);
+            if (a) {
+              float f;
+              if (25 == ai) {
+                f = _cbor_half((uint16_t) val);
+              }
+              else {
+                const uint32_t bits = (uint32_t) val;
+                memcpy(&f, &bits, sizeof(f));
+              }
+              memcpy(&a->target_mem, &f, sizeof(f));
+            }
+          }
+          break;
+        case 27:
+          {
+            Argument* a = _place(w, TCode::DOUBLE);
+            uint8_t*  d = _reserve(w, sizeof(double));
+            if (a) {
+              memcpy(d, &val, sizeof(double));
+              a->target_mem = d;
+            }
+          }
+          break;
+        default:
+          {
+            Argument* a = _place(w, TCode::UINT32);
+            if (a) a->target_mem = (void*)(uintptr_t) val;
+          }
+          break;
+      }
+      return h;
+  }
+}
+
+#endif  // MANUVR_CBOR
+
+
+
+#if defined(MANUVR_CBOR) || defined(MANUVR_JSON)
+/*******************************************************************************
+* ArgEncoder
+*******************************************************************************/
+
+/**
+* All output passes through here. When sizing, it is only counted. When writing
+*   to a buffer, it is copied (or the encode fails if it won't fit). When
+*   writing to a sink, small pieces are coalesced, and large ones are passed
+*   through where they sit.
+*/
+void ArgEncoder::_put(ArgEncoderOut* o, const uint8_t* src, unsigned int n) {
+  if (o->fail || (0 == n)) return;
+  if (nullptr != o->sink) {
+    if ((o->fill + n) <= sizeof(o->scratch)) {
+      memcpy(&o->scratch[o->fill], src, n);
+      o->fill += n;
+    }
+    else {
+      _flush(o);
+      if (n < sizeof(o->scratch)) {
+        memcpy(o->scratch, src, n);
+        o->fill = n;
+      }
+      else if (!o->fail && (0 != o->sink(o->ctx, src, n))) {
+        o->fail = true;
+      }
+    }
+  }
+  else if (nullptr != o->buf) {
+    if ((o->pos + n) > o->len) {
+      o->fail = true;
+      return;
+    }
+    memcpy(o->buf + o->pos, src, n);
+  }
+  o->pos += n;
+}
+
+void ArgEncoder::_flush(ArgEncoderOut* o) {
+  if ((nullptr != o->sink) && (0 < o->fill) && !o->fail) {
+    if (0 != o->sink(o->ctx, o->scratch, o->fill)) o->fail = true;
+  }
+  o->fill = 0;
+}
+
+int ArgEncoder::_finish(ArgEncoderOut* o) {
+  _flush(o);
+  return (o->fail ? -1 : (int) o->pos);
+}
+
+/**
+* How many bytes will the given Identity serialize to? Identities too short to
+*   serialize are encoded as empty.
+*/
+unsigned int ArgEncoder::_identity_len(Identity* ident) {
+  const unsigned int i_len = (nullptr != ident) ? ident->length() : 0;
+  return ((i_len > IDENTITY_BASE_PERSIST_LENGTH) ? i_len : 0);
+}
+
+/**
+* Puts an Identity's serialized form, which must be _identity_len() bytes.
+*   Sizing never serializes it. Writing to a buffer serializes it in place.
+*   A sink gets it by way of scratch, or the heap if it won't fit there.
+*/
+void ArgEncoder::_put_identity(ArgEncoderOut* o, Identity* ident, unsigned int i_len) {
+  if (o->fail || (0 == i_len)) return;
+  if (nullptr != o->sink) {
+    if ((o->fill + i_len) > sizeof(o->scratch)) _flush(o);
+    if (i_len <= sizeof(o->scratch)) {
+      ident->toBuffer(&o->scratch[o->fill]);
+      o->fill += i_len;
+      o->pos  += i_len;
+    }
+    else {
+      uint8_t* raw = (uint8_t*) malloc(i_len);
+      if (nullptr == raw) {
+        o->fail = true;
+        return;
+      }
+      ident->toBuffer(raw);
+      _put(o, raw, i_len);
+      free(raw);
+    }
+  }
+  else if (nullptr != o->buf) {
+    if ((o->pos + i_len) > o->len) {
+      o->fail = true;
+      return;
+    }
+    ident->toBuffer(o->buf + o->pos);
+    o->pos += i_len;
+  }
+  else {
+    o->pos += i_len;
+  }
+}
+#endif  // MANUVR_CBOR || MANUVR_JSON
+
+
+#if defined(MANUVR_CBOR)
+/* Writes the initial byte of a data item, with the shortest form of its argument. */
+static void _cbor_put_head(uint8_t* h, int* n, uint8_t major, uint64_t val) {
+  major = major << 5;
+  if (val < 24) {
+    h[0] = major | (uint8_t) val;
+    *n = 1;
+    return;
+  }
+  int width;
+  if (val <= 0xFF)              { h[0] = major | 24;  width = 1; }
+  else if (val <= 0xFFFF)       { h[0] = major | 25;  width = 2; }
+  else if (val <= 0xFFFFFFFF)   { h[0] = major | 26;  width = 4; }
+  else                          { h[0] = major | 27;  width = 8; }
+  for (int i = width; i > 0; i--) {
+    h[i] = (uint8_t) (val & 0xFF);
+    val  = val >> 8;
+  }
+  *n = width + 1;
+}
+
+/**
+* @return true if the type has a CBOR representation.
+*/
+static bool _cbor_can(TCode tc) {
+  switch (tc) {
+    case TCode::INT8:
+    case TCode::INT16:
+    case TCode::INT32:
+    case TCode::INT64:
+    case TCode::UINT8:
+    case TCode::UINT16:
+    case TCode::UINT32:
+    case TCode::UINT64:
+    case TCode::BOOLEAN:
+    case TCode::FLOAT:
+    case TCode::DOUBLE:
+    case TCode::STR:
+    case TCode::STR_BUILDER:
+    case TCode::BINARY:
+    case TCode::VECT_3_FLOAT:
+    case TCode::VECT_4_FLOAT:
+    case TCode::IDENTITY:
+    #if defined(CONFIG_MANUVR_IMG_SUPPORT)
+    case TCode::IMAGE:
+    #endif   // CONFIG_MANUVR_IMG_SUPPORT
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+* Encodes one Argument. Keyed Arguments become single-pair maps. Types that we
+*   can't export are skipped (key and all).
+*/
+void ArgEncoder::_cbor_arg(ArgEncoderOut* o, Argument* src) {
+  const TCode tc = src->typeCode();
+  if (!_cbor_can(tc)) return;
+  uint8_t h[9];
+  int     n = 0;
+  if (nullptr != src->getKey()) {
+    const unsigned int k_len = strlen(src->getKey());
+    _cbor_put_head(h, &n, 5, 1);
+    _put(o, h, n);
+    _cbor_put_head(h, &n, 3, k_len);
+    _put(o, h, n);
+    _put(o, (const uint8_t*) src->getKey(), k_len);
+  }
+  switch (tc) {
+    case TCode::INT8:
+    case TCode::INT16:
+    case TCode::INT32:
+    case TCode::INT64:
+      {
+        int64_t x = 0;
+        switch (tc) {
+          case TCode::INT8:   { int8_t  v = 0;   src->getValueAs(&v);  x = v;  }  break;
+          case TCode::INT16:  { int16_t v = 0;   src->getValueAs(&v);  x = v;  }  break;
+          case TCode::INT32:  { int32_t v = 0;   src->getValueAs(&v);  x = v;  }  break;
+          default:            { long long v = 0; src->getValueAs(&v);  x = v;  }  break;
+        }
+        if (x < 0) _cbor_put_head(h, &n, 1, (uint64_t) (-(x + 1)));
+        else       _cbor_put_head(h, &n, 0, (uint64_t) x);
+        _put(o, h, n);
+      }
+      break;
+    case TCode::UINT8:
+    case TCode::UINT16:
+    case TCode::UINT32:
+    case TCode::UINT64:
+      {
+        uint64_t x = 0;
+        switch (tc) {
+          case TCode::UINT8:   { uint8_t  v = 0;           src->getValueAs(&v);  x = v;  }  break;
+          case TCode::UINT16:  { uint16_t v = 0;           src->getValueAs(&v);  x = v;  }  break;
+          case TCode::UINT32:  { uint32_t v = 0;           src->getValueAs(&v);  x = v;  }  break;
+          default:             { unsigned long long v = 0; src->getValueAs(&v);  x = v;  }  break;
+        }
+        _cbor_put_head(h, &n, 0, x);
+        _put(o, h, n);
+      }
+      break;
+    case TCode::BOOLEAN:
+      h[0] = (0 != (uintptr_t) src->pointer()) ? 0xF5 : 0xF4;
+      _put(o, h, 1);
+      break;
+    case TCode::FLOAT:
+      {
+        float    x    = 0.0f;
+        uint32_t bits = 0;
+        src->getValueAs(&x);
+        memcpy(&bits, &x, sizeof(bits));
+        h[0] = 0xFA;
+        for (int i = 4; i > 0; i--) {
+          h[i] = (uint8_t) (bits & 0xFF);
+          bits = bits >> 8;
+        }
+        _put(o, h, 5);
+      }
+      break;
+    case TCode::DOUBLE:
+      {
+        double   x    = 0.0;
+        uint64_t bits = 0;
+        src->getValueAs(&x);
+        memcpy(&bits, &x, sizeof(bits));
+        h[0] = 0xFB;
+        for (int i = 8; i > 0; i--) {
+          h[i] = (uint8_t) (bits & 0xFF);
+          bits = bits >> 8;
+        }
+        _put(o, h, 9);
+      }
+      break;
+    case TCode::STR:
+    case TCode::STR_BUILDER:
+      {
+        const char* str = nullptr;
+        if (TCode::STR == tc) {
+          char* x = nullptr;
+          src->getValueAs(&x);
+          str = x;
+        }
+        else {
+          StringBuilder* x = nullptr;
+          src->getValueAs(&x);
+          str = (nullptr != x) ? (const char*) x->string() : nullptr;
+        }
+        const unsigned int s_len = (nullptr != str) ? strlen(str) : 0;
+        _cbor_put_head(h, &n, 3, s_len);
+        _put(o, h, n);
+        _put(o, (const uint8_t*) str, s_len);
+      }
+      break;
+    case TCode::BINARY:
+    case TCode::VECT_3_FLOAT:
+    case TCode::VECT_4_FLOAT:
+      // NOTE: This ought to work for any types retaining portability isn't important.
+      _cbor_put_head(h, &n, 6, MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(tc));
+      _put(o, h, n);
+      _cbor_put_head(h, &n, 2, src->length());
+      _put(o, h, n);
+      _put(o, (const uint8_t*) src->pointer(), src->length());
+      break;
+    case TCode::IDENTITY:
+      {
+        Identity* ident = (Identity*) src->pointer();
+        const unsigned int i_len = _identity_len(ident);
+        _cbor_put_head(h, &n, 6, MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(tc));
+        _put(o, h, n);
+        _cbor_put_head(h, &n, 2, i_len);
+        _put(o, h, n);
+        _put_identity(o, ident, i_len);
+      }
+      break;
+    #if defined(CONFIG_MANUVR_IMG_SUPPORT)
+    case TCode::IMAGE:
+      {
+        Image* img = (Image*) src->pointer();
+        uint32_t sz_buf = img->bytesUsed();
+        uint32_t nb_buf = 0;
+        uint8_t  intermediary[32];
+        if ((0 == sz_buf) || (0 != img->serializeWithoutBuffer(intermediary, &nb_buf))) {
+          nb_buf = 0;
+          sz_buf = 0;
+        }
+        _cbor_put_head(h, &n, 6, MANUVR_CBOR_VENDOR_TYPE | TcodeToInt(tc));
+        _put(o, h, n);
+        _cbor_put_head(h, &n, 2, nb_buf);   // TODO: This might cause two discrete CBOR objects.
+        _put(o, h, n);
+        _put(o, intermediary, nb_buf);
+        _cbor_put_head(h, &n, 2, sz_buf);
+        _put(o, h, n);
+        _put(o, img->buffer(), sz_buf);
+      }
+      break;
+    #endif   // CONFIG_MANUVR_IMG_SUPPORT
+    default:
+      break;
+  }
+}
+
+
+/**
+* @return The exact length of the CBOR encoding of the chain.
+*/
+int ArgEncoder::sizeCBOR(Argument* src) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  for (; nullptr != src; src = src->_next) _cbor_arg(&o, src);
+  return _finish(&o);
+}
+
+/**
+* Encodes the chain into the given buffer.
+*
+* @return The number of bytes written, or -1 if the buffer was too small.
+*/
+int ArgEncoder::writeCBOR(Argument* src, uint8_t* buf, unsigned int len) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  o.buf = buf;
+  o.len = len;
+  for (; nullptr != src; src = src->_next) _cbor_arg(&o, src);
+  return _finish(&o);
+}
+
+/**
+* Encodes the chain into the given sink.
+*
+* @return The number of bytes passed to the sink, or -1 if it refused them.
+*/
+int ArgEncoder::gatherCBOR(Argument* src, ArgEncoderSink sink, void* ctx) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  o.sink = sink;
+  o.ctx  = ctx;
+  for (; nullptr != src; src = src->_next) _cbor_arg(&o, src);
+  return _finish(&o);
+}
 #endif  // MANUVR_CBOR
+
+
+#if defined(MANUVR_JSON)
+static const char _b64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Numbers are formatted on the stack, and put as a piece. */
+static unsigned int _json_fmt(char* buf, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  const int n = vsnprintf(buf, 32, fmt, args);
+  va_end(args);
+  return ((0 < n) ? (unsigned int) n : 0);
+}
+
+/* Reals are written with the fewest digits that read back to the same value. */
+static unsigned int _json_real(char* buf, double v, bool single) {
+  unsigned int n = _json_fmt(buf, (single ? "%.7g" : "%.15g"), v);
+  const double back = strtod(buf, nullptr);
+  if (single ? ((float) back != (float) v) : (back != v)) {
+    n = _json_fmt(buf, (single ? "%.9g" : "%.17g"), v);
+  }
+  return n;
+}
+
+/**
+* Writes a quoted string, escaped as JSON requires. Runs of characters that
+*   need no escaping are put whole.
+*/
+void ArgEncoder::_json_string(ArgEncoderOut* o, const char* str, unsigned int len) {
+  _put(o, (const uint8_t*) "\"", 1);
+  unsigned int run = 0;
+  for (unsigned int i = 0; i < len; i++) {
+    const uint8_t c = (uint8_t) str[i];
+    if ((c >= 0x20) && ('"' != c) && ('\\' != c)) continue;
+    _put(o, (const uint8_t*) (str + run), i - run);
+    run = i + 1;
+    char esc[7] = { '\\', 0, 0, 0, 0, 0, 0 };
+    unsigned int e_len = 2;
+    switch (c) {
+      case '"':   esc[1] = '"';   break;
+      case '\\':  esc[1] = '\\';  break;
+      case '\b':  esc[1] = 'b';   break;
+      case '\f':  esc[1] = 'f';   break;
+      case '\n':  esc[1] = 'n';   break;
+      case '\r':  esc[1] = 'r';   break;
+      case '\t':  esc[1] = 't';   break;
+      default:
+        snprintf(esc, sizeof(esc), "\\u%04x", c);
+        e_len = 6;
+        break;
+    }
+    _put(o, (const uint8_t*) esc, e_len);
+  }
+  _put(o, (const uint8_t*) (str + run), len - run);
+  _put(o, (const uint8_t*) "\"", 1);
+}
+
+/**
+* Writes binary data as a quoted base64 string.
+*/
+void ArgEncoder::_json_base64(ArgEncoderOut* o, const uint8_t* src, unsigned int len) {
+  uint8_t out[64];   // 48 bytes of input at a time.
+  unsigned int fill = 0;
+  _put(o, (const uint8_t*) "\"", 1);
+  for (unsigned int i = 0; i < len; i += 3) {
+    const unsigned int rem = len - i;
+    const uint32_t v = (src[i] << 16) | ((rem > 1) ? (src[i + 1] << 8) : 0) | ((rem > 2) ? src[i + 2] : 0);
+    out[fill++] = _b64_alphabet[(v >> 18) & 0x3F];
+    out[fill++] = _b64_alphabet[(v >> 12) & 0x3F];
+    out[fill++] = (rem > 1) ? _b64_alphabet[(v >> 6) & 0x3F] : '=';
+    out[fill++] = (rem > 2) ? _b64_alphabet[v & 0x3F] : '=';
+    if (fill == sizeof(out)) {
+      _put(o, out, fill);
+      fill = 0;
+    }
+  }
+  _put(o, out, fill);
+  _put(o, (const uint8_t*) "\"", 1);
+}
+
+/**
+* Writes the value of one Argument. Types without a JSON representation are null.
+*/
+void ArgEncoder::_json_value(ArgEncoderOut* o, Argument* src) {
+  char t[32];
+  switch (src->typeCode()) {
+    case TCode::INT8:
+    case TCode::INT16:
+    case TCode::INT32:
+    case TCode::INT64:
+      {
+        long long v = 0;
+        switch (src->typeCode()) {
+          case TCode::INT8:   { int8_t  x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          case TCode::INT16:  { int16_t x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          case TCode::INT32:  { int32_t x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          default:            src->getValueAs(&v);                             break;
+        }
+        _put(o, (const uint8_t*) t, _json_fmt(t, "%lld", v));
+      }
+      break;
+    case TCode::UINT8:
+    case TCode::UINT16:
+    case TCode::UINT32:
+    case TCode::UINT64:
+      {
+        unsigned long long v = 0;
+        switch (src->typeCode()) {
+          case TCode::UINT8:   { uint8_t  x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          case TCode::UINT16:  { uint16_t x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          case TCode::UINT32:  { uint32_t x = 0;  src->getValueAs(&x);  v = x;  }  break;
+          default:             src->getValueAs(&v);                              break;
+        }
+        _put(o, (const uint8_t*) t, _json_fmt(t, "%llu", v));
+      }
+      break;
+    case TCode::BOOLEAN:
+      if (0 != (uintptr_t) src->pointer()) _put(o, (const uint8_t*) "true", 4);
+      else                                 _put(o, (const uint8_t*) "false", 5);
+      break;
+    case TCode::FLOAT:
+    case TCode::DOUBLE:
+      {
+        double v = 0.0;
+        if (TCode::FLOAT == src->typeCode()) {
+          float f = 0.0f;
+          src->getValueAs(&f);
+          v = f;
+        }
+        else {
+          src->getValueAs(&v);
+        }
+        if (isfinite(v)) {
+          _put(o, (const uint8_t*) t, _json_real(t, v, (TCode::FLOAT == src->typeCode())));
+        }
+        else {
+          _put(o, (const uint8_t*) "null", 4);   // JSON has no NaN or infinity.
+        }
+      }
+      break;
+    case TCode::STR:
+      {
+        char* v = nullptr;
+        src->getValueAs(&v);
+        _json_string(o, v, (nullptr != v) ? strlen(v) : 0);
+      }
+      break;
+    case TCode::STR_BUILDER:
+      {
+        StringBuilder* v = nullptr;
+        src->getValueAs(&v);
+        const char* str = (nullptr != v) ? (const char*) v->string() : nullptr;
+        _json_string(o, str, (nullptr != str) ? strlen(str) : 0);
+      }
+      break;
+    case TCode::VECT_3_FLOAT:
+    case TCode::VECT_4_FLOAT:
+      {
+        const int count = (TCode::VECT_3_FLOAT == src->typeCode()) ? 3 : 4;
+        const uint8_t* p = (const uint8_t*) src->pointer();
+        for (int i = 0; i < count; i++) {
+          float f;
+          memcpy(&f, p + (i * sizeof(float)), sizeof(float));
+          _put(o, (const uint8_t*) ((0 == i) ? "[" : ","), 1);
+          if (isfinite(f)) _put(o, (const uint8_t*) t, _json_real(t, f, true));
+          else             _put(o, (const uint8_t*) "null", 4);
+        }
+        _put(o, (const uint8_t*) "]", 1);
+      }
+      break;
+    case TCode::VECT_3_UINT16:
+    case TCode::VECT_3_INT16:
+      {
+        const bool     sign = (TCode::VECT_3_INT16 == src->typeCode());
+        const uint8_t* p    = (const uint8_t*) src->pointer();
+        for (int i = 0; i < 3; i++) {
+          uint16_t u;
+          memcpy(&u, p + (i * sizeof(uint16_t)), sizeof(uint16_t));
+          _put(o, (const uint8_t*) ((0 == i) ? "[" : ","), 1);
+          _put(o, (const uint8_t*) t, _json_fmt(t, "%d", (sign ? (int) (int16_t) u : (int) u)));
+        }
+        _put(o, (const uint8_t*) "]", 1);
+      }
+      break;
+    case TCode::BINARY:
+      _json_base64(o, (const uint8_t*) src->pointer(), src->length());
+      break;
+    case TCode::IDENTITY:
+      {
+        Identity* ident = (Identity*) src->pointer();
+        const unsigned int i_len = _identity_len(ident);
+        if (0 == i_len) {
+          _put(o, (const uint8_t*) "null", 4);
+        }
+        else if ((nullptr == o->buf) && (nullptr == o->sink)) {
+          _put(o, nullptr, 2 + (4 * ((i_len + 2) / 3)));   // Sizing. Quotes and base64.
+        }
+        else {
+          uint8_t* raw = (uint8_t*) malloc(i_len);
+          if (nullptr == raw) {
+            o->fail = true;
+          }
+          else {
+            ident->toBuffer(raw);
+            _json_base64(o, raw, i_len);
+            free(raw);
+          }
+        }
+      }
+      break;
+    default:
+      _put(o, (const uint8_t*) "null", 4);
+      break;
+  }
+}
+
+/**
+* Writes a whole chain.
+*/
+void ArgEncoder::_json_chain(ArgEncoderOut* o, Argument* src) {
+  bool all_keyed = true;
+  for (Argument* a = src; nullptr != a; a = a->_next) {
+    if (nullptr == a->getKey()) {
+      all_keyed = false;
+      break;
+    }
+  }
+  _put(o, (const uint8_t*) (all_keyed ? "{" : "["), 1);
+  for (Argument* a = src; nullptr != a; a = a->_next) {
+    if (a != src) _put(o, (const uint8_t*) ",", 1);
+    if (nullptr != a->getKey()) {
+      if (!all_keyed) _put(o, (const uint8_t*) "{", 1);
+      _json_string(o, a->getKey(), strlen(a->getKey()));
+      _put(o, (const uint8_t*) ":", 1);
+      _json_value(o, a);
+      if (!all_keyed) _put(o, (const uint8_t*) "}", 1);
+    }
+    else {
+      _json_value(o, a);
+    }
+  }
+  _put(o, (const uint8_t*) (all_keyed ? "}" : "]"), 1);
+}
+
+
+/**
+* @return The exact length of the JSON encoding of the chain.
+*/
+int ArgEncoder::sizeJSON(Argument* src) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  if (nullptr != src) _json_chain(&o, src);
+  return _finish(&o);
+}
+
+/**
+* Encodes the chain into the given buffer. No terminator is written.
+*
+* @return The number of bytes written, or -1 if the buffer was too small.
+*/
+int ArgEncoder::writeJSON(Argument* src, uint8_t* buf, unsigned int len) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  o.buf = buf;
+  o.len = len;
+  if (nullptr != src) _json_chain(&o, src);
+  return _finish(&o);
+}
+
+/**
+* Encodes the chain into the given sink.
+*
+* @return The number of bytes passed to the sink, or -1 if it refused them.
+*/
+int ArgEncoder::gatherJSON(Argument* src, ArgEncoderSink sink, void* ctx) {
+  ArgEncoderOut o;
+  memset(&o, 0, sizeof(o));
+  o.sink = sink;
+  o.ctx  = ctx;
+  if (nullptr != src) _json_chain(&o, src);
+  return _finish(&o);
+}
+#endif  // MANUVR_JSON
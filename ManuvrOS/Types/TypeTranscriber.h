@@ -28,6 +28,7 @@ This is the base class for a type transcriber.
 #include <EnumeratedTypeCodes.h>
 
 class Argument;
+class Identity;
 
 #if defined(MANUVR_CBOR)
   #include <cbor-cpp/cbor.h>
@@ -77,7 +78,144 @@ class Argument;
       /* Please forgive the stupid name. */
       void _caaa(Argument*);
   };
+
+
+  #ifndef CBOR_DECODER_MAX_DEPTH
+    #define CBOR_DECODER_MAX_DEPTH  16   // Deepest container nesting we will follow.
+  #endif
+
+  #ifndef CBOR_DECODER_MAX_PENDING
+    #define CBOR_DECODER_MAX_PENDING  65536   // Longest incomplete item feed() will hold.
+  #endif
+
+  /*
+  * A streaming CBOR decoder that builds Argument chains without a per-value
+  *   allocation. Each batch of complete top-level items is walked twice: once
+  *   to size it, and once to place every Argument, key, and value into a single
+  *   block that is freed when the head of the batch is deleted. Keys repeated
+  *   within a batch are stored once.
+  *
+  * Input may arrive in arbitrary pieces. Complete items are decoded directly
+  *   from the caller's buffer, and only an incomplete tail is copied aside until
+  *   the rest of it arrives.
+  *
+  * Nested arrays and maps are flattened into the chain. A map key is given to
+  *   the first Argument emitted for its value.
+  */
+  class CBORArgDecoder {
+    public:
+      CBORArgDecoder();
+      ~CBORArgDecoder();
+
+      int       feed(const uint8_t* buf, unsigned int len);
+      Argument* take();
+      void      reset();
+
+      inline unsigned int pending() {  return _partial_len;  };   // Bytes of an incomplete item.
+      inline unsigned int ready() {    return _ready;        };   // Arguments waiting for take().
+
+      static Argument* decode(const uint8_t* buf, unsigned int len, int* consumed);
+
+
+    private:
+      /* State for one walk over the input. */
+      typedef struct {
+        bool           emit;      // false: sizing pass. true: placement pass.
+        uint8_t        skip;      // Non-zero while walking something we discard.
+        TCode          tag;       // Manuvr type from our vendor tag, or NONE.
+        uint32_t       args;      // Arguments counted or placed.
+        uint32_t       bytes;     // Payload bytes counted or placed.
+        const uint8_t* key;       // Map key waiting for a value.
+        uint32_t       key_len;
+        Argument*      arr;       // Placement pass only.
+        uint8_t*       pool;      // Placement pass only.
+      } CBORWalk;
+
+      Argument*    _head        = nullptr;
+      Argument*    _tail        = nullptr;
+      uint8_t*     _partial     = nullptr;   // Holds an item that has not fully arrived.
+      unsigned int _partial_len = 0;
+      unsigned int _partial_cap = 0;
+      unsigned int _ready       = 0;
+
+      static Argument* _build(const uint8_t* buf, unsigned int len, int* consumed, uint32_t* count, Argument** last);
+      static int       _walk(CBORWalk*, const uint8_t* p, const uint8_t* end, uint8_t depth);
+      static Argument* _place(CBORWalk*, TCode);
+      static uint8_t*  _reserve(CBORWalk*, uint32_t);
+  };
 #endif  // MANUVR_CBOR
 
 
+#if defined(MANUVR_CBOR) || defined(MANUVR_JSON)
+  #ifndef ARG_ENCODER_GATHER_MIN
+    #define ARG_ENCODER_GATHER_MIN  64   // Payloads this large go to a sink without a copy.
+  #endif
+
+  /*
+  * Receives encoder output, in order, for scatter/gather writes. The buffer is
+  *   only valid for the duration of the call.
+  * Return 0 to continue, or anything else to abort the encode.
+  */
+  typedef int (*ArgEncoderSink)(void* ctx, const uint8_t* buf, unsigned int len);
+
+  /*
+  * Encodes Argument chains without building them up piecewise. The size*()
+  *   functions give the exact length of the encoding, so that the write*()
+  *   functions can fill a single buffer of the caller's choosing. The gather*()
+  *   functions pass the encoding to a sink instead: small items are coalesced,
+  *   and large strings and blobs are handed over where they already sit.
+  *
+  * All functions return the length of the encoding, or -1 on failure.
+  *
+  * The JSON form of a chain is an object if every Argument has a key, and an
+  *   array otherwise (with keyed Arguments as single-member objects).
+  */
+  class ArgEncoder {
+    public:
+      #if defined(MANUVR_CBOR)
+      static int sizeCBOR(Argument*);
+      static int writeCBOR(Argument*, uint8_t* buf, unsigned int len);
+      static int gatherCBOR(Argument*, ArgEncoderSink, void* ctx);
+      #endif
+
+      #if defined(MANUVR_JSON)
+      static int sizeJSON(Argument*);
+      static int writeJSON(Argument*, uint8_t* buf, unsigned int len);
+      static int gatherJSON(Argument*, ArgEncoderSink, void* ctx);
+      #endif
+
+
+    private:
+      /* Where output goes. Sizing if there is neither a buffer nor a sink. */
+      typedef struct {
+        uint8_t*       buf;
+        unsigned int   len;
+        unsigned int   pos;       // Bytes produced so far.
+        ArgEncoderSink sink;
+        void*          ctx;
+        unsigned int   fill;      // Bytes waiting in scratch.
+        bool           fail;
+        uint8_t        scratch[ARG_ENCODER_GATHER_MIN];
+      } ArgEncoderOut;
+
+      static void _put(ArgEncoderOut*, const uint8_t*, unsigned int);
+      static void _flush(ArgEncoderOut*);
+      static int  _finish(ArgEncoderOut*);
+      static unsigned int _identity_len(Identity*);
+      static void _put_identity(ArgEncoderOut*, Identity*, unsigned int);
+
+      #if defined(MANUVR_CBOR)
+      static void _cbor_arg(ArgEncoderOut*, Argument*);
+      #endif
+
+      #if defined(MANUVR_JSON)
+      static void _json_chain(ArgEncoderOut*, Argument*);
+      static void _json_value(ArgEncoderOut*, Argument*);
+      static void _json_string(ArgEncoderOut*, const char*, unsigned int);
+      static void _json_base64(ArgEncoderOut*, const uint8_t*, unsigned int);
+      #endif
+  };
+#endif  // MANUVR_CBOR || MANUVR_JSON
+
+
 #endif  // __MANUVR_TYPE_TRANSCRIBER_H__
@@ -52,6 +52,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <DataStructures/Slab.h>
 
 
 /*******************************************************************************
@@ -65,6 +66,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 * Static members and initializers should be located here.
 *******************************************************************************/
 
+/*
+* The slab that PDU buffers come from. It is created on first use, and never
+*   destroyed, so that static construction and destruction order are moot.
+*/
+static Slab* _pdu_slab() {
+  static Slab* slab = new Slab(COAP_PDU_BUFFER_SIZE, COAP_PDU_SLAB_CHUNK, COAP_PDU_SLAB_MAX_CHUNKS);
+  return slab;
+}
+
 const char* CoAPMessage::optionNumToString(uint16_t code) {
   switch(code) {
     case COAP_OPTION_IF_MATCH:       return "IF_MATCH";
@@ -187,6 +197,9 @@ CoAPMessage::Code CoAPMessage::httpStatusToCode(int httpStatus) {
  * When using this constructor, the CoAPMessage class will allocate space for the PDU.
  * Contrast this with the parameterized constructors, which allow the use of an external buffer.
  *
+ * The PDU is built in a fixed-size buffer from a slab shared by all messages. Options may be added in
+ * any order. They are held aside, and written to the PDU (sorted) only when it is next read.
+ *
  * Note, the PDU container and space can be reused by issuing a CoAPMessage::reset(). If the new PDU exceeds the
  * space of the previously allocated memory, then further memory will be dynamically allocated.
  *
@@ -203,9 +216,15 @@ CoAPMessage::Code CoAPMessage::httpStatusToCode(int httpStatus) {
  */
 CoAPMessage::CoAPMessage() {
   // pdu
-  _pdu = (uint8_t*)calloc(4,sizeof(uint8_t));
+  _pdu = (uint8_t*) _pdu_slab()->take();
+  _bufferLength = COAP_PDU_BUFFER_SIZE;
+  if (nullptr == _pdu) {
+    // The slab is at its limit. Fall back to the heap.
+    _pdu = (uint8_t*)calloc(4,sizeof(uint8_t));
+    _bufferLength = 4;
+  }
+  memset(_pdu, 0x00, COAP_HDR_SIZE);
   _pduLength = 4;
-  _bufferLength = _pduLength;
 
   //options
   _numOptions = 0;
@@ -307,7 +326,8 @@ CoAPMessage::CoAPMessage(uint8_t *buffer, int bufferLength, int pduLength) {
 /// Reset CoAPMessage container so it can be reused to build a new PDU.
 /**
  * This resets the CoAPMessage container, setting the pdu length, option count, etc back to zero. The
- * PDU can then be populated as if it were newly constructed.
+ * PDU can then be populated as if it were newly constructed. Buffers are kept, so a reused message
+ * costs no allocation.
  *
  * Note that the space available will depend on how the CoAPMessage was originally constructed:
  * -# CoAPMessage::CoAPMessage()
@@ -327,13 +347,17 @@ CoAPMessage::CoAPMessage(uint8_t *buffer, int bufferLength, int pduLength) {
  */
 int CoAPMessage::reset() {
   // pdu
-  memset(_pdu,0x00,_bufferLength);
+  memset(_pdu,0x00,COAP_HDR_SIZE);
   // packet always has at least a header
   _pduLength = 4;
+  setVersion(1);
 
   // options
   _numOptions = 0;
   _maxAddedOptionNumber = 0;
+  _staged_count  = 0;
+  _arena_len     = 0;
+  _options_dirty = false;
   // payload
   _payloadPointer = nullptr;
   _payloadLength = 0;
@@ -351,6 +375,11 @@ int CoAPMessage::reset() {
  * \return 1 if the PDU validates correctly, 0 if not. XXX maybe add some error codes
  */
 int CoAPMessage::validate() {
+  // From here on, the PDU is authoritative for options.
+  packOptions();
+  _staged_count = 0;
+  _arena_len    = 0;
+
   if(_pduLength<4) {
     coap_log.concatf("PDU has to be a minimum of 4 bytes. This: %d bytes\n",_pduLength);
     Kernel::log(&coap_log);
@@ -377,8 +406,6 @@ int CoAPMessage::validate() {
     Kernel::log(&coap_log);
     return 0;
   }
-  coap_log.concatf("Version: %d\n", version);
-  coap_log.concatf("Type: %d\n", getType());
 
   // token length must be between 0 and 8
   int tokenLength = getTokenLength();
@@ -387,7 +414,6 @@ int CoAPMessage::validate() {
     Kernel::log(&coap_log);
     return 0;
   }
-  coap_log.concatf("Token length: %d\n",tokenLength);
   // check total length
   if((COAP_HDR_SIZE+tokenLength)>_pduLength) {
     coap_log.concat("Token length would make pdu longer than actual length.\n");
@@ -405,9 +431,9 @@ int CoAPMessage::validate() {
     (code>COAP_UNSUPPORTED_CONTENT_FORMAT&&code<COAP_INTERNAL_SERVER_ERROR) ||
     (code>COAP_PROXYING_NOT_SUPPORTED) ) {
     coap_log.concatf("Invalid CoAP code: %d\n",code);
+    Kernel::log(&coap_log);
     return 0;
   }
-  coap_log.concatf("CoAP code: %d\n",code);
 
   // token can be anything so nothing to check
 
@@ -420,9 +446,8 @@ int CoAPMessage::validate() {
 
   // may be 0 options
   if(optionPos==_pduLength) {
-    coap_log.concat("No options. No payload.\n");
-    Kernel::log(&coap_log);
     _numOptions = 0;
+    _payloadPointer = nullptr;
     _payloadLength = 0;
     return 1;
   }
@@ -442,8 +467,6 @@ int CoAPMessage::validate() {
           _payloadPointer = &_pdu[optionPos+1];
           _payloadLength = (bytesRemaining-1);
           _numOptions = numOptions;
-          coap_log.concatf("Payload found, length: %d\n",_payloadLength);
-          Kernel::log(&coap_log);
           return 1;
         }
         // payload marker but no payload
@@ -462,11 +485,8 @@ int CoAPMessage::validate() {
         Kernel::log(&coap_log);
         return 0;
       }
-      coap_log.concatf("Option header byte appears sane: 0x%x%x\n",upperNibble,lowerNibble);
     }
     else {
-      coap_log.concat("No more data. No payload.\n");
-      Kernel::log(&coap_log);
       _payloadPointer = nullptr;
       _payloadLength = 0;
       _numOptions = numOptions;
@@ -478,7 +498,6 @@ int CoAPMessage::validate() {
 
     // check that there is enough space for the extended delta and length bytes (if any)
     int headerBytesNeeded = computeExtraBytes(upperNibble);
-    coap_log.concatf("%d extra bytes needed for extended delta\n",headerBytesNeeded);
     if(headerBytesNeeded>bytesRemaining) {
       coap_log.concatf("Not enough space for extended option delta, needed %d, have %d.\n",headerBytesNeeded,bytesRemaining);
       Kernel::log(&coap_log);
@@ -491,13 +510,11 @@ int CoAPMessage::validate() {
       Kernel::log(&coap_log);
       return 0;
     }
-    coap_log.concatf("Enough space for extended delta and length: %d, continuing.\n",headerBytesNeeded);
 
     // extract option details
     optionDelta = getOptionDelta(&_pdu[optionPos]);
     optionNumber += optionDelta;
     optionValueLength = getOptionValueLength(&_pdu[optionPos]);
-    coap_log.concatf("Got option: %d with length %d\n",optionNumber,optionValueLength);
     // compute total length
     totalLength = 1; // mandatory header
     totalLength += computeExtraBytes(optionDelta);
@@ -509,7 +526,6 @@ int CoAPMessage::validate() {
       Kernel::log(&coap_log);
       return 0;
     }
-    coap_log.concatf("Enough space for option payload: %d %d\n",optionValueLength,(totalLength-headerBytesNeeded-1));
 
     // recompute bytesRemaining
     bytesRemaining -= totalLength;
@@ -521,8 +537,6 @@ int CoAPMessage::validate() {
     // inc number of options XXX
     numOptions++;
   }
-
-  Kernel::log(&coap_log);
   return 1;
 }
 
@@ -545,7 +559,10 @@ int CoAPMessage::validate() {
  */
 CoAPMessage::~CoAPMessage() {
   if(!_constructedFromBuffer) {
-    free(_pdu);
+    if (!_pdu_slab()->give(_pdu)) free(_pdu);
+  }
+  if (_arena != _arena_inline) {
+    free(_arena);
   }
 }
 
@@ -607,8 +624,6 @@ int CoAPMessage::setURI(char *uri, int urilen) {
 
     // ignore leading slash
     if(*startP==splitChar) {
-      coap_log.concat("Skipping leading slash\n");
-      Kernel::log(&coap_log);
       startP++;
     }
 
@@ -617,7 +632,6 @@ int CoAPMessage::setURI(char *uri, int urilen) {
 
     // might not be another slash
     if(endP==nullptr) {
-      coap_log.concat("Ending out of slash\n");
       // check if there is a ?
       endP = strchr(startP,'?');
       // done if no queries
@@ -865,94 +879,33 @@ uint8_t* CoAPMessage::getTokenPointer() {
  * \return 0 on success, 1 on failure.
  */
 int CoAPMessage::setToken(uint8_t *token, uint8_t tokenLength) {
-  coap_log.concat("Setting token\n");
-  Kernel::log(&coap_log);
   if(token==nullptr) {
     coap_log.concat("NULL pointer passed as token reference\n");
     Kernel::log(&coap_log);
     return 1;
   }
 
-  if(tokenLength==0) {
-    coap_log.concat("Token has zero length\n");
+  if((tokenLength==0) || (tokenLength>8)) {
+    coap_log.concatf("Bad token length: %u\n", tokenLength);
     Kernel::log(&coap_log);
     return 1;
   }
 
-  // if tokenLength has not changed, just copy the new value
+  // if tokenLength has changed, move everything after the token
   uint8_t oldTokenLength = getTokenLength();
-  if(tokenLength==oldTokenLength) {
-    memcpy((void*)&_pdu[4],token,tokenLength);
-    return 0;
-  }
-
-  // otherwise compute new length of PDU
-  uint8_t oldPDULength = _pduLength;
-  _pduLength -= oldTokenLength;
-  _pduLength += tokenLength;
-
-  // now, have to shift old memory around, but shift direction depends
-  // whether pdu is now bigger or smaller
-  if(_pduLength>oldPDULength) {
-    // new PDU is bigger, need to allocate space for new PDU
-    if(!_constructedFromBuffer) {
-      uint8_t *newMemory = (uint8_t*)realloc(_pdu,_pduLength);
-      if(newMemory==nullptr) {
-        // malloc failed
-        coap_log.concat("Failed to allocate memory for token\n");
-        Kernel::log(&coap_log);
-        _pduLength = oldPDULength;
-        return 1;
-      }
-      _pdu = newMemory;
-      _bufferLength = _pduLength;
+  if(tokenLength!=oldTokenLength) {
+    int shift = tokenLength-oldTokenLength;
+    if(!reservePDU(_pduLength+shift)) {
+      return 1;
     }
-    else {
-      // constructed from buffer, check space
-      if(_pduLength>_bufferLength) {
-        coap_log.concatf("Buffer too small to contain token, needed %d, got %d.\n",_pduLength-oldPDULength,_bufferLength-oldPDULength);
-        Kernel::log(&coap_log);
-        _pduLength = oldPDULength;
-        return 1;
-      }
+    memmove(&_pdu[COAP_HDR_SIZE+tokenLength], &_pdu[COAP_HDR_SIZE+oldTokenLength], _pduLength-(COAP_HDR_SIZE+oldTokenLength));
+    _pduLength += shift;
+    if(_payloadPointer!=nullptr) {
+      _payloadPointer += shift;
     }
-
-    // and then shift everything after token up to end of new PDU
-    // memory overlaps so do this manually so to avoid additional mallocs
-    int shiftOffset = _pduLength-oldPDULength;
-    int shiftAmount = _pduLength-tokenLength-COAP_HDR_SIZE; // everything after token
-    shiftPDUUp(shiftOffset,shiftAmount);
-
-    // now copy the token into the new space and set official token length
-    memcpy((void*)&_pdu[4],token,tokenLength);
     setTokenLength(tokenLength);
-
-    // and return success
-    return 0;
   }
-
-  // new PDU is smaller, copy the new token value over the old one
   memcpy((void*)&_pdu[4],token,tokenLength);
-  // and shift everything after the new token down
-  int startLocation = COAP_HDR_SIZE+tokenLength;
-  int shiftOffset = oldPDULength-_pduLength;
-  int shiftAmount = oldPDULength-oldTokenLength-COAP_HDR_SIZE;
-  shiftPDUDown(startLocation,shiftOffset,shiftAmount);
-  // then reduce size of buffer
-  if(!_constructedFromBuffer) {
-    uint8_t *newMemory = (uint8_t*)realloc(_pdu,_pduLength);
-    if(newMemory==nullptr) {
-      // malloc failed, PDU in inconsistent state
-      coap_log.concat("Failed to shrink PDU for new token. PDU probably broken\n");
-      Kernel::log(&coap_log);
-      return 1;
-    }
-    _pdu = newMemory;
-    _bufferLength = _pduLength;
-  }
-
-  // and officially set the new tokenLength
-  setTokenLength(tokenLength);
   return 0;
 }
 
@@ -993,9 +946,7 @@ uint16_t CoAPMessage::getMessageID() {
  * This returns the options as a sequence of structs.
  */
 CoAPMessage::CoapOption* CoAPMessage::getOptions() {
-  coap_log.concatf("getOptions() called, %d options.\n",_numOptions);
-  Kernel::log(&coap_log);
-
+  packOptions();
   uint16_t optionDelta =0, optionNumber = 0, optionValueLength = 0;
   int totalLength = 0;
 
@@ -1041,153 +992,97 @@ CoAPMessage::CoapOption* CoAPMessage::getOptions() {
 
 /// Add an option to the PDU.
 /**
- * Unlike other implementations, options can be added in any order, and in-memory manipulation will be
- * performed to ensure the correct ordering of options (they use a delta encoding of option numbers).
- * Re-ordering memory like this incurs a small performance cost, so if you care about this, then you
- * might want to add options in ascending order of option number.
+ * Options can be added in any order. Each is copied aside as it is added, and the PDU is rewritten
+ * (with its options sorted by number) once, when it is next read. Options with the same number keep
+ * the order in which they were added.
  * \param optionNumber The number of the option, see the enum CoAPMessage::Option for shorthand notations.
  * \param optionLength The length of the option payload in bytes.
  * \param optionValue A pointer to the byte sequence that is the option payload (bytes will be copied).
  * \return 0 on success, 1 on failure.
  */
 int CoAPMessage::addOption(uint16_t insertedOptionNumber, uint16_t optionValueLength, uint8_t *optionValue) {
-  // this inserts the option in memory, and re-computes the deltas accordingly
-  // prevOption <-- insertionPosition
-  // nextOption
-
-  // find insertion location and previous option number
-  uint16_t prevOptionNumber = 0; // option number of option before insertion point
-  int insertionPosition = findInsertionPosition(insertedOptionNumber,&prevOptionNumber);
-  coap_log.concatf("inserting option at position %d, after option with number: %hu\n",insertionPosition,prevOptionNumber);
-  Kernel::log(&coap_log);
-
-  // compute option delta length
-  uint16_t optionDelta = insertedOptionNumber-prevOptionNumber;
-  uint8_t extraDeltaBytes = computeExtraBytes(optionDelta);
-
-  // compute option length length
-  uint16_t extraLengthBytes = computeExtraBytes(optionValueLength);
-
-  // compute total length of option
-  uint16_t optionLength = COAP_OPTION_HDR_BYTE + extraDeltaBytes + extraLengthBytes + optionValueLength;
-
-  // if this is at the end of the PDU, job is done, just malloc and insert
-  if(insertionPosition==_pduLength) {
-    coap_log.concat("Inserting at end of PDU\n");
+  if(0!=stageExistingOptions()) {
+    return 1;
+  }
+  if(_staged_count>=COAP_MAX_OPTIONS) {
+    coap_log.concatf("Cannot add option %u. Already have %d.\n",insertedOptionNumber,_staged_count);
     Kernel::log(&coap_log);
+    return 1;
+  }
+  if(!reserveArena(_arena_len+optionValueLength)) {
+    coap_log.concat("Failed to allocate memory for option.\n");
+    Kernel::log(&coap_log);
+    return 1;
+  }
+  if(optionValueLength>0) {
+    memcpy(&_arena[_arena_len],optionValue,optionValueLength);
+  }
+  _staged[_staged_count].number = insertedOptionNumber;
+  _staged[_staged_count].length = optionValueLength;
+  _staged[_staged_count].offset = _arena_len;
+  _arena_len += optionValueLength;
+  _staged_count++;
+  _numOptions = _staged_count;
+  _options_dirty = true;
+  return 0;
+}
 
-    // optionNumber must be biggest added
-    _maxAddedOptionNumber = insertedOptionNumber;
-
-    // set new PDU length and allocate space for extra option
-    int oldPDULength = _pduLength;
-    _pduLength += optionLength;
-    if(!_constructedFromBuffer) {
-      uint8_t *newMemory = (uint8_t*)realloc(_pdu,_pduLength);
-      if(newMemory==nullptr) {
-        coap_log.concat("Failed to allocate memory for option.\n");
-        Kernel::log(&coap_log);
-        _pduLength = oldPDULength;
-        // malloc failed
-        return 1;
-      }
-      _pdu = newMemory;
-      _bufferLength = _pduLength;
-    }
-    else {
-      // constructed from buffer, check space
-      if(_pduLength>_bufferLength) {
-        coap_log.concatf("Buffer too small for new option: needed %d, got %d.\n",_pduLength-oldPDULength,_bufferLength-oldPDULength);
-        Kernel::log(&coap_log);
-        _pduLength = oldPDULength;
-        return 1;
-      }
+/// Writes staged options into the PDU.
+/**
+ * Sorts the staged options by number, and writes them between the token and the payload. This
+ * is a no-op unless options were added since the last call.
+ * \return 0 on success, -1 if the PDU could not hold the options.
+ */
+int CoAPMessage::packOptions() {
+  if(!_options_dirty) {
+    return 0;
+  }
+  // stable insertion sort, since repeated options must keep their order
+  for(int i=1; i<_staged_count; i++) {
+    StagedOption opt = _staged[i];
+    int j = i;
+    while((j>0) && (_staged[j-1].number>opt.number)) {
+      _staged[j] = _staged[j-1];
+      j--;
     }
+    _staged[j] = opt;
+  }
 
-    // insert option at position
-    insertOption(insertionPosition,optionDelta,optionValueLength,optionValue);
-    _numOptions++;
-    return 0;
+  // measure the encoded options
+  int optionsLength = 0;
+  uint16_t prev = 0;
+  for(int i=0; i<_staged_count; i++) {
+    optionsLength += COAP_OPTION_HDR_BYTE + computeExtraBytes(_staged[i].number-prev);
+    optionsLength += computeExtraBytes(_staged[i].length) + _staged[i].length;
+    prev = _staged[i].number;
   }
-  // XXX could do 0xFF pdu payload case for changing of dynamically allocated application space SDUs < yeah, if you're insane
-
-  // the next option might (probably) needs it's delta changing
-  // I want to take this into account when allocating space for the new
-  // option, to avoid having to do two mallocs, first get info about this option
-  int nextOptionDelta = getOptionDelta(&_pdu[insertionPosition]);
-  int nextOptionNumber = prevOptionNumber + nextOptionDelta;
-  int nextOptionDeltaBytes = computeExtraBytes(nextOptionDelta);
-  // recompute option delta, relative to inserted option
-  int newNextOptionDelta = nextOptionNumber-insertedOptionNumber;
-  int newNextOptionDeltaBytes = computeExtraBytes(newNextOptionDelta);
-  // determine adjustment
-  int optionDeltaAdjustment = newNextOptionDeltaBytes-nextOptionDeltaBytes;
-
-  // create space for new option, including adjustment space for option delta
-  //DBG_PDU();
-  coap_log.concat("Creating space\n");
-  int mallocLength = optionLength+optionDeltaAdjustment;
-  int oldPDULength = _pduLength;
-  _pduLength += mallocLength;
 
-  if(!_constructedFromBuffer) {
-    uint8_t *newMemory = (uint8_t*)realloc(_pdu,_pduLength);
-    if(newMemory==nullptr) {
-      coap_log.concat("Failed to allocate memory for option\n");
-      Kernel::log(&coap_log);
-      _pduLength = oldPDULength;
-      return 1;
-    }
-    _pdu = newMemory;
-    _bufferLength = _pduLength;
-  } else {
-    // constructed from buffer, check space
-    if(_pduLength>_bufferLength) {
-      coap_log.concatf("Buffer too small to contain option, needed %d, got %d.\n",_pduLength-oldPDULength,_bufferLength-oldPDULength);
-      Kernel::log(&coap_log);
-      _pduLength = oldPDULength;
-      return 1;
-    }
+  // everything from the payload marker onward keeps its content, but may move
+  int optionStart = COAP_HDR_SIZE + getTokenLength();
+  int optionEnd   = (_payloadPointer!=nullptr) ? (int)(_payloadPointer-_pdu)-1 : _pduLength;
+  int tailLength  = _pduLength-optionEnd;
+  int newLength   = optionStart+optionsLength+tailLength;
+  if(!reservePDU(newLength)) {
+    return -1;
+  }
+  if(tailLength>0) {
+    memmove(&_pdu[optionStart+optionsLength],&_pdu[optionEnd],tailLength);
   }
 
-  // move remainder of PDU data up to create hole for new option
-  //DBG_PDU();
-  coap_log.concat("Shifting PDU.\n");
-  shiftPDUUp(mallocLength,_pduLength-(insertionPosition+mallocLength));
-  //DBG_PDU();
-
-  // adjust option delta bytes of following option
-  // move the option header to the correct position
-  int nextHeaderPos = insertionPosition+mallocLength;
-  _pdu[nextHeaderPos-optionDeltaAdjustment] = _pdu[nextHeaderPos];
-  nextHeaderPos -= optionDeltaAdjustment;
-  // and set the new value
-  setOptionDelta(nextHeaderPos, newNextOptionDelta);
-
-  // new option shorter
-  // p p n n x x x x x
-  // p p n n x x x x x -
-  // p p - n n x x x x x
-  // p p - - n x x x x x
-  // p p o o n x x x x x
-
-  // new option longer
-  // p p n n x x x x x
-  // p p n n x x x x x - - -
-  // p p - - - n n x x x x x
-  // p p - - n n n x x x x x
-  // p p o o n n n x x x x x
-
-  // note, it can only ever be shorter or the same since if an option was inserted the delta got smaller
-  // but I'll leave that little comment in, just to show that it would work even if the delta got bigger
-
-  // now insert the new option into the gap
-  coap_log.concat("Inserting new option... ");
-  insertOption(insertionPosition,optionDelta,optionValueLength,optionValue);
-  coap_log.concat("done\n");
-
-  // done, mark it with B!
-  Kernel::log(&coap_log);
+  uint8_t* out = &_pdu[optionStart];
+  prev = 0;
+  for(int i=0; i<_staged_count; i++) {
+    out += encodeOption(out,_staged[i].number-prev,_staged[i].length,&_arena[_staged[i].offset]);
+    prev = _staged[i].number;
+  }
+
+  _pduLength = newLength;
+  if(_payloadPointer!=nullptr) {
+    _payloadPointer = &_pdu[optionStart+optionsLength+1];
+  }
+  _numOptions = _staged_count;
+  _maxAddedOptionNumber = prev;
+  _options_dirty = false;
   return 0;
 }
 
@@ -1197,12 +1092,17 @@ int CoAPMessage::addOption(uint16_t insertedOptionNumber, uint16_t optionValueLe
  * and return a pointer to it. If the PDU was constructed from a buffer, this doesn't
  * malloc anything, it just changes the _pduLength and returns the payload pointer.
  *
- * \note The pointer returned points into the PDU buffer.
+ * \note The pointer returned points into the PDU buffer. Adding options afterward may move the
+ * payload, so fill it before adding any more.
  * \param len The length of the payload buffer to allocate.
  * \return Either a pointer to the payload buffer, or NULL if there wasn't enough space / allocation failed.
  */
 uint8_t* CoAPMessage::mallocPayload(int len) {
-  coap_log.concat("Entering mallocPayload\n");
+  // the payload goes after the options, so they must be in place
+  if(0!=packOptions()) {
+    return nullptr;
+  }
+
   // sanity checks
   if(len==0) {
     coap_log.concat("Cannot allocate a zero length payload\n");
@@ -1212,7 +1112,6 @@ uint8_t* CoAPMessage::mallocPayload(int len) {
 
   // further sanity
   if(len==_payloadLength) {
-    coap_log.concat("Space for payload of specified length already exists\n");
     if(_payloadPointer==nullptr) {
       coap_log.concatf("Garbage PDU. Payload length is %d, but existing _payloadPointer NULL",_payloadLength);
       Kernel::log(&coap_log);
@@ -1221,8 +1120,6 @@ uint8_t* CoAPMessage::mallocPayload(int len) {
     return _payloadPointer;
   }
 
-  coap_log.concatf("_bufferLength: %d, _pduLength: %d, _payloadLength: %d\n",_bufferLength,_pduLength,_payloadLength);
-
   // might be making payload bigger (including bigger than 0) or smaller
   int markerSpace = 1;
   int payloadSpace = len;
@@ -1236,23 +1133,8 @@ uint8_t* CoAPMessage::mallocPayload(int len) {
 
   // make space for payload (and payload marker if necessary)
   int newLen = _pduLength+payloadSpace+markerSpace;
-  if(!_constructedFromBuffer) {
-    uint8_t* newPDU = (uint8_t*)realloc(_pdu,newLen);
-    if(newPDU==nullptr) {
-      coap_log.concat("Cannot allocate (or shrink) space for payload\n");
-      Kernel::log(&coap_log);
-      return nullptr;
-    }
-    _pdu = newPDU;
-    _bufferLength = newLen;
-  } else {
-    // constructed from buffer, check space
-    coap_log.concatf("newLen: %d, _bufferLength: %d\n",newLen,_bufferLength);
-    if(newLen>_bufferLength) {
-      coap_log.concatf("Buffer too small to contain desired payload, needed %d, got %d.\n",newLen-_pduLength,_bufferLength-_pduLength);
-      Kernel::log(&coap_log);
-      return nullptr;
-    }
+  if(!reservePDU(newLen)) {
+    return nullptr;
   }
 
   // deal with fresh allocation case separately
@@ -1269,8 +1151,6 @@ uint8_t* CoAPMessage::mallocPayload(int len) {
   // otherwise, just adjust length of PDU
   _pduLength = newLen;
   _payloadLength = len;
-  coap_log.concat("Leaving mallocPayload\n");
-  Kernel::log(&coap_log);
   return _payloadPointer;
 }
 
@@ -1376,42 +1256,116 @@ int CoAPMessage::setContentFormat(CoAPMessage::ContentFormat format) {
 /// PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE
 /// PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE PRIVATE
 
-/// Moves a block of bytes to end of PDU from given offset.
+/// Makes certain that the PDU buffer can hold the given number of bytes.
 /**
- * This moves the block of bytes _pdu[_pduLength-1-shiftOffset-shiftAmount] ... _pdu[_pduLength-1-shiftOffset]
- * to the end of the PDU.
- * \param shiftOffset End of block to move, relative to end of PDU (-1).
- * \param shiftAmount Length of block to move.
+ * A PDU that outgrows its slab buffer is moved to the heap. Thereafter, it is resized in place.
+ * \param len The length the PDU will need.
+ * \return true if the buffer is large enough.
  */
-void CoAPMessage::shiftPDUUp(int shiftOffset, int shiftAmount) {
-  coap_log.concatf("shiftOffset: %d, shiftAmount: %d",shiftOffset,shiftAmount);
-  int destPointer = _pduLength-1;
-  int srcPointer  = destPointer-shiftOffset;
-  while(shiftAmount--) {
-    _pdu[destPointer] = _pdu[srcPointer];
-    destPointer--;
-    srcPointer--;
+bool CoAPMessage::reservePDU(int len) {
+  if(len<=_bufferLength) {
+    return true;
   }
-  Kernel::log(&coap_log);
+  if(_constructedFromBuffer) {
+    coap_log.concatf("Buffer too small, needed %d, got %d.\n",len,_bufferLength);
+    Kernel::log(&coap_log);
+    return false;
+  }
+
+  int payloadOffset = (_payloadPointer!=nullptr) ? (int)(_payloadPointer-_pdu) : -1;
+  uint8_t* newPDU = nullptr;
+  if(_pdu_slab()->contains(_pdu)) {
+    newPDU = (uint8_t*)malloc(len);
+    if(newPDU!=nullptr) {
+      memcpy(newPDU,_pdu,_pduLength);
+      _pdu_slab()->give(_pdu);
+    }
+  }
+  else {
+    newPDU = (uint8_t*)realloc(_pdu,len);
+  }
+  if(newPDU==nullptr) {
+    coap_log.concatf("Failed to allocate %d bytes for PDU.\n",len);
+    Kernel::log(&coap_log);
+    return false;
+  }
+  _pdu = newPDU;
+  _bufferLength = len;
+  if(payloadOffset>=0) {
+    _payloadPointer = &_pdu[payloadOffset];
+  }
+  return true;
 }
 
-/// Moves a block of bytes down a specified number of steps.
+/// Makes certain that the option arena can hold the given number of bytes.
 /**
- * Moves the block of bytes _pdu[startLocation+shiftOffset] ... _pdu[startLocation+shiftOffset+shiftAmount]
- * down to \b startLocation.
- * \param startLocation Index where to shift the block to.
- * \param shiftOffset Where the block starts, relative to start index.
- * \param shiftAmount Length of block to shift.
+ * \param len The number of bytes of option values the message will hold.
+ * \return true if the arena is large enough.
  */
-void CoAPMessage::shiftPDUDown(int startLocation, int shiftOffset, int shiftAmount) {
-  coap_log.concatf("startLocation: %d, shiftOffset: %d, shiftAmount: %d\n",startLocation,shiftOffset,shiftAmount);
-  int srcPointer = startLocation+shiftOffset;
-  while(shiftAmount--) {
-    _pdu[startLocation] = _pdu[srcPointer];
-    startLocation++;
-    srcPointer++;
+bool CoAPMessage::reserveArena(int len) {
+  if(len<=_arena_cap) {
+    return true;
+  }
+  if(len>0xFFFF) {
+    return false;
+  }
+  int cap = ((_arena_cap*2)>len) ? (_arena_cap*2) : len;
+  if(cap>0xFFFF) {
+    cap = 0xFFFF;
+  }
+  uint8_t* newArena = nullptr;
+  if(_arena==_arena_inline) {
+    newArena = (uint8_t*)malloc(cap);
+    if(newArena!=nullptr) {
+      memcpy(newArena,_arena_inline,_arena_len);
+    }
   }
-  Kernel::log(&coap_log);
+  else {
+    newArena = (uint8_t*)realloc(_arena,cap);
+  }
+  if(newArena==nullptr) {
+    return false;
+  }
+  _arena = newArena;
+  _arena_cap = cap;
+  return true;
+}
+
+/// Copies the options already in the PDU aside, so that more can be added.
+/**
+ * This is only needed for a PDU that was parsed, or reset by validate(). Once options are
+ * staged, the staging is kept complete.
+ * \return 0 on success, -1 if the options would not fit.
+ */
+int CoAPMessage::stageExistingOptions() {
+  if((_staged_count>0) || (_numOptions==0)) {
+    return 0;
+  }
+  if(_numOptions>COAP_MAX_OPTIONS) {
+    coap_log.concatf("PDU has %d options. Cannot stage more than %d.\n",_numOptions,COAP_MAX_OPTIONS);
+    Kernel::log(&coap_log);
+    return -1;
+  }
+  int optionPos = COAP_HDR_SIZE + getTokenLength();
+  uint16_t optionNumber = 0;
+  for(int i=0; i<_numOptions; i++) {
+    uint16_t optionDelta = getOptionDelta(&_pdu[optionPos]);
+    uint16_t optionValueLength = getOptionValueLength(&_pdu[optionPos]);
+    int headerLength = COAP_OPTION_HDR_BYTE + computeExtraBytes(optionDelta) + computeExtraBytes(optionValueLength);
+    optionNumber += optionDelta;
+    if(!reserveArena(_arena_len+optionValueLength)) {
+      _arena_len = 0;
+      return -1;
+    }
+    memcpy(&_arena[_arena_len],&_pdu[optionPos+headerLength],optionValueLength);
+    _staged[i].number = optionNumber;
+    _staged[i].length = optionValueLength;
+    _staged[i].offset = _arena_len;
+    _arena_len += optionValueLength;
+    optionPos += headerLength+optionValueLength;
+  }
+  _staged_count = _numOptions;
+  return 0;
 }
 
 /// Gets the payload length of an option.
@@ -1468,52 +1422,6 @@ uint16_t CoAPMessage::getOptionDelta(uint8_t *option) {
 }
 
 
-/// Finds the insertion position in the current list of options for the specified option.
-/**
- * \param optionNumber The option's number.
- * \param prevOptionNumber A pointer to a uint16_t which will store the option number of the option previous
- * to the insertion point.
- * \return 0 on success, 1 on failure. \b prevOptionNumber will contain the option number of the option
- * before the insertion position (for example 0 if no options have been inserted).
- */
-int CoAPMessage::findInsertionPosition(uint16_t optionNumber, uint16_t *prevOptionNumber) {
-  // zero this for safety
-  *prevOptionNumber = 0x00;
-
-  coap_log.concatf("_pduLength: %d\n",_pduLength);
-  Kernel::log(&coap_log);
-
-  // if option is bigger than any currently stored, it goes at the end
-  // this includes the case that no option has yet been added
-  if( (optionNumber >= _maxAddedOptionNumber) || (_pduLength == (COAP_HDR_SIZE+getTokenLength())) ) {
-    *prevOptionNumber = _maxAddedOptionNumber;
-    return _pduLength;
-  }
-
-  // otherwise walk over the options
-  int optionPos = COAP_HDR_SIZE + getTokenLength();
-  uint16_t optionDelta = 0, optionValueLength = 0;
-  uint16_t currentOptionNumber = 0;
-  while(optionPos<_pduLength && _pdu[optionPos]!=0xFF) {
-    optionDelta = getOptionDelta(&_pdu[optionPos]);
-    currentOptionNumber += optionDelta;
-    optionValueLength = getOptionValueLength(&_pdu[optionPos]);
-    // test if this is insertion position
-    if(currentOptionNumber>optionNumber) {
-      return optionPos;
-    }
-    // keep track of the last valid option number
-    *prevOptionNumber = currentOptionNumber;
-    // move onto next option
-    optionPos += computeExtraBytes(optionDelta);
-    optionPos += computeExtraBytes(optionValueLength);
-    optionPos += optionValueLength;
-    optionPos++; // (for mandatory option header byte)
-  }
-  return optionPos;
-
-}
-
 /// CoAP uses a minimal-byte representation for length fields. This returns the number of bytes needed to represent a given length.
 int CoAPMessage::computeExtraBytes(uint16_t n) {
   if(n<269) {
@@ -1522,97 +1430,62 @@ int CoAPMessage::computeExtraBytes(uint16_t n) {
   return 2;
 }
 
-/// Set the option delta to the specified value.
-/**
- * This assumes space has been made for the option delta.
- * \param optionPosition The index of the option in the PDU.
- * \param optionDelta The option delta value to set.
- */
-void CoAPMessage::setOptionDelta(int optionPosition, uint16_t optionDelta) {
-  int headerStart = optionPosition;
-  // clear the old option delta bytes
-  _pdu[headerStart] &= 0x0F;
-
-  // set the option delta bytes
-  if(optionDelta<13) {
-    _pdu[headerStart] |= (optionDelta << 4);
-  }
-  else if(optionDelta<269) {
-     // 1 extra byte
-    _pdu[headerStart] |= 0xD0; // 13 in first nibble
-    _pdu[++optionPosition] &= 0x00;
-    _pdu[optionPosition] |= (optionDelta-13);
-  }
-  else {
-    // 2 extra bytes, network byte order uint16_t
-    _pdu[headerStart] |= 0xE0; // 14 in first nibble
-    optionDelta -= 269;
-    uint8_t *to = &_pdu[optionPosition];
-    optionPosition += 2;
-    endian_store16(to, optionDelta);
-  }
-}
-
-/// Insert an option in-memory at the specified location.
+/// Encode an option at the specified location.
 /**
  * This assumes that there is enough space at the location specified.
- * \param insertionPosition Position in the PDU where the option should be placed.
+ * \param out Where in the PDU the option should be written.
  * \param optionDelta The delta value for the option.
  * \param optionValueLength The length of the option value.
  * \param optionValue A pointer to the sequence of bytes representing the option value.
- * \return 0 on success, 1 on failure.
+ * \return The number of bytes written.
  */
-int CoAPMessage::insertOption(
-  int insertionPosition,
+int CoAPMessage::encodeOption(
+  uint8_t *out,
   uint16_t optionDelta,
   uint16_t optionValueLength,
   uint8_t *optionValue) {
 
-  int headerStart = insertionPosition;
-
-  // clear old option header start
-  _pdu[headerStart] &= 0x00;
+  uint8_t header = 0x00;
+  int pos = COAP_OPTION_HDR_BYTE;
 
   // set the option delta bytes
   if(optionDelta<13) {
-    _pdu[headerStart] |= (optionDelta << 4);
-  } else if(optionDelta<269) {
-     // 1 extra byte
-    _pdu[headerStart] |= 0xD0; // 13 in first nibble
-    _pdu[++insertionPosition] &= 0x00;
-    _pdu[insertionPosition] |= (optionDelta-13);
-  } else {
+    header |= (optionDelta << 4);
+  }
+  else if(optionDelta<269) {
+    // 1 extra byte
+    header |= 0xD0; // 13 in first nibble
+    out[pos++] = (optionDelta-13);
+  }
+  else {
     // 2 extra bytes, network byte order uint16_t
-    _pdu[headerStart] |= 0xE0; // 14 in first nibble
-    optionDelta -= 269;
-    uint8_t *to = &_pdu[insertionPosition];
-    insertionPosition += 2;
-    endian_store16(to, optionDelta);
+    header |= 0xE0; // 14 in first nibble
+    uint8_t *to = &out[pos];
+    endian_store16(to, (optionDelta-269));
+    pos += 2;
   }
 
   // set the option value length bytes
   if(optionValueLength<13) {
-    _pdu[headerStart] |= (optionValueLength & 0x000F);
+    header |= (optionValueLength & 0x000F);
   }
   else if(optionValueLength<269) {
-    _pdu[headerStart] |= 0x0D; // 13 in second nibble
-    _pdu[++insertionPosition] &= 0x00;
-    _pdu[insertionPosition] |= (optionValueLength-13);
+    header |= 0x0D; // 13 in second nibble
+    out[pos++] = (optionValueLength-13);
   }
   else {
-    _pdu[headerStart] |= 0x0E; // 14 in second nibble
-    // this is in network byte order
-    coap_log.concatf("optionValueLength: %u\n",optionValueLength);
-    uint8_t *to = &_pdu[insertionPosition];
-    optionValueLength -= 269;
-    endian_store16(to, optionValueLength);
-    insertionPosition += 2;
+    header |= 0x0E; // 14 in second nibble
+    uint8_t *to = &out[pos];
+    endian_store16(to, (optionValueLength-269));
+    pos += 2;
   }
+  out[0] = header;
 
   // and finally copy the option value itself
-  memcpy(&_pdu[++insertionPosition],optionValue,optionValueLength);
-  Kernel::log(&coap_log);
-  return 0;
+  if(optionValueLength>0) {
+    memcpy(&out[pos],optionValue,optionValueLength);
+  }
+  return pos+optionValueLength;
 }
 
 // DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG DEBUG
@@ -1697,17 +1570,40 @@ void CoAPMessage::printOptionHuman(uint8_t *option) {
 *            or -1 if something went wrong.
 */
 int CoAPMessage::serialize(StringBuilder* buffer) {
-  return 0;
+  if(0!=packOptions()) {
+    return -1;
+  }
+  buffer->concat(_pdu, _pduLength);
+  return _pduLength;
 }
 
 
 /**
 * This function should be called by the session to feed bytes to a message.
+* CoAP over UDP has one PDU per datagram, so the bytes are taken as a whole PDU,
+*   replacing whatever the message held. The buffer is reused if it is large enough.
 *
 * @return  The number of bytes consumed, or a negative value on failure.
 */
 int CoAPMessage::accumulate(unsigned char* _buf, int _len) {
-  return 0;
+  if((nullptr == _buf) || (COAP_HDR_SIZE > _len)) {
+    return -1;
+  }
+  _staged_count   = 0;
+  _arena_len      = 0;
+  _options_dirty  = false;
+  _numOptions     = 0;
+  _payloadPointer = nullptr;
+  _payloadLength  = 0;
+  if(_buf != _pdu) {
+    _pduLength = 0;   // Nothing in the buffer is worth keeping.
+    if(!reservePDU(_len)) {
+      return -1;
+    }
+    memcpy(_pdu, _buf, _len);
+  }
+  _pduLength = _len;
+  return (1 == validate()) ? _len : -1;
 }
 
 /**
@@ -1716,6 +1612,7 @@ int CoAPMessage::accumulate(unsigned char* _buf, int _len) {
 * @param   StringBuilder* The buffer into which this fxn should write its output.
 */
 void CoAPMessage::printDebug(StringBuilder *output) {
+  packOptions();
   XenoMessage::printDebug(output);
   if(_constructedFromBuffer) {
     output->concatf("\t PDU was constructed from buffer of %d bytes\n",_bufferLength);
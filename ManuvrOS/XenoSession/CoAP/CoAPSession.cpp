@@ -123,18 +123,21 @@ int8_t CoAPSession::fromCounterparty(StringBuilder* buf, int8_t mm) {
 * @return  int8_t  // TODO!!!
 */
 int8_t CoAPSession::bin_stream_rx(unsigned char *buf, int len) {
-  local_log.concatf("CoAPSession::bin_stream_rx(%p, %d): ", buf, len);
-  CoAPMessage *recvPDU = new CoAPMessage(buf, len, len);
-  if(recvPDU->validate()!=1) {
-    local_log.concat("Malformed CoAP packet\n");
+  // Each datagram is a whole PDU, so one message object serves for all of them.
+  if (nullptr == working) {
+    working = new CoAPMessage();
+  }
+  if (0 > working->accumulate(buf, len)) {
+    if (getVerbosity() > 3) {
+      local_log.concatf("CoAPSession::bin_stream_rx(%p, %d): Malformed CoAP packet\n", buf, len);
+      Kernel::log(&local_log);
+    }
     return 0;
   }
-  recvPDU->printDebug(&local_log);
-
-  for (int x = 0; x < len; x++) local_log.concatf("%02x ", *(buf+x));
-
-  local_log.concat("\n");
-  Kernel::log(&local_log);
+  if (getVerbosity() > 5) {
+    working->printDebug(&local_log);
+    Kernel::log(&local_log);
+  }
   return 1;
 }
 
@@ -286,7 +289,7 @@ void CoAPSession::printDebug(StringBuilder *output) {
   output->concatf("-- Next Packet ID       0x%08x\n", (uint32_t) _next_packetid);
 
   if (nullptr != working) {
-    output->concat("--\n-- Incomplete inbound message:\n");
+    output->concat("--\n-- Last inbound message:\n");
     working->printDebug(output);
   }
 }
@@ -37,24 +37,44 @@ The message class was derived from cantcoap.
 #define COAP_HDR_SIZE            4
 #define COAP_OPTION_HDR_BYTE     1
 
+// Messages build their PDUs in fixed-size buffers, taken from a slab that grows
+//   by this many buffers at a time, up to the given number of chunks. A PDU that
+//   outgrows its buffer (or finds the slab empty) is moved to the heap.
+#ifndef COAP_PDU_BUFFER_SIZE
+  #define COAP_PDU_BUFFER_SIZE     256
+#endif
+#ifndef COAP_PDU_SLAB_CHUNK
+  #define COAP_PDU_SLAB_CHUNK        8
+#endif
+#ifndef COAP_PDU_SLAB_MAX_CHUNKS
+  #define COAP_PDU_SLAB_MAX_CHUNKS   4
+#endif
+
+// How many options may a message carry?
+#ifndef COAP_MAX_OPTIONS
+  #define COAP_MAX_OPTIONS          16
+#endif
+
+// Option values of up to this many bytes (in total) are held in the message
+//   itself until the PDU is packed. Beyond this, they are held on the heap.
+#ifndef COAP_OPTION_ARENA_BYTES
+  #define COAP_OPTION_ARENA_BYTES   64
+#endif
+
 #if (__BYTE_ORDER == __LITTLE_ENDIAN__) || (__BYTE_ORDER == __ORDER_LITTLE_ENDIAN__)
   inline uint16_t endian_be16(uint16_t val) {
     return (((val & 0xFF00) >> 8) | ((val & 0x00FF) << 8));
   };
-
-  #define endian_load16(cast, from) ((cast)( \
-    (((uint16_t)((uint8_t*)(from))[0]) >> 8) | \
-    (((uint16_t)((uint8_t*)(from))[1])     ) ))
 #elif (__BYTE_ORDER == __BIG_ENDIAN__) || (__BYTE_ORDER == __ORDER_BIG_ENDIAN__)
   inline uint16_t endian_be16(uint16_t val) {
     return val;
   };
-
-  #define endian_load16(cast, from) ((cast)( \
-    (((uint16_t)((uint8_t*)(from))[0]) << 8) | \
-    (((uint16_t)((uint8_t*)(from))[1])     ) ))
 #endif  // __BYTE_ORDER
 
+// Loads a network-order 16-bit value. This is the same on any host.
+#define endian_load16(cast, from) ((cast)( \
+  (((uint16_t)((uint8_t*)(from))[0]) << 8) | \
+  (((uint16_t)((uint8_t*)(from))[1])     ) ))
 
 #define endian_store16(to, num) \
   do { uint16_t val = endian_be16(num); memcpy(to, &val, 2); } while(0);
@@ -86,7 +106,7 @@ class CoAPMessage : public XenoMessage {
     // Called to accumulate data into the class.
     // Returns -1 on failure, or the number of bytes consumed on success.
     int serialize(StringBuilder*);       // Returns the number of bytes resulting.
-    int accumulate(unsigned char*, int);
+    int accumulate(unsigned char*, int); // Takes a whole datagram.
 
     int decompose_publish();
 
@@ -206,6 +226,9 @@ class CoAPMessage : public XenoMessage {
     /* Return the number of options in the message. */
     inline int getNumOptions() {      return _numOptions;    };
 
+    /* Sorts and writes any options added since the last call. Readers of the PDU call this. */
+    int packOptions();
+
 
     inline int setURI(char *uri) {
       return setURI(uri, strlen(uri));
@@ -230,7 +253,7 @@ class CoAPMessage : public XenoMessage {
     uint8_t* mallocPayload(int bytes);
     int setPayload(uint8_t *value, int len);
 
-    inline uint8_t* getPayloadPointer() {  return _payloadPointer; };
+    inline uint8_t* getPayloadPointer() {  packOptions();  return _payloadPointer; };
     inline int getPayloadLength() {        return _payloadLength;  };
     uint8_t* getPayloadCopy();
 
@@ -241,8 +264,8 @@ class CoAPMessage : public XenoMessage {
     */
     inline void setPDULength(int len) { _pduLength = len;   };
     // pdu buffer accessors.
-    inline uint16_t getPDULength() {    return _pduLength;  };
-    inline uint8_t* getPDUPointer() {   return _pdu;        };
+    inline uint16_t getPDULength() {    packOptions();  return _pduLength;  };
+    inline uint8_t* getPDUPointer() {   packOptions();  return _pdu;        };
 
     // debugging
     void printOptionHuman(uint8_t *option);
@@ -254,6 +277,16 @@ class CoAPMessage : public XenoMessage {
 
 
   private:
+    /*
+    * Options are held aside as they are added, and written to the PDU (in order)
+    *   when it is next read. Their values are kept in the option arena.
+    */
+    typedef struct {
+      uint16_t number;
+      uint16_t length;
+      uint16_t offset;     // Where the value is in the option arena.
+    } StagedOption;
+
     StringBuilder coap_log;   // TODO: Make local variable.
 
     // TODO: These members were digested from cantcoap...
@@ -266,16 +299,23 @@ class CoAPMessage : public XenoMessage {
     int _numOptions;
     uint16_t _maxAddedOptionNumber;
 
-    void shiftPDUUp(int shiftOffset, int shiftAmount);
-    void shiftPDUDown(int startLocation, int shiftOffset, int shiftAmount);
+    StagedOption _staged[COAP_MAX_OPTIONS];
+    uint8_t      _arena_inline[COAP_OPTION_ARENA_BYTES];
+    uint8_t*     _arena         = _arena_inline;  // Unless it was outgrown.
+    uint16_t     _arena_len     = 0;
+    uint16_t     _arena_cap     = COAP_OPTION_ARENA_BYTES;
+    uint8_t      _staged_count  = 0;      // Zero means the PDU is authoritative for options.
+    bool         _options_dirty = false;  // Staged options have not been written to the PDU.
+
+    bool reservePDU(int len);
+    bool reserveArena(int len);
+    int  stageExistingOptions();
     uint8_t codeToValue(CoAPMessage::Code c);
 
     // option stuff
-    int findInsertionPosition(uint16_t optionNumber, uint16_t *prevOptionNumber);
     int computeExtraBytes(uint16_t n);
-    int insertOption(int insertionPosition, uint16_t optionDelta, uint16_t optionValueLength, uint8_t *optionValue);
+    int encodeOption(uint8_t* out, uint16_t optionDelta, uint16_t optionValueLength, uint8_t *optionValue);
     uint16_t getOptionDelta(uint8_t *option);
-    void setOptionDelta(int optionPosition, uint16_t optionDelta);
     uint16_t getOptionValueLength(uint8_t *option);
 };
 
@@ -62,7 +62,8 @@ MQTTOpts opts = {
 *
 * @param   ManuvrXport* All sessions must have one (and only one) transport.
 */
-MQTTSession::MQTTSession(ManuvrXport* _xport) : XenoSession("MQTTSession", _xport) {
+MQTTSession::MQTTSession(ManuvrXport* _xport) : XenoSession("MQTTSession", _xport),
+  _msg_slab(sizeof(MQTTMessage), MQTT_MSG_SLAB_CHUNK, MQTT_MSG_SLAB_MAX_CHUNKS) {
   _ping_outstanding(false);
   working   = NULL;
   _next_packetid = 1;
@@ -74,6 +75,16 @@ MQTTSession::MQTTSession(ManuvrXport* _xport) : XenoSession("MQTTSession", _xpor
   _ping_timer.alterSchedulePeriod(4000);
   _ping_timer.autoClear(false);
   _ping_timer.enableSchedule(false);
+
+  _retry_timer.repurpose(MANUVR_MSG_SESS_ORIGINATE_MSG, (EventReceiver*) this);
+  _retry_timer.incRefs();
+  _retry_timer.specific_target = (EventReceiver*) this;
+  _retry_timer.alterScheduleRecurrence(-1);
+  _retry_timer.alterSchedulePeriod(MQTT_RETRY_PERIOD_MS / 2);
+  _retry_timer.autoClear(false);
+  _retry_timer.enableSchedule(false);   // Only runs while something is in flight.
+
+  memset(_inflight, 0, sizeof(_inflight));
 }
 
 
@@ -83,14 +94,55 @@ MQTTSession::MQTTSession(ManuvrXport* _xport) : XenoSession("MQTTSession", _xpor
 MQTTSession::~MQTTSession() {
   _ping_timer.enableSchedule(false);
   platform.kernel()->removeSchedule(&_ping_timer);
+  _retry_timer.enableSchedule(false);
+  platform.kernel()->removeSchedule(&_retry_timer);
 
   if (NULL != working) {
-    delete working;
+    _msg_give(working);
     working = NULL;
   }
   unsubscribeAll();
   while (_pending_mqtt_messages.hasNext()) {
-    delete _pending_mqtt_messages.dequeue();
+    _msg_give(_pending_mqtt_messages.dequeue());
+  }
+  while (_qos2_held.hasNext()) {
+    _msg_give(_qos2_held.dequeue());
+  }
+  for (int i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if (_inflight[i].packet) free(_inflight[i].packet);
+  }
+  while (_backlog.hasNext()) {
+    MQTTInflight* rec = _backlog.dequeue();
+    if (rec->packet) free(rec->packet);
+    free(rec);
+  }
+  if (_scratch) free(_scratch);
+}
+
+
+/**
+* Allocates an inbound message. From the slab if possible, and the heap if not.
+*
+* @return A freshly-constructed message, or nullptr if we are out of memory.
+*/
+MQTTMessage* MQTTSession::_msg_take() {
+  void* mem = _msg_slab.take();
+  return ((nullptr != mem) ? new (mem) MQTTMessage() : new MQTTMessage());
+}
+
+
+/**
+* Destroys an inbound message, and frees its memory to wherever it came from.
+*
+* @param  obj  The message to free.
+*/
+void MQTTSession::_msg_give(MQTTMessage* obj) {
+  if (_msg_slab.contains(obj)) {
+    obj->~MQTTMessage();
+    _msg_slab.give(obj);
+  }
+  else {
+    delete obj;
   }
 }
 
@@ -119,35 +171,28 @@ int8_t MQTTSession::fromCounterparty(StringBuilder* buf, int8_t mm) {
 /****************************************************************************************************
 * Subscription management.                                                                          *
 ****************************************************************************************************/
-int8_t MQTTSession::subscribe(const char* topic, ManuvrMsg* runnable) {
-  std::map<const char*, ManuvrMsg*>::iterator it = _subscriptions.find(topic);
-  if (_subscriptions.end() == it) {
-    // If the list doesn't already have the topic....
-    runnable->setOriginator((EventReceiver*)this);
-    _subscriptions[topic] = runnable;
-    return sendSub(topic, QOS1);   // TODO: make dynamic
+int8_t MQTTSession::subscribe(const char* topic, ManuvrMsg* runnable, enum QoS qos) {
+  if (nullptr == _subscriptions.find(topic)) {
+    // If the trie doesn't already have the topic....
+    if (0 == _subscriptions.insert(topic, runnable, qos)) {
+      runnable->setOriginator((EventReceiver*)this);
+      return sendSub(topic, qos);
+    }
   }
   return -1;
 }
 
 
 int8_t MQTTSession::unsubscribe(const char* topic) {
-  std::map<const char*, ManuvrMsg*>::iterator it = _subscriptions.find(topic);
-  if (_subscriptions.end() != it) {
-    // TODO: We need to clean up the runnable. For now, we'll assume it is handled elsewhere.
-    // delete it->second;
-    _subscriptions.erase(topic);
-    return 0;
-  }
-  return -1;
+  // TODO: We need to clean up the runnable. For now, we'll assume it is handled elsewhere.
+  return (nullptr != _subscriptions.remove(topic)) ? 0 : -1;
 }
 
 
 int8_t MQTTSession::resubscribeAll() {
   if (isEstablished()) {
-    std::map<const char*, ManuvrMsg*>::iterator it;
-    for (it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
-      if (!sendSub(it->first, QOS1)) {   // TODO: Make QoS dynmaic.
+    for (uint32_t i = 0; i < _subscriptions.size(); i++) {
+      if (!sendSub(_subscriptions.filter(i), (enum QoS) _subscriptions.qos(i))) {
         return -1;
       }
     }
@@ -157,10 +202,10 @@ int8_t MQTTSession::resubscribeAll() {
 
 int8_t MQTTSession::unsubscribeAll() {
   if (isEstablished()) {
-    std::map<const char*, ManuvrMsg*>::iterator it;
-    for (it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
-      if (sendUnsub(it->first)) {
-        _subscriptions.erase(it->first);
+    // Backward, because removal moves the last subscription into the hole.
+    for (int i = _subscriptions.size() - 1; i >= 0; i--) {
+      if (sendUnsub(_subscriptions.filter(i))) {
+        _subscriptions.remove(_subscriptions.filter(i));
       }
     }
   }
@@ -178,39 +223,68 @@ int8_t MQTTSession::unsubscribeAll() {
 /**
 * When we take bytes from the transport, and can't use them all right away,
 *   we store them to prepend to the next group of bytes that come through.
+* On the Kernel's thread, a QoS0 or QoS1 PUBLISH that arrives whole is
+*   delivered where it lies in the buffer, without being copied, so long as
+*   nothing is queued ahead of it.
+* Anything else is accumulated into an MQTTMessage and queued for the Kernel's
+*   thread: the remainder of a split packet, a QoS2 PUBLISH (which must be held
+*   until PUBREL), and everything that arrives on a transport's own thread,
+*   since the transport's buffer won't outlive this call.
 *
-* @param
-* @param
-* @return  int8_t  // TODO!!!
+* @param  buf  The bytes from the transport.
+* @param  len  How many bytes there are.
+* @return 0 on success, -1 on a malformed packet or memory failure.
 */
 int8_t MQTTSession::bin_stream_rx(unsigned char *buf, int len) {
-  int8_t return_value = 0;
-  if (len >= 1) {
+  const bool in_place = Kernel::onKernelThread();
+  while (len > 0) {
+    if ((NULL == working) && in_place && (PUBLISH == (*buf >> 4)) && (QOS2 != ((*buf >> 1) & 0x03))) {
+      _rx_lock();
+      const bool queue_empty = (0 == _pending_mqtt_messages.size());
+      _rx_unlock();
+      // Read the remaining length, which is encoded as a string of 7-bit ints.
+      int rem_len = 0;
+      int hdr_len = 1;
+      int multiplier = 1;
+      while ((hdr_len < len) && (hdr_len <= 4)) {
+        rem_len += (*(buf + hdr_len) & 127) * multiplier;
+        multiplier *= 128;
+        if (0 == (*(buf + hdr_len++) & 128)) {
+          multiplier = 0;   // Field completed.
+          break;
+        }
+      }
+      if (queue_empty && (0 == multiplier) && ((hdr_len + rem_len) <= len)) {
+        proc_publish(*buf, (uint8_t*) buf + hdr_len, rem_len);
+        buf += (hdr_len + rem_len);
+        len -= (hdr_len + rem_len);
+        continue;
+      }
+    }
     if (NULL == working) {
-      working = new MQTTMessage();
+      working = _msg_take();
+      if (NULL == working) {
+        return -1;
+      }
     }
 
     int _eaten = working->accumulate(buf, len);
     if (-1 == _eaten) {
-      delete working;
+      _msg_give(working);
       working = NULL;
-      return_value = -1;
+      return -1;
     }
-    else {
-      // These are success cases.
-      if (working->parseComplete()) {
-        _pending_mqtt_messages.insert(working);
-        requestService();     // Pitch an event to deal with the message.
-        working = NULL;
-
-        if (len - _eaten > 0) {
-          // We not only finished a message, but we are beginning another. Recurse.
-          return bin_stream_rx(buf + _eaten, len - _eaten);
-        }
-      }
+    buf += _eaten;
+    len -= _eaten;
+    if (working->parseComplete()) {
+      _rx_lock();
+      _pending_mqtt_messages.insert(working);
+      _rx_unlock();
+      requestService();     // Pitch an event to deal with the message.
+      working = NULL;
     }
   }
-  return return_value;
+  return 0;
 }
 
 
@@ -231,24 +305,142 @@ int8_t MQTTSession::connection_callback(bool _con) {
 * This is the point at which choices are made about what happens to the event's life-cycle.
 */
 int8_t MQTTSession::sendEvent(ManuvrMsg* active_event) {
-  //XenoMessage* nu_outbound_msg = XenoMessage::fetchPreallocation(this);
-  //nu_outbound_msg->provideEvent(active_event);
+  return (sendPublish(active_event) ? 0 : -1);
+}
 
-  //StringBuilder buf;
-  //if (nu_outbound_msg->serialize(&buf) > 0) {
-  //  owner->sendBuffer(&buf);
-  //}
 
-  //if (nu_outbound_msg->expectsACK()) {
-  //  _outbound_messages.insert(nu_outbound_msg);
-  //}
+/**
+* Makes sure that a packet buffer is at least the given size.
+*
+* @return true if the buffer is large enough. false if we ran out of memory.
+*/
+static bool _mqtt_buf_fit(uint8_t** buf, uint32_t* cap, uint32_t needed) {
+  if (*cap < needed) {
+    uint8_t* nu = (uint8_t*) realloc(*buf, needed);
+    if (nullptr == nu) {
+      return false;
+    }
+    *buf = nu;
+    *cap = needed;
+  }
+  return true;
+}
 
-  // We are about to pass a message across the transport.
-  //ManuvrMsg* event = Kernel::returnEvent(MANUVR_MSG_XPORT_SEND);
-  //event->originator      = this;   // We want the callback and the only receiver of this
-  //event->specific_target = owner;  //   event to be the transport that instantiated us.
-  //raiseEvent(event);
-  return 0;
+
+/**
+* Publishes a payload to the given topic. The packet is held briefly, so that
+*   it can share a transport write with others. Safe to call from any thread.
+* QoS1 and QoS2 publications occupy a place in the in-flight window until they
+*   are acknowledged, and are sent again if that takes too long. If the window
+*   is full, they wait their turn in the backlog.
+*
+* @param  topic    The topic to publish to.
+* @param  payload  The payload. It is copied.
+* @param  len      The length of the payload.
+* @param  qos      The quality-of-service for the publication.
+* @return true if the packet was queued. false if the session isn't established,
+*           the backlog is full, or we ran out of memory.
+*/
+bool MQTTSession::publish(const char* topic, uint8_t* payload, int len, enum QoS qos) {
+  if (!isEstablished() || (nullptr == topic)) {
+    return false;
+  }
+  // Fixed header (at most 5), topic length, topic, packet id, payload.
+  const uint32_t needed = 9 + strlen(topic) + len;
+  MQTTString _topic = MQTTString_initializer;
+  _topic.cstring = (char*) topic;
+  bool return_value = false;
+  bool must_flush   = false;
+
+  _if_lock();
+  if (QOS0 == qos) {
+    if (_mqtt_buf_fit(&_scratch, &_scratch_cap, needed)) {
+      int plen = MQTTSerialize_publish(_scratch, _scratch_cap, 0, qos, 0, 0, _topic, payload, len);
+      if (plen > 0) {
+        must_flush   = _hold_packet(_scratch, plen);
+        return_value = true;
+      }
+    }
+  }
+  else {
+    MQTTInflight* slot = nullptr;
+    if (!windowFull() && (0 == _backlog.size())) {
+      for (int i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+        if (MQTT_INFLIGHT_FREE == _inflight[i].state) {
+          slot = &_inflight[i];
+          break;
+        }
+      }
+    }
+    MQTTInflight* rec = slot;
+    if ((nullptr == rec) && (MQTT_MAX_BACKLOG > _backlog.size())) {
+      rec = (MQTTInflight*) calloc(1, sizeof(MQTTInflight));
+    }
+    if ((nullptr != rec) && _mqtt_buf_fit(&rec->packet, &rec->cap, needed)) {
+      const uint16_t _msg_id = (uint16_t) getNextPacketId();
+      int plen = MQTTSerialize_publish(rec->packet, rec->cap, 0, qos, 0, _msg_id, _topic, payload, len);
+      if (plen > 0) {
+        rec->len       = plen;
+        rec->packet_id = _msg_id;
+        rec->state     = (QOS1 == qos) ? MQTT_INFLIGHT_PUBACK : MQTT_INFLIGHT_PUBREC;
+        rec->retries   = 0;
+        if (nullptr != slot) {
+          must_flush = _inflight_send(slot);
+        }
+        else {
+          _backlog.insert(rec);
+          rec = nullptr;
+        }
+        return_value = true;
+      }
+    }
+    if ((nullptr != rec) && (rec != slot)) {
+      // A backlog record that didn't make it into the backlog.
+      if (rec->packet) free(rec->packet);
+      free(rec);
+    }
+  }
+  _if_unlock();
+  if (must_flush) {
+    flush();
+  }
+  return return_value;
+}
+
+
+/**
+* Writes every held packet to the transport, in one piece.
+*/
+void MQTTSession::flush() {
+  StringBuilder out;
+  _tx_lock();
+  if (0 < _tx_len) {
+    out.concatHandoff(&_tx_buf);
+    _tx_len = 0;
+  }
+  _tx_unlock();
+  if (0 < out.length()) {
+    _tx_writes++;
+    BufferPipe::toCounterparty(&out, MEM_MGMT_RESPONSIBLE_BEARER);
+  }
+}
+
+
+/**
+* Narrows (or widens) the in-flight window. Publications already in flight are
+*   unaffected.
+*
+* @param  n  How many QoS1/QoS2 publications may be unacknowledged at once.
+*              Clamped to [1, MQTT_MAX_INFLIGHT].
+*/
+void MQTTSession::maxInflight(uint8_t n) {
+  _if_lock();
+  _max_inflight = (n < 1) ? 1 : ((n > MQTT_MAX_INFLIGHT) ? MQTT_MAX_INFLIGHT : n);
+  const bool must_flush = _promote();
+  _if_unlock();
+  if (must_flush) {
+    flush();
+  }
 }
 
 
@@ -350,84 +542,293 @@ bool MQTTSession::sendDisconnectPacket() {
 
 
 bool MQTTSession::sendPublish(ManuvrMsg* _msg) {
-  if (isEstablished()) {
-    enum QoS _qos = _msg->demandsACK() ? QOS1 : QOS0;
-    int _msg_id = 0;
-    MQTTString topic = MQTTString_initializer;
-    topic.cstring = (char *)_msg->getMsgDef()->debug_label;
-
-    switch (_qos) {
-      case QOS0:
-        break;
-      case QOS1:
-      case QOS2:
-        _msg_id = getNextPacketId();
-        break;
+  StringBuilder payload;
+  if (0 > _msg->serialize(&payload)) {
+    return false;
+  }
+  return publish(
+    _msg->getMsgDef()->debug_label,
+    payload.string(),
+    payload.length(),
+    (_msg->demandsACK() ? QOS1 : QOS0)
+  );
+}
+
+
+/**
+* Queues one of the four-byte acknowledgement packets.
+*
+* @param  type       PUBACK, PUBREC, PUBREL, or PUBCOMP.
+* @param  packet_id  The packet being acknowledged.
+* @return true on success.
+*/
+bool MQTTSession::sendAck(uint8_t type, uint16_t packet_id) {
+  uint8_t buf[4];
+  int len = MQTTSerialize_ack(buf, sizeof(buf), type, 0, packet_id);
+  if (len > 0) {
+    _queue_packet(buf, len);
+    return true;
+  }
+  return false;
+}
+
+
+/**
+* Holds a packet for the next write to the transport. The first packet held
+*   asks for service, and the write happens then. A full buffer is written now.
+*
+* @param  buf  The packet. It is copied.
+* @param  len  Its length.
+*/
+void MQTTSession::_queue_packet(uint8_t* buf, int len) {
+  if (_hold_packet(buf, len)) {
+    flush();
+  }
+}
+
+
+/**
+* Holds a packet for the next write to the transport, but leaves the writing
+*   to the caller. For use while the window is locked.
+*
+* @param  buf  The packet. It is copied.
+* @param  len  Its length.
+* @return true if the caller should flush().
+*/
+bool MQTTSession::_hold_packet(uint8_t* buf, int len) {
+  _tx_lock();
+  const bool was_empty = (0 == _tx_len);
+  _tx_buf.concat(buf, len);
+  _tx_len += len;
+  _tx_packets++;
+  const bool full = (_tx_len >= MQTT_TX_COALESCE_BYTES);
+  _tx_unlock();
+  if (!full && was_empty) {
+    requestService();
+  }
+  return full;
+}
+
+
+/**
+* @return The in-flight record for the given packet id, or nullptr.
+*/
+MQTTInflight* MQTTSession::_inflight_find(uint16_t packet_id) {
+  for (int i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if ((MQTT_INFLIGHT_FREE != _inflight[i].state) && (packet_id == _inflight[i].packet_id)) {
+      return &_inflight[i];
     }
+  }
+  return nullptr;
+}
 
-    size_t buf_size     = 64;
-    unsigned char* buf  = (unsigned char*) alloca(buf_size);
 
-    int len = MQTTSerialize_publish(
-      buf, buf_size,
-      0,
-      _qos,
-      0, //message->retained,
-      _msg_id,
-      topic,
-      (unsigned char*) "TEST MESSAGE",         // message->payload,
-      strlen("TEST MESSAGE")  //message->payloadlen
-    );
+/**
+* Puts a packet that has just taken a place in the window on the wire.
+* Caller must hold the window lock.
+*
+* @return true if the caller should flush().
+*/
+bool MQTTSession::_inflight_send(MQTTInflight* slot) {
+  slot->sent_ms = millis();
+  if (0 == _inflight_count++) {
+    _retry_timer.enableSchedule(true);
+  }
+  return _hold_packet(slot->packet, slot->len);
+}
+
 
-    if (len > 0) {
-      return sendPacket(buf, len);
+/**
+* Frees a place in the window, and gives it to the backlog if anything is
+*   waiting. The packet buffer is kept for reuse.
+* Caller must hold the window lock.
+*
+* @return true if the caller should flush().
+*/
+bool MQTTSession::_inflight_release(MQTTInflight* slot) {
+  slot->state = MQTT_INFLIGHT_FREE;
+  _inflight_count--;
+  const bool return_value = _promote();
+  if (0 == _inflight_count) {
+    _retry_timer.enableSchedule(false);
+  }
+  return return_value;
+}
+
+
+/**
+* Moves publications from the backlog into the window, for as long as there
+*   is room. Caller must hold the window lock.
+*
+* @return true if the caller should flush().
+*/
+bool MQTTSession::_promote() {
+  bool return_value = false;
+  for (int i = 0; (i < MQTT_MAX_INFLIGHT) && !windowFull() && (0 < _backlog.size()); i++) {
+    MQTTInflight* slot = &_inflight[i];
+    if (MQTT_INFLIGHT_FREE == slot->state) {
+      MQTTInflight* rec = _backlog.dequeue();
+      // Trade buffers with the record, and free whichever one the slot had.
+      uint8_t* old_buf = slot->packet;
+      slot->packet     = rec->packet;
+      slot->cap        = rec->cap;
+      slot->len        = rec->len;
+      slot->packet_id  = rec->packet_id;
+      slot->state      = rec->state;
+      slot->retries    = 0;
+      if (old_buf) free(old_buf);
+      free(rec);
+      return_value |= _inflight_send(slot);
     }
   }
-  return false;
+  return return_value;
 }
 
 
-/*
+/**
+* Sends again anything that has waited too long for acknowledgement. Packets
+*   that have been tried too many times are abandoned.
 */
-int MQTTSession::proc_publish(MQTTMessage* nu) {
-  int return_value = nu->decompose_publish();
-
-  if (return_value >= 0) {
-    std::map<const char*, ManuvrMsg*>::iterator it = _subscriptions.find(nu->topic);
-    for (it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
-      if (0 == strcmp((const char*) nu->topic, it->first)) {
-        if (0 < nu->argumentBytes()) {
-          it->second->inflateArgumentsFromBuffer((uint8_t*) nu->payload, nu->argumentBytes());
-          //StringBuilder* _hack = new StringBuilder((uint8_t*) nu->payload, nu->argumentBytes());
-          //_hack->concat('\0');  // Yuck... No native null-term.
-          //_hack->string();  // Condense.
-          //it->second->markArgForReap(it->second->addArg(_hack), true);
-        }
-        //nu->printDebug(&local_log);
-        //local_log.concat("\n\n");
-        //it->second->printDebug(&local_log);
-        //Kernel::log(&local_log);
-
-        raiseEvent(it->second);
-        delete nu;  // TODO: Yuck. Nasty. No. Bad.
-        return 0;
+void MQTTSession::_retransmit() {
+  const uint32_t now = millis();
+  _if_lock();
+  for (int i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    MQTTInflight* slot = &_inflight[i];
+    if ((MQTT_INFLIGHT_FREE == slot->state) || ((now - slot->sent_ms) < _retry_ms)) {
+      continue;
+    }
+    if (MQTT_MAX_RETRIES <= slot->retries) {
+      if (getVerbosity() > 2) {
+        local_log.concatf("%s abandoned packet 0x%04x.\n", getReceiverName(), slot->packet_id);
       }
+      _abandoned++;
+      _inflight_release(slot);   // Anything promoted is flushed below.
+      continue;
+    }
+    if (MQTT_INFLIGHT_PUBCOMP != slot->state) {
+      *(slot->packet) |= 0x08;   // A PUBLISH sent again must be marked DUP.
     }
+    slot->retries++;
+    slot->sent_ms = now;
+    _retransmits++;
+    _hold_packet(slot->packet, slot->len);
+  }
+  _if_unlock();
+  flush();
+}
+
 
+/**
+* Delivers a PUBLISH to every subscription that matches its topic. The body is
+*   read in place, and the payload is inflated straight into each runnable.
+* Must be called from the Kernel's thread.
+*
+* @param  header  The fixed header byte of the packet.
+* @param  body    The packet, after the fixed header.
+* @param  len     The remaining length of the packet.
+* @return The number of subscriptions that were triggered, or -1 if none were.
+*/
+int MQTTSession::proc_publish(uint8_t header, uint8_t* body, int len) {
+  MQTTHeader _hdr;
+  _hdr.byte = header;
+  if ((nullptr == body) || (len < 2)) {
+    return -1;
+  }
+  const int _topic_len = (*(body) * 256) + *(body + 1);
+  const char* _topic   = (const char*) body + 2;
+  int offset = 2 + _topic_len;
+  if (QOS0 != _hdr.bits.qos) {
+    // Only QoS1 and QoS2 carry a packet id.
+    offset += 2;
+  }
+  if (offset > len) {
+    return -1;
+  }
+  if (QOS1 == _hdr.bits.qos) {
+    sendAck(PUBACK, (*(body + offset - 2) * 256) + *(body + offset - 1));
+  }
+  // QoS2 was acknowledged with PUBREC when it arrived. See _qos2_hold().
+
+  ManuvrMsg* runnables[MQTT_MAX_FANOUT];
+  int count = _subscriptions.match(_topic, _topic_len, runnables, MQTT_MAX_FANOUT);
+  if (count > MQTT_MAX_FANOUT) count = MQTT_MAX_FANOUT;
+  if (0 >= count) {
     if (getVerbosity() > 2) {
-      local_log.concatf("%s got a PUBLISH on a topc (%s) it wasn't expecting.\n", getReceiverName(), nu->topic);
+      local_log.concatf("%s got a PUBLISH on a topic (%.*s) it wasn't expecting.\n", getReceiverName(), _topic_len, _topic);
       Kernel::log(&local_log);
     }
+    return -1;
   }
-  return -1;
+  for (int i = 0; i < count; i++) {
+    if (offset < len) {
+      runnables[i]->inflateArgumentsFromBuffer(body + offset, len - offset);
+    }
+    raiseEvent(runnables[i]);
+  }
+  return count;
+}
+
+
+/**
+* Takes custody of an inbound QoS2 PUBLISH, and acknowledges it with PUBREC.
+*   It is delivered when the broker releases it with PUBREL. A PUBLISH that
+*   the broker sends again in the meantime is acknowledged, but not kept, so
+*   the message is delivered exactly once.
+*
+* @param  nu  The PUBLISH.
+* @return true if we kept the message. false if the caller should free it.
+*/
+bool MQTTSession::_qos2_hold(MQTTMessage* nu) {
+  uint8_t* body = (uint8_t*) nu->payload;
+  const int len = nu->argumentBytes();
+  if ((nullptr == body) || (len < 2)) {
+    return false;
+  }
+  const int offset = 2 + (*(body) * 256) + *(body + 1);
+  if ((offset + 2) > len) {
+    return false;
+  }
+  const uint16_t _id = (*(body + offset) * 256) + *(body + offset + 1);
+  for (int i = 0; i < _qos2_held.size(); i++) {
+    if (_id == _qos2_held.get(i)->unique_id) {
+      sendAck(PUBREC, _id);   // Our PUBREC was lost. We already have it.
+      return false;
+    }
+  }
+  if (MQTT_MAX_QOS2_HELD <= _qos2_held.size()) {
+    return false;   // Without a PUBREC, the broker will send it again.
+  }
+  nu->unique_id = _id;
+  _qos2_held.insert(nu);
+  sendAck(PUBREC, _id);
+  return true;
+}
+
+
+/**
+* @param  packet_id  The id given in a PUBREL.
+* @return The held PUBLISH with that id, which the caller now owns. nullptr if
+*           we have already delivered it.
+*/
+MQTTMessage* MQTTSession::_qos2_release(uint16_t packet_id) {
+  for (int i = 0; i < _qos2_held.size(); i++) {
+    MQTTMessage* held = _qos2_held.get(i);
+    if (packet_id == held->unique_id) {
+      _qos2_held.remove(held);
+      return held;
+    }
+  }
+  return nullptr;
 }
 
 
 int MQTTSession::process_inbound() {
-  if (0 == _pending_mqtt_messages.size()) {
+  _rx_lock();
+  MQTTMessage* nu = (0 < _pending_mqtt_messages.size()) ? _pending_mqtt_messages.dequeue() : nullptr;
+  _rx_unlock();
+  if (nullptr == nu) {
     return -1;
   }
-  MQTTMessage* nu = _pending_mqtt_messages.dequeue();
 
   unsigned short packet_type = nu->packetType();
   switch (packet_type) {
@@ -450,28 +851,78 @@ int MQTTSession::process_inbound() {
             break;
         }
       }
-      delete nu;
+      _msg_give(nu);
       return 1;
     case PUBACK:
-      // TODO: Mark outbound message as received.
+    case PUBREC:
+    case PUBREL:
+    case PUBCOMP:
+      if (nu->argumentBytes() >= 2) {
+        const uint16_t _id = (*((uint8_t*)nu->payload) * 256) + *((uint8_t*)nu->payload + 1);
+        if (PUBREL == packet_type) {
+          // The broker has released a QoS2 PUBLISH to us. Deliver it now.
+          MQTTMessage* held = _qos2_release(_id);
+          if (nullptr != held) {
+            proc_publish(held->headerByte(), (uint8_t*) held->payload, held->argumentBytes());
+            _msg_give(held);
+          }
+          sendAck(PUBCOMP, _id);
+          break;
+        }
+        bool must_flush = false;
+        _if_lock();
+        MQTTInflight* slot = _inflight_find(_id);
+        switch (packet_type) {
+          case PUBACK:
+            if (slot && (MQTT_INFLIGHT_PUBACK == slot->state)) must_flush = _inflight_release(slot);
+            break;
+          case PUBREC:
+            if (slot && (MQTT_INFLIGHT_PUBREC == slot->state)) {
+              // The PUBLISH is delivered. From now on, we retransmit the PUBREL.
+              slot->len     = MQTTSerialize_ack(slot->packet, slot->cap, PUBREL, 0, _id);
+              slot->state   = MQTT_INFLIGHT_PUBCOMP;
+              slot->retries = 0;
+              slot->sent_ms = millis();
+            }
+            break;
+          case PUBCOMP:
+            if (slot && (MQTT_INFLIGHT_PUBCOMP == slot->state)) must_flush = _inflight_release(slot);
+            break;
+        }
+        _if_unlock();
+        if (PUBREC == packet_type) {
+          sendAck(PUBREL, _id);
+        }
+        if (must_flush) {
+          flush();
+        }
+      }
       break;
     case SUBACK:
       // TODO: Only NOW should we insert into the subscription queue.
+      if ((nu->argumentBytes() >= 3) && (0x80 == *((uint8_t*)nu->payload + 2))) {
+        local_log.concatf("%s had a subscription refused.\n", getReceiverName());
+        Kernel::log(&local_log);
+      }
       break;
     case PUBLISH:
-      proc_publish(nu);
+      if (QOS2 == ((nu->headerByte() >> 1) & 0x03)) {
+        if (_qos2_hold(nu)) {
+          return 0;   // Kept until PUBREL.
+        }
+      }
+      else {
+        proc_publish(nu->headerByte(), (uint8_t*) nu->payload, nu->argumentBytes());
+      }
       break;
 
-    case PUBCOMP:
-      break;
     case PINGRESP:
       _ping_outstanding(false);
       break;
     default:
       break;
   }
-
-
+  _msg_give(nu);
   return 0;
 }
 
@@ -498,6 +949,7 @@ int MQTTSession::process_inbound() {
 int8_t MQTTSession::attached() {
   if (EventReceiver::attached()) {
     platform.kernel()->addSchedule(&_ping_timer);
+    platform.kernel()->addSchedule(&_retry_timer);
     //if (owner->connected()) {
     //  // Are we connected right now?
     //  sendConnectPacket();
@@ -560,10 +1012,12 @@ int8_t MQTTSession::notify(ManuvrMsg* active_event) {
       break;
 
     case MANUVR_MSG_SESS_SERVICE:
-      if (_pending_mqtt_messages.size() > 0) {
-        process_inbound();
+      // Service requests for a message already queued are dropped, so take
+      //   everything that is pending.
+      while (-1 != process_inbound()) {
         return_value++;
       }
+      flush();
       break;
 
     case MANUVR_MSG_SESS_HANGUP:
@@ -578,7 +1032,12 @@ int8_t MQTTSession::notify(ManuvrMsg* active_event) {
       break;
 
     case MANUVR_MSG_SESS_ORIGINATE_MSG:
-      sendKeepAlive();
+      if (active_event == &_retry_timer) {
+        _retransmit();
+      }
+      else {
+        sendKeepAlive();
+      }
       return_value++;
       break;
 
@@ -662,12 +1121,16 @@ void MQTTSession::procDirectDebugInstruction(StringBuilder *input) {
 void MQTTSession::printDebug(StringBuilder *output) {
   XenoSession::printDebug(output);
   output->concatf("-- Next Packet ID       0x%08x\n", (uint32_t) _next_packetid);
+  output->concatf("-- In flight            %u / %u\n", _inflight_count, _max_inflight);
+  output->concatf("-- Backlog              %d\n", _backlog.size());
+  output->concatf("-- QoS2 awaiting PUBREL %d\n", _qos2_held.size());
+  output->concatf("-- Packets/writes       %u / %u\n", (unsigned long) _tx_packets, (unsigned long) _tx_writes);
+  output->concatf("-- Retransmits          %u (%u abandoned)\n", (unsigned long) _retransmits, (unsigned long) _abandoned);
   if (_ping_outstanding()) output->concat("-- EXPIRED PING\n");
   output->concat("-- Subscribed topics\n");
 
-  std::map<const char*, ManuvrMsg*>::iterator it;
-  for (it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
-    output->concatf("--\t%s\t~~~~> %s\n", it->first, it->second->getMsgDef()->debug_label);
+  for (uint32_t i = 0; i < _subscriptions.size(); i++) {
+    output->concatf("--\t%s\t~~~~> %s\n", _subscriptions.filter(i), _subscriptions.runnable(i)->getMsgDef()->debug_label);
   }
 
   if (NULL != working) {
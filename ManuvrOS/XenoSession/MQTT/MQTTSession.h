@@ -25,11 +25,58 @@ This class originated from IBM's C-client demo code, but was re-written into
 #define __XENOSESSION_MQTT_H__
 
 #include "../XenoSession.h"
+#include "MQTTTopicTrie.h"
 
 #include <paho.mqtt.embedded-c/MQTTPacket.h>
 
 #define MAX_PACKET_ID 65535
 
+// How many subscriptions may a single PUBLISH trigger?
+#ifndef MQTT_MAX_FANOUT
+  #define MQTT_MAX_FANOUT 8
+#endif
+
+// Inbound MQTTMessages come from a slab that grows by this many at a time, up
+//   to the given number of chunks. Beyond that, they come from the heap.
+#ifndef MQTT_MSG_SLAB_CHUNK
+  #define MQTT_MSG_SLAB_CHUNK 4
+#endif
+#ifndef MQTT_MSG_SLAB_MAX_CHUNKS
+  #define MQTT_MSG_SLAB_MAX_CHUNKS 4
+#endif
+
+// How many outbound QoS1/QoS2 PUBLISHes may await acknowledgement at once?
+//   This is the ceiling. The window can be narrowed at runtime.
+#ifndef MQTT_MAX_INFLIGHT
+  #define MQTT_MAX_INFLIGHT 16
+#endif
+
+// How many QoS1/QoS2 publications may wait for a place in the window? Beyond
+//   this, publish() refuses.
+#ifndef MQTT_MAX_BACKLOG
+  #define MQTT_MAX_BACKLOG 32
+#endif
+
+// How many inbound QoS2 PUBLISHes may await PUBREL at once?
+#ifndef MQTT_MAX_QOS2_HELD
+  #define MQTT_MAX_QOS2_HELD 8
+#endif
+
+// How long do we wait for an acknowledgement before sending a packet again, and
+//   how many times will we try before giving up on it?
+#ifndef MQTT_RETRY_PERIOD_MS
+  #define MQTT_RETRY_PERIOD_MS 2000
+#endif
+#ifndef MQTT_MAX_RETRIES
+  #define MQTT_MAX_RETRIES 4
+#endif
+
+// Outbound packets are held, and written to the transport together when the
+//   session is next serviced, or when this many bytes have accumulated.
+#ifndef MQTT_TX_COALESCE_BYTES
+  #define MQTT_TX_COALESCE_BYTES 1024
+#endif
+
 /*
 * These state flags are hosted by the EventReceiver. This may change in the future.
 * Might be too much convention surrounding their assignment across inherritence.
@@ -39,6 +86,26 @@ This class originated from IBM's C-client demo code, but was re-written into
 
 enum QoS { QOS0, QOS1, QOS2 };
 
+/* What an in-flight PUBLISH is waiting on. */
+#define MQTT_INFLIGHT_FREE     0x00
+#define MQTT_INFLIGHT_PUBACK   0x01   // QoS1
+#define MQTT_INFLIGHT_PUBREC   0x02   // QoS2, first half.
+#define MQTT_INFLIGHT_PUBCOMP  0x03   // QoS2, second half. The packet is now a PUBREL.
+
+/*
+* An outbound packet that awaits acknowledgement. We keep our own copy of it
+*   for retransmission. The buffer is kept when the slot is freed, and reused.
+*/
+typedef struct {
+  uint8_t* packet;
+  uint32_t cap;         // Size of the packet buffer.
+  uint32_t len;         // Length of the packet.
+  uint32_t sent_ms;     // When was it last sent?
+  uint16_t packet_id;
+  uint8_t  state;
+  uint8_t  retries;
+} MQTTInflight;
+
 
 class MQTTMessage : public XenoMessage {
   public:
@@ -46,7 +113,6 @@ class MQTTMessage : public XenoMessage {
     char retained;
     char dup;
     uint16_t unique_id;
-    char* topic;
     void *payload;
 
     MQTTMessage();
@@ -59,9 +125,8 @@ class MQTTMessage : public XenoMessage {
     int serialize(StringBuilder*);       // Returns the number of bytes resulting.
     int accumulate(unsigned char*, int);
 
-    int decompose_publish();
-
     inline uint16_t packetType() {  return _header.bits.type; };
+    inline uint8_t  headerByte() {  return _header.byte;      };
     inline bool parseComplete() {   return (_parse_stage > 2); };
 
 
@@ -91,8 +156,18 @@ class MQTTSession : public XenoSession {
 
     int8_t sendEvent(ManuvrMsg*);
 
+    /* Publication... */
+    bool publish(const char* topic, uint8_t* payload, int len, enum QoS);
+    void flush();
+    void maxInflight(uint8_t);
+    inline uint8_t  maxInflight() {   return _max_inflight;                      };
+    inline uint8_t  inflight() {      return _inflight_count;                    };
+    inline int      backlog() {       return _backlog.size();                    };
+    inline bool     windowFull() {    return (_inflight_count >= _max_inflight); };
+    inline void     retryPeriod(uint32_t ms) {  _retry_ms = ms;  _retry_timer.alterSchedulePeriod((ms > 1) ? (ms / 2) : 1);  };
+
     /* Management of subscriptions... */
-    int8_t subscribe(const char*, ManuvrMsg*);  // Start getting broadcasts about a given message type.
+    int8_t subscribe(const char*, ManuvrMsg*, enum QoS qos = QOS1);  // Start getting broadcasts about a given message type.
     int8_t unsubscribe(const char*);                 // Stop getting broadcasts about a given message type.
     int8_t resubscribeAll();
     int8_t unsubscribeAll();
@@ -116,9 +191,31 @@ class MQTTSession : public XenoSession {
   private:
     MQTTMessage* working;
 
-    std::map<const char*, ManuvrMsg*> _subscriptions;   // Topics we are subscribed to, and the events they trigger.
-    PriorityQueue<MQTTMessage*> _pending_mqtt_messages;      // Valid MQTT messages that have arrived.
+    MQTTTopicTrie _subscriptions;                        // Topics we are subscribed to, and the events they trigger.
+    PriorityQueue<MQTTMessage*> _pending_mqtt_messages;  // Valid MQTT messages that have arrived.
+    PriorityQueue<MQTTMessage*> _qos2_held;              // QoS2 PUBLISHes that await PUBREL.
+    Slab _msg_slab;                                      // Inbound MQTTMessages come from here.
     ManuvrMsg _ping_timer;    // Periodic KA ping.
+    ManuvrMsg _retry_timer;   // Retransmission of unacknowledged packets.
+
+    MQTTInflight _inflight[MQTT_MAX_INFLIGHT];
+    PriorityQueue<MQTTInflight*> _backlog;   // Publications waiting for a place in the window.
+    uint8_t      _inflight_count = 0;
+    uint8_t      _if_locked      = 0;   // Guards the window, the backlog, and _scratch.
+    uint8_t      _max_inflight   = MQTT_MAX_INFLIGHT;
+    uint32_t     _retry_ms       = MQTT_RETRY_PERIOD_MS;
+
+    StringBuilder _tx_buf;          // Outbound packets, held for coalescing.
+    uint32_t      _tx_len    = 0;
+    uint8_t       _tx_locked = 0;   // Held packets are flushed from more than one thread.
+    uint8_t       _rx_locked = 0;   // Guards _pending_mqtt_messages against the transport's thread.
+    uint8_t*      _scratch     = nullptr;   // Serialization space for QoS0.
+    uint32_t      _scratch_cap = 0;
+
+    uint32_t _tx_packets  = 0;
+    uint32_t _tx_writes   = 0;
+    uint32_t _retransmits = 0;
+    uint32_t _abandoned   = 0;
 
     unsigned int _next_packetid;
     unsigned int command_timeout_ms;
@@ -129,6 +226,7 @@ class MQTTSession : public XenoSession {
     inline void _ping_outstanding(bool nu) { return (_er_set_flag(MQTT_SESS_FLAG_PING_WAIT, nu)); };
 
     inline bool sendPacket(uint8_t* buf, int len) {
+      flush();   // Anything we were holding must go first.
       return (MEM_MGMT_RESPONSIBLE_BEARER == BufferPipe::toCounterparty(buf, len, MEM_MGMT_RESPONSIBLE_BEARER));
     };
     inline int getNextPacketId() {
@@ -141,9 +239,30 @@ class MQTTSession : public XenoSession {
     bool sendConnectPacket();
     bool sendDisconnectPacket();
     bool sendPublish(ManuvrMsg*);
-
-    int proc_publish(MQTTMessage*);
-    int process_inbound();
+    bool sendAck(uint8_t type, uint16_t packet_id);
+
+    int  proc_publish(uint8_t header, uint8_t* body, int len);
+    int  process_inbound();
+    bool _qos2_hold(MQTTMessage*);
+    MQTTMessage* _qos2_release(uint16_t packet_id);
+
+    MQTTMessage* _msg_take();
+    void         _msg_give(MQTTMessage*);
+
+    void          _queue_packet(uint8_t* buf, int len);
+    bool          _hold_packet(uint8_t* buf, int len);
+    MQTTInflight* _inflight_find(uint16_t packet_id);
+    bool          _inflight_send(MQTTInflight*);
+    bool          _inflight_release(MQTTInflight*);
+    bool          _promote();
+    void          _retransmit();
+
+    inline void _tx_lock() {     while (__atomic_test_and_set(&_tx_locked, __ATOMIC_ACQUIRE)) {}  };
+    inline void _tx_unlock() {   __atomic_clear(&_tx_locked, __ATOMIC_RELEASE);                  };
+    inline void _rx_lock() {     while (__atomic_test_and_set(&_rx_locked, __ATOMIC_ACQUIRE)) {}  };
+    inline void _rx_unlock() {   __atomic_clear(&_rx_locked, __ATOMIC_RELEASE);                  };
+    inline void _if_lock() {     while (__atomic_test_and_set(&_if_locked, __ATOMIC_ACQUIRE)) {}  };
+    inline void _if_unlock() {   __atomic_clear(&_if_locked, __ATOMIC_RELEASE);                  };
 
 };
 
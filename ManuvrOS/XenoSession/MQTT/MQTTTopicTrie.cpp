@@ -0,0 +1,481 @@
+/*
+File:   MQTTTopicTrie.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+
+#if defined (MANUVR_SUPPORT_MQTT)
+
+#include "MQTTTopicTrie.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* FNV-1a, over a single level of a topic. */
+static uint32_t _level_hash(const char* level, uint16_t len) {
+  uint32_t h = 2166136261u;
+  for (uint16_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t) level[i]) * 16777619u;
+  }
+  return h;
+}
+
+
+/*******************************************************************************
+*   ___ _              ___      _ _              _      _
+*  / __| |__ _ ______ | _ ) ___(_) |___ _ _ _ __| |__ _| |_ ___
+* | (__| / _` (_-<_-< | _ \/ _ \ | / -_) '_| '_ \ / _` |  _/ -_)
+*  \___|_\__,_/__/__/ |___/\___/_|_\___|_| | .__/_\__,_|\__\___|
+*                                          |_|
+* Constructors/destructors, class initialization functions and so-forth...
+*******************************************************************************/
+
+/**
+* Constructor. The trie allocates nothing until the first insertion.
+*/
+MQTTTopicTrie::MQTTTopicTrie() {
+}
+
+/**
+* Destructor. The runnables are not ours, and are left alone.
+*/
+MQTTTopicTrie::~MQTTTopicTrie() {
+  clear();
+}
+
+
+/**
+* Drops every subscription, and frees all of our memory.
+*/
+void MQTTTopicTrie::clear() {
+  for (uint32_t i = 1; i < _node_count; i++) {
+    if (_nodes[i].level) free(_nodes[i].level);
+  }
+  for (uint32_t i = 0; i < _sub_count; i++) {
+    free(_subs[i].filter);
+  }
+  if (_nodes) free(_nodes);
+  if (_edges) free(_edges);
+  if (_subs)  free(_subs);
+  _nodes      = nullptr;
+  _edges      = nullptr;
+  _subs       = nullptr;
+  _node_count = 0;
+  _node_cap   = 0;
+  _free_node  = 0;
+  _edge_mask  = 0;
+  _edge_count = 0;
+  _sub_count  = 0;
+  _sub_cap    = 0;
+}
+
+
+/*******************************************************************************
+* Subscriptions
+*******************************************************************************/
+
+/**
+* Adds a subscription.
+*
+* @param  filter    The topic filter. May contain wildcards. We keep a copy.
+* @param  runnable  The message to associate with the filter.
+* @param  qos       The QoS requested for the subscription. Kept for the caller.
+* @return 0 on success, or -1 if the filter is invalid, already present, or
+*           we ran out of memory.
+*/
+int8_t MQTTTopicTrie::insert(const char* filter, ManuvrMsg* runnable, uint8_t qos) {
+  if (0 == _node_count) {
+    // The root is made with the first subscription.
+    _nodes = (TrieNode*) malloc(16 * sizeof(TrieNode));
+    if (nullptr == _nodes) return -1;
+    memset(&_nodes[0], 0, sizeof(TrieNode));
+    _node_cap   = 16;
+    _node_count = 1;
+  }
+  if (_sub_count == _sub_cap) {
+    const uint32_t nu_cap = (_sub_cap) ? (_sub_cap * 2) : 8;
+    TopicSub* nu = (TopicSub*) realloc(_subs, nu_cap * sizeof(TopicSub));
+    if (nullptr == nu) return -1;
+    _subs    = nu;
+    _sub_cap = nu_cap;
+  }
+
+  const uint32_t node = _walk(filter, true);
+  if ((0 == node) || (0 != _nodes[node].sub)) {
+    return -1;
+  }
+  const size_t len = strlen(filter);
+  char* copy = (char*) malloc(len + 1);
+  if (nullptr == copy) {
+    _prune(node);
+    return -1;
+  }
+  memcpy(copy, filter, len + 1);
+  _subs[_sub_count].filter   = copy;
+  _subs[_sub_count].runnable = runnable;
+  _subs[_sub_count].node     = node;
+  _subs[_sub_count].qos      = qos;
+  _nodes[node].sub = ++_sub_count;
+  return 0;
+}
+
+
+/**
+* Removes a subscription. Nodes that no longer lead anywhere are freed.
+*
+* @param  filter  The topic filter, exactly as it was inserted.
+* @return The runnable that was associated with the filter, or nullptr if there
+*           was no such subscription.
+*/
+ManuvrMsg* MQTTTopicTrie::remove(const char* filter) {
+  const uint32_t node = _walk(filter, false);
+  if ((0 == node) || (0 == _nodes[node].sub)) {
+    return nullptr;
+  }
+  const uint32_t idx = _nodes[node].sub - 1;
+  ManuvrMsg* return_value = _subs[idx].runnable;
+  free(_subs[idx].filter);
+  _sub_count--;
+  if (idx != _sub_count) {
+    // Fill the hole with the last subscription.
+    _subs[idx] = _subs[_sub_count];
+    _nodes[_subs[idx].node].sub = idx + 1;
+  }
+  _nodes[node].sub = 0;
+  _prune(node);
+  return return_value;
+}
+
+
+/**
+* @param  filter  The topic filter, exactly as it was inserted.
+* @return The runnable associated with the filter, or nullptr if there is none.
+*/
+ManuvrMsg* MQTTTopicTrie::find(const char* filter) {
+  const uint32_t node = _walk(filter, false);
+  if ((0 == node) || (0 == _nodes[node].sub)) {
+    return nullptr;
+  }
+  return _subs[_nodes[node].sub - 1].runnable;
+}
+
+
+/**
+* Finds every subscription whose filter matches the given topic. Per the spec,
+*   topics that begin with '$' are not matched by wildcards in the first level.
+*
+* @param  topic  The topic of a PUBLISH. Need not be null-terminated.
+* @param  len    The length of the topic.
+* @param  out    The runnables of up to max matching subscriptions are written here.
+* @param  max    How many runnables out can hold.
+* @return The number of matching subscriptions (which may exceed max), or -1
+*           if the topic has too many levels.
+*/
+int MQTTTopicTrie::match(const char* topic, int len, ManuvrMsg** out, int max) {
+  if ((0 == _node_count) || (nullptr == topic) || (0 >= len)) {
+    return 0;
+  }
+  // Find the levels of the topic.
+  int starts[MQTT_TOPIC_MAX_LEVELS];
+  int lens[MQTT_TOPIC_MAX_LEVELS];
+  int levels = 0;
+  int s      = 0;
+  for (int i = 0; i <= len; i++) {
+    if ((i == len) || ('/' == topic[i])) {
+      if (MQTT_TOPIC_MAX_LEVELS == levels) return -1;
+      starts[levels] = s;
+      lens[levels]   = i - s;
+      levels++;
+      s = i + 1;
+    }
+  }
+  const bool sys_topic = ('$' == *topic);
+
+  // Depth-first, with a stack of our own. A node can add at most one pending
+  //   sibling per level, so the stack never gets deeper than the topic.
+  struct {
+    uint32_t node;
+    int      depth;
+  } stack[MQTT_TOPIC_MAX_LEVELS + 2];
+  int sp    = 0;
+  int found = 0;
+  stack[sp].node  = 0;
+  stack[sp].depth = 0;
+  sp++;
+
+  while (0 < sp) {
+    sp--;
+    const uint32_t  node  = stack[sp].node;
+    const int       depth = stack[sp].depth;
+    const TrieNode* x     = &_nodes[node];
+    const bool wild_ok = !(sys_topic && (0 == depth));
+    uint32_t sub = 0;
+
+    // '#' matches this level and everything below it, including nothing.
+    if (wild_ok && (0 != x->multi) && (0 != (sub = _nodes[x->multi].sub))) {
+      if (found < max) out[found] = _subs[sub - 1].runnable;
+      found++;
+    }
+    if (depth == levels) {
+      if (0 != (sub = x->sub)) {
+        if (found < max) out[found] = _subs[sub - 1].runnable;
+        found++;
+      }
+      continue;
+    }
+    if (wild_ok && (0 != x->plus)) {
+      stack[sp].node  = x->plus;
+      stack[sp].depth = depth + 1;
+      sp++;
+    }
+    const uint32_t lit = _literal(node, topic + starts[depth], (uint16_t) lens[depth]);
+    if (0 != lit) {
+      stack[sp].node  = lit;
+      stack[sp].depth = depth + 1;
+      sp++;
+    }
+  }
+  return found;
+}
+
+
+/*******************************************************************************
+* Trie management
+*******************************************************************************/
+
+/**
+* Follows a filter down the trie, level by level, and validates it on the way.
+*
+* @param  filter  The topic filter.
+* @param  create  If true, missing nodes are made.
+* @return The index of the filter's final node, or 0 if there is no such node,
+*           the filter is invalid, or we ran out of memory.
+*/
+uint32_t MQTTTopicTrie::_walk(const char* filter, bool create) {
+  if ((nullptr == filter) || (0 == *filter) || (0 == _node_count)) {
+    return 0;
+  }
+  uint32_t    node   = 0;
+  int         levels = 0;
+  const char* level  = filter;
+  while (true) {
+    const char*    end = strchr(level, '/');
+    const uint16_t len = (uint16_t) ((nullptr != end) ? (end - level) : strlen(level));
+    uint32_t next = 0;
+    if (++levels > MQTT_TOPIC_MAX_LEVELS) {
+      break;
+    }
+    if ((1 == len) && ('#' == *level)) {
+      if (nullptr != end) break;   // '#' must be the last level.
+      next = _nodes[node].multi;
+      if ((0 == next) && create) {
+        next = _new_node(node, nullptr, 0, 0);
+        _nodes[node].multi = next;
+      }
+    }
+    else if ((1 == len) && ('+' == *level)) {
+      next = _nodes[node].plus;
+      if ((0 == next) && create) {
+        next = _new_node(node, nullptr, 0, 0);
+        _nodes[node].plus = next;
+      }
+    }
+    else {
+      // Wildcards must occupy a whole level.
+      if (memchr(level, '+', len) || memchr(level, '#', len)) break;
+      next = _literal(node, level, len);
+      if ((0 == next) && create) {
+        next = _new_node(node, level, len, _level_hash(level, len));
+      }
+    }
+    if (0 == next) break;
+    node = next;
+    if (nullptr == end) {
+      return node;
+    }
+    level = end + 1;
+  }
+  if (create) _prune(node);   // Don't leave a partial path behind.
+  return 0;
+}
+
+
+/**
+* @return The index of the literal child of parent with the given level, or 0.
+*/
+uint32_t MQTTTopicTrie::_literal(uint32_t parent, const char* level, uint16_t len) {
+  if (nullptr == _edges) return 0;
+  const uint32_t hash = _level_hash(level, len);
+  uint32_t i = _edge_home(parent, hash);
+  while (0 != _edges[i]) {
+    const TrieNode* x = &_nodes[_edges[i]];
+    if ((x->parent == parent) && (x->hash == hash) && (x->level_len == len) && (0 == memcmp(x->level, level, len))) {
+      return _edges[i];
+    }
+    i = (i + 1) & _edge_mask;
+  }
+  return 0;
+}
+
+
+/**
+* Makes a node beneath the given parent. A level of nullptr makes a wildcard
+*   node, which the caller must link into the parent.
+*
+* @return The index of the new node, or 0 if we ran out of memory.
+*/
+uint32_t MQTTTopicTrie::_new_node(uint32_t parent, const char* level, uint16_t len, uint32_t hash) {
+  char* copy = nullptr;
+  if (nullptr != level) {
+    copy = (char*) malloc(len + 1);
+    if (nullptr == copy) return 0;
+    memcpy(copy, level, len);
+    copy[len] = '\0';
+  }
+
+  uint32_t idx = _free_node;
+  if (0 != idx) {
+    _free_node = _nodes[idx].parent;
+  }
+  else {
+    if (_node_count == _node_cap) {
+      TrieNode* nu = (TrieNode*) realloc(_nodes, (_node_cap * 2) * sizeof(TrieNode));
+      if (nullptr == nu) {
+        if (copy) free(copy);
+        return 0;
+      }
+      _nodes    = nu;
+      _node_cap = _node_cap * 2;
+    }
+    idx = _node_count++;
+  }
+
+  TrieNode* x = &_nodes[idx];
+  memset(x, 0, sizeof(TrieNode));
+  x->parent    = parent;
+  x->level     = copy;
+  x->level_len = len;
+  x->hash      = hash;
+  if ((nullptr != copy) && !_edge_insert(idx)) {
+    free(copy);
+    x->level   = nullptr;
+    x->parent  = _free_node;
+    _free_node = idx;
+    return 0;
+  }
+  _nodes[parent].children++;
+  return idx;
+}
+
+
+/**
+* Frees the given node, and then its ancestors, for as long as they neither
+*   end a subscription nor lead to one. The root is never freed.
+*/
+void MQTTTopicTrie::_prune(uint32_t node) {
+  while ((0 != node) && (0 == _nodes[node].sub) && (0 == _nodes[node].children)) {
+    TrieNode* x = &_nodes[node];
+    const uint32_t parent = x->parent;
+    if (nullptr != x->level) {
+      _edge_remove(node);
+      free(x->level);
+      x->level = nullptr;
+    }
+    else if (_nodes[parent].plus == node) {
+      _nodes[parent].plus = 0;
+    }
+    else if (_nodes[parent].multi == node) {
+      _nodes[parent].multi = 0;
+    }
+    _nodes[parent].children--;
+    x->parent  = _free_node;
+    _free_node = node;
+    node = parent;
+  }
+}
+
+
+/**
+* Adds a literal node to the edge table, growing it if it is 3/4 full.
+*
+* @return true on success.
+*/
+bool MQTTTopicTrie::_edge_insert(uint32_t node) {
+  if ((nullptr == _edges) || (((_edge_count + 1) * 4) > ((_edge_mask + 1) * 3))) {
+    if (!_edge_grow()) return false;
+  }
+  uint32_t i = _edge_home(_nodes[node].parent, _nodes[node].hash);
+  while (0 != _edges[i]) i = (i + 1) & _edge_mask;
+  _edges[i] = node;
+  _edge_count++;
+  return true;
+}
+
+
+/**
+* Removes a literal node from the edge table. Entries that followed it are
+*   shifted back, so that no tombstones are needed.
+*/
+void MQTTTopicTrie::_edge_remove(uint32_t node) {
+  uint32_t i = _edge_home(_nodes[node].parent, _nodes[node].hash);
+  while (node != _edges[i]) {
+    if (0 == _edges[i]) return;   // Not here.
+    i = (i + 1) & _edge_mask;
+  }
+  _edges[i] = 0;
+  _edge_count--;
+  uint32_t j = i;
+  while (true) {
+    j = (j + 1) & _edge_mask;
+    const uint32_t n = _edges[j];
+    if (0 == n) break;
+    const uint32_t k = _edge_home(_nodes[n].parent, _nodes[n].hash);
+    // If n's home lies cyclically within (i, j], it must stay where it is.
+    if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) continue;
+    _edges[i] = n;
+    _edges[j] = 0;
+    i = j;
+  }
+}
+
+
+/**
+* Doubles the edge table, and rehashes what was in it.
+*
+* @return true on success.
+*/
+bool MQTTTopicTrie::_edge_grow() {
+  const uint32_t old_size = (nullptr != _edges) ? (_edge_mask + 1) : 0;
+  const uint32_t nu_size  = (old_size) ? (old_size * 2) : 16;
+  uint32_t* nu = (uint32_t*) calloc(nu_size, sizeof(uint32_t));
+  if (nullptr == nu) return false;
+  uint32_t* old = _edges;
+  _edges     = nu;
+  _edge_mask = nu_size - 1;
+  for (uint32_t r = 0; r < old_size; r++) {
+    if (0 != old[r]) {
+      uint32_t i = _edge_home(_nodes[old[r]].parent, _nodes[old[r]].hash);
+      while (0 != _edges[i]) i = (i + 1) & _edge_mask;
+      _edges[i] = old[r];
+    }
+  }
+  if (old) free(old);
+  return true;
+}
+
+#endif  // MANUVR_SUPPORT_MQTT
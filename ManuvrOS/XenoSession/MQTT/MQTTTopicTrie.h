@@ -0,0 +1,113 @@
+/*
+File:   MQTTTopicTrie.h
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+A trie of MQTT topic filters, one level per node.
+
+Each subscription filter (which may contain the '+' and '#' wildcards) maps
+  to the runnable that an arriving PUBLISH should trigger. Matching a topic
+  costs a hash probe per level, rather than a string comparison against every
+  subscription.
+
+Nodes live in a single array, and are referred to by index. Literal edges are
+  held in one open-addressed table, keyed on the parent's index and the hash
+  of the level. Wildcard edges hang directly off of their parent node.
+
+The subscriptions themselves are kept in a dense array, so that the session
+  can iterate them (for re-subscription, and debug) without walking the trie.
+  Removing a subscription may reorder that array.
+*/
+
+#ifndef __MANUVR_MQTT_TOPIC_TRIE_H__
+#define __MANUVR_MQTT_TOPIC_TRIE_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class ManuvrMsg;
+
+// Topics and filters with more levels than this are rejected.
+#ifndef MQTT_TOPIC_MAX_LEVELS
+  #define MQTT_TOPIC_MAX_LEVELS 32
+#endif
+
+
+class MQTTTopicTrie {
+  public:
+    MQTTTopicTrie();
+    ~MQTTTopicTrie();
+
+    int8_t     insert(const char* filter, ManuvrMsg*, uint8_t qos = 0);
+    ManuvrMsg* remove(const char* filter);
+    ManuvrMsg* find(const char* filter);
+    int        match(const char* topic, int len, ManuvrMsg** out, int max);
+    void       clear();
+
+    inline uint32_t    size() {                return _sub_count;         };
+    inline const char* filter(uint32_t i) {    return _subs[i].filter;    };
+    inline ManuvrMsg*  runnable(uint32_t i) {  return _subs[i].runnable;  };
+    inline uint8_t     qos(uint32_t i) {       return _subs[i].qos;       };
+
+
+  private:
+    typedef struct {
+      char*     level;      // Our copy of this node's level. nullptr for wildcards and the root.
+      uint32_t  parent;
+      uint32_t  hash;       // Hash of the level.
+      uint32_t  sub;        // Index+1 of the subscription that ends here. Zero if none.
+      uint32_t  plus;       // Index of the '+' child. Zero if none.
+      uint32_t  multi;      // Index of the '#' child. Zero if none.
+      uint32_t  children;   // How many children (of any kind) we have.
+      uint16_t  level_len;
+    } TrieNode;
+
+    typedef struct {
+      char*      filter;    // Our copy of the filter string.
+      ManuvrMsg* runnable;
+      uint32_t   node;
+      uint8_t    qos;       // The QoS that was requested for the subscription.
+    } TopicSub;
+
+    TrieNode* _nodes      = nullptr;   // _nodes[0] is the root.
+    uint32_t  _node_count = 0;         // Slots in use, including freed ones.
+    uint32_t  _node_cap   = 0;
+    uint32_t  _free_node  = 0;         // Head of the free list (through parent). Zero if empty.
+
+    uint32_t* _edges      = nullptr;   // Node indices. Zero marks an empty slot.
+    uint32_t  _edge_mask  = 0;
+    uint32_t  _edge_count = 0;
+
+    TopicSub* _subs       = nullptr;
+    uint32_t  _sub_count  = 0;
+    uint32_t  _sub_cap    = 0;
+
+    uint32_t _walk(const char* filter, bool create);
+    uint32_t _literal(uint32_t parent, const char* level, uint16_t len);
+    uint32_t _new_node(uint32_t parent, const char* level, uint16_t len, uint32_t hash);
+    bool     _edge_insert(uint32_t node);
+    void     _edge_remove(uint32_t node);
+    bool     _edge_grow();
+    void     _prune(uint32_t node);
+
+    inline uint32_t _edge_home(uint32_t parent, uint32_t hash) {
+      return ((hash ^ (parent * 0x9E3779B1)) & _edge_mask);
+    };
+};
+
+#endif  // __MANUVR_MQTT_TOPIC_TRIE_H__
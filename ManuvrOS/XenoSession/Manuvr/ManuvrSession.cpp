@@ -104,47 +104,68 @@ int8_t ManuvrSession::sendSyncPacket() {
 
 
 /**
-* This fxn is destructive to the session buffer. The point is to eliminate bytes from the
-*   buffer until we have the following 4-byte sequence at offset 0. In that case, we consume
-*   all the sync data from the buffer and return non-zero.
-* If no sync packets were found in the buffer, we should return zero after having fully-consumed
-*   the buffer.
+* Finds the end of the last sync packet in a buffer.
 *
-* @return  int8_t 0 if we did not find a sync packet. 1 if we did. -1 on meltdown.
+* @param  buf  The buffer to search.
+* @param  len  Its length.
+* @return The offset of the first byte after the last sync packet, or 0 if there were none.
 */
-int8_t ManuvrSession::scan_buffer_for_sync() {
-  int8_t return_value = 0;
-  int len = session_buffer.length();
-  int last_sync_offset = 0;
+static int sync_stream_end(uint8_t* buf, int len) {
+  int end    = 0;
   int offset = 0;
-  uint32_t sync_value = 0x04 + (CHECKSUM_PRELOAD_BYTE << 24);
-  unsigned char *buf = session_buffer.string();
   while (len >= offset+4) {
-    if (parseUint32Fromchars(buf + offset) == sync_value) {
-      // If we have those 4 bytes in sequence, we have found a sync packet.
-      return_value = 1;
-      last_sync_offset = offset;
-      offset += 4;
-      // Notice that we continue the loop. If we found one sync packet, we will likely find more.
-    }
-    else {
-      offset++;
-    }
+    int x = XenoManuvrMessage::contains_sync_pattern(buf + offset, len - offset);
+    if (x < 0) break;
+    offset += x;
+    // We found one sync packet. We will likely find more, so skip the whole run.
+    offset += XenoManuvrMessage::locate_sync_break(buf + offset, len - offset);
+    end = offset;
+  }
+  return end;
+}
+
+
+/**
+* Scans newly-arrived bytes for sync packets while the session is out of sync. The point
+*   is to discard bytes until we have seen a sync packet, and then to leave the session
+*   buffer holding only what followed the last one.
+* Bytes that we discard are never copied into the session buffer. We only keep the last
+*   three (a sync packet may be split across two reads), along with whatever the buffer
+*   was holding when we lost sync.
+*
+* @param  buf  The bytes that just arrived.
+* @param  len  How many there are.
+* @return  int8_t 0 if we did not find a sync packet. 1 if we did.
+*/
+int8_t ManuvrSession::scan_buffer_for_sync(uint8_t* buf, int len) {
+  int end = sync_stream_end(buf, len);
+  if (end > 0) {
+    // Anything we were holding is older than this sync, and can go.
+    session_buffer.clear();
+    if (len > end) session_buffer.concat(buf + end, len - end);
+    return 1;
   }
 
-  if (return_value) {
-    /* We found a sync! Now to cull the sync data from the session buffer. We COULD
-    *  only cull the modulus of the offset and let the parser handle the sync packets,
-    *  but that would just waste resources. We might as well eliminate all the junk now. */
-    session_buffer.cull(last_sync_offset + 4);
+  // The new bytes had no sync packet, but one might straddle the boundary.
+  const int bridge = (len < 3) ? len : 3;
+  session_buffer.concat(buf, bridge);
+  const int held = session_buffer.length();
+  end = sync_stream_end(session_buffer.string(), held);
+  if (end > 0) {
+    session_buffer.cull(end);
+    if (len > bridge) session_buffer.concat(buf + bridge, len - bridge);
+    return 1;
   }
-  else if (len > 7) {
-    /* We did not find a sync packet, but we have more in the buffer than we need to find it.
-    *  Cull all but the last 3 bytes. The next time we get data from the transport, we will
-    *  concat to the buffer and run this check again. */
-    session_buffer.cull(len - 3);
+
+  // No sync. Keep the last 3 bytes, and check them against the next read.
+  if (len > bridge) {
+    session_buffer.clear();
+    session_buffer.concat(buf + (len - 3), 3);
   }
-  return return_value;
+  else if (held > 3) {
+    session_buffer.cull(held - 3);
+  }
+  return 0;
 }
 
 
@@ -230,6 +251,8 @@ void ManuvrSession::mark_session_sync(bool pending) {
 /**
 * When we take bytes from the transport, and can't use them all right away,
 *   we store them to prepend to the next group of bytes that come through.
+* If we aren't holding any, the bytes are parsed where they lie, and only the
+*   remainder is copied.
 *
 * @param
 * @param
@@ -237,8 +260,7 @@ void ManuvrSession::mark_session_sync(bool pending) {
 */
 int8_t ManuvrSession::bin_stream_rx(unsigned char *buf, int len) {
   int8_t return_value = 0;
-
-  session_buffer.concat(buf, len);
+  bool    in_place     = false;   // Are we parsing from buf, rather than the session buffer?
 
   uint16_t statcked_sess_state = getPhase();
 
@@ -255,12 +277,14 @@ int8_t ManuvrSession::bin_stream_rx(unsigned char *buf, int len) {
   switch (_sync_state) {   // Consider the top four bits of the session state.
     case XENOSESSION_STATE_SYNC_SYNCD:       // The nominal case. Session is in-sync. Do nothing.
     case XENOSESSION_STATE_SYNC_PEND_EXIT:   // We have exchanged sync packets with the counterparty.
+      in_place = (0 == session_buffer.length());
+      if (!in_place) session_buffer.concat(buf, len);
       break;
     case XENOSESSION_STATE_SYNC_INITIATED:   // The counterparty noticed the problem.
     case XENOSESSION_STATE_SYNC_INITIATOR:   // We noticed a problem. We wait for a sync packet...
-      /* At this point, we shouldn't be adding to the inbound queue. We should simply add
-         to the session buffer and scan it for sync packets. */
-      if (scan_buffer_for_sync()) {   // We are getting sync back now.
+      /* At this point, we shouldn't be adding to the inbound queue. We should simply scan
+         for sync packets. Whatever follows them is left in the session buffer. */
+      if (scan_buffer_for_sync(buf, len)) {   // We are getting sync back now.
         /* Since we are going to fall-through into the general parser case, we should reset
            the values that it will use to index and make decisions... */
         mark_session_sync(true);   // Indicate that we are done with sync, but may still see such packets.
@@ -280,6 +304,7 @@ int8_t ManuvrSession::bin_stream_rx(unsigned char *buf, int len) {
       #ifdef MANUVR_DEBUG
       if (getVerbosity() > 1) local_log.concatf("ILLEGAL _sync_state: 0x%02x (top 4)\n", _sync_state);
       #endif
+      session_buffer.concat(buf, len);
       break;
   }
 
@@ -312,12 +337,17 @@ int8_t ManuvrSession::bin_stream_rx(unsigned char *buf, int len) {
 
   // If the working message is not in a RECEIVING state, it means something has gone sideways.
   if ((XENO_MSG_PROC_STATE_RECEIVING | XENO_MSG_PROC_STATE_UNINITIALIZED) & working->getState()) {
-    int consumed = working->feedBuffer(&session_buffer);
+    int consumed = in_place ? working->accumulate(buf, len) : working->feedBuffer(&session_buffer);
     #ifdef MANUVR_DEBUG
     if (getVerbosity() > 5) local_log.concatf("Feeding message %p. Consumed %d of %d bytes.\n", working, consumed, len);
     #endif
 
-    if (consumed > 0) {
+    if (in_place) {
+      // Hold whatever the message didn't claim for next time.
+      if (consumed < 0) consumed = 0;
+      if (len > consumed) session_buffer.concat(buf + consumed, len - consumed);
+    }
+    else if (consumed > 0) {
       // Be sure to cull any bytes in the session buffer that were claimed.
       session_buffer.cull(consumed);
     }
@@ -361,6 +391,7 @@ int8_t ManuvrSession::bin_stream_rx(unsigned char *buf, int len) {
     }
   }
   else {
+    if (in_place) session_buffer.concat(buf, len);
     if (getVerbosity() > 3) {
       local_log.concatf("XenoManuvrMessage %p is in the wrong state to accept bytes.\n", working);
       if (getVerbosity() > 5) working->printDebug(&local_log);
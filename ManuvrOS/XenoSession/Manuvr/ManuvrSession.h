@@ -137,6 +137,10 @@ class XenoManuvrMessage : public XenoMessage {
     static void reclaimPreallocation(XenoMessage*);
     static const uint8_t SYNC_PACKET_BYTES[4];    // Plase note the subtle abuse of type....
 
+    /* Sync-stream scanning. The session uses these to find its way back into sync. */
+    static int contains_sync_pattern(uint8_t* buf, int len);
+    static int locate_sync_break(uint8_t* buf, int len);
+
 
   private:
     XenoSession*    session;   // A reference to the session that we are associated with.
@@ -154,9 +158,6 @@ class XenoManuvrMessage : public XenoMessage {
     uint8_t   checksum_c;      // The checksum of the data that we calculate.
 
     static XenoManuvrMessage __prealloc_pool[XENOMSG_M_PREALLOC_COUNT];
-
-    static int contains_sync_pattern(uint8_t* buf, int len);
-    static int locate_sync_break(uint8_t* buf, int len);
 };
 
 
@@ -198,6 +199,7 @@ class ManuvrSession : public XenoSession
     /*
     * A buffer for holding inbound stream until enough has arrived to parse. This eliminates
     *   the need for the transport to care about how much data we consumed versus left in its buffer.
+    * While we are out of sync, this holds no more than the last few bytes we were given.
     */
     StringBuilder session_buffer;
 
@@ -214,7 +216,7 @@ class ManuvrSession : public XenoSession
 
     int8_t sendKeepAlive();
     int8_t sendSyncPacket();
-    int8_t scan_buffer_for_sync();
+    int8_t scan_buffer_for_sync(uint8_t* buf, int len);
     void   mark_session_desync(uint8_t desync_source);
     void   mark_session_sync(bool pending);
 
@@ -26,6 +26,13 @@ XenoManuvrMessage is the class that is the interface between ManuvrMsgs and
 #include "../XenoSession.h"
 #include <Kernel.h>
 #include <Platform/Platform.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
 
 // TODO: This is temporary until the session is fully-abstracted.
 #include "ManuvrSession.h"
@@ -115,6 +122,9 @@ void XenoManuvrMessage::reclaimPreallocation(XenoMessage* obj) {
 
 /**
 * Scan a buffer for the protocol's sync pattern.
+* Where the CPU has 16-byte vectors, candidates are found by comparing the first and
+*   last bytes of the pattern across a whole vector at once. The middle bytes are only
+*   checked for the (rare) candidates. Elsewhere, we compare a word at each offset.
 *
 * @param buf  The buffer to search through.
 * @param len  How far should we go?
@@ -122,16 +132,45 @@ void XenoManuvrMessage::reclaimPreallocation(XenoMessage* obj) {
 */
 int XenoManuvrMessage::contains_sync_pattern(uint8_t* buf, int len) {
   int i = 0;
-  while (i < len-3) {
-    if (*(buf + i + 0) == XenoManuvrMessage::SYNC_PACKET_BYTES[0]) {
-      if (*(buf + i + 1) == XenoManuvrMessage::SYNC_PACKET_BYTES[1]) {
-        if (*(buf + i + 2) == XenoManuvrMessage::SYNC_PACKET_BYTES[2]) {
-          if (*(buf + i + 3) == XenoManuvrMessage::SYNC_PACKET_BYTES[3]) {
-            return i;
-          }
+  uint32_t sync_word;
+  memcpy(&sync_word, SYNC_PACKET_BYTES, 4);
+  #if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(SYNC_PACKET_BYTES[0]);
+    const __m128i last  = _mm_set1_epi8(SYNC_PACKET_BYTES[3]);
+    while (i + 19 <= len) {
+      const __m128i a = _mm_loadu_si128((const __m128i*) (buf + i));
+      const __m128i d = _mm_loadu_si128((const __m128i*) (buf + i + 3));
+      uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(d, last)));
+      while (mask) {
+        const int c = i + __builtin_ctz(mask);
+        if ((*(buf + c + 1) == SYNC_PACKET_BYTES[1]) && (*(buf + c + 2) == SYNC_PACKET_BYTES[2])) {
+          return c;
         }
+        mask &= mask - 1;
       }
+      i += 16;
     }
+  #elif defined(__ARM_NEON)
+    const uint8x16_t first = vdupq_n_u8(SYNC_PACKET_BYTES[0]);
+    const uint8x16_t last  = vdupq_n_u8(SYNC_PACKET_BYTES[3]);
+    while (i + 19 <= len) {
+      const uint8x16_t m = vandq_u8(vceqq_u8(vld1q_u8(buf + i), first), vceqq_u8(vld1q_u8(buf + i + 3), last));
+      // Narrowing leaves us with a nibble per byte.
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+      while (mask) {
+        const int c = i + (__builtin_ctzll(mask) >> 2);
+        if ((*(buf + c + 1) == SYNC_PACKET_BYTES[1]) && (*(buf + c + 2) == SYNC_PACKET_BYTES[2])) {
+          return c;
+        }
+        mask &= ~((uint64_t) 0x0F << ((c - i) << 2));
+      }
+      i += 16;
+    }
+  #endif
+  while (i < len-3) {
+    uint32_t word;
+    memcpy(&word, buf + i, 4);
+    if (word == sync_word) return i;
     i++;
   }
   return -1;
@@ -148,11 +187,28 @@ int XenoManuvrMessage::contains_sync_pattern(uint8_t* buf, int len) {
 */
 int XenoManuvrMessage::locate_sync_break(uint8_t* buf, int len) {
   int i = 0;
+  uint32_t sync_word;
+  memcpy(&sync_word, SYNC_PACKET_BYTES, 4);
+  #if defined(__SSE2__)
+    const __m128i pattern = _mm_set1_epi32(sync_word);
+    while (i + 16 <= len) {
+      const uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (buf + i)), pattern));
+      if (0xFFFF != mask) return (i + (__builtin_ctz(~mask) & ~3));
+      i += 16;
+    }
+  #elif defined(__ARM_NEON)
+    const uint8x16_t pattern = vreinterpretq_u8_u32(vdupq_n_u32(sync_word));
+    while (i + 16 <= len) {
+      const uint8x16_t m = vceqq_u8(vld1q_u8(buf + i), pattern);
+      const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+      if (~((uint64_t) 0) != mask) return (i + ((__builtin_ctzll(~mask) >> 2) & ~3));
+      i += 16;
+    }
+  #endif
   while (i < len-3) {
-    if (*(buf + i + 0) != XenoManuvrMessage::SYNC_PACKET_BYTES[0]) return i;
-    if (*(buf + i + 1) != XenoManuvrMessage::SYNC_PACKET_BYTES[1]) return i;
-    if (*(buf + i + 2) != XenoManuvrMessage::SYNC_PACKET_BYTES[2]) return i;
-    if (*(buf + i + 3) != XenoManuvrMessage::SYNC_PACKET_BYTES[3]) return i;
+    uint32_t word;
+    memcpy(&word, buf + i, 4);
+    if (word != sync_word) return i;
     i += 4;
   }
   return i;
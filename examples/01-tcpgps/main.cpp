@@ -126,14 +126,8 @@ int main(int argc, const char* argv[]) {
 
   // The main loop. Run forever, as a microcontroller would.
   // Program exit is handled in Platform.
-  int events_procd = 0;
+  // procIdleFlags() blocks until there is work, so there is no need to sleep.
   while (1) {
-    events_procd = kernel->procIdleFlags();
-    if (0 == events_procd) {
-      // This is a resource-saver. How this is handled on a particular platform
-      //   is still out-of-scope. Since we are in a threaded environment, we can
-      //   sleep. Other systems might use ISR hooks or RTC notifications.
-      sleep_millis(20);
-    }
+    kernel->procIdleFlags();
   }
 }
@@ -0,0 +1,349 @@
+/*
+File:   ArgumentPoolTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests inline Argument values and the per-message Argument pool, and counts
+  the heap allocations that a sensor-shaped event costs with and without them.
+This test is linked with malloc() wrapped (see the Makefile), so that it can
+  count heap allocations.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#define MANUVR_MSG_ARG_POOL_TEST  0xF620
+#define ARG_POOL_BENCH_EVENTS     20000
+
+
+/*
+* Heap accounting. The linker sends every call to these.
+*/
+extern "C" {
+  void* __real_malloc(size_t);
+  void* __real_calloc(size_t, size_t);
+  void* __real_realloc(void*, size_t);
+
+  unsigned long heap_allocs = 0;
+
+  void* __wrap_malloc(size_t sz) {              heap_allocs++;  return __real_malloc(sz);      }
+  void* __wrap_calloc(size_t n, size_t sz) {    heap_allocs++;  return __real_calloc(n, sz);   }
+  void* __wrap_realloc(void* p, size_t sz) {    heap_allocs++;  return __real_realloc(p, sz);  }
+}
+
+
+/*
+* Globals.
+*/
+uint32_t events_seen = 0;
+uint32_t events_bad  = 0;
+
+/* Checks that each sensor event arrives with its values intact. */
+int sensor_listener(ManuvrMsg* m) {
+  uint32_t seq = 0;
+  Vector3f accel;
+  Vector3f* gyro = nullptr;
+  events_seen++;
+  if ((0 != m->getArgAs((uint8_t) 0, &seq)) || (4 != m->argCount())) {
+    events_bad++;
+    return 0;
+  }
+  gyro = (Vector3f*) m->getArgs()->retrieveArgByIdx(2)->pointer();
+  m->getArgs()->retrieveArgByIdx(1)->getValueAs(&accel);
+  if ((accel.x != (float) seq) || (gyro->z != (float) seq * 3)) {
+    events_bad++;
+  }
+  return 1;
+}
+
+
+/*
+* A sensor event, as a driver had to build it before values could be held
+*   inline: a heap copy of each vector, marked for reap.
+*/
+void raise_legacy(uint32_t seq) {
+  ManuvrMsg* event = Kernel::returnEvent(MANUVR_MSG_ARG_POOL_TEST);
+  event->addArg(seq);
+  for (int i = 1; i <= 3; i++) {
+    Vector3f* v = (Vector3f*) malloc(sizeof(Vector3f));
+    v->x = (float) seq * i;
+    v->y = 0.5f;
+    v->z = (float) seq * i;
+    event->addArg(v)->reapValue(true);
+  }
+  Kernel::staticRaiseEvent(event);
+}
+
+/*
+* The same event, with the vectors passed by value.
+*/
+void raise_pooled(uint32_t seq) {
+  ManuvrMsg* event = Kernel::returnEvent(MANUVR_MSG_ARG_POOL_TEST);
+  event->addArg(seq);
+  for (int i = 1; i <= 3; i++) {
+    event->addArg(Vector3f((float) seq * i, 0.5f, (float) seq * i));
+  }
+  Kernel::staticRaiseEvent(event);
+}
+
+
+/*
+*
+*/
+int ARG_INLINE_VALUES() {
+  printf("===< ARG_INLINE_VALUES >=========================================\n");
+  const char* long_str = "This string is too long to fit inside an Argument.";
+  char short_str[8] = "short";
+
+  delete new Argument((uint32_t) 0);   // So that the slab has room.
+  unsigned long allocs = heap_allocs;
+  Argument a(3.14159265358979);
+  Vector3f v(1.0f, -2.0f, 3.5f);
+  a.append(v);
+  a.append(short_str)->copyValue();
+  if (heap_allocs != allocs) {
+    printf("Inline values cost %lu heap allocations.\n", heap_allocs - allocs);
+    return -1;
+  }
+  a.append(long_str)->copyValue();
+  short_str[0] = 'X';   // The copy must not see this.
+  v.x = 99.0f;
+
+  double   d = 0.0;
+  Vector3f r;
+  char*    s = nullptr;
+  a.getValueAs((uint8_t) 0, &d);
+  a.getValueAs((uint8_t) 1, &r);
+  a.getValueAs((uint8_t) 2, &s);
+  if ((3.14159265358979 != d) || (1.0f != r.x) || (3.5f != r.z)) {
+    printf("Inline values did not survive.\n");
+    return -1;
+  }
+  if ((nullptr == s) || strcmp(s, "short")) {
+    printf("Short string was not copied.\n");
+    return -1;
+  }
+  a.getValueAs((uint8_t) 3, &s);
+  if ((s == long_str) || strcmp(s, long_str) || !a.retrieveArgByIdx(3)->reapValue()) {
+    printf("Long string was not copied to the heap.\n");
+    return -1;
+  }
+  // Inline values must never be freed.
+  a.retrieveArgByIdx(1)->reapValue(true);
+  if (a.retrieveArgByIdx(1)->reapValue()) {
+    printf("An inline value was marked for reap.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int ARG_MSG_POOL() {
+  printf("===< ARG_MSG_POOL >==============================================\n");
+  ManuvrMsg msg(MANUVR_MSG_ARG_POOL_TEST);
+  Argument::trimArena();
+  for (int i = 0; i < MANUVR_MSG_ARG_POOL + 2; i++) {
+    msg.addArg(Vector3f((float) i, 0.0f, 0.0f));
+  }
+  msg.addArg(2.5);
+  if ((MANUVR_MSG_ARG_POOL + 3) != msg.argCount()) {
+    printf("Message has %d Arguments.\n", msg.argCount());
+    return -1;
+  }
+
+  // Pooled Arguments must be moved out if the chain leaves the message.
+  Argument* taken = msg.takeArgs();
+  msg.clearArgs();
+  Vector3f r;
+  double   d = 0.0;
+  for (int i = 0; i < MANUVR_MSG_ARG_POOL + 2; i++) {
+    taken->getValueAs((uint8_t) i, &r);
+    if ((float) i != r.x) {
+      printf("Argument %d was damaged when taken (%.1f).\n", i, (double) r.x);
+      delete taken;
+      return -1;
+    }
+  }
+  taken->getValueAs((uint8_t) (MANUVR_MSG_ARG_POOL + 2), &d);
+  delete taken;
+  if (2.5 != d) {
+    printf("Double was damaged when taken.\n");
+    return -1;
+  }
+
+  // Clearing and refilling a message reuses its pool.
+  for (int n = 0; n < 4; n++) {
+    msg.addArg((uint32_t) n);
+    msg.addArg(Vector3f(1.0f, 2.0f, 3.0f));
+    msg.clearArgs();
+  }
+  if (0 != msg.argCount()) {
+    printf("Message still has Arguments after clearArgs().\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* A chain that was indexed while in the message must still be sound once it
+*   has been taken, and its pooled Arguments have moved.
+*/
+int ARG_MSG_TAKE_INDEXED() {
+  printf("===< ARG_MSG_TAKE_INDEXED >======================================\n");
+  static const char* keys[] = {"k0", "k1", "k2", "k3", "k4", "k5", "k6", "k7", "k8", "k9", "k10", "k11"};
+  const int total = sizeof(keys) / sizeof(char*);
+  ManuvrMsg msg(MANUVR_MSG_ARG_POOL_TEST);
+  // A head from the slab, so that its index outlives the move of the pool.
+  msg.addArg(new Argument((uint32_t) 0))->setKey(keys[0]);
+  for (int i = 1; i < total; i++) {
+    msg.addArg((uint32_t) i)->setKey(keys[i]);
+  }
+
+  // Past ARGUMENT_INDEX_MIN_ARGS, a keyed lookup indexes the chain.
+  Argument* found = msg.getArgs()->retrieveArgByKey(keys[total - 1]);
+  uint32_t val = 0;
+  if ((nullptr == found) || (0 != found->getValueAs(&val)) || ((uint32_t) (total - 1) != val)) {
+    printf("Keyed lookup in the message failed.\n");
+    return -1;
+  }
+
+  Argument* taken = msg.takeArgs();
+  msg.clearArgs();
+  int ret = 0;
+  for (int i = 0; (0 == ret) && (i < total); i++) {
+    val = 0xFFFFFFFF;
+    if ((0 != taken->getValueAs((uint8_t) i, &val)) || ((uint32_t) i != val)) {
+      printf("Argument %d was wrong by position after take (%u).\n", i, val);
+      ret = -1;
+    }
+    found = taken->retrieveArgByKey(keys[i]);
+    val = 0xFFFFFFFF;
+    if ((0 == ret) && ((nullptr == found) || (0 != found->getValueAs(&val)) || ((uint32_t) i != val))) {
+      printf("Argument %s was wrong by key after take.\n", keys[i]);
+      ret = -1;
+    }
+  }
+  // Appending must find the real tail.
+  if ((0 == ret) && (nullptr != taken->link(new Argument((uint32_t) 99)))) {
+    if ((total + 1) != taken->argCount()) {
+      printf("Chain has %d Arguments after append.\n", taken->argCount());
+      ret = -1;
+    }
+  }
+  delete taken;
+  return ret;
+}
+
+
+/*
+*
+*/
+int ARG_SENSOR_EVENT_ALLOCS() {
+  printf("===< ARG_SENSOR_EVENT_ALLOCS >===================================\n");
+  Kernel* kernel = platform.kernel();
+  ManuvrMsg::registerMessage(MANUVR_MSG_ARG_POOL_TEST, 0, "ARG_POOL_TEST", ManuvrMsg::MSG_ARGS_NONE, nullptr);
+  kernel->before(MANUVR_MSG_ARG_POOL_TEST, sensor_listener, 0);
+
+  // Warm up, so that neither path pays for slab growth.
+  for (int i = 0; i < 32; i++) {
+    raise_legacy(i);
+    raise_pooled(i);
+  }
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  events_seen = 0;
+  events_bad  = 0;
+
+  unsigned long allocs = heap_allocs;
+  unsigned long start  = micros();
+  for (int i = 0; i < ARG_POOL_BENCH_EVENTS; i++) {
+    raise_legacy(i);
+    kernel->procIdleFlags();
+  }
+  unsigned long legacy_us     = micros() - start;
+  unsigned long legacy_allocs = heap_allocs - allocs;
+
+  allocs = heap_allocs;
+  start  = micros();
+  for (int i = 0; i < ARG_POOL_BENCH_EVENTS; i++) {
+    raise_pooled(i);
+    kernel->procIdleFlags();
+  }
+  unsigned long pooled_us     = micros() - start;
+  unsigned long pooled_allocs = heap_allocs - allocs;
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+
+  printf("\t %d sensor events, each with 3 Vector3f Arguments.\n", ARG_POOL_BENCH_EVENTS);
+  printf("\t Heap vectors:       %8lu us  %6.2f allocs/event\n", legacy_us, legacy_allocs / (double) ARG_POOL_BENCH_EVENTS);
+  printf("\t Inline and pooled:  %8lu us  %6.2f allocs/event\n", pooled_us, pooled_allocs / (double) ARG_POOL_BENCH_EVENTS);
+
+  if ((2 * ARG_POOL_BENCH_EVENTS != events_seen) || (0 != events_bad)) {
+    printf("Saw %u events (%u bad). Expected %u.\n", events_seen, events_bad, 2 * ARG_POOL_BENCH_EVENTS);
+    return -1;
+  }
+  if ((pooled_allocs + (3 * ARG_POOL_BENCH_EVENTS)) > legacy_allocs) {
+    printf("Pooled events did not save the vector allocations.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  if (0 == ARG_INLINE_VALUES()) {
+    if (0 == ARG_MSG_POOL()) {
+      if (0 == ARG_MSG_TAKE_INDEXED()) {
+        if (0 == ARG_SENSOR_EVENT_ALLOCS()) {
+          printf("**********************************\n");
+          printf("*  Argument pool tests all pass  *\n");
+          printf("**********************************\n");
+          exit_value = 0;
+        }
+        else printTestFailure("ARG_SENSOR_EVENT_ALLOCS");
+      }
+      else printTestFailure("ARG_MSG_TAKE_INDEXED");
+    }
+    else printTestFailure("ARG_MSG_POOL");
+  }
+  else printTestFailure("ARG_INLINE_VALUES");
+
+  exit(exit_value);
+}
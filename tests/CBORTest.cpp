@@ -0,0 +1,490 @@
+/*
+File:   CBORTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the streaming CBOR decoder and the pre-sized encoders, and benchmarks
+  them against the cbor-cpp paths that they replaced.
+This test is linked with malloc() wrapped (see the Makefile), so that it can
+  count heap allocations.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#define CBOR_BENCH_MESSAGES     20000
+#define CBOR_FEED_MESSAGES      64
+
+
+/*
+* Heap accounting. The linker sends every call to these.
+*/
+extern "C" {
+  void* __real_malloc(size_t);
+  void* __real_calloc(size_t, size_t);
+  void* __real_realloc(void*, size_t);
+
+  unsigned long heap_allocs = 0;
+
+  void* __wrap_malloc(size_t sz) {              heap_allocs++;  return __real_malloc(sz);      }
+  void* __wrap_calloc(size_t n, size_t sz) {    heap_allocs++;  return __real_calloc(n, sz);   }
+  void* __wrap_realloc(void* p, size_t sz) {    heap_allocs++;  return __real_realloc(p, sz);  }
+}
+
+
+#if defined(MANUVR_CBOR)
+
+/*
+* Builds a message shaped like typical sensor traffic.
+*/
+Argument* build_message(uint32_t seq) {
+  Argument* a = new Argument(seq);
+  a->setKey("seq");
+  a->append((int16_t) -1200)->setKey("temp");
+  a->append((uint8_t) 41)->setKey("humidity");
+  a->append(1013.25f)->setKey("pressure");
+  a->append(0.000123456789)->setKey("lux");
+  a->append("ok")->setKey("status");
+  a->append((int8_t) -3)->setKey("rssi");
+  a->append((uint16_t) 3300)->setKey("vbat");
+  return a;
+}
+
+
+/*
+* The decode path that CBORArgDecoder replaced, reproduced for comparison.
+*/
+Argument* legacy_decode(uint8_t* buf, unsigned int len) {
+  Argument* return_value = nullptr;
+  CBORArgListener listener(&return_value);
+  cbor::input input(buf, len);
+  cbor::decoder decoder(input, listener);
+  decoder.run();
+  return return_value;
+}
+
+
+/*
+* The encode path that ArgEncoder replaced, reproduced (for the types that
+*   build_message() uses) for comparison.
+*/
+int legacy_encode(Argument* src, StringBuilder* out) {
+  cbor::output_dynamic output;
+  cbor::encoder encoder(output);
+  for (int i = 0; i < src->argCount(); i++) {
+    Argument* a = src->retrieveArgByIdx(i);
+    encoder.write_map(1);
+    encoder.write_string(a->getKey());
+    switch (a->typeCode()) {
+      case TCode::INT8:    { int8_t   x = 0;  a->getValueAs(&x);  encoder.write_int((int) x);           }  break;
+      case TCode::INT16:   { int16_t  x = 0;  a->getValueAs(&x);  encoder.write_int((int) x);           }  break;
+      case TCode::UINT8:   { uint8_t  x = 0;  a->getValueAs(&x);  encoder.write_int((unsigned int) x);  }  break;
+      case TCode::UINT16:  { uint16_t x = 0;  a->getValueAs(&x);  encoder.write_int((unsigned int) x);  }  break;
+      case TCode::UINT32:  { uint32_t x = 0;  a->getValueAs(&x);  encoder.write_int((unsigned int) x);  }  break;
+      case TCode::FLOAT:   { float    x = 0;  a->getValueAs(&x);  encoder.write_float(x);               }  break;
+      case TCode::DOUBLE:  { double   x = 0;  a->getValueAs(&x);  encoder.write_double(x);              }  break;
+      case TCode::STR:     { char*    x = 0;  a->getValueAs(&x);  encoder.write_string(x);              }  break;
+      default:  break;
+    }
+  }
+  out->concat(output.data(), output.size());
+  return output.size();
+}
+
+
+/* Collects the output of a gather encode. */
+typedef struct {
+  uint8_t buf[512];
+  int     len;
+  int     calls;
+} GatherTarget;
+
+int gather_sink(void* ctx, const uint8_t* buf, unsigned int len) {
+  GatherTarget* g = (GatherTarget*) ctx;
+  if ((g->len + len) > sizeof(g->buf)) return -1;
+  memcpy(g->buf + g->len, buf, len);
+  g->len += len;
+  g->calls++;
+  return 0;
+}
+
+
+/* Checks a decoded message against what build_message() would have made. */
+int vet_message(Argument* r, uint32_t seq) {
+  uint32_t u32 = 0;
+  int16_t  i16 = 0;
+  uint16_t u16 = 0;
+  float    f   = 0.0f;
+  double   d   = 0.0;
+  char*    str = nullptr;
+  if ((0 != r->getValueAs((uint8_t) 0, &u32)) || (u32 != seq))           return -1;
+  if ((0 != r->getValueAs((uint8_t) 1, &i16)) || (-1200 != i16))         return -1;
+  if ((0 != r->getValueAs((uint8_t) 3, &f))   || (1013.25f != f))        return -1;
+  if ((0 != r->getValueAs((uint8_t) 4, &d))   || (0.000123456789 != d))  return -1;
+  if ((0 != r->getValueAs((uint8_t) 5, &str)) || strcmp(str, "ok"))      return -1;
+  if ((0 != r->getValueAs((uint8_t) 7, &u16)) || (3300 != u16))          return -1;
+  if (strcmp(r->getKey(), "seq") || strcmp(r->retrieveArgByIdx(7)->getKey(), "vbat")) return -1;
+  return 0;
+}
+
+
+/*
+*
+*/
+int CBOR_ROUNDTRIP() {
+  printf("===< CBOR_ROUNDTRIP >============================================\n");
+  StringBuilder shuttle;
+  Argument* a = build_message(0x0102AB00);
+  if (0 >= Argument::encodeToCBOR(a, &shuttle)) {
+    printf("Failed to encode.\n");
+    return -1;
+  }
+  int consumed = 0;
+  Argument* r = CBORArgDecoder::decode(shuttle.string(), shuttle.length(), &consumed);
+  if ((nullptr == r) || (consumed != shuttle.length())) {
+    printf("Failed to decode (%d of %d bytes).\n", consumed, shuttle.length());
+    return -1;
+  }
+  if ((r->argCount() != a->argCount()) || vet_message(r, 0x0102AB00)) {
+    printf("Decoded message does not match.\n");
+    return -1;
+  }
+  delete a;
+  delete r;
+
+  // Repeated keys are stored once per block.
+  a = new Argument((uint8_t) 1);
+  a->setKey("k");
+  a->append((uint8_t) 2)->setKey("k");
+  shuttle.clear();
+  Argument::encodeToCBOR(a, &shuttle);
+  r = CBORArgDecoder::decode(shuttle.string(), shuttle.length(), nullptr);
+  delete a;
+  if ((nullptr == r) || (r->getKey() != r->retrieveArgByIdx(1)->getKey())) {
+    printf("Repeated keys were not interned.\n");
+    return -1;
+  }
+  delete r;
+
+  // Malformed input is refused.
+  uint8_t bad[] = { 0x1C, 0x00 };
+  r = CBORArgDecoder::decode(bad, sizeof(bad), &consumed);
+  if ((nullptr != r) || (-1 != consumed)) {
+    printf("Malformed input was accepted.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int CBOR_PARTIAL_FEED() {
+  printf("===< CBOR_PARTIAL_FEED >=========================================\n");
+  StringBuilder shuttle;
+  for (int i = 0; i < CBOR_FEED_MESSAGES; i++) {
+    Argument* a = build_message(i);
+    Argument::encodeToCBOR(a, &shuttle);
+    delete a;
+  }
+  const int total = shuttle.length();
+  uint8_t*  buf   = shuttle.string();
+  CBORArgDecoder decoder;
+  int decoded = 0;
+  int offset  = 0;
+  while (offset < total) {
+    // Pieces that break items at arbitrary points, as a BufferPipe would.
+    int piece = 1 + (randomUInt32() % 23);
+    if (piece > (total - offset)) piece = total - offset;
+    const int ret = decoder.feed(buf + offset, piece);
+    if (0 > ret) {
+      printf("feed() failed at offset %d.\n", offset);
+      return -1;
+    }
+    decoded += ret;
+    offset  += piece;
+  }
+  if ((0 != decoder.pending()) || ((CBOR_FEED_MESSAGES * 8) != decoded)) {
+    printf("Decoded %d Arguments, with %u bytes pending.\n", decoded, decoder.pending());
+    return -1;
+  }
+  Argument* chain = decoder.take();
+  Argument* cursor = chain;
+  for (int i = 0; i < CBOR_FEED_MESSAGES; i++) {
+    if (vet_message(cursor, i)) {
+      printf("Message %d does not match.\n", i);
+      delete chain;
+      return -1;
+    }
+    cursor = cursor->retrieveArgByIdx(8);
+  }
+  delete chain;
+  return 0;
+}
+
+
+/*
+* Hostile headers must be refused, rather than held while we wait for bytes
+*   that will never come.
+*/
+int CBOR_HOSTILE_FEED() {
+  printf("===< CBOR_HOSTILE_FEED >=========================================\n");
+  // A text string, and a map key, that each claim 4GB.
+  const uint8_t huge_str[] = {0x7A, 0xFF, 0xFF, 0xFF, 0xFF, 'a', 'b'};
+  const uint8_t huge_key[] = {0xA1, 0x7A, 0xFF, 0xFF, 0xFF, 0xFF, 'k'};
+  CBORArgDecoder decoder;
+  if (-1 != decoder.feed(huge_str, sizeof(huge_str))) {
+    printf("A string of 4GB was not refused.\n");
+    return -1;
+  }
+  if (-1 != decoder.feed(huge_key, sizeof(huge_key))) {
+    printf("A map key of 4GB was not refused.\n");
+    return -1;
+  }
+  if (0 != decoder.pending()) {
+    printf("The decoder held %u bytes after refusing input.\n", decoder.pending());
+    return -1;
+  }
+
+  // An array that claims more members than will ever arrive. Each member is
+  //   fine, but the decoder must not hold the whole thing forever.
+  const uint8_t huge_arr[] = {0x9B, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00};
+  uint8_t members[256];
+  memset(members, 0x01, sizeof(members));
+  if (0 != decoder.feed(huge_arr, sizeof(huge_arr))) {
+    printf("The array header was not held.\n");
+    return -1;
+  }
+  int ret = 0;
+  unsigned int fed = sizeof(huge_arr);
+  while ((0 == ret) && (fed <= (CBOR_DECODER_MAX_PENDING + sizeof(members)))) {
+    ret = decoder.feed(members, sizeof(members));
+    fed += sizeof(members);
+  }
+  if ((-1 != ret) || (0 != decoder.pending())) {
+    printf("An unending array was held to %u bytes.\n", decoder.pending());
+    return -1;
+  }
+
+  // The decoder is still good for honest input.
+  const uint8_t honest[] = {0x63, 'y', 'e', 's'};
+  if (1 != decoder.feed(honest, sizeof(honest))) {
+    printf("The decoder did not recover.\n");
+    return -1;
+  }
+  Argument* a = decoder.take();
+  char* str = nullptr;
+  const bool good = (nullptr != a) && (0 == a->getValueAs(&str)) && (0 == strcmp("yes", str));
+  if (a) delete a;
+  if (!good) {
+    printf("Honest input decoded wrongly after recovery.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int CBOR_ENCODE() {
+  printf("===< CBOR_ENCODE >===============================================\n");
+  uint8_t blob[150];
+  for (unsigned int i = 0; i < sizeof(blob); i++) blob[i] = (uint8_t) i;
+  Argument* a = build_message(77);
+  a->append((void*) blob, sizeof(blob))->setKey("blob");
+  a->append((uint32_t) 9);   // Unkeyed.
+
+  const int sz = ArgEncoder::sizeCBOR(a);
+  uint8_t buf[512];
+  if ((0 >= sz) || (sz != ArgEncoder::writeCBOR(a, buf, sizeof(buf)))) {
+    printf("CBOR size and write disagree.\n");
+    return -1;
+  }
+  if (-1 != ArgEncoder::writeCBOR(a, buf, sz - 1)) {
+    printf("CBOR write overran a short buffer.\n");
+    return -1;
+  }
+  GatherTarget g;
+  g.len   = 0;
+  g.calls = 0;
+  if ((sz != ArgEncoder::gatherCBOR(a, gather_sink, &g)) || (sz != g.len) || memcmp(buf, g.buf, sz)) {
+    printf("CBOR gather differs from write.\n");
+    return -1;
+  }
+  printf("\t CBOR: %d bytes, gathered in %d pieces.\n", sz, g.calls);
+  Argument* r = CBORArgDecoder::decode(buf, sz, nullptr);
+  if ((nullptr == r) || (r->argCount() != a->argCount()) || vet_message(r, 77)) {
+    printf("CBOR did not round-trip.\n");
+    return -1;
+  }
+  Argument* r_blob = r->retrieveArgByIdx(8);
+  if ((sizeof(blob) != r_blob->length()) || memcmp(blob, r_blob->pointer(), sizeof(blob))) {
+    printf("Blob did not round-trip.\n");
+    return -1;
+  }
+  delete r;
+
+  #if defined(MANUVR_JSON)
+    const char* expected = "[{\"seq\":77},{\"temp\":-1200},{\"humidity\":41},{\"pressure\":1013.25},"
+      "{\"lux\":0.000123456789},{\"status\":\"ok\"},{\"rssi\":-3},{\"vbat\":3300},{\"blob\":\"";
+    StringBuilder json;
+    const int j_len = Argument::encodeToJSON(a, &json);
+    if ((j_len != ArgEncoder::sizeJSON(a)) || (0 != strncmp((const char*) json.string(), expected, strlen(expected)))) {
+      printf("JSON is not as expected:\n%s\n", (const char*) json.string());
+      return -1;
+    }
+    printf("\t JSON: %d bytes.\n", j_len);
+  #endif  // MANUVR_JSON
+  delete a;
+  return 0;
+}
+
+
+/*
+*
+*/
+int CBOR_BENCHMARK() {
+  printf("===< CBOR_BENCHMARK >============================================\n");
+  StringBuilder shuttle;
+  Argument* a = build_message(0x00C0FFEE);
+  Argument::encodeToCBOR(a, &shuttle);
+  delete a;
+  uint8_t*  msg     = shuttle.string();
+  const int msg_len = shuttle.length();
+  const double mb   = ((double) msg_len * CBOR_BENCH_MESSAGES) / (1024.0 * 1024.0);
+
+  int legacy_args = 0;
+  unsigned long allocs = heap_allocs;
+  unsigned long start  = micros();
+  for (int i = 0; i < CBOR_BENCH_MESSAGES; i++) {
+    Argument* r = legacy_decode(msg, msg_len);
+    legacy_args += r->argCount();
+    delete r;
+  }
+  unsigned long legacy_us     = micros() - start;
+  unsigned long legacy_allocs = heap_allocs - allocs;
+
+  int arena_args = 0;
+  allocs = heap_allocs;
+  start  = micros();
+  for (int i = 0; i < CBOR_BENCH_MESSAGES; i++) {
+    Argument* r = CBORArgDecoder::decode(msg, msg_len, nullptr);
+    arena_args += r->argCount();
+    delete r;
+  }
+  unsigned long arena_us     = micros() - start;
+  unsigned long arena_allocs = heap_allocs - allocs;
+
+  printf("\t %d messages of %d bytes (8 keyed values).\n", CBOR_BENCH_MESSAGES, msg_len);
+  printf("\t cbor-cpp listener:  %8lu us  %7.2f MB/s  %5.2f allocs/msg\n",
+    legacy_us, mb / (legacy_us / 1000000.0), ((double) legacy_allocs) / CBOR_BENCH_MESSAGES);
+  printf("\t CBORArgDecoder:     %8lu us  %7.2f MB/s  %5.2f allocs/msg\n",
+    arena_us,  mb / (arena_us / 1000000.0),  ((double) arena_allocs) / CBOR_BENCH_MESSAGES);
+
+  if (legacy_args != arena_args) {
+    printf("Implementations disagree (%d vs %d).\n", legacy_args, arena_args);
+    return -1;
+  }
+
+  // Encoding, into a StringBuilder as the callers do.
+  a = build_message(0x00C0FFEE);
+  int legacy_bytes = 0;
+  allocs = heap_allocs;
+  start  = micros();
+  for (int i = 0; i < CBOR_BENCH_MESSAGES; i++) {
+    StringBuilder out;
+    legacy_bytes += legacy_encode(a, &out);
+  }
+  legacy_us     = micros() - start;
+  legacy_allocs = heap_allocs - allocs;
+
+  int sized_bytes = 0;
+  allocs = heap_allocs;
+  start  = micros();
+  for (int i = 0; i < CBOR_BENCH_MESSAGES; i++) {
+    StringBuilder out;
+    sized_bytes += Argument::encodeToCBOR(a, &out);
+  }
+  arena_us     = micros() - start;
+  arena_allocs = heap_allocs - allocs;
+  delete a;
+
+  printf("\t cbor-cpp encoder:   %8lu us  %7.2f MB/s  %5.2f allocs/msg\n",
+    legacy_us, mb / (legacy_us / 1000000.0), ((double) legacy_allocs) / CBOR_BENCH_MESSAGES);
+  printf("\t ArgEncoder:         %8lu us  %7.2f MB/s  %5.2f allocs/msg\n",
+    arena_us,  mb / (arena_us / 1000000.0),  ((double) arena_allocs) / CBOR_BENCH_MESSAGES);
+
+  if (legacy_bytes != sized_bytes) {
+    printf("Encoders disagree on length (%d vs %d).\n", legacy_bytes, sized_bytes);
+    return -1;
+  }
+  return 0;
+}
+#endif  // MANUVR_CBOR
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(MANUVR_CBOR)
+  if (0 == CBOR_ROUNDTRIP()) {
+    if (0 == CBOR_PARTIAL_FEED()) {
+      if (0 == CBOR_HOSTILE_FEED()) {
+        if (0 == CBOR_ENCODE()) {
+          if (0 == CBOR_BENCHMARK()) {
+            printf("**********************************\n");
+            printf("*  CBOR tests all pass           *\n");
+            printf("**********************************\n");
+            exit_value = 0;
+          }
+          else printTestFailure("CBOR_BENCHMARK");
+        }
+        else printTestFailure("CBOR_ENCODE");
+      }
+      else printTestFailure("CBOR_HOSTILE_FEED");
+    }
+    else printTestFailure("CBOR_PARTIAL_FEED");
+  }
+  else printTestFailure("CBOR_ROUNDTRIP");
+  #else
+  printf("Built without MANUVR_CBOR. Nothing to test.\n");
+  exit_value = 0;
+  #endif  // MANUVR_CBOR
+
+  exit(exit_value);
+}
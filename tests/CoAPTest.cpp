@@ -0,0 +1,348 @@
+/*
+File:   CoAPTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the CoAP PDU builder against known encodings, and measures request and
+  response throughput over loopback UDP with fresh and reused messages.
+This test is linked with malloc() wrapped (see the Makefile), so that it can
+  count heap allocations.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(MANUVR_SUPPORT_COAP)
+#include <XenoSession/CoAP/CoAPSession.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define COAP_BENCH_EXCHANGES    20000
+#define COAP_BENCH_PORT         56830
+
+
+/*
+* Heap accounting. The linker sends every call to these.
+*/
+extern "C" {
+  void* __real_malloc(size_t);
+  void* __real_calloc(size_t, size_t);
+  void* __real_realloc(void*, size_t);
+
+  unsigned long heap_allocs = 0;
+
+  void* __wrap_malloc(size_t sz) {              heap_allocs++;  return __real_malloc(sz);      }
+  void* __wrap_calloc(size_t n, size_t sz) {    heap_allocs++;  return __real_calloc(n, sz);   }
+  void* __wrap_realloc(void* p, size_t sz) {    heap_allocs++;  return __real_realloc(p, sz);  }
+}
+
+
+/*
+* Fills in a GET for /sensors/temp?unit=c, adding its options out of order.
+*/
+void build_request(CoAPMessage* req, uint16_t mid) {
+  uint8_t token[4] = {(uint8_t) (mid >> 8), (uint8_t) mid, 0xC0, 0xA9};
+  uint8_t accept   = CoAPMessage::COAP_CONTENT_FORMAT_APP_JSON;
+  req->setType(CoAPMessage::COAP_CONFIRMABLE);
+  req->setCode(CoAPMessage::COAP_GET);
+  req->setMessageID(mid);
+  req->addOption(CoAPMessage::COAP_OPTION_URI_QUERY, 6, (uint8_t*) "unit=c");
+  req->addOption(CoAPMessage::COAP_OPTION_URI_PATH, 7, (uint8_t*) "sensors");
+  req->addOption(CoAPMessage::COAP_OPTION_ACCEPT, 1, &accept);
+  req->addOption(CoAPMessage::COAP_OPTION_URI_PATH, 4, (uint8_t*) "temp");
+  req->setToken(token, 4);
+}
+
+/*
+* Fills in the piggy-backed response to a request.
+*/
+void build_response(CoAPMessage* req, CoAPMessage* resp) {
+  resp->setType(CoAPMessage::COAP_ACKNOWLEDGEMENT);
+  resp->setCode(CoAPMessage::COAP_CONTENT);
+  resp->setMessageID(req->getMessageID());
+  resp->setToken(req->getTokenPointer(), req->getTokenLength());
+  resp->setPayload((uint8_t*) "{\"temp\":21.5}", 13);
+  resp->setContentFormat(CoAPMessage::COAP_CONTENT_FORMAT_APP_JSON);
+}
+
+
+/*
+* Options added out of order must come out sorted, and a parsed PDU must read
+*   back as it was built.
+*/
+int COAP_BUILD_ORDER() {
+  printf("===< COAP_BUILD_ORDER >==========================================\n");
+  const uint8_t expected[] = {
+    0x41, 0x01, 0x12, 0x34, 0xAB,     // CON GET, MID 0x1234, token 0xAB
+    0x60,                             // OBSERVE (6), empty
+    0x54, 't', 'e', 'm', 'p',         // URI_PATH (11)
+    0x11, 0x32,                       // CONTENT_FORMAT (12), 50
+    0xFF, 'h', 'i'
+  };
+  uint8_t tok = 0xAB;
+  uint8_t fmt = 50;
+  CoAPMessage msg;
+  msg.setType(CoAPMessage::COAP_CONFIRMABLE);
+  msg.setCode(CoAPMessage::COAP_GET);
+  msg.setMessageID(0x1234);
+  msg.setPayload((uint8_t*) "hi", 2);
+  msg.addOption(CoAPMessage::COAP_OPTION_CONTENT_FORMAT, 1, &fmt);
+  msg.addOption(CoAPMessage::COAP_OPTION_URI_PATH, 4, (uint8_t*) "temp");
+  msg.setToken(&tok, 1);
+  msg.addOption(CoAPMessage::COAP_OPTION_OBSERVE, 0, nullptr);
+
+  StringBuilder out;
+  if (((int) sizeof(expected) != msg.serialize(&out)) || memcmp(out.string(), expected, sizeof(expected))) {
+    printf("Built PDU does not match:");
+    for (int i = 0; i < out.length(); i++) printf(" %02x", *(out.string() + i));
+    printf("\n");
+    return -1;
+  }
+  if ((1 != msg.validate()) || (2 != msg.getPayloadLength()) || memcmp(msg.getPayloadPointer(), "hi", 2)) {
+    printf("Built PDU does not validate.\n");
+    return -1;
+  }
+
+  // Long and repeated options, and large deltas, through a parse and a rebuild.
+  char long_uri[300];
+  memset(long_uri, 'x', sizeof(long_uri));
+  CoAPMessage big;
+  big.setType(CoAPMessage::COAP_NON_CONFIRMABLE);
+  big.setCode(CoAPMessage::COAP_POST);
+  big.addOption(2048, 2, (uint8_t*) "zz");
+  big.addOption(CoAPMessage::COAP_OPTION_PROXY_URI, sizeof(long_uri), (uint8_t*) long_uri);
+  big.setURI((char*) "/a/bb/ccc", 9);
+
+  StringBuilder wire;
+  int wire_len = big.serialize(&wire);
+  CoAPMessage parsed;
+  if ((wire_len != parsed.accumulate(wire.string(), wire.length())) || (5 != parsed.getNumOptions())) {
+    printf("Could not parse a PDU with long options.\n");
+    return -1;
+  }
+  char uri[32];
+  int  uri_len = 0;
+  if (parsed.getURI(uri, sizeof(uri), &uri_len) || strcmp(uri, "/a/bb/ccc")) {
+    printf("URI did not survive (%s).\n", uri);
+    return -1;
+  }
+  CoAPMessage::CoapOption* opts = parsed.getOptions();
+  bool opts_ok = (CoAPMessage::COAP_OPTION_PROXY_URI == opts[3].optionNumber) && ((int) sizeof(long_uri) == opts[3].optionValueLength);
+  opts_ok &= (2048 == opts[4].optionNumber) && (2 == opts[4].optionValueLength);
+  free(opts);
+  if (!opts_ok) {
+    printf("Options were not sorted.\n");
+    return -1;
+  }
+
+  // Adding to a parsed PDU rebuilds it with the new option in place.
+  parsed.addOption(CoAPMessage::COAP_OPTION_URI_HOST, 4, (uint8_t*) "host");
+  StringBuilder rewire;
+  if ((wire_len + 5 != parsed.serialize(&rewire)) || (6 != parsed.getNumOptions())) {
+    printf("Could not add an option to a parsed PDU.\n");
+    return -1;
+  }
+  opts = parsed.getOptions();
+  opts_ok = (CoAPMessage::COAP_OPTION_URI_HOST == opts[0].optionNumber) && !memcmp(opts[0].optionValuePointer, "host", 4);
+  free(opts);
+  if (!opts_ok) {
+    printf("Added option is out of place.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* A message that is reset and refilled should not touch the heap.
+*/
+int COAP_REUSE() {
+  printf("===< COAP_REUSE >================================================\n");
+  CoAPMessage req;
+  CoAPMessage resp;
+  StringBuilder first;
+  build_request(&req, 1);
+  req.serialize(&first);
+
+  unsigned long allocs = heap_allocs;
+  for (int i = 0; i < 100; i++) {
+    req.reset();
+    build_request(&req, 1);
+    resp.reset();
+    build_response(&req, &resp);
+    req.getPDUPointer();
+    resp.getPDUPointer();
+  }
+  if (heap_allocs != allocs) {
+    printf("Reused messages cost %lu heap allocations.\n", heap_allocs - allocs);
+    return -1;
+  }
+  if ((first.length() != req.getPDULength()) || memcmp(first.string(), req.getPDUPointer(), first.length())) {
+    printf("A reused message built a different PDU.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* Runs requests and responses between two sockets on the loopback interface.
+*   If reuse is false, every PDU gets a new message, as the session used to.
+*
+* @return The number of exchanges that completed intact.
+*/
+int run_exchanges(int client, int server, struct sockaddr_in* srv_addr, bool reuse) {
+  uint8_t rx[COAP_PDU_BUFFER_SIZE];
+  struct sockaddr_in peer;
+  socklen_t peer_len;
+  int intact = 0;
+  // The client's request, the server's view of it, the server's response, and the client's view of that.
+  CoAPMessage* msgs[4];
+  for (int j = 0; j < 4; j++) msgs[j] = reuse ? new CoAPMessage() : nullptr;
+
+  for (int i = 0; i < COAP_BENCH_EXCHANGES; i++) {
+    if (!reuse) {
+      for (int j = 0; j < 4; j++) msgs[j] = new CoAPMessage();
+    }
+    else {
+      msgs[0]->reset();
+      msgs[2]->reset();
+    }
+    build_request(msgs[0], (uint16_t) i);
+    sendto(client, msgs[0]->getPDUPointer(), msgs[0]->getPDULength(), 0, (struct sockaddr*) srv_addr, sizeof(*srv_addr));
+
+    peer_len = sizeof(peer);
+    int n = recvfrom(server, rx, sizeof(rx), 0, (struct sockaddr*) &peer, &peer_len);
+    if (0 < msgs[1]->accumulate(rx, n)) {
+      build_response(msgs[1], msgs[2]);
+      sendto(server, msgs[2]->getPDUPointer(), msgs[2]->getPDULength(), 0, (struct sockaddr*) &peer, peer_len);
+
+      n = recvfrom(client, rx, sizeof(rx), 0, nullptr, nullptr);
+      if ((0 < msgs[3]->accumulate(rx, n)) && ((uint16_t) i == msgs[3]->getMessageID())) {
+        if ((13 == msgs[3]->getPayloadLength()) && (1 == msgs[3]->getNumOptions())) {
+          intact++;
+        }
+      }
+    }
+    if (!reuse) {
+      for (int j = 0; j < 4; j++) delete msgs[j];
+    }
+  }
+  if (reuse) {
+    for (int j = 0; j < 4; j++) delete msgs[j];
+  }
+  return intact;
+}
+
+
+int COAP_LOOPBACK_BENCH() {
+  printf("===< COAP_LOOPBACK_BENCH >=======================================\n");
+  struct sockaddr_in srv_addr;
+  memset(&srv_addr, 0, sizeof(srv_addr));
+  srv_addr.sin_family      = AF_INET;
+  srv_addr.sin_port        = htons(COAP_BENCH_PORT);
+  srv_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int server = socket(AF_INET, SOCK_DGRAM, 0);
+  int client = socket(AF_INET, SOCK_DGRAM, 0);
+  if ((0 > server) || (0 > client) || bind(server, (struct sockaddr*) &srv_addr, sizeof(srv_addr))) {
+    printf("Could not open loopback sockets. Skipping the benchmark.\n");
+    if (0 <= server) close(server);
+    if (0 <= client) close(client);
+    return 0;
+  }
+
+  run_exchanges(client, server, &srv_addr, true);   // Warm up the slab.
+
+  unsigned long allocs = heap_allocs;
+  unsigned long start  = micros();
+  int fresh_ok = run_exchanges(client, server, &srv_addr, false);
+  unsigned long fresh_us     = micros() - start;
+  unsigned long fresh_allocs = heap_allocs - allocs;
+
+  allocs = heap_allocs;
+  start  = micros();
+  int reuse_ok = run_exchanges(client, server, &srv_addr, true);
+  unsigned long reuse_us     = micros() - start;
+  unsigned long reuse_allocs = heap_allocs - allocs;
+  close(server);
+  close(client);
+
+  printf("\t %d CoAP request/response exchanges over loopback UDP.\n", COAP_BENCH_EXCHANGES);
+  printf("\t Fresh messages:   %8lu us  %8.0f exchanges/s  %6.2f allocs/exchange\n",
+    fresh_us, COAP_BENCH_EXCHANGES / (fresh_us / 1000000.0), fresh_allocs / (double) COAP_BENCH_EXCHANGES);
+  printf("\t Reused messages:  %8lu us  %8.0f exchanges/s  %6.2f allocs/exchange\n",
+    reuse_us, COAP_BENCH_EXCHANGES / (reuse_us / 1000000.0), reuse_allocs / (double) COAP_BENCH_EXCHANGES);
+
+  if ((COAP_BENCH_EXCHANGES != fresh_ok) || (COAP_BENCH_EXCHANGES != reuse_ok)) {
+    printf("Exchanges intact: %d fresh, %d reused.\n", fresh_ok, reuse_ok);
+    return -1;
+  }
+  if (0 != reuse_allocs) {
+    printf("Reused messages touched the heap.\n");
+    return -1;
+  }
+  return 0;
+}
+#endif  // MANUVR_SUPPORT_COAP
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(MANUVR_SUPPORT_COAP)
+    if (0 == COAP_BUILD_ORDER()) {
+      if (0 == COAP_REUSE()) {
+        if (0 == COAP_LOOPBACK_BENCH()) {
+          printf("**********************************\n");
+          printf("*  CoAP tests all pass           *\n");
+          printf("**********************************\n");
+          exit_value = 0;
+        }
+        else printTestFailure("COAP_LOOPBACK_BENCH");
+      }
+      else printTestFailure("COAP_REUSE");
+    }
+    else printTestFailure("COAP_BUILD_ORDER");
+  #else
+    printf("CoAP support was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}
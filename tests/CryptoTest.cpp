@@ -234,6 +234,140 @@ int CRYPTO_TEST_SYMMETRIC() {
 #endif // __BUILD_HAS_SYMMETRIC
 
 
+/*
+* Reusable contexts.
+* A digest fed from a fragmented StringBuilder must match the one-shot digest
+*   of the same bytes, and a keyed cipher context must match the one-shot
+*   cipher. Then we measure what the contexts save us.
+*/
+int CRYPTO_TEST_CONTEXTS() {
+  printf("===< CRYPTO_TEST_CONTEXTS >======================================\n");
+  const int BENCH_ROUNDS = 2000;
+  const int BENCH_SIZES[] = { 64, 1500 };
+  uint8_t buf_in[1536];
+  uint8_t buf_out[1536];
+  random_fill(buf_in, sizeof(buf_in));
+
+  #if defined(__BUILD_HAS_DIGEST)
+  {
+    Hashes* algs_to_test = list_supported_digests();
+    int idx = 0;
+    while (Hashes::NONE != algs_to_test[idx]) {
+      const Hashes h = algs_to_test[idx];
+      const int o_len = get_digest_output_length(h);
+      uint8_t* hash_flat  = (uint8_t*) alloca(o_len);
+      uint8_t* hash_frags = (uint8_t*) alloca(o_len);
+
+      // Build an uncollapsed buffer with fragments of uneven length.
+      StringBuilder frags;
+      int offset = 0;
+      int frag_len = 1;
+      while (offset < 1500) {
+        int n = ((1500 - offset) < frag_len) ? (1500 - offset) : frag_len;
+        frags.concat(&buf_in[offset], n);
+        offset += n;
+        frag_len = (frag_len * 3) + 1;
+      }
+
+      HashContext ctx;
+      int ret = wrapped_hash_init(&ctx, h);
+      if (0 == ret) ret = wrapped_hash_start(&ctx);
+      if (0 == ret) ret = wrapped_hash_update_sb(&ctx, &frags);
+      if (0 == ret) ret = wrapped_hash_finish(&ctx, hash_frags);
+      if (0 != ret) {
+        printf("%s: Context digest failed.\n", get_digest_label(h));
+        wrapped_hash_free(&ctx);
+        return -1;
+      }
+      if ((0 != wrapped_hash(buf_in, 1500, hash_flat, h)) || (0 != memcmp(hash_flat, hash_frags, o_len))) {
+        printf("%s: Fragmented digest does not match the flat digest.\n", get_digest_label(h));
+        wrapped_hash_free(&ctx);
+        return -1;
+      }
+      if (1 < frags.count()) {
+        // The first comparison must not have been a trivial one.
+        printf("%-14s fragmented digest (%d fragments) matches.\n", get_digest_label(h), frags.count());
+      }
+
+      for (unsigned int s = 0; s < sizeof(BENCH_SIZES) / sizeof(int); s++) {
+        const int len = BENCH_SIZES[s];
+        unsigned long start = micros();
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+          wrapped_hash(buf_in, len, hash_flat, h);
+        }
+        unsigned long oneshot_us = micros() - start;
+        start = micros();
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+          wrapped_hash_start(&ctx);
+          wrapped_hash_update(&ctx, buf_in, len);
+          wrapped_hash_finish(&ctx, hash_frags);
+        }
+        unsigned long context_us = micros() - start;
+        printf("  %4d bytes:  one-shot %8lu us   context %8lu us   (%d rounds)\n", len, oneshot_us, context_us, BENCH_ROUNDS);
+      }
+      wrapped_hash_free(&ctx);
+      idx++;
+    }
+  }
+  #endif  // __BUILD_HAS_DIGEST
+
+  #if defined(__BUILD_HAS_SYMMETRIC) && defined(WRAPPED_SYM_AES_256_CBC)
+  {
+    const Cipher ci    = Cipher::SYM_AES_256_CBC;
+    const int key_size = get_cipher_key_length(ci);
+    uint8_t key[(key_size>>3)];
+    uint8_t iv_oneshot[16];
+    uint8_t iv_context[16];
+    random_fill(key, (key_size>>3));
+    bzero(iv_oneshot, 16);
+    bzero(iv_context, 16);
+
+    CipherContext ctx;
+    if (0 != wrapped_sym_cipher_init(&ctx, ci, key, key_size, OP_ENCRYPT)) {
+      printf("Failed to key the cipher context.\n");
+      wrapped_sym_cipher_free(&ctx);
+      return -1;
+    }
+
+    // Two chained updates must equal one pass over the whole buffer.
+    uint8_t* expected = (uint8_t*) alloca(1536);
+    if (0 != wrapped_sym_cipher(buf_in, 1536, expected, 1536, key, key_size, iv_oneshot, ci, OP_ENCRYPT)) {
+      printf("Failed to encrypt.\n");
+      wrapped_sym_cipher_free(&ctx);
+      return -1;
+    }
+    if ((0 != wrapped_sym_cipher_update(&ctx, buf_in, 512, buf_out, 512, iv_context)) ||
+        (0 != wrapped_sym_cipher_update(&ctx, &buf_in[512], 1024, &buf_out[512], 1024, iv_context)) ||
+        (0 != memcmp(expected, buf_out, 1536)) || (0 != memcmp(iv_oneshot, iv_context, 16))) {
+      printf("Cipher context output does not match the one-shot cipher.\n");
+      wrapped_sym_cipher_free(&ctx);
+      return -1;
+    }
+    printf("%-14s chained context output matches.\n", get_cipher_label(ci));
+
+    for (unsigned int s = 0; s < sizeof(BENCH_SIZES) / sizeof(int); s++) {
+      // Round down to the block size.
+      const int len = BENCH_SIZES[s] & ~15;
+      unsigned long start = micros();
+      for (int i = 0; i < BENCH_ROUNDS; i++) {
+        wrapped_sym_cipher(buf_in, len, buf_out, len, key, key_size, iv_oneshot, ci, OP_ENCRYPT);
+      }
+      unsigned long oneshot_us = micros() - start;
+      start = micros();
+      for (int i = 0; i < BENCH_ROUNDS; i++) {
+        wrapped_sym_cipher_update(&ctx, buf_in, len, buf_out, len, iv_context);
+      }
+      unsigned long context_us = micros() - start;
+      printf("  %4d bytes:  one-shot %8lu us   context %8lu us   (%d rounds)\n", len, oneshot_us, context_us, BENCH_ROUNDS);
+    }
+    wrapped_sym_cipher_free(&ctx);
+  }
+  #endif  // __BUILD_HAS_SYMMETRIC
+  printf("\n");
+  return 0;
+}
+
+
 #if defined(__BUILD_HAS_ASYMMETRIC)
 static std::map<CryptoKey, Trips*>  asym_estimate_deltas;
 
@@ -398,13 +532,16 @@ int main(int argc, char *argv[]) {
     if (0 == CRYPTO_TEST_RNG()) {
       if (0 == CRYPTO_TEST_HASHES()) {
         if (0 == CRYPTO_TEST_SYMMETRIC()) {
-          if (0 == CRYPTO_TEST_ASYMMETRIC()) {
-            printf("**********************************\n");
-            printf("*  Cryptography tests all pass   *\n");
-            printf("**********************************\n");
-            exit_value = 0;
+          if (0 == CRYPTO_TEST_CONTEXTS()) {
+            if (0 == CRYPTO_TEST_ASYMMETRIC()) {
+              printf("**********************************\n");
+              printf("*  Cryptography tests all pass   *\n");
+              printf("**********************************\n");
+              exit_value = 0;
+            }
+            else printTestFailure("CRYPTO_TEST_ASYMMETRIC");
           }
-          else printTestFailure("CRYPTO_TEST_ASYMMETRIC");
+          else printTestFailure("CRYPTO_TEST_CONTEXTS");
         }
         else printTestFailure("CRYPTO_TEST_SYMMETRIC");
       }
@@ -0,0 +1,257 @@
+/*
+File:   I2CTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the linux I2CAdapter against the in-process bus simulator, and compares
+  the cost of syncing a register-mapped device one register at a time with
+  the cost of doing it in bursts.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(CONFIG_MANUVR_I2C)
+#include <I2CAdapter.h>
+#include <Platform/Peripherals/I2C/I2CDeviceWithRegisters.h>
+#include <Platform/Targets/Linux/I2C/I2CSimBus.h>
+#include <linux/i2c.h>
+
+#define I2C_TEST_ADDR     0x40
+#define I2C_TEST_REGS     10     // Eight 8-bit registers and two 16-bit.
+#define I2C_TEST_REG_MEM  12
+
+
+/*
+* A register-mapped device with eight 8-bit registers at 0x00-0x07, and two
+*   16-bit registers at 0x08 and 0x0A. The last is read-only.
+*/
+class SimDevice : public I2CDeviceWithRegisters {
+  public:
+    int reads  = 0;
+    int writes = 0;
+
+    SimDevice() : I2CDeviceWithRegisters(I2C_TEST_ADDR, I2C_TEST_REGS, I2C_TEST_REG_MEM) {
+      for (uint16_t i = 0; i < 8; i++) {
+        defineRegister(i, (uint8_t) 0, false, false, true);
+      }
+      defineRegister((uint16_t) 0x08, (uint16_t) 0, false, false, true);
+      defineRegister((uint16_t) 0x0A, (uint16_t) 0, false, false, false);
+    };
+
+    /* Expose what the test needs. */
+    inline void    bursts(bool x) {              multi_access_support = x;          };
+    inline int8_t  sync_all() {                  return syncRegisters();            };
+    inline int8_t  flush() {                     return writeDirtyRegisters();      };
+    inline int8_t  stage(uint8_t r, unsigned int v) {  return writeIndirect(r, v, true);  };
+    inline unsigned int value(uint8_t r) {       return regValue(r);                };
+    inline bool    dirty(uint8_t r) {            return regDirty(r);                };
+
+  protected:
+    int8_t register_write_cb(DeviceRegister*) {  writes++;  return 0;  };
+    int8_t register_read_cb(DeviceRegister*) {   reads++;   return 0;  };
+};
+
+
+I2CSimSlave sim_slave;
+
+
+/*
+* Runs the kernel until the device has seen the given number of callbacks, or
+*   a second has passed.
+*/
+bool await_callbacks(SimDevice* dev, int* counter, int count) {
+  unsigned long deadline = millis() + 1000;
+  while (*counter < count) {
+    if (millis() > deadline) return false;
+    platform.kernel()->procIdleFlags();
+    sched_yield();
+  }
+  return true;
+}
+
+
+/*
+* The simulator on its own: register pointer, auto-increment, NAKs, and the
+*   accounting of bus time.
+*/
+int I2C_SIM_BUS() {
+  printf("===< I2C_SIM_BUS >===============================================\n");
+  int return_value = -1;
+  uint8_t wr[4] = { 0x10, 0xAA, 0xBB, 0xCC };
+  uint8_t sa    = 0x11;
+  uint8_t rd[2] = { 0, 0 };
+  struct i2c_msg msgs[3] = {
+    { I2C_TEST_ADDR, 0,        4, wr },   // Write three registers from 0x10.
+    { I2C_TEST_ADDR, 0,        1, &sa },  // Point at 0x11...
+    { I2C_TEST_ADDR, I2C_M_RD, 2, rd }    // ...and read two back.
+  };
+  I2CSimBus::resetStats();
+  if (3 == I2CSimBus::transfer(msgs, 3)) {
+    if ((0xBB == rd[0]) && (0xCC == rd[1]) && (0xAA == sim_slave.regs[0x10])) {
+      if ((1 == I2CSimBus::transfers()) && (3 == I2CSimBus::messages()) && (7 == I2CSimBus::bytes())) {
+        struct i2c_msg nobody = { I2C_TEST_ADDR + 1, 0, 1, &sa };
+        if (0 > I2CSimBus::transfer(&nobody, 1)) {
+          return_value = 0;
+        }
+        else printf("A transfer to an absent slave was not NAK'd.\n");
+      }
+      else printf("Simulator stats are wrong (%u transfers, %u messages, %u bytes).\n", I2CSimBus::transfers(), I2CSimBus::messages(), I2CSimBus::bytes());
+    }
+    else printf("Simulated register file holds the wrong values.\n");
+  }
+  else printf("Simulated transfer failed.\n");
+  return return_value;
+}
+
+
+/*
+* Syncs the device register-by-register, and then in bursts. The bursts must
+*   get the same data with fewer transfers and less bus time.
+*/
+int I2C_REGISTER_BURSTS(SimDevice* dev) {
+  printf("===< I2C_REGISTER_BURSTS >=======================================\n");
+  int return_value = -1;
+  for (int i = 0; i < 256; i++) sim_slave.regs[i] = (uint8_t) (0x30 + i);
+
+  dev->bursts(false);
+  dev->reads = 0;
+  I2CSimBus::resetStats();
+  if ((0 == dev->sync_all()) && await_callbacks(dev, &dev->reads, I2C_TEST_REGS)) {
+    const uint32_t single_xfers = I2CSimBus::transfers();
+    const uint32_t single_us    = I2CSimBus::busMicros();
+    printf("\tOne register at a time:  %u transfers, %u us of bus time.\n", single_xfers, single_us);
+
+    for (int i = 0; i < 256; i++) sim_slave.regs[i] = (uint8_t) (0x50 + i);
+    dev->bursts(true);
+    dev->reads = 0;
+    I2CSimBus::resetStats();
+    if ((0 == dev->sync_all()) && await_callbacks(dev, &dev->reads, I2C_TEST_REGS)) {
+      const uint32_t burst_xfers = I2CSimBus::transfers();
+      const uint32_t burst_us    = I2CSimBus::busMicros();
+      printf("\tIn bursts:               %u transfers, %u us of bus time.\n", burst_xfers, burst_us);
+      if ((0x55 == dev->value(0x05)) && (0x5A5B == dev->value(0x0A))) {
+        if ((burst_xfers < single_xfers) && (burst_us < single_us)) {
+          return_value = 0;
+        }
+        else printf("Bursts were no cheaper.\n");
+      }
+      else printf("Burst read got the wrong values (0x%02x, 0x%04x).\n", dev->value(0x05), dev->value(0x0A));
+    }
+    else printf("Burst sync did not complete.\n");
+  }
+  else printf("Single-register sync did not complete.\n");
+  return return_value;
+}
+
+
+/*
+* Adjacent dirty registers go out together. A clean register breaks the run.
+*/
+int I2C_DIRTY_BURSTS(SimDevice* dev) {
+  printf("===< I2C_DIRTY_BURSTS >==========================================\n");
+  int return_value = -1;
+  dev->bursts(true);
+  dev->writes = 0;
+  dev->stage(0x01, 0x11);
+  dev->stage(0x02, 0x22);
+  dev->stage(0x03, 0x33);
+  dev->stage(0x06, 0x66);
+  dev->stage(0x07, 0x77);
+  dev->stage(0x08, 0x0102);
+  I2CSimBus::resetStats();
+  if ((0 == dev->flush()) && await_callbacks(dev, &dev->writes, 6)) {
+    if (2 == I2CSimBus::transfers()) {
+      if ((0x33 == sim_slave.regs[0x03]) && (0x77 == sim_slave.regs[0x07]) && (0x02 == sim_slave.regs[0x09])) {
+        if (!dev->dirty(0x01) && !dev->dirty(0x08)) {
+          return_value = 0;
+        }
+        else printf("Registers are still dirty after the write.\n");
+      }
+      else printf("The slave didn't get the right values.\n");
+    }
+    else printf("Expected 2 transfers, but saw %u.\n", I2CSimBus::transfers());
+  }
+  else printf("Dirty register write did not complete.\n");
+  return return_value;
+}
+
+
+#endif  // CONFIG_MANUVR_I2C
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+
+  #if defined(CONFIG_MANUVR_I2C)
+    // The simulator must be up before the adapter opens the bus.
+    memset(&sim_slave, 0, sizeof(sim_slave));
+    sim_slave.addr = I2C_TEST_ADDR;
+    I2CSimBus::attach(&sim_slave);
+    I2CSimBus::enable(true);
+
+    const I2CAdapterOptions i2c_opts(
+      1,   // Device number
+      255, // sda
+      255  // scl
+    );
+    I2CAdapter i2c(&i2c_opts);
+    SimDevice dev;
+    platform.kernel()->subscribe(&i2c);
+    platform.bootstrap();
+    i2c.addSlaveDevice(&dev);
+
+    if (0 == I2C_SIM_BUS()) {
+      if (0 == I2C_REGISTER_BURSTS(&dev)) {
+        if (0 == I2C_DIRTY_BURSTS(&dev)) {
+          printf("**********************************\n");
+          printf("*  I2C tests all pass            *\n");
+          printf("**********************************\n");
+          exit_value = 0;
+        }
+        else printTestFailure("I2C_DIRTY_BURSTS");
+      }
+      else printTestFailure("I2C_REGISTER_BURSTS");
+    }
+    else printTestFailure("I2C_SIM_BUS");
+  #else
+    platform.bootstrap();
+    printf("I2C support was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}
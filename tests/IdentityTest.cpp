@@ -36,6 +36,9 @@ This program runs tests on Identity elements.
 #include <Platform/Platform.h>
 #include <Types/cbor-cpp/cbor.h>
 #include <Platform/Identity.h>
+#if defined(__HAS_CRYPT_WRAPPER)
+  #include <Platform/Identity/IdentityVerifier.h>
+#endif
 
 
 IdentityUUID* id_uuid = nullptr;
@@ -143,6 +146,181 @@ int CRYPTO_IDENT_TESTS() {
 }
 
 
+#if defined(__HAS_CRYPT_WRAPPER) && defined(__BUILD_HAS_ASYMMETRIC)
+#define IDENT_BATCH_IDENTITIES    4
+#define IDENT_BATCH_TUPLES      256
+
+static int          batches_seen    = 0;
+static int          batches_landed  = 0;   // Seen while their batch was still in flight.
+static VerifyBatch* batch_watched   = nullptr;
+
+// Exposes the raw public key, so we can compare against the stateless path.
+class BatchPubKey : public IdentityPubKey {
+  public:
+    BatchPubKey(const char* nom, Cipher c, CryptoKey k) : IdentityPubKey(nom, c, k) {};
+    inline uint8_t* pub() {     return _pub;       };
+    inline uint16_t pubLen() {  return _pub_size;  };
+    inline Hashes   digest() {  return _digest;    };
+};
+
+int batch_listener(ManuvrMsg* m) {
+  if ((nullptr != batch_watched) && batch_watched->raised(m)) {
+    batches_seen++;
+    // The Kernel isn't finished with the event, so the batch must still be held.
+    if (batch_watched->inFlight()) batches_landed++;
+  }
+  return 0;
+}
+
+/*
+* Runs the Kernel until the batch lands, or we give up.
+*
+* @return true if the batch landed.
+*/
+bool wait_for_batch(VerifyBatch* batch) {
+  Kernel* kernel = platform.kernel();
+  unsigned long give_up = millis() + 20000;
+  while (batch->inFlight() && (millis() < give_up)) {
+    kernel->procIdleFlags();
+    sleep_millis(1);
+  }
+  return !batch->inFlight();
+}
+
+/*
+* Checks the results of a landed batch.
+*
+* @return 0 if every tuple has the expected result.
+*/
+int check_batch(VerifyBatch* batch, int expected_pass) {
+  if (expected_pass != (int) batch->passed()) {
+    printf("Batch passed %u tuples. Expected %d.\n", batch->passed(), expected_pass);
+    return -1;
+  }
+  for (int i = 0; i < IDENT_BATCH_TUPLES; i++) {
+    const bool bad = (0 == (i % 16));
+    if ((0 == batch->job(i)->result) == bad) {
+      printf("Tuple %d has the wrong result.\n", i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+* Checks a batch of signatures through the IdentityVerifier, and compares its
+*   rate against verifying the same tuples one at a time, from raw keys.
+*/
+int VERIFY_BATCH_TESTS() {
+  printf("===< VERIFY_BATCH_TESTS >========================================\n");
+  int return_value = -1;
+  Kernel* kernel = platform.kernel();
+  const char* msg = "Pay no attention to the man behind the curtain.";
+  const size_t msg_len = strlen(msg);
+  uint8_t tampered[64];
+  memcpy(tampered, msg, msg_len);
+  tampered[0] ^= 0x01;
+
+  BatchPubKey* idents[IDENT_BATCH_IDENTITIES];
+  uint8_t* sigs[IDENT_BATCH_IDENTITIES];
+  size_t   sig_lens[IDENT_BATCH_IDENTITIES];
+  int signed_count = 0;
+  for (int i = 0; i < IDENT_BATCH_IDENTITIES; i++) {
+    idents[i]   = new BatchPubKey("BatchIdent", Cipher::ASYM_ECDSA, CryptoKey::ECC_SECP256R1);
+    sig_lens[i] = idents[i]->sizeOutputBuffer(0);
+    sigs[i]     = (uint8_t*) alloca(sig_lens[i]);
+    if (0 == idents[i]->sign((uint8_t*) msg, msg_len, sigs[i], &sig_lens[i])) {
+      signed_count++;
+    }
+  }
+
+  // Every 16th tuple has a message that doesn't match its signature.
+  VerifyBatch batch(nullptr);
+  int expected_pass = 0;
+  for (int i = 0; i < IDENT_BATCH_TUPLES; i++) {
+    const int n = i % IDENT_BATCH_IDENTITIES;
+    const bool bad = (0 == (i % 16));
+    if (!bad) expected_pass++;
+    batch.add(idents[n], (bad ? tampered : (uint8_t*) msg), msg_len, sigs[n], sig_lens[n]);
+  }
+
+  batch_watched = &batch;
+  kernel->before(MANUVR_MSG_IDENT_VERIFIED, batch_listener, 0);
+  if (IDENT_BATCH_IDENTITIES != signed_count) {
+    printf("Only %d of %d identities could sign.\n", signed_count, IDENT_BATCH_IDENTITIES);
+  }
+  else if (0 != IdentityVerifier::submit(&batch)) {
+    printf("Failed to submit the batch.\n");
+  }
+  else if (0 == IdentityVerifier::submit(&batch)) {
+    printf("Submitted a batch that was already in flight.\n");
+  }
+  else if (!wait_for_batch(&batch) || (1 != batches_seen)) {
+    printf("The batch never finished.\n");
+  }
+  else if (1 != batches_landed) {
+    printf("The batch was let go before the Kernel was finished with its event.\n");
+  }
+  else if (0 == check_batch(&batch, expected_pass)) {
+    const uint32_t batch_rate = batch.verifiesPerSecond();
+
+    // Now the same tuples on this thread alone. First the old way, parsing the
+    //   key for every signature, and then with each identity's cached key.
+    unsigned long start = micros();
+    for (int i = 0; i < IDENT_BATCH_TUPLES; i++) {
+      const int n = i % IDENT_BATCH_IDENTITIES;
+      size_t sig_len = sig_lens[n];
+      wrapped_sign_verify(Cipher::ASYM_ECDSA, CryptoKey::ECC_SECP256R1, idents[n]->digest(),
+        (0 == (i % 16)) ? tampered : (uint8_t*) msg, msg_len,
+        sigs[n], &sig_len, idents[n]->pub(), idents[n]->pubLen(), OP_VERIFY
+      );
+    }
+    const unsigned long parsing_us = micros() - start;
+    start = micros();
+    for (int i = 0; i < IDENT_BATCH_TUPLES; i++) {
+      const int n = i % IDENT_BATCH_IDENTITIES;
+      size_t sig_len = sig_lens[n];
+      idents[n]->verify((0 == (i % 16)) ? tampered : (uint8_t*) msg, msg_len, sigs[n], &sig_len);
+    }
+    const unsigned long cached_us = micros() - start;
+
+    printf("Batch of %d:  %u verifies/sec over %d workers (%u us).\n", IDENT_BATCH_TUPLES, batch_rate, IDENT_VERIFY_WORKERS, batch.elapsedMicros());
+    printf("Serial, parsing keys: %lu us.\n", parsing_us);
+    printf("Serial, cached keys:  %lu us.\n", cached_us);
+    StringBuilder out;
+    IdentityVerifier::printDebug(&out);
+    printf("%s\n", (const char*) out.string());
+
+    // A landed batch can go around again.
+    if (0 != IdentityVerifier::submit(&batch)) {
+      printf("Failed to resubmit the batch.\n");
+    }
+    else if (!wait_for_batch(&batch) || (2 != batches_seen) || (2 != batches_landed)) {
+      printf("The resubmitted batch never finished.\n");
+    }
+    else {
+      return_value = check_batch(&batch, expected_pass);
+    }
+  }
+
+  // The identities and the batch must not go away under the workers, and a
+  //   batch in flight would wait on the Kernel (which is us) as it is destroyed.
+  if (!wait_for_batch(&batch)) {
+    printf("The batch is stuck in flight.\n");
+    exit(1);
+  }
+  kernel->unregisterCallbacks(MANUVR_MSG_IDENT_VERIFIED, batch_listener, nullptr);
+  batch_watched = nullptr;
+  for (int i = 0; i < IDENT_BATCH_IDENTITIES; i++) delete idents[i];
+  return return_value;
+}
+#else
+int VERIFY_BATCH_TESTS() {
+  return 0;
+}
+#endif  // __HAS_CRYPT_WRAPPER && __BUILD_HAS_ASYMMETRIC
+
+
 void printTestFailure(const char* test) {
   printf("\n");
   printf("*********************************************\n");
@@ -165,10 +343,13 @@ int main(int argc, char *argv[]) {
 
   if (0 == UUID_IDENT_TESTS()) {
     if (0 == CRYPTO_IDENT_TESTS()) {
-      printf("**********************************\n");
-      printf("*  Identity tests all pass       *\n");
-      printf("**********************************\n");
-      exit_value = 0;
+      if (0 == VERIFY_BATCH_TESTS()) {
+        printf("**********************************\n");
+        printf("*  Identity tests all pass       *\n");
+        printf("**********************************\n");
+        exit_value = 0;
+      }
+      else printTestFailure("VERIFY_BATCH_TESTS");
     }
     else printTestFailure("CRYPTO_IDENT_TESTS");
   }
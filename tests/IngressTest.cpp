@@ -0,0 +1,246 @@
+/*
+File:   IngressTest.cpp
+Author: agent
+Date:   2026.10.16
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+This program hammers the Kernel's event ingress from several threads at once,
+  and makes certain that every event is delivered exactly once.
+Uses pthreads directly, so this test must run on linux.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#define MANUVR_MSG_INGRESS_TEST  0xF600
+#define INGRESS_PRODUCERS        4
+#define INGRESS_EVENTS_PER       50000
+#define INGRESS_TOTAL            (INGRESS_PRODUCERS * INGRESS_EVENTS_PER)
+
+
+/*
+* Globals.
+*/
+ManuvrMsg* test_events = nullptr;
+uint8_t    seen[INGRESS_TOTAL];
+uint32_t   delivered  = 0;
+uint32_t   misdeliver = 0;
+uint32_t   refused    = 0;   // Raises that were refused. Off-thread, there should be none.
+
+
+/* A receiver that tallies each test event as it arrives. */
+class IngressCounter : public EventReceiver {
+  public:
+    IngressCounter() : EventReceiver("IngressCounter") {};
+
+    const uint16_t* msgCodesOfInterest() {
+      static const uint16_t codes[] = { MANUVR_MSG_INGRESS_TEST, MANUVR_MSG_UNDEFINED };
+      return codes;
+    };
+
+    int8_t notify(ManuvrMsg* active_event) {
+      if (MANUVR_MSG_INGRESS_TEST == active_event->eventCode()) {
+        int idx = active_event - test_events;
+        if ((idx >= 0) && (idx < INGRESS_TOTAL)) {
+          seen[idx]++;
+          delivered++;
+        }
+        else {
+          misdeliver++;
+        }
+        return 1;
+      }
+      return EventReceiver::notify(active_event);
+    };
+};
+
+IngressCounter counter;
+
+
+/* Each producer raises its own slice of the test events. */
+void* producer_thread(void* arg) {
+  const int p = (int) (intptr_t) arg;
+  uint32_t fails = 0;
+  for (int i = 0; i < INGRESS_EVENTS_PER; i++) {
+    ManuvrMsg* ev = &test_events[(p * INGRESS_EVENTS_PER) + i];
+    // A full ring spills into the overflow list, so this never refuses.
+    if (0 != Kernel::staticRaiseEvent(ev)) fails++;
+  }
+  __atomic_add_fetch(&refused, fails, __ATOMIC_RELAXED);
+  return nullptr;
+}
+
+
+/*
+*
+*/
+int INGRESS_INIT_STATE() {
+  printf("===< INGRESS_INIT_STATE >========================================\n");
+  ManuvrMsg::registerMessage(MANUVR_MSG_INGRESS_TEST, 0, "INGRESS_TEST", ManuvrMsg::MSG_ARGS_NONE, nullptr);
+  platform.kernel()->subscribe(&counter);
+  memset(seen, 0, sizeof(seen));
+
+  test_events = new ManuvrMsg[INGRESS_TOTAL];
+  for (int i = 0; i < INGRESS_TOTAL; i++) {
+    test_events[i].repurpose(MANUVR_MSG_INGRESS_TEST, nullptr);
+    test_events[i].priority(i % INGRESS_PRODUCERS);
+    test_events[i].incRefs();   // The Kernel must not reclaim these.
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int INGRESS_STRESS() {
+  printf("===< INGRESS_STRESS >============================================\n");
+  Kernel* kernel = platform.kernel();
+  pthread_t producers[INGRESS_PRODUCERS];
+
+  unsigned long start = micros();
+  for (int p = 0; p < INGRESS_PRODUCERS; p++) {
+    if (pthread_create(&producers[p], nullptr, producer_thread, (void*) (intptr_t) p)) {
+      printf("Failed to create producer %d.\n", p);
+      return -1;
+    }
+  }
+
+  // We are the consumer.
+  unsigned long last_progress = millis();
+  uint32_t last_delivered = 0;
+  while (delivered < INGRESS_TOTAL) {
+    kernel->procIdleFlags();
+    if (delivered != last_delivered) {
+      last_delivered = delivered;
+      last_progress  = millis();
+    }
+    else if ((millis() - last_progress) > 5000) {
+      printf("Stalled at %u of %u events.\n", delivered, INGRESS_TOTAL);
+      break;
+    }
+  }
+  unsigned long elapsed = micros() - start;
+
+  for (int p = 0; p < INGRESS_PRODUCERS; p++) {
+    pthread_join(producers[p], nullptr);
+  }
+
+  printf("\t %d producers, %d events each.\n", INGRESS_PRODUCERS, INGRESS_EVENTS_PER);
+  printf("\t Delivered %u events in %lu us (%.0f events/sec).\n",
+    delivered, elapsed, (delivered * 1000000.0) / (double) elapsed
+  );
+  printf("\t Raises refused: %u\n", refused);
+  return ((INGRESS_TOTAL == delivered) && (0 == refused)) ? 0 : -1;
+}
+
+
+/*
+* On the Kernel's own thread, insertion happens before the raise returns, so
+*   a bad event is refused synchronously.
+*/
+int INGRESS_KERNEL_THREAD() {
+  printf("===< INGRESS_KERNEL_THREAD >=====================================\n");
+  Kernel* kernel = platform.kernel();
+  kernel->procIdleFlags();   // Claim the Kernel for this thread.
+  ManuvrMsg local;
+  local.repurpose(MANUVR_MSG_INGRESS_TEST, nullptr);
+  local.incRefs();   // The Kernel must not reclaim this.
+  ManuvrMsg* good = &local;
+  const int depth = kernel->queueSize();
+  if (0 == Kernel::staticRaiseEvent(good)) {
+    if ((depth + 1) == kernel->queueSize() && kernel->containsPreformedEvent(good)) {
+      if (-3 == Kernel::staticRaiseEvent(good)) {   // Already queued.
+        ManuvrMsg* bad = Kernel::returnEvent(MANUVR_MSG_UNDEFINED);
+        if (0 != Kernel::staticRaiseEvent(bad)) {
+          while (0 < kernel->queueSize()) kernel->procIdleFlags();
+          return 0;
+        }
+        else printf("An undefined event was accepted.\n");
+      }
+      else printf("A duplicate insertion was not refused.\n");
+    }
+    else printf("The event was not in the queue when the raise returned.\n");
+  }
+  else printf("Raise on the Kernel's thread failed.\n");
+  return -1;
+}
+
+
+/*
+*
+*/
+int INGRESS_COMPARE_RESULTS() {
+  printf("===< INGRESS_COMPARE_RESULTS >===================================\n");
+  int lost = 0;
+  int duped = 0;
+  for (int i = 0; i < INGRESS_TOTAL; i++) {
+    if (0 == seen[i]) lost++;
+    else if (1 < seen[i]) duped++;
+  }
+  printf("\t Lost: %d   Duplicated: %d   Misdelivered: %u\n", lost, duped, misdeliver);
+  platform.kernel()->unsubscribe(&counter);
+  delete[] test_events;
+  return ((0 == lost) && (0 == duped) && (0 == misdeliver)) ? 0 : -1;
+}
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  printf("EVENT_MANAGER_INGRESS_DEPTH      %d\n", EVENT_MANAGER_INGRESS_DEPTH);
+
+  if (0 == INGRESS_INIT_STATE()) {
+    if (0 == INGRESS_STRESS()) {
+      if (0 == INGRESS_COMPARE_RESULTS()) {
+        if (0 == INGRESS_KERNEL_THREAD()) {
+          printf("**********************************\n");
+          printf("*  Ingress tests all pass        *\n");
+          printf("**********************************\n");
+          exit_value = 0;
+        }
+        else printTestFailure("INGRESS_KERNEL_THREAD");
+      }
+      else printTestFailure("INGRESS_COMPARE_RESULTS");
+    }
+    else printTestFailure("INGRESS_STRESS");
+  }
+  else printTestFailure("INGRESS_INIT_STATE");
+
+  exit(exit_value);
+}
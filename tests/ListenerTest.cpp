@@ -0,0 +1,255 @@
+/*
+File:   ListenerTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the Kernel's call-ahead/callback listener tables, and benchmarks them
+  against the map-of-PriorityQueues arrangement they replaced.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#include <StringBuilder.h>
+#include <PriorityQueue.h>
+#include <DataStructures/ListenerTable.h>
+#include <Platform/Platform.h>
+
+#define MANUVR_MSG_LISTENER_TEST  0xF610
+#define LISTENER_BENCH_CODES      64      // Distinct codes with listeners.
+#define LISTENER_BENCH_FIRES      200000  // Fires per run.
+
+
+/*
+* Globals.
+*/
+int calls_a = 0;
+int calls_b = 0;
+int calls_c = 0;
+int order_log[8];
+int order_idx = 0;
+ListenerTable<ManuvrMsg*>* reentrant_table = nullptr;
+
+int listener_a(ManuvrMsg* m) {  calls_a++;  if (order_idx < 8) order_log[order_idx++] = 'a';  return 1;  }
+int listener_b(ManuvrMsg* m) {  calls_b++;  if (order_idx < 8) order_log[order_idx++] = 'b';  return 0;  }
+int listener_c(ManuvrMsg* m) {  calls_c++;  if (order_idx < 8) order_log[order_idx++] = 'c';  return 1;  }
+
+/* Removes itself, and adds listener_c, from within a fire(). */
+int listener_mutator(ManuvrMsg* m) {
+  reentrant_table->remove(1, listener_mutator);
+  reentrant_table->add(1, listener_c);
+  return 1;
+}
+
+/* Unregisters itself from the Kernel while the Kernel is dispatching. */
+int kernel_self_removing(ManuvrMsg* m) {
+  calls_a++;
+  platform.kernel()->unregisterCallbacks(MANUVR_MSG_LISTENER_TEST, kernel_self_removing, nullptr);
+  return 1;
+}
+
+int bench_listener(ManuvrMsg* m) {  return 1;  }
+
+
+/*
+* The arrangement that ListenerTable replaced, reproduced for comparison.
+*/
+int legacy_fire(std::map<uint16_t, PriorityQueue<listenerFxnPtr>*>* listeners, uint16_t code, ManuvrMsg* m) {
+  int return_value = 0;
+  std::map<uint16_t, PriorityQueue<listenerFxnPtr>*>::iterator it = listeners->find(code);
+  if (it != listeners->end()) {
+    PriorityQueue<listenerFxnPtr>* queue = (*listeners)[code];
+    if (nullptr != queue) {
+      for (int i = 0; i < queue->size(); i++) {
+        if (queue->recycle()(m)) return_value++;
+      }
+    }
+  }
+  return return_value;
+}
+
+
+/*
+*
+*/
+int LISTENER_ORDER_AND_REMOVAL() {
+  printf("===< LISTENER_ORDER_AND_REMOVAL >================================\n");
+  ListenerTable<ManuvrMsg*> table;
+  table.add(5, listener_a);
+  table.add(3, listener_c);
+  table.add(5, listener_b);
+  table.add(5, listener_c);
+
+  order_idx = 0;
+  if (2 != table.fire(5, nullptr)) {
+    printf("Fire returned the wrong count.\n");
+    return -1;
+  }
+  if ((3 != order_idx) || ('a' != order_log[0]) || ('b' != order_log[1]) || ('c' != order_log[2])) {
+    printf("Listeners fired out of registration order.\n");
+    return -1;
+  }
+  if (0 != table.fire(4, nullptr)) {
+    printf("A code with no listeners fired something.\n");
+    return -1;
+  }
+  if (table.remove(5, listener_b) || (0 == table.remove(5, listener_b))) {
+    printf("Removal did not behave.\n");
+    return -1;
+  }
+  if ((2 != table.count(5)) || (1 != table.count(3)) || (3 != table.size())) {
+    printf("Counts are wrong after removal.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int LISTENER_REENTRANCY() {
+  printf("===< LISTENER_REENTRANCY >=======================================\n");
+  ListenerTable<ManuvrMsg*> table;
+  reentrant_table = &table;
+  table.add(1, listener_mutator);
+  table.add(1, listener_a);
+  calls_a = 0;
+  calls_c = 0;
+
+  table.fire(1, nullptr);
+  if ((1 != calls_a) || (0 != calls_c)) {
+    printf("A listener added during fire() saw the event (a=%d, c=%d).\n", calls_a, calls_c);
+    return -1;
+  }
+  if ((2 != table.count(1)) || (2 != table.size())) {
+    printf("Deferred changes were not settled.\n");
+    return -1;
+  }
+  table.fire(1, nullptr);
+  if ((2 != calls_a) || (1 != calls_c)) {
+    printf("Deferred changes did not take effect (a=%d, c=%d).\n", calls_a, calls_c);
+    return -1;
+  }
+
+  // Now through the Kernel.
+  Kernel* kernel = platform.kernel();
+  ManuvrMsg::registerMessage(MANUVR_MSG_LISTENER_TEST, 0, "LISTENER_TEST", ManuvrMsg::MSG_ARGS_NONE, nullptr);
+  calls_a = 0;
+  kernel->before(MANUVR_MSG_LISTENER_TEST, kernel_self_removing, 0);
+  for (int i = 0; i < 3; i++) {
+    Kernel::raiseEvent(MANUVR_MSG_LISTENER_TEST, nullptr);
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  }
+  if (1 != calls_a) {
+    printf("Kernel listener that removed itself was called %d times.\n", calls_a);
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int LISTENER_BENCHMARK() {
+  printf("===< LISTENER_BENCHMARK >========================================\n");
+  std::map<uint16_t, PriorityQueue<listenerFxnPtr>*> legacy;
+  ListenerTable<ManuvrMsg*> table;
+  // Codes with listeners are spread out, with 1-3 listeners each. Half of all
+  //   fires are for codes that nobody listens for, as is typical.
+  for (int i = 0; i < LISTENER_BENCH_CODES; i++) {
+    const uint16_t code = 0x0100 + (i * 7);
+    PriorityQueue<listenerFxnPtr>* queue = new PriorityQueue<listenerFxnPtr>();
+    legacy[code] = queue;
+    for (int n = 0; n <= (i % 3); n++) {
+      queue->insert(bench_listener);
+      table.add(code, bench_listener);
+    }
+  }
+  uint16_t* codes = (uint16_t*) malloc(LISTENER_BENCH_FIRES * sizeof(uint16_t));
+  for (int i = 0; i < LISTENER_BENCH_FIRES; i++) {
+    const uint32_t r = randomUInt32();
+    codes[i] = (r & 1) ? (0x0100 + (((r >> 1) % LISTENER_BENCH_CODES) * 7)) : (0x0800 + (r >> 20));
+  }
+
+  int legacy_hits = 0;
+  unsigned long start = micros();
+  for (int i = 0; i < LISTENER_BENCH_FIRES; i++) {
+    legacy_hits += legacy_fire(&legacy, codes[i], nullptr);
+  }
+  unsigned long legacy_us = micros() - start;
+
+  int table_hits = 0;
+  start = micros();
+  for (int i = 0; i < LISTENER_BENCH_FIRES; i++) {
+    table_hits += table.fire(codes[i], nullptr);
+  }
+  unsigned long table_us = micros() - start;
+
+  printf("\t %d fires over %d listened codes.\n", LISTENER_BENCH_FIRES, LISTENER_BENCH_CODES);
+  printf("\t map + PriorityQueue:  %8lu us  (%.1f ns/event)\n", legacy_us, (legacy_us * 1000.0) / LISTENER_BENCH_FIRES);
+  printf("\t ListenerTable:        %8lu us  (%.1f ns/event)\n", table_us,  (table_us  * 1000.0) / LISTENER_BENCH_FIRES);
+
+  std::map<uint16_t, PriorityQueue<listenerFxnPtr>*>::iterator it;
+  for (it = legacy.begin(); it != legacy.end(); it++) delete it->second;
+  free(codes);
+
+  if (legacy_hits != table_hits) {
+    printf("Implementations disagree (%d vs %d).\n", legacy_hits, table_hits);
+    return -1;
+  }
+  return 0;
+}
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  if (0 == LISTENER_ORDER_AND_REMOVAL()) {
+    if (0 == LISTENER_REENTRANCY()) {
+      if (0 == LISTENER_BENCHMARK()) {
+        printf("**********************************\n");
+        printf("*  Listener tests all pass       *\n");
+        printf("**********************************\n");
+        exit_value = 0;
+      }
+      else printTestFailure("LISTENER_BENCHMARK");
+    }
+    else printTestFailure("LISTENER_REENTRANCY");
+  }
+  else printTestFailure("LISTENER_ORDER_AND_REMOVAL");
+
+  exit(exit_value);
+}
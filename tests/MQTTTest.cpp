@@ -0,0 +1,683 @@
+/*
+File:   MQTTTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the MQTT topic trie against a brute-force matcher, and measures it (and
+  the session's inbound PUBLISH path) against a large subscription set.
+Then measures the outbound path through the in-flight window, against a broker
+  stand-in that acknowledges what it is sent, and checks the backlog behind the
+  window and exactly-once delivery of inbound QoS2.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(MANUVR_SUPPORT_MQTT)
+#include <XenoSession/MQTT/MQTTSession.h>
+
+#define MQTT_TEST_MSG           0xF630
+#define MQTT_BENCH_TOPICS       10000
+#define MQTT_BENCH_LOOKUPS      100000
+#define MQTT_BENCH_LEGACY       1000     // The linear search is too slow to run as often.
+#define MQTT_BENCH_PUBLISHES    100000
+#define MQTT_BENCH_BATCH        64       // PUBLISH packets per drain of the Kernel.
+#define MQTT_BENCH_SLICE        997      // Bytes per read from the "transport".
+#define MQTT_BENCH_UPLINK       20000    // Outbound QoS1 publications.
+
+static const unsigned char MQTT_TEST_ARGS[] = {(unsigned char) TCode::UINT32, 0};
+
+/*
+* Globals.
+*/
+ManuvrMsg* runnables      = nullptr;   // One per benchmark topic.
+uint32_t   deliveries     = 0;
+uint32_t   bad_deliveries = 0;
+
+/*
+* Stands in for a broker on the far end of a transport. It acknowledges every
+*   PUBLISH it is written, and holds the acknowledgements until told to deliver
+*   them, as a network would.
+*/
+class BrokerStandIn : public BufferPipe {
+  public:
+    uint32_t writes    = 0;
+    uint32_t publishes = 0;
+    uint32_t dups      = 0;
+    uint32_t pubrels   = 0;
+    uint32_t drop_acks = 0;   // How many acknowledgements to "lose".
+
+    BrokerStandIn() : BufferPipe() {};
+    ~BrokerStandIn() {};
+
+    const char* pipeName() {  return "BrokerStandIn";  };
+
+    int8_t toCounterparty(StringBuilder* buf, int8_t mm) {
+      uint8_t* p   = buf->string();
+      int      len = buf->length();
+      writes++;
+      while (len > 1) {
+        const uint8_t hdr = *p;
+        int rem = 0;
+        int hdr_len = 1;
+        int multiplier = 1;
+        do {
+          rem += (*(p + hdr_len) & 127) * multiplier;
+          multiplier *= 128;
+        } while (*(p + hdr_len++) & 128);
+        const uint8_t* body = p + hdr_len;
+        switch (hdr >> 4) {
+          case PUBLISH:
+            publishes++;
+            if (hdr & 0x08) dups++;
+            if (((hdr >> 1) & 3) > 0) {
+              const int id_at = 2 + (*body * 256) + *(body + 1);
+              if (drop_acks > 0) {
+                drop_acks--;
+              }
+              else {
+                _reply((((hdr >> 1) & 3) == 1) ? PUBACK : PUBREC, *(body + id_at), *(body + id_at + 1));
+              }
+            }
+            break;
+          case PUBREL:
+            pubrels++;
+            _reply(PUBCOMP, *body, *(body + 1));
+            break;
+          default:
+            break;
+        }
+        p   += hdr_len + rem;
+        len -= hdr_len + rem;
+      }
+      return MEM_MGMT_RESPONSIBLE_BEARER;
+    };
+
+    /* Sends everything we've held back to the session. */
+    void deliver() {
+      if (0 < replies.length()) {
+        StringBuilder out;
+        out.concatHandoff(&replies);
+        far()->fromCounterparty(&out, MEM_MGMT_RESPONSIBLE_CREATOR);
+      }
+    };
+
+    void reset() {
+      writes    = 0;
+      publishes = 0;
+      dups      = 0;
+      pubrels   = 0;
+    };
+
+
+  private:
+    StringBuilder replies;
+
+    void _reply(uint8_t type, uint8_t id_msb, uint8_t id_lsb) {
+      uint8_t pkt[4] = { (uint8_t) ((type << 4) | ((PUBREL == type) ? 0x02 : 0x00)), 0x02, id_msb, id_lsb };
+      replies.concat(pkt, 4);
+    };
+};
+
+
+/* Each benchmark runnable carries the index of its own topic. */
+int delivery_listener(ManuvrMsg* m) {
+  uint32_t idx = 0;
+  deliveries++;
+  if ((0 != m->getArgAs(&idx)) || (1 != m->argCount()) || ((uint32_t) (m - runnables) != idx)) {
+    bad_deliveries++;
+  }
+  return 1;
+}
+
+void bench_topic(char* buf, unsigned idx) {
+  sprintf(buf, "site/%u/sensor/%u", idx / 100, idx % 100);
+}
+
+
+/*
+* The matching that the trie replaces, spelled out the long way.
+*/
+bool legacy_topic_matches(const char* filter, const char* topic) {
+  if (('$' == *topic) && (('+' == *filter) || ('#' == *filter))) {
+    return false;
+  }
+  while (true) {
+    if ('#' == *filter) return true;
+    const char* f_end = strchrnul(filter, '/');
+    const char* t_end = strchrnul(topic, '/');
+    if (!((1 == (f_end - filter)) && ('+' == *filter))) {
+      if (((f_end - filter) != (t_end - topic)) || strncmp(filter, topic, f_end - filter)) {
+        return false;
+      }
+    }
+    if (0 == *f_end) return (0 == *t_end);
+    if (0 == *t_end) return (0 == strcmp(f_end, "/#"));
+    filter = f_end + 1;
+    topic  = t_end + 1;
+  }
+}
+
+
+/*
+* Checks the trie's matches for each topic against the brute-force matcher.
+*/
+int check_trie_against_legacy(MQTTTopicTrie* trie, const char** filters, ManuvrMsg* tags, bool* present, int f_count, const char** topics, int t_count) {
+  ManuvrMsg* out[32];
+  for (int t = 0; t < t_count; t++) {
+    int expected = 0;
+    for (int f = 0; f < f_count; f++) {
+      if (present[f] && legacy_topic_matches(filters[f], topics[t])) expected++;
+    }
+    int found = trie->match(topics[t], strlen(topics[t]), out, 32);
+    if (found != expected) {
+      printf("Topic \"%s\" matched %d filters. Expected %d.\n", topics[t], found, expected);
+      return -1;
+    }
+    for (int i = 0; i < found; i++) {
+      const int f = out[i] - tags;
+      if (!present[f] || !legacy_topic_matches(filters[f], topics[t])) {
+        printf("Topic \"%s\" wrongly matched \"%s\".\n", topics[t], filters[f]);
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int MQTT_TRIE_MATCH() {
+  printf("===< MQTT_TRIE_MATCH >===========================================\n");
+  const char* filters[] = {
+    "a/b/c", "a/+/c", "a/#", "#", "+/b/+", "a/b", "+", "$SYS/#", "$SYS/+/load",
+    "a//c", "a/+/+/d", "sport/tennis/+", "sport/#", "+/+", "/+", "+/#"
+  };
+  const char* topics[] = {
+    "a/b/c", "a/x/c", "a", "a/b", "b", "$SYS/cpu/load", "$SYS", "a//c", "a/b/c/d",
+    "sport", "sport/tennis/player1", "sport/tennis", "x/b/y", "/", "/b/", "unmatched/topic/here"
+  };
+  const char* invalid[] = { "a/#/b", "a+/b", "", "a/b#", "#/a", "++" };
+  const int f_count = sizeof(filters) / sizeof(const char*);
+  const int t_count = sizeof(topics)  / sizeof(const char*);
+  ManuvrMsg tags[f_count];
+  bool present[f_count];
+  MQTTTopicTrie trie;
+
+  for (int f = 0; f < f_count; f++) {
+    if (0 != trie.insert(filters[f], &tags[f])) {
+      printf("Failed to insert \"%s\".\n", filters[f]);
+      return -1;
+    }
+    present[f] = true;
+  }
+  for (unsigned i = 0; i < sizeof(invalid) / sizeof(const char*); i++) {
+    if (0 == trie.insert(invalid[i], &tags[0])) {
+      printf("Invalid filter \"%s\" was accepted.\n", invalid[i]);
+      return -1;
+    }
+  }
+  if ((0 == trie.insert("a/b", &tags[0])) || (&tags[5] != trie.find("a/b")) || (f_count != (int) trie.size())) {
+    printf("Duplicate filter was accepted, or the trie lost track of its size.\n");
+    return -1;
+  }
+  if (check_trie_against_legacy(&trie, filters, tags, present, f_count, topics, t_count)) {
+    return -1;
+  }
+
+  // Remove every other filter, and check again.
+  for (int f = 0; f < f_count; f += 2) {
+    if (&tags[f] != trie.remove(filters[f])) {
+      printf("Failed to remove \"%s\".\n", filters[f]);
+      return -1;
+    }
+    present[f] = false;
+  }
+  if ((nullptr != trie.remove(filters[0])) || (nullptr != trie.find(filters[0]))) {
+    printf("Removed filter is still present.\n");
+    return -1;
+  }
+  if (check_trie_against_legacy(&trie, filters, tags, present, f_count, topics, t_count)) {
+    return -1;
+  }
+  // The iteration array must still agree with the trie.
+  for (uint32_t i = 0; i < trie.size(); i++) {
+    if (trie.runnable(i) != trie.find(trie.filter(i))) {
+      printf("Subscription %u (\"%s\") is out of step with the trie.\n", i, trie.filter(i));
+      return -1;
+    }
+  }
+
+  // Put them back, reusing the freed nodes.
+  for (int f = 0; f < f_count; f += 2) {
+    trie.insert(filters[f], &tags[f]);
+    present[f] = true;
+  }
+  if (check_trie_against_legacy(&trie, filters, tags, present, f_count, topics, t_count)) {
+    return -1;
+  }
+  trie.clear();
+  if ((0 != trie.size()) || (0 != trie.match("a/b/c", 5, nullptr, 0))) {
+    printf("Trie was not empty after clear().\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int MQTT_TRIE_BENCH() {
+  printf("===< MQTT_TRIE_BENCH >===========================================\n");
+  MQTTTopicTrie trie;
+  char** legacy = (char**) malloc(MQTT_BENCH_TOPICS * sizeof(char*));
+  char   topic[48];
+  int    return_value = 0;
+
+  for (unsigned i = 0; i < MQTT_BENCH_TOPICS; i++) {
+    bench_topic(topic, i);
+    legacy[i] = strdup(topic);
+    if (0 != trie.insert(topic, &runnables[i])) {
+      printf("Failed to insert \"%s\".\n", topic);
+      return_value = -1;
+    }
+  }
+
+  // The old session compared the topic against every subscription.
+  volatile unsigned hits = 0;
+  unsigned long start = micros();
+  for (unsigned n = 0; n < MQTT_BENCH_LEGACY; n++) {
+    bench_topic(topic, (n * 7919) % MQTT_BENCH_TOPICS);
+    for (unsigned i = 0; i < MQTT_BENCH_TOPICS; i++) {
+      if (0 == strcmp(topic, legacy[i])) hits++;
+    }
+  }
+  const double legacy_ns = ((micros() - start) * 1000.0) / MQTT_BENCH_LEGACY;
+
+  ManuvrMsg* out[4];
+  start = micros();
+  for (unsigned n = 0; n < MQTT_BENCH_LOOKUPS; n++) {
+    const unsigned idx = (n * 7919) % MQTT_BENCH_TOPICS;
+    bench_topic(topic, idx);
+    if ((1 != trie.match(topic, strlen(topic), out, 4)) || (&runnables[idx] != out[0])) {
+      printf("Trie failed to match \"%s\".\n", topic);
+      return_value = -1;
+      break;
+    }
+  }
+  const double trie_ns = ((micros() - start) * 1000.0) / MQTT_BENCH_LOOKUPS;
+
+  printf("\t %d literal subscriptions.\n", MQTT_BENCH_TOPICS);
+  printf("\t Linear strcmp():  %10.1f ns/lookup\n", legacy_ns);
+  printf("\t Topic trie:       %10.1f ns/lookup\n", trie_ns);
+  if (MQTT_BENCH_LEGACY != hits) {
+    return_value = -1;
+  }
+
+  for (unsigned i = 0; i < MQTT_BENCH_TOPICS; i++) free(legacy[i]);
+  free(legacy);
+  return return_value;
+}
+
+
+/*
+* Writes a PUBLISH packet for the given benchmark topic, carrying its index.
+*
+* @return The length of the packet.
+*/
+int build_publish(uint8_t* buf, unsigned idx, uint16_t packet_id) {
+  char topic[48];
+  bench_topic(topic, idx);
+  const int topic_len = strlen(topic);
+  const bool qos1     = (0 != (idx & 1));   // Mix in packets that carry an id.
+  const int  rem_len  = 2 + topic_len + (qos1 ? 2 : 0) + 4;
+  int i = 0;
+  buf[i++] = (PUBLISH << 4) | (qos1 ? (QOS1 << 1) : 0);
+  buf[i++] = (uint8_t) rem_len;   // Always less than 128.
+  buf[i++] = (uint8_t) (topic_len >> 8);
+  buf[i++] = (uint8_t) (topic_len & 0xFF);
+  memcpy(buf + i, topic, topic_len);
+  i += topic_len;
+  if (qos1) {
+    buf[i++] = (uint8_t) (packet_id >> 8);
+    buf[i++] = (uint8_t) (packet_id & 0xFF);
+  }
+  uint32_t val = idx;
+  memcpy(buf + i, &val, 4);
+  return i + 4;
+}
+
+
+/*
+* Feeds a stream of PUBLISH packets to a session, in reads that don't respect
+*   packet boundaries, and counts what comes out of the Kernel.
+*/
+int MQTT_SESSION_FEED() {
+  printf("===< MQTT_SESSION_FEED >=========================================\n");
+  Kernel* kernel = platform.kernel();
+  MQTTSession session(nullptr);
+  char topic[48];
+  ManuvrMsg::registerMessage(MQTT_TEST_MSG, 0, "MQTT_TEST", MQTT_TEST_ARGS, nullptr);
+  kernel->before(MQTT_TEST_MSG, delivery_listener, 0);
+
+  for (unsigned i = 0; i < MQTT_BENCH_TOPICS; i++) {
+    bench_topic(topic, i);
+    runnables[i].repurpose(MQTT_TEST_MSG);
+    runnables[i].incRefs();
+    if (-1 == session.subscribe(topic, &runnables[i])) {
+      printf("Failed to subscribe to \"%s\".\n", topic);
+      return -1;
+    }
+  }
+
+  uint8_t* feed = (uint8_t*) malloc(MQTT_BENCH_BATCH * 48);
+  unsigned long build_us = 0;
+  unsigned long start    = micros();
+  for (unsigned sent = 0; sent < MQTT_BENCH_PUBLISHES; sent += MQTT_BENCH_BATCH) {
+    // Topics within a batch are distinct, so no runnable is raised twice at once.
+    unsigned long b_start = micros();
+    int feed_len = 0;
+    for (unsigned n = sent; (n < sent + MQTT_BENCH_BATCH) && (n < MQTT_BENCH_PUBLISHES); n++) {
+      feed_len += build_publish(feed + feed_len, n % MQTT_BENCH_TOPICS, (uint16_t) (n + 1));
+    }
+    build_us += micros() - b_start;
+
+    for (int offset = 0; offset < feed_len; offset += MQTT_BENCH_SLICE) {
+      const int slice = ((feed_len - offset) < MQTT_BENCH_SLICE) ? (feed_len - offset) : MQTT_BENCH_SLICE;
+      StringBuilder piece(feed + offset, slice);
+      session.fromCounterparty(&piece, MEM_MGMT_RESPONSIBLE_CREATOR);
+    }
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  }
+  const unsigned long feed_us = (micros() - start) - build_us;
+  free(feed);
+
+  printf("\t %d PUBLISH packets over %d subscriptions, read %d bytes at a time.\n", MQTT_BENCH_PUBLISHES, MQTT_BENCH_TOPICS, MQTT_BENCH_SLICE);
+  printf("\t Delivered in %lu us (%.0f msgs/s).\n", feed_us, MQTT_BENCH_PUBLISHES / (feed_us / 1000000.0));
+
+  if ((MQTT_BENCH_PUBLISHES != deliveries) || (0 != bad_deliveries)) {
+    printf("Saw %u deliveries (%u bad). Expected %u.\n", deliveries, bad_deliveries, MQTT_BENCH_PUBLISHES);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+* Publishes until count publications are acknowledged, and reports the rate.
+*
+* @return The number of microseconds it took.
+*/
+unsigned long run_uplink(MQTTSession* session, BrokerStandIn* broker, unsigned count, enum QoS qos) {
+  Kernel* kernel = platform.kernel();
+  uint8_t payload[16];
+  unsigned sent = 0;
+  memset(payload, 0xA5, sizeof(payload));
+  broker->reset();
+  unsigned long start = micros();
+  while ((sent < count) || (0 < session->inflight())) {
+    while ((sent < count) && session->publish("telemetry/imu", payload, sizeof(payload), qos)) {
+      sent++;
+    }
+    kernel->procIdleFlags();   // Held packets are written...
+    broker->deliver();         // ...acknowledged...
+    kernel->procIdleFlags();   // ...and the acknowledgements processed.
+  }
+  return (micros() - start);
+}
+
+
+/*
+*
+*/
+int MQTT_PUBLISH_WINDOW() {
+  printf("===< MQTT_PUBLISH_WINDOW >=======================================\n");
+  Kernel* kernel = platform.kernel();
+  BrokerStandIn broker;
+  MQTTSession session(nullptr);
+  session.setNear(&broker);
+  broker.setFar(&session);
+  kernel->subscribe(&session);
+  int return_value = -1;
+
+  uint8_t connack[] = { (CONNACK << 4), 0x02, 0x00, 0x00 };
+  StringBuilder ca(connack, sizeof(connack));
+  session.fromCounterparty(&ca, MEM_MGMT_RESPONSIBLE_CREATOR);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+
+  if (session.isEstablished()) {
+    // One publication at a time, as sendPublish() used to behave.
+    session.maxInflight(1);
+    const unsigned long serial_us = run_uplink(&session, &broker, MQTT_BENCH_UPLINK, QOS1);
+    const uint32_t serial_writes  = broker.writes;
+    const uint32_t serial_pubs    = broker.publishes;
+
+    session.maxInflight(MQTT_MAX_INFLIGHT);
+    const unsigned long window_us = run_uplink(&session, &broker, MQTT_BENCH_UPLINK, QOS1);
+    const uint32_t window_writes  = broker.writes;
+    const uint32_t window_pubs    = broker.publishes;
+
+    printf("\t %d QoS1 publications.\n", MQTT_BENCH_UPLINK);
+    printf("\t Window of 1:   %8lu us  %8.0f msgs/s  %6u transport writes\n", serial_us, MQTT_BENCH_UPLINK / (serial_us / 1000000.0), serial_writes);
+    printf("\t Window of %2d:  %8lu us  %8.0f msgs/s  %6u transport writes\n", MQTT_MAX_INFLIGHT, window_us, MQTT_BENCH_UPLINK / (window_us / 1000000.0), window_writes);
+
+    // QoS2 takes the four-way handshake.
+    const unsigned long qos2_us = run_uplink(&session, &broker, MQTT_BENCH_UPLINK / 10, QOS2);
+    printf("\t QoS2, window of %2d: %u publications in %lu us\n", MQTT_MAX_INFLIGHT, MQTT_BENCH_UPLINK / 10, qos2_us);
+
+    if ((MQTT_BENCH_UPLINK != serial_pubs) || (MQTT_BENCH_UPLINK != window_pubs)) {
+      printf("Broker saw %u and %u publications. Expected %u.\n", serial_pubs, window_pubs, MQTT_BENCH_UPLINK);
+    }
+    else if ((window_writes * 4) > serial_writes) {
+      printf("The window did not coalesce writes.\n");
+    }
+    else if ((MQTT_BENCH_UPLINK / 10) != broker.pubrels) {
+      printf("Broker saw %u PUBRELs. Expected %u.\n", broker.pubrels, MQTT_BENCH_UPLINK / 10);
+    }
+    else {
+      // Lose some acknowledgements, and expect them to be retried.
+      uint8_t payload[4] = {1, 2, 3, 4};
+      session.retryPeriod(20);
+      broker.reset();
+      broker.drop_acks = 3;
+      for (int i = 0; i < 3; i++) session.publish("telemetry/lossy", payload, 4, QOS1);
+      unsigned long start = micros();
+      while ((0 < session.inflight()) && ((micros() - start) < 2000000)) {
+        kernel->procIdleFlags();
+        broker.deliver();
+        sleep_millis(1);
+      }
+      printf("\t Lost acknowledgements: %u retransmitted.\n", broker.dups);
+      if ((0 != session.inflight()) || (3 > broker.dups)) {
+        printf("Unacknowledged publications were not sent again.\n");
+      }
+      else {
+        return_value = 0;
+      }
+    }
+  }
+  else {
+    printf("Session was not established by CONNACK.\n");
+  }
+
+  kernel->unsubscribe(&session);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  return return_value;
+}
+
+
+/*
+* Brings a session up against a broker stand-in.
+*/
+void establish(MQTTSession* session, BrokerStandIn* broker) {
+  Kernel* kernel = platform.kernel();
+  session->setNear(broker);
+  broker->setFar(session);
+  kernel->subscribe(session);
+  uint8_t connack[] = { (CONNACK << 4), 0x02, 0x00, 0x00 };
+  StringBuilder ca(connack, sizeof(connack));
+  session->fromCounterparty(&ca, MEM_MGMT_RESPONSIBLE_CREATOR);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+}
+
+
+/*
+* Publications that find the window full wait their turn, rather than being
+*   refused. Only a full backlog refuses them.
+*/
+int MQTT_PUBLISH_BACKLOG() {
+  printf("===< MQTT_PUBLISH_BACKLOG >======================================\n");
+  Kernel* kernel = platform.kernel();
+  BrokerStandIn broker;
+  MQTTSession session(nullptr);
+  establish(&session, &broker);
+  int return_value = -1;
+  uint8_t payload[4] = {1, 2, 3, 4};
+
+  session.maxInflight(1);
+  int accepted = 0;
+  while (session.publish("telemetry/backlog", payload, 4, QOS1)) accepted++;
+  if ((1 + MQTT_MAX_BACKLOG) != accepted) {
+    printf("Window of 1 accepted %d publications. Expected %d.\n", accepted, 1 + MQTT_MAX_BACKLOG);
+  }
+  else {
+    unsigned long start = micros();
+    while (((0 < session.inflight()) || (0 < session.backlog())) && ((micros() - start) < 2000000)) {
+      kernel->procIdleFlags();
+      broker.deliver();
+      kernel->procIdleFlags();
+    }
+    if ((0 != session.backlog()) || ((uint32_t) accepted != broker.publishes)) {
+      printf("Broker saw %u of %d publications.\n", broker.publishes, accepted);
+    }
+    else {
+      return_value = 0;
+    }
+  }
+  kernel->unsubscribe(&session);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  return return_value;
+}
+
+
+/*
+* A QoS2 PUBLISH must be delivered once, when the broker releases it, no
+*   matter how many times the broker sends it.
+*/
+int MQTT_QOS2_INBOUND() {
+  printf("===< MQTT_QOS2_INBOUND >=========================================\n");
+  Kernel* kernel = platform.kernel();
+  BrokerStandIn broker;
+  MQTTSession session(nullptr);
+  establish(&session, &broker);
+  int return_value = -1;
+  char topic[48];
+  bench_topic(topic, 5);
+  session.subscribe(topic, &runnables[5], QOS2);
+
+  uint8_t pkt[64];
+  const int len = build_publish(pkt, 5, 0x0107);   // An odd index carries a packet id...
+  pkt[0] = (PUBLISH << 4) | (QOS2 << 1);           // ...so it can be made QoS2.
+  const uint32_t before = deliveries;
+  for (int i = 0; i < 2; i++) {
+    // The second one is a retransmission, as if our PUBREC was lost.
+    StringBuilder p(pkt, len);
+    session.fromCounterparty(&p, MEM_MGMT_RESPONSIBLE_CREATOR);
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  }
+  if (before != deliveries) {
+    printf("A QoS2 PUBLISH was delivered before PUBREL.\n");
+  }
+  else {
+    uint8_t pubrel[] = { (uint8_t) ((PUBREL << 4) | 0x02), 0x02, 0x01, 0x07 };
+    for (int i = 0; i < 2; i++) {
+      StringBuilder r(pubrel, sizeof(pubrel));
+      session.fromCounterparty(&r, MEM_MGMT_RESPONSIBLE_CREATOR);
+      while (0 < kernel->queueSize()) kernel->procIdleFlags();
+    }
+    if ((before + 1) != deliveries) {
+      printf("Saw %u deliveries after PUBREL. Expected 1.\n", deliveries - before);
+    }
+    else if (0 != bad_deliveries) {
+      printf("The QoS2 delivery carried the wrong value.\n");
+    }
+    else {
+      return_value = 0;
+    }
+  }
+  kernel->unsubscribe(&session);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  return return_value;
+}
+#endif  // MANUVR_SUPPORT_MQTT
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(MANUVR_SUPPORT_MQTT)
+    runnables = new ManuvrMsg[MQTT_BENCH_TOPICS];
+    if (0 == MQTT_TRIE_MATCH()) {
+      if (0 == MQTT_TRIE_BENCH()) {
+        if (0 == MQTT_SESSION_FEED()) {
+          if (0 == MQTT_PUBLISH_WINDOW()) {
+            if (0 == MQTT_PUBLISH_BACKLOG()) {
+              if (0 == MQTT_QOS2_INBOUND()) {
+                printf("**********************************\n");
+                printf("*  MQTT tests all pass           *\n");
+                printf("**********************************\n");
+                exit_value = 0;
+              }
+              else printTestFailure("MQTT_QOS2_INBOUND");
+            }
+            else printTestFailure("MQTT_PUBLISH_BACKLOG");
+          }
+          else printTestFailure("MQTT_PUBLISH_WINDOW");
+        }
+        else printTestFailure("MQTT_SESSION_FEED");
+      }
+      else printTestFailure("MQTT_TRIE_BENCH");
+    }
+    else printTestFailure("MQTT_TRIE_MATCH");
+  #else
+    printf("MQTT support was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}
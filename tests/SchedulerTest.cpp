@@ -138,6 +138,68 @@ int SCHEDULER_DESTROY_SCHEDULES() {
 }
 
 
+/*
+* Loads the scheduler with many periodic schedules and measures the cost of
+*   servicing it. Most ticks should have nothing due, and should therefore
+*   cost almost nothing, regardless of how many schedules are present.
+*/
+#define SCHED_BENCH_COUNT   10000
+#define SCHED_BENCH_TICKS   2000
+
+int bench_fire_count = 0;
+
+void sched_bench_cb() {
+  bench_fire_count++;
+}
+
+int SCHEDULER_BENCHMARK() {
+  printf("===< SCHEDULER_BENCHMARK >=======================================\n");
+  Kernel* kernel = platform.kernel();
+  ManuvrMsg* bench_schedules[SCHED_BENCH_COUNT];
+  uint32_t expected_fires = 0;
+
+  for (int i = 0; i < SCHED_BENCH_COUNT; i++) {
+    // Periods are spread between 1 and 10 seconds.
+    uint32_t period = 1000 + (randomUInt32() % 9000);
+    bench_schedules[i] = kernel->createSchedule(period, -1, false, sched_bench_cb);
+    if (nullptr == bench_schedules[i]) {
+      printf("Failed to create schedule %d.\n", i);
+      return -1;
+    }
+    bench_schedules[i]->enableSchedule(true);
+    expected_fires += (SCHED_BENCH_TICKS * MANUVR_PLATFORM_TIMER_PERIOD_MS) / period;
+  }
+
+  kernel->maxEventsPerLoop(127);
+  unsigned long worst_tick = 0;
+  unsigned long total_us   = 0;
+  for (int t = 0; t < SCHED_BENCH_TICKS; t++) {
+    kernel->advanceScheduler();
+    // Only the scheduler is timed. procIdleFlags() would also block until the
+    //   next deadline whenever it finds nothing to run.
+    unsigned long start = micros();
+    kernel->serviceSchedules();
+    unsigned long tick_us = micros() - start;
+    // Drain the fired events. With the queue non-empty, this never blocks.
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+    total_us += tick_us;
+    if (tick_us > worst_tick) worst_tick = tick_us;
+  }
+
+  printf("\t %d schedules over %d ticks.\n", SCHED_BENCH_COUNT, SCHED_BENCH_TICKS);
+  printf("\t Mean service time:   %.3f us/tick\n", total_us / (double) SCHED_BENCH_TICKS);
+  printf("\t Worst service time:  %lu us\n", worst_tick);
+  printf("\t Fired %d times (expected at least %u).\n", bench_fire_count, expected_fires);
+
+  for (int i = 0; i < SCHED_BENCH_COUNT; i++) {
+    kernel->removeSchedule(bench_schedules[i]);
+  }
+  // Each procIdleFlags() also advances the scheduler from the platform's clock,
+  //   so we can only assert a lower bound on the number of fires.
+  return (bench_fire_count >= (int) expected_fires) ? 0 : -1;
+}
+
+
 /*
 *
 */
@@ -174,13 +236,16 @@ int main(int argc, char *argv[]) {
         if (0 == SCHEDULER_HANG()) {
           if (0 == SCHEDULER_COMPARE_AGAINST_RTC()) {
             if (0 == SCHEDULER_DESTROY_SCHEDULES()) {
-              if (0 == SCHEDULER_COMPARE_RESULTS()) {
-                printf("**********************************\n");
-                printf("*  Scheduler tests all pass      *\n");
-                printf("**********************************\n");
-                exit_value = 0;
+              if (0 == SCHEDULER_BENCHMARK()) {
+                if (0 == SCHEDULER_COMPARE_RESULTS()) {
+                  printf("**********************************\n");
+                  printf("*  Scheduler tests all pass      *\n");
+                  printf("**********************************\n");
+                  exit_value = 0;
+                }
+                else printTestFailure("SCHEDULER_COMPARE_RESULTS");
               }
-              else printTestFailure("SCHEDULER_COMPARE_RESULTS");
+              else printTestFailure("SCHEDULER_BENCHMARK");
             }
             else printTestFailure("SCHEDULER_DESTROY_SCHEDULES");
           }
@@ -0,0 +1,232 @@
+/*
+File:   SensorTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the SensorManager's polling against fake sensors: sensors are read
+  soonest deadline first, sensors that aren't due are skipped, and a pass
+  stops when it has spent its budget.
+The manager is not given to the Kernel. Each pass is run by hand, so that the
+  schedule can't add passes of its own.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(CONFIG_MANUVR_SENSOR_MGR)
+#include <Drivers/Sensors/SensorWrapper.h>
+
+#define SENSOR_TEST_LOG_LEN  32
+
+
+/*
+* Globals.
+*/
+char read_log[SENSOR_TEST_LOG_LEN + 1];
+int  read_idx = 0;
+
+
+/*
+* A sensor that logs its reads, and takes as long as we say to do them.
+*/
+class FakeSensor : public SensorWrapper {
+  public:
+    char     tag;
+    uint32_t busy_us = 0;
+
+    FakeSensor(const char* n, char t) : SensorWrapper(n), tag(t) {};
+
+    SensorError init() {                                  return SensorError::NO_ERROR;  };
+    SensorError setParameter(uint16_t, int, uint8_t*) {   return SensorError::INVALID_PARAM_ID;  };
+    SensorError getParameter(uint16_t, int, uint8_t*) {   return SensorError::INVALID_PARAM_ID;  };
+    SensorError readSensor() {
+      const unsigned long t0 = micros();
+      while ((micros() - t0) < busy_us) {}
+      if (read_idx < SENSOR_TEST_LOG_LEN) read_log[read_idx++] = tag;
+      return SensorError::NO_ERROR;
+    };
+};
+
+
+SensorManager* sm       = nullptr;
+FakeSensor*    sensor_a = nullptr;
+FakeSensor*    sensor_b = nullptr;
+FakeSensor*    sensor_c = nullptr;
+ManuvrMsg      svc_msg;
+
+
+/*
+* Runs one service pass, and gives the order of the reads it did.
+*/
+const char* run_pass() {
+  memset(read_log, 0, sizeof(read_log));
+  read_idx = 0;
+  sm->notify(&svc_msg);
+  return (const char*) read_log;
+}
+
+
+/*
+* Periods are kept within what a deadline in micros() can express.
+*/
+int SENSOR_PERIOD_CLAMP() {
+  printf("===< SENSOR_PERIOD_CLAMP >=======================================\n");
+  int return_value = -1;
+  FakeSensor s("fake_clamp", 'x');
+  s.samplePeriod(0);
+  if (1 == s.samplePeriod()) {
+    s.samplePeriod(0xFFFFFFFF);
+    if (SENSOR_MAX_PERIOD_MS == s.samplePeriod()) {
+      return_value = 0;
+    }
+    else printf("A huge period came back as %u.\n", s.samplePeriod());
+  }
+  else printf("A zero period came back as %u.\n", s.samplePeriod());
+  return return_value;
+}
+
+
+/*
+* New sensors are all read on the first pass. After that, they come due in
+*   order of their periods, and are read soonest first.
+*/
+int SENSOR_ORDERING() {
+  printf("===< SENSOR_ORDERING >===========================================\n");
+  int return_value = -1;
+  sensor_a->samplePeriod(50);
+  sensor_b->samplePeriod(10);
+  sensor_c->samplePeriod(30);
+  if ((0 == sm->addSensor(sensor_a)) && (0 == sm->addSensor(sensor_b)) && (0 == sm->addSensor(sensor_c))) {
+    if (3 == strlen(run_pass())) {
+      sleep_millis(60);
+      const char* order = run_pass();
+      if (0 == strcmp("bca", order)) {
+        return_value = 0;
+      }
+      else printf("Expected reads in order \"bca\", but saw \"%s\".\n", order);
+    }
+    else printf("The first pass did not read every new sensor (\"%s\").\n", read_log);
+  }
+  else printf("Failed to add the sensors.\n");
+  return return_value;
+}
+
+
+/*
+* A sensor that isn't due is not read, and a pass with nothing due reads
+*   nothing.
+*/
+int SENSOR_SKIPPING() {
+  printf("===< SENSOR_SKIPPING >===========================================\n");
+  int return_value = -1;
+  const char* order = run_pass();
+  if (0 == strlen(order)) {
+    sleep_millis(15);
+    order = run_pass();
+    if (0 == strcmp("b", order)) {
+      return_value = 0;
+    }
+    else printf("Expected only \"b\" to be due, but saw \"%s\".\n", order);
+  }
+  else printf("A pass with nothing due read \"%s\".\n", order);
+  return return_value;
+}
+
+
+/*
+* A pass stops once it has spent its budget, but always reads one sensor.
+*   What was left over heads the next pass.
+*/
+int SENSOR_BUDGET() {
+  printf("===< SENSOR_BUDGET >=============================================\n");
+  int return_value = -1;
+  sensor_a->busy_us = 2000;
+  sensor_b->busy_us = 2000;
+  sensor_c->busy_us = 2000;
+  sm->pollBudget(3000);
+  sleep_millis(60);
+  const char* order = run_pass();
+  if (2 == strlen(order)) {
+    char left = ('a' + 'b' + 'c') - (order[0] + order[1]);
+    sm->pollBudget(0);
+    order = run_pass();
+    if ((1 == strlen(order)) && (left == order[0])) {
+      return_value = 0;
+    }
+    else printf("Expected the leftover \"%c\" alone, but saw \"%s\".\n", left, order);
+  }
+  else printf("Expected the budget to allow two reads, but saw \"%s\".\n", order);
+  sm->pollBudget(SENSOR_MGR_POLL_BUDGET_US);
+  return return_value;
+}
+
+#endif  // CONFIG_MANUVR_SENSOR_MGR
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(CONFIG_MANUVR_SENSOR_MGR)
+    sm       = new SensorManager();
+    sensor_a = new FakeSensor("fake_a", 'a');
+    sensor_b = new FakeSensor("fake_b", 'b');
+    sensor_c = new FakeSensor("fake_c", 'c');
+    svc_msg.repurpose(MANUVR_MSG_SENSOR_MGR_SVC, nullptr);
+    svc_msg.incRefs();
+
+    if (0 == SENSOR_PERIOD_CLAMP()) {
+      if (0 == SENSOR_ORDERING()) {
+        if (0 == SENSOR_SKIPPING()) {
+          if (0 == SENSOR_BUDGET()) {
+            printf("**********************************\n");
+            printf("*  Sensor tests all pass         *\n");
+            printf("**********************************\n");
+            exit_value = 0;
+          }
+          else printTestFailure("SENSOR_BUDGET");
+        }
+        else printTestFailure("SENSOR_SKIPPING");
+      }
+      else printTestFailure("SENSOR_ORDERING");
+    }
+    else printTestFailure("SENSOR_PERIOD_CLAMP");
+  #else
+    printf("SensorManager support was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}
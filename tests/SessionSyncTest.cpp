@@ -0,0 +1,390 @@
+/*
+File:   SessionSyncTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the sync-stream scanners that ManuvrSession uses to recover from
+  desync, and measures what recovery costs on a noisy link.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(MANUVR_OVER_THE_WIRE)
+#include <XenoSession/Manuvr/ManuvrSession.h>
+
+#define SYNC_MATCH_ROUNDS       200000
+#define SYNC_BENCH_BYTES        (4 * 1024 * 1024)
+#define SYNC_BENCH_SLICE        61       // Bytes per read from the "transport".
+#define SYNC_BENCH_TRAILER      8        // Sync packets at the end of the corpus.
+
+
+/*
+* Stands in for a transport. Whatever the session writes is counted and dropped.
+*/
+class WireStandIn : public BufferPipe {
+  public:
+    uint32_t writes = 0;
+
+    WireStandIn() : BufferPipe() {};
+    ~WireStandIn() {};
+
+    const char* pipeName() {  return "WireStandIn";  };
+
+    int8_t toCounterparty(StringBuilder* buf, int8_t mm) {
+      writes++;
+      return MEM_MGMT_RESPONSIBLE_BEARER;
+    };
+};
+
+
+/*
+* The scanners as they were, byte by byte.
+*/
+int legacy_contains_sync_pattern(uint8_t* buf, int len) {
+  int i = 0;
+  while (i < len-3) {
+    if (*(buf + i + 0) == XenoManuvrMessage::SYNC_PACKET_BYTES[0]) {
+      if (*(buf + i + 1) == XenoManuvrMessage::SYNC_PACKET_BYTES[1]) {
+        if (*(buf + i + 2) == XenoManuvrMessage::SYNC_PACKET_BYTES[2]) {
+          if (*(buf + i + 3) == XenoManuvrMessage::SYNC_PACKET_BYTES[3]) {
+            return i;
+          }
+        }
+      }
+    }
+    i++;
+  }
+  return -1;
+}
+
+int legacy_locate_sync_break(uint8_t* buf, int len) {
+  int i = 0;
+  while (i < len-3) {
+    if (*(buf + i + 0) != XenoManuvrMessage::SYNC_PACKET_BYTES[0]) return i;
+    if (*(buf + i + 1) != XenoManuvrMessage::SYNC_PACKET_BYTES[1]) return i;
+    if (*(buf + i + 2) != XenoManuvrMessage::SYNC_PACKET_BYTES[2]) return i;
+    if (*(buf + i + 3) != XenoManuvrMessage::SYNC_PACKET_BYTES[3]) return i;
+    i += 4;
+  }
+  return i;
+}
+
+/*
+* The session's desync path as it was: every read is appended to the session
+*   buffer, and the whole buffer is scanned.
+*/
+int8_t legacy_scan_buffer_for_sync(StringBuilder* session_buffer) {
+  int8_t return_value = 0;
+  int len = session_buffer->length();
+  int last_sync_offset = 0;
+  int offset = 0;
+  uint32_t sync_value = 0x04 + (CHECKSUM_PRELOAD_BYTE << 24);
+  unsigned char *buf = session_buffer->string();
+  while (len >= offset+4) {
+    if (parseUint32Fromchars(buf + offset) == sync_value) {
+      return_value = 1;
+      last_sync_offset = offset;
+      offset += 4;
+    }
+    else {
+      offset++;
+    }
+  }
+  if (return_value) {
+    session_buffer->cull(last_sync_offset + 4);
+  }
+  else if (len > 7) {
+    session_buffer->cull(len - 3);
+  }
+  return return_value;
+}
+
+
+/*
+* Noise from a link that is out of sync. Biased toward the bytes of the sync
+*   packet, so that the scanners see plenty of near-misses.
+*/
+void fill_noise(uint8_t* buf, int len) {
+  for (int i = 0; i < len; i++) {
+    switch (randomUInt32() & 3) {
+      case 0:   *(buf + i) = XenoManuvrMessage::SYNC_PACKET_BYTES[0];  break;
+      case 1:   *(buf + i) = XenoManuvrMessage::SYNC_PACKET_BYTES[1];  break;
+      default:  *(buf + i) = (uint8_t) randomUInt32();                 break;
+    }
+    // Noise must never contain a sync packet by accident.
+    if ((i >= 3) && (0 == memcmp(buf + i - 3, XenoManuvrMessage::SYNC_PACKET_BYTES, 4))) {
+      *(buf + i) = 0xAA;
+    }
+  }
+}
+
+
+/*
+* The scanners must agree with the byte-wise versions, at every alignment and length.
+*/
+int SYNC_SCAN_MATCH() {
+  printf("===< SYNC_SCAN_MATCH >===========================================\n");
+  uint8_t buf[160];
+  for (int r = 0; r < SYNC_MATCH_ROUNDS; r++) {
+    const int len = randomUInt32() % 150;
+    const int start = randomUInt32() % 4;
+    switch (r % 3) {
+      case 0:   // Noise, maybe with a sync packet in it.
+        fill_noise(buf, sizeof(buf));
+        if ((len > 4) && (randomUInt32() & 1)) {
+          memcpy(buf + start + (randomUInt32() % (len - 3)), XenoManuvrMessage::SYNC_PACKET_BYTES, 4);
+        }
+        break;
+      case 1:   // A sync stream, with a flaw.
+        for (int i = 0; i < (int) sizeof(buf); i++) buf[i] = XenoManuvrMessage::SYNC_PACKET_BYTES[(i - start) & 3];
+        buf[start + (randomUInt32() % (len + 1))] = (uint8_t) randomUInt32();
+        break;
+      default:  // A flawless sync stream.
+        for (int i = 0; i < (int) sizeof(buf); i++) buf[i] = XenoManuvrMessage::SYNC_PACKET_BYTES[(i - start) & 3];
+        break;
+    }
+
+    int expected = legacy_contains_sync_pattern(buf + start, len);
+    int found    = XenoManuvrMessage::contains_sync_pattern(buf + start, len);
+    if (expected != found) {
+      printf("contains_sync_pattern() returned %d for a %d-byte buffer. Expected %d.\n", found, len, expected);
+      return -1;
+    }
+    expected = legacy_locate_sync_break(buf + start, len);
+    found    = XenoManuvrMessage::locate_sync_break(buf + start, len);
+    if (expected != found) {
+      printf("locate_sync_break() returned %d for a %d-byte buffer. Expected %d.\n", found, len, expected);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+/*
+* Feeds a session a long run of noise, split into serial-sized reads, and then
+*   a sync stream. The session must resync, and only after the noise is gone.
+*/
+int SYNC_SESSION_RESYNC() {
+  printf("===< SYNC_SESSION_RESYNC >=======================================\n");
+  Kernel* kernel = platform.kernel();
+  int return_value = -1;
+  const int trailer_len = SYNC_BENCH_TRAILER * 4;
+  const int corpus_len  = SYNC_BENCH_BYTES + trailer_len;
+  uint8_t* corpus = (uint8_t*) malloc(corpus_len + 16);
+  fill_noise(corpus, SYNC_BENCH_BYTES);
+  for (int i = 0; i < SYNC_BENCH_TRAILER; i++) {
+    memcpy(corpus + SYNC_BENCH_BYTES + (i * 4), XenoManuvrMessage::SYNC_PACKET_BYTES, 4);
+  }
+
+  // Old scanners over the whole corpus, in a single buffer.
+  unsigned long start = micros();
+  int offset = 0;
+  int x;
+  while ((x = legacy_contains_sync_pattern(corpus + offset, corpus_len - offset)) >= 0) {
+    offset += x;
+    offset += legacy_locate_sync_break(corpus + offset, corpus_len - offset);
+  }
+  unsigned long legacy_scan_us = micros() - start;
+  int legacy_end = offset;
+
+  start  = micros();
+  offset = 0;
+  while ((x = XenoManuvrMessage::contains_sync_pattern(corpus + offset, corpus_len - offset)) >= 0) {
+    offset += x;
+    offset += XenoManuvrMessage::locate_sync_break(corpus + offset, corpus_len - offset);
+  }
+  unsigned long scan_us = micros() - start;
+  if ((offset != legacy_end) || (offset != corpus_len)) {
+    printf("Scanners disagree on where the sync stream ends (%d vs %d).\n", offset, legacy_end);
+    free(corpus);
+    return -1;
+  }
+
+  // The old desync path, one read at a time.
+  StringBuilder legacy_buffer;
+  int legacy_found_at = -1;
+  start = micros();
+  for (int i = 0; i < corpus_len; i += SYNC_BENCH_SLICE) {
+    const int len = ((corpus_len - i) < SYNC_BENCH_SLICE) ? (corpus_len - i) : SYNC_BENCH_SLICE;
+    StringBuilder read(corpus + i, len);
+    legacy_buffer.concat(read.string(), read.length());
+    if (legacy_scan_buffer_for_sync(&legacy_buffer) && (legacy_found_at < 0)) {
+      legacy_found_at = i;
+    }
+  }
+  unsigned long legacy_session_us = micros() - start;
+
+  // The session itself.
+  WireStandIn wire;
+  ManuvrSession session(&wire);
+  kernel->subscribe(&session);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+
+  StringBuilder state;
+  session.printDebug(&state);
+  if (nullptr == strstr((const char*) state.string(), "SYNCING")) {
+    printf("Session was not out of sync to begin with.\n");
+  }
+  else {
+    start = micros();
+    for (int i = 0; i < SYNC_BENCH_BYTES; i += SYNC_BENCH_SLICE) {
+      const int len = ((SYNC_BENCH_BYTES - i) < SYNC_BENCH_SLICE) ? (SYNC_BENCH_BYTES - i) : SYNC_BENCH_SLICE;
+      StringBuilder read(corpus + i, len);
+      session.fromCounterparty(&read, MEM_MGMT_RESPONSIBLE_CREATOR);
+    }
+    unsigned long session_us = micros() - start;
+
+    state.clear();
+    session.printDebug(&state);
+    if (nullptr == strstr((const char*) state.string(), "SYNCING")) {
+      printf("Session left desync on noise alone.\n");
+    }
+    else {
+      StringBuilder read(corpus + SYNC_BENCH_BYTES, trailer_len);
+      session.fromCounterparty(&read, MEM_MGMT_RESPONSIBLE_CREATOR);
+      state.clear();
+      session.printDebug(&state);
+      if (nullptr != strstr((const char*) state.string(), "SYNCING")) {
+        printf("Session did not notice the sync stream.\n");
+      }
+      else if (legacy_found_at < SYNC_BENCH_BYTES - SYNC_BENCH_SLICE) {
+        printf("The old desync path found sync in the noise (at %d).\n", legacy_found_at);
+      }
+      else {
+        printf("\t %d bytes of noise, then %d sync packets.\n", SYNC_BENCH_BYTES, SYNC_BENCH_TRAILER);
+        printf("\t Byte-wise scan:               %8lu us  %7.1f MB/s\n", legacy_scan_us, SYNC_BENCH_BYTES / (double) (legacy_scan_us + 1));
+        printf("\t Vector scan:                  %8lu us  %7.1f MB/s\n", scan_us, SYNC_BENCH_BYTES / (double) (scan_us + 1));
+        printf("\t Desync path (%d-byte reads)\n", SYNC_BENCH_SLICE);
+        printf("\t   Appending to the buffer:    %8lu us\n", legacy_session_us);
+        printf("\t   ManuvrSession:              %8lu us\n", session_us);
+        return_value = 0;
+      }
+    }
+  }
+
+  kernel->unsubscribe(&session);
+  while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  free(corpus);
+  return return_value;
+}
+
+
+/*
+* A sync packet split across two reads. Neither read holds a whole packet, so
+*   the session can only find it by way of the bytes it kept from the first.
+*   Every split point is tried, and the second read also ends with the start of
+*   another packet, so that some of it is left over past the bridge.
+*/
+int SYNC_SESSION_SPLIT() {
+  printf("===< SYNC_SESSION_SPLIT >========================================\n");
+  Kernel* kernel = platform.kernel();
+  int return_value = 0;
+  uint8_t first[64];
+  uint8_t second[8];
+  for (int split = 1; (split < 4) && (0 == return_value); split++) {
+    const int first_len  = (int) sizeof(first) - 4 + split;
+    const int second_len = (4 - split) + 3;
+    fill_noise(first, first_len - split);
+    first[first_len - split - 1] = 0xAA;   // Can't be part of a sync packet.
+    memcpy(first + (first_len - split), XenoManuvrMessage::SYNC_PACKET_BYTES, split);
+    memcpy(second, XenoManuvrMessage::SYNC_PACKET_BYTES + split, 4 - split);
+    memcpy(second + (4 - split), XenoManuvrMessage::SYNC_PACKET_BYTES, 3);
+
+    WireStandIn wire;
+    ManuvrSession session(&wire);
+    kernel->subscribe(&session);
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+
+    StringBuilder state;
+    session.printDebug(&state);
+    if (nullptr == strstr((const char*) state.string(), "SYNCING")) {
+      printf("Session was not out of sync to begin with.\n");
+      return_value = -1;
+    }
+    else {
+      StringBuilder read_one(first, first_len);
+      session.fromCounterparty(&read_one, MEM_MGMT_RESPONSIBLE_CREATOR);
+      state.clear();
+      session.printDebug(&state);
+      if (nullptr == strstr((const char*) state.string(), "SYNCING")) {
+        printf("Session left desync on %d bytes of a sync packet.\n", split);
+        return_value = -1;
+      }
+      else {
+        StringBuilder read_two(second, second_len);
+        session.fromCounterparty(&read_two, MEM_MGMT_RESPONSIBLE_CREATOR);
+        state.clear();
+        session.printDebug(&state);
+        if (nullptr != strstr((const char*) state.string(), "SYNCING")) {
+          printf("Session missed a sync packet split %d/%d across two reads.\n", split, 4 - split);
+          return_value = -1;
+        }
+      }
+    }
+    kernel->unsubscribe(&session);
+    while (0 < kernel->queueSize()) kernel->procIdleFlags();
+  }
+  return return_value;
+}
+#endif  // MANUVR_OVER_THE_WIRE
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(MANUVR_OVER_THE_WIRE)
+    if (0 == SYNC_SCAN_MATCH()) {
+      if (0 == SYNC_SESSION_RESYNC()) {
+        if (0 == SYNC_SESSION_SPLIT()) {
+          printf("**********************************\n");
+          printf("*  Session sync tests all pass   *\n");
+          printf("**********************************\n");
+          exit_value = 0;
+        }
+        else printTestFailure("SYNC_SESSION_SPLIT");
+      }
+      else printTestFailure("SYNC_SESSION_RESYNC");
+    }
+    else printTestFailure("SYNC_SCAN_MATCH");
+  #else
+    printf("ManuvrSession was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}
@@ -0,0 +1,423 @@
+/*
+File:   StorageTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests the log-structured LinuxStorage, and benchmarks its writes against the
+  whole-file rewrite that it replaced. Also measures mount time and resident
+  memory for a store of large blobs, read through the mapping, against the
+  buffered whole-file load that it replaced. Outstanding views must pin the
+  mapping.
+Uses the filesystem directly, so this test must run on linux.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#define STORAGE_TEST_PATH       "/tmp/manuvr_storage_test.log"
+#define STORAGE_LEGACY_PATH     "/tmp/manuvr_storage_legacy.bin"
+#define STORAGE_BENCH_KEYS      16
+#define STORAGE_BENCH_VAL_LEN   256
+#define STORAGE_BENCH_WRITES    2000
+#define STORAGE_BLOB_COUNT      32      // Identities and certificates.
+#define STORAGE_BLOB_LEN        32768
+
+
+/*
+* Globals.
+*/
+LinuxStorage* store = nullptr;
+
+
+/* Mounts a fresh LinuxStorage on the test path. */
+LinuxStorage* mount_store() {
+  Argument opts(STORAGE_TEST_PATH);
+  opts.setKey("store_path");
+  LinuxStorage* nu = new LinuxStorage(&opts);
+  platform.kernel()->subscribe((EventReceiver*) nu);
+  return nu;
+}
+
+void unmount_store(LinuxStorage* s) {
+  platform.kernel()->unsubscribe((EventReceiver*) s);
+  delete s;
+}
+
+off_t file_size(const char* path) {
+  struct stat st;
+  return (0 == stat(path, &st)) ? st.st_size : -1;
+}
+
+
+/*
+* The persistence strategy that LinuxStorage replaced, reproduced for
+*   comparison: every write truncates the file and rewrites all of it.
+*/
+int legacy_save(uint8_t* buf, int len) {
+  int fd = open(STORAGE_LEGACY_PATH, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd < 0) return -1;
+  StringBuilder copy(buf, len);
+  int q = write(fd, copy.string(), len);
+  close(fd);
+  return (q == len) ? 0 : -1;
+}
+
+
+/* Anonymous (not file-backed) resident memory, in kB. */
+long rss_anon_kb() {
+  long return_value = -1;
+  FILE* f = fopen("/proc/self/status", "r");
+  if (f) {
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+      if (0 == strncmp(line, "RssAnon:", 8)) {
+        return_value = strtol(line + 8, nullptr, 10);
+        break;
+      }
+    }
+    fclose(f);
+  }
+  return return_value;
+}
+
+
+/*
+* The load that LinuxStorage used to do at mount, reproduced for comparison:
+*   the whole file, through a 2KB buffer, into a StringBuilder.
+*/
+int legacy_load(const char* path, StringBuilder* buf) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  uint8_t buffer[2048];
+  int r_len = read(fd, buffer, sizeof(buffer));
+  while (0 < r_len) {
+    buf->concat(buffer, r_len);
+    r_len = read(fd, buffer, sizeof(buffer));
+  }
+  close(fd);
+  return 0;
+}
+
+
+/*
+*
+*/
+int STORAGE_ROUNDTRIP() {
+  printf("===< STORAGE_ROUNDTRIP >=========================================\n");
+  unlink(STORAGE_TEST_PATH);
+  store = mount_store();
+  if (!store->isMounted()) {
+    printf("Failed to mount %s.\n", STORAGE_TEST_PATH);
+    return -1;
+  }
+
+  uint8_t a_val[] = "alpha value";
+  uint8_t b_val[] = "bravo";
+  uint8_t c_val[] = "charlie, overwritten";
+  if (StorageErr::NONE != store->persistentWrite("a", a_val, sizeof(a_val), 0)) return -1;
+  if (StorageErr::NONE != store->persistentWrite("b", b_val, sizeof(b_val), 0)) return -1;
+  if (StorageErr::KEY_CLOBBERED != store->persistentWrite("b", c_val, sizeof(c_val), 0)) {
+    printf("Overwriting a key was not reported.\n");
+    return -1;
+  }
+  if (StorageErr::NONE != store->persistentWrite(nullptr, a_val, 5, LINUX_STORAGE_FLAG_SYNC)) return -1;
+
+  uint8_t out[64];
+  unsigned int len = sizeof(out);
+  if ((StorageErr::NONE != store->persistentRead("b", out, &len, 0)) || (sizeof(c_val) != len) || memcmp(out, c_val, len)) {
+    printf("Read of an overwritten key returned the wrong value.\n");
+    return -1;
+  }
+  len = sizeof(out);
+  if ((StorageErr::NONE != store->persistentRead(nullptr, out, &len, 0)) || (5 != len)) {
+    printf("The default key did not round-trip.\n");
+    return -1;
+  }
+  len = sizeof(out);
+  if (StorageErr::KEY_NOT_FOUND != store->persistentRead("nope", out, &len, 0)) {
+    printf("A missing key was found.\n");
+    return -1;
+  }
+  if ((StorageErr::NONE != store->erase("a")) || (2 != store->keyCount())) {
+    printf("Erase failed.\n");
+    return -1;
+  }
+  StringBuilder sb;
+  if ((StorageErr::NONE != store->persistentRead("b", &sb, 0)) || (sizeof(c_val) != sb.length())) {
+    printf("StringBuilder read returned %d bytes.\n", sb.length());
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* Remount, and make certain that the log is replayed. Then tear the tail of
+*   the log as a crash would, and make certain that only the torn record is lost.
+*/
+int STORAGE_RECOVERY() {
+  printf("===< STORAGE_RECOVERY >==========================================\n");
+  unmount_store(store);
+  store = mount_store();
+  uint8_t out[64];
+  unsigned int len = sizeof(out);
+  if ((2 != store->keyCount()) || (StorageErr::KEY_NOT_FOUND != store->persistentRead("a", out, &len, 0))) {
+    printf("Replay produced %u keys.\n", store->keyCount());
+    return -1;
+  }
+  uint8_t d_val[] = "this record will be torn";
+  store->persistentWrite("d", d_val, sizeof(d_val), LINUX_STORAGE_FLAG_SYNC);
+  const off_t good_size = store->logSize();
+  unmount_store(store);
+
+  if (0 != truncate(STORAGE_TEST_PATH, good_size - 7)) return -1;
+  store = mount_store();
+  len = sizeof(out);
+  if ((2 != store->keyCount()) || (StorageErr::KEY_NOT_FOUND != store->persistentRead("d", out, &len, 0))) {
+    printf("The torn record was not discarded.\n");
+    return -1;
+  }
+  len = sizeof(out);
+  if (StorageErr::NONE != store->persistentRead("b", out, &len, 0)) {
+    printf("A good record was lost with the torn one.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+*
+*/
+int STORAGE_COMPACTION() {
+  printf("===< STORAGE_COMPACTION >========================================\n");
+  uint8_t val[STORAGE_BENCH_VAL_LEN];
+  for (int i = 0; i < 200; i++) {
+    memset(val, i, sizeof(val));
+    store->persistentWrite("churn", val, sizeof(val), 0);
+  }
+  const uint32_t before = store->logSize();
+  if (StorageErr::NONE != store->compact()) {
+    printf("Compaction failed.\n");
+    return -1;
+  }
+  printf("\t Log went from %u to %u bytes.\n", before, store->logSize());
+  if ((0 != store->garbage()) || (store->logSize() >= before) || (store->logSize() != file_size(STORAGE_TEST_PATH))) {
+    return -1;
+  }
+  uint8_t out[STORAGE_BENCH_VAL_LEN];
+  unsigned int len = sizeof(out);
+  if ((StorageErr::NONE != store->persistentRead("churn", out, &len, 0)) || (199 != out[0])) {
+    printf("The newest value did not survive compaction.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* A store of large blobs. Mount it both ways, and touch every value.
+*/
+int STORAGE_MAPPED_READS() {
+  printf("===< STORAGE_MAPPED_READS >======================================\n");
+  uint8_t* blob = (uint8_t*) malloc(STORAGE_BLOB_LEN);
+  char     key[16];
+  store->wipe();
+  for (int i = 0; i < STORAGE_BLOB_COUNT; i++) {
+    snprintf(key, sizeof(key), "cert%d", i);
+    memset(blob, i, STORAGE_BLOB_LEN);
+    store->persistentWrite(key, blob, STORAGE_BLOB_LEN, 0);
+  }
+  unmount_store(store);
+  free(blob);
+
+  // Before: the whole file is copied onto the heap at mount.
+  long rss_before = rss_anon_kb();
+  unsigned long start = micros();
+  StringBuilder* legacy = new StringBuilder();
+  legacy_load(STORAGE_TEST_PATH, legacy);
+  legacy->string();   // Collapse the fragments, as a reader would.
+  unsigned long legacy_us  = micros() - start;
+  long legacy_rss_kb = rss_anon_kb() - rss_before;
+  delete legacy;
+
+  // After: the log is mapped, and values are viewed in place.
+  rss_before = rss_anon_kb();
+  start = micros();
+  store = mount_store();
+  uint32_t checksum = 0;
+  for (int i = 0; i < STORAGE_BLOB_COUNT; i++) {
+    const uint8_t* view = nullptr;
+    uint32_t len = 0;
+    snprintf(key, sizeof(key), "cert%d", i);
+    if ((StorageErr::NONE != store->persistentView(key, &view, &len)) || (STORAGE_BLOB_LEN != len)) {
+      printf("No view of %s.\n", key);
+      return -1;
+    }
+    checksum += view[0] + view[len - 1];
+    store->releaseView();
+  }
+  unsigned long mapped_us  = micros() - start;
+  long mapped_rss_kb = rss_anon_kb() - rss_before;
+
+  printf("\t %d blobs of %d bytes.\n", STORAGE_BLOB_COUNT, STORAGE_BLOB_LEN);
+  printf("\t Buffered load:  %8lu us  %6ld kB anonymous\n", legacy_us, legacy_rss_kb);
+  printf("\t Mapped views:   %8lu us  %6ld kB anonymous\n", mapped_us, mapped_rss_kb);
+
+  // Ownership, on demand, must agree with the view.
+  StringBuilder owned;
+  if ((StorageErr::NONE != store->persistentRead("cert5", &owned, 0)) || (5 != *(owned.string()))) {
+    printf("Copying read disagrees with the view.\n");
+    return -1;
+  }
+  return (((STORAGE_BLOB_COUNT - 1) * STORAGE_BLOB_COUNT) == (int) checksum) ? 0 : -1;
+}
+
+
+/*
+* A view must hold still while it is outstanding, even as the log outgrows its
+*   mapping. Compaction and wipes have to wait for it.
+*/
+int STORAGE_VIEW_HOLD() {
+  printf("===< STORAGE_VIEW_HOLD >=========================================\n");
+  const uint8_t* view = nullptr;
+  uint32_t len = 0;
+  if (StorageErr::NONE != store->persistentView("cert3", &view, &len)) {
+    printf("No view of cert3.\n");
+    return -1;
+  }
+  const uint32_t gen = store->mapGeneration();
+  uint8_t* blob = (uint8_t*) malloc(STORAGE_BLOB_LEN);
+  const int writes = (LINUX_STORAGE_MAP_BYTES / STORAGE_BLOB_LEN) + 1;
+  for (int i = 0; i < writes; i++) {
+    memset(blob, i, STORAGE_BLOB_LEN);
+    store->persistentWrite("grow", blob, STORAGE_BLOB_LEN, 0);
+  }
+  free(blob);
+
+  StringBuilder grown;
+  if ((StorageErr::NONE != store->persistentRead("grow", &grown, 0)) || ((uint8_t) (writes - 1) != *(grown.string()))) {
+    printf("A read past the held mapping failed.\n");
+    return -1;
+  }
+  if ((gen != store->mapGeneration()) || (3 != view[0]) || (3 != view[len - 1])) {
+    printf("The mapping moved out from under a view.\n");
+    return -1;
+  }
+  if ((StorageErr::BUSY != store->compact()) || (StorageErr::BUSY != store->wipe())) {
+    printf("Compaction or a wipe went ahead with a view outstanding.\n");
+    return -1;
+  }
+  store->releaseView();
+  if (StorageErr::NONE != store->compact()) {
+    printf("Compaction failed once the view was released.\n");
+    return -1;
+  }
+  return 0;
+}
+
+
+/*
+* A config store and telemetry checkpoints: a handful of keys, written often.
+*/
+int STORAGE_BENCHMARK() {
+  printf("===< STORAGE_BENCHMARK >=========================================\n");
+  uint8_t* legacy_buf = (uint8_t*) malloc(STORAGE_BENCH_KEYS * STORAGE_BENCH_VAL_LEN);
+  uint8_t  val[STORAGE_BENCH_VAL_LEN];
+  char     key[8];
+  store->wipe();
+
+  unsigned long start = micros();
+  for (int i = 0; i < STORAGE_BENCH_WRITES; i++) {
+    const int k = i % STORAGE_BENCH_KEYS;
+    memset(val, i, sizeof(val));
+    memcpy(legacy_buf + (k * STORAGE_BENCH_VAL_LEN), val, sizeof(val));
+    legacy_save(legacy_buf, STORAGE_BENCH_KEYS * STORAGE_BENCH_VAL_LEN);
+  }
+  unsigned long legacy_us = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < STORAGE_BENCH_WRITES; i++) {
+    snprintf(key, sizeof(key), "k%d", i % STORAGE_BENCH_KEYS);
+    memset(val, i, sizeof(val));
+    store->persistentWrite(key, val, sizeof(val), 0);
+  }
+  store->flush();
+  unsigned long log_us = micros() - start;
+
+  printf("\t %d writes of %d bytes over %d keys.\n", STORAGE_BENCH_WRITES, STORAGE_BENCH_VAL_LEN, STORAGE_BENCH_KEYS);
+  printf("\t Whole-file rewrite:  %8lu us  (%.0f writes/s)\n", legacy_us, (STORAGE_BENCH_WRITES * 1000000.0) / legacy_us);
+  printf("\t Log-structured:      %8lu us  (%.0f writes/s)\n", log_us,    (STORAGE_BENCH_WRITES * 1000000.0) / log_us);
+
+  free(legacy_buf);
+  unlink(STORAGE_LEGACY_PATH);
+  return (STORAGE_BENCH_KEYS == store->keyCount()) ? 0 : -1;
+}
+
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  if (0 == STORAGE_ROUNDTRIP()) {
+    if (0 == STORAGE_RECOVERY()) {
+      if (0 == STORAGE_COMPACTION()) {
+        if (0 == STORAGE_MAPPED_READS()) {
+          if (0 == STORAGE_VIEW_HOLD()) {
+            if (0 == STORAGE_BENCHMARK()) {
+              printf("**********************************\n");
+              printf("*  Storage tests all pass        *\n");
+              printf("**********************************\n");
+              exit_value = 0;
+            }
+            else printTestFailure("STORAGE_BENCHMARK");
+          }
+          else printTestFailure("STORAGE_VIEW_HOLD");
+        }
+        else printTestFailure("STORAGE_MAPPED_READS");
+      }
+      else printTestFailure("STORAGE_COMPACTION");
+    }
+    else printTestFailure("STORAGE_RECOVERY");
+  }
+  else printTestFailure("STORAGE_ROUNDTRIP");
+
+  if (nullptr != store) unmount_store(store);
+  unlink(STORAGE_TEST_PATH);
+  exit(exit_value);
+}
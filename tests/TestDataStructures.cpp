@@ -61,6 +61,7 @@ This program runs tests on raw data-handling classes.
 
 
 #define STRBUILDER_STATICTEST_STRING "I CAN cOUNT to PoTaTo   "
+#define ARG_INDEX_BENCH_LOOKUPS      200000  // Keyed lookups per chain length.
 
 int test_StringBuilderStatics(StringBuilder* log) {
   int return_value = -1;
@@ -814,6 +815,150 @@ int test_Arguments_PODs() {
 }
 
 
+/*
+* The keyed lookup that the index replaced, reproduced for comparison.
+*/
+Argument* legacy_retrieveArgByKey(Argument* a, const char* k) {
+  for (; nullptr != a; a = a->retrieveArgByIdx(1)) {
+    if ((nullptr != a->getKey()) && (0 == strcmp(a->getKey(), k))) return a;
+  }
+  return nullptr;
+}
+
+/*
+* Builds a chain of n keyed Arguments, whose values are their positions. Keys
+*   are written into the given buffer, 16 bytes apiece.
+*/
+Argument* build_keyed_chain(int n, char* keys) {
+  Argument* chain = nullptr;
+  for (int i = 0; i < n; i++) {
+    char* k = keys + (i * 16);
+    snprintf(k, 16, "key_%d", i);
+    Argument* a = new Argument((uint32_t) i);
+    a->setKey(k);
+    if (nullptr == chain) chain = a;
+    else chain->link(a);
+  }
+  return chain;
+}
+
+
+/**
+* Tests the lazy index that keyed and positional lookups use on long chains.
+* @return 0 on pass. Non-zero otherwise.
+*/
+int test_Arguments_Index() {
+  int return_value = -1;
+  StringBuilder log("===< Arguments Index >==================================\n");
+  const int n = 64;
+  char* keys = (char*) malloc(n * 16);
+  Argument* chain = build_keyed_chain(n, keys);
+  chain->retrieveArgByIdx(5)->setKey("key_50");   // A duplicate, ahead of the real one.
+
+  uint32_t val = 0;
+  char probe[16];
+  bool lookups_agree = true;
+  for (int i = 0; i < n; i++) {
+    // Copies of the keys, so that pointer comparison can't help.
+    snprintf(probe, sizeof(probe), "key_%d", i);
+    if (legacy_retrieveArgByKey(chain, probe) != chain->retrieveArgByKey(probe)) {
+      log.concatf("Keyed lookup for %s disagrees with the walk.\n", probe);
+      lookups_agree = false;
+    }
+  }
+  Argument* walk = chain;
+  for (int i = 0; i < n; i++) {
+    if (walk != chain->retrieveArgByIdx(i)) {
+      log.concatf("Positional lookup for %d disagrees with the walk.\n", i);
+      lookups_agree = false;
+    }
+    walk = walk->retrieveArgByIdx(1);
+  }
+
+  if (lookups_agree) {
+    if ((0 == chain->getValueAs("key_50", &val)) && (5 == val)) {
+      if ((nullptr == chain->retrieveArgByKey("key_999")) && (nullptr == chain->retrieveArgByIdx(n))) {
+        if ((0 == chain->getValueAs((uint8_t) 40, &val)) && (40 == val)) {
+          // Linking through a member of the chain must not leave a stale index.
+          Argument* extra = new Argument((uint32_t) 1000);
+          extra->setKey("late_key");
+          chain->retrieveArgByIdx(n - 1)->link(extra);
+          if ((extra == chain->retrieveArgByKey("late_key")) && (extra == chain->retrieveArgByIdx(n))) {
+            // Nor may dropping one.
+            if (0 == chain->dropArg(&chain, extra)) {
+              if ((nullptr == chain->retrieveArgByKey("late_key")) && (nullptr == chain->retrieveArgByIdx(n))) {
+                return_value = 0;
+              }
+              else log.concat("Dropped Argument was still found.\n");
+              delete extra;
+            }
+            else log.concat("Failed to drop an Argument.\n");
+          }
+          else log.concat("Argument linked after the index was built was not found.\n");
+        }
+        else log.concatf("Positional lookup returned %u. Expected 40.\n", val);
+      }
+      else log.concat("Lookup past the end of the chain found something.\n");
+    }
+    else log.concatf("Duplicate key returned %u. Expected the first (5).\n", val);
+  }
+  delete chain;
+  free(keys);
+  printf("%s\n\n", (const char*) log.string());
+  return return_value;
+}
+
+
+/**
+* Benchmarks keyed lookup against the walk it replaced, for chains of 8, 64,
+*   and 512 Arguments.
+* @return 0 on pass. Non-zero otherwise.
+*/
+int test_Arguments_Index_Benchmark() {
+  const int lengths[3] = {8, 64, 512};
+  printf("===< Arguments Index Benchmark >========================\n");
+  for (int l = 0; l < 3; l++) {
+    const int n = lengths[l];
+    char* keys   = (char*) malloc(n * 16);
+    char* probes = (char*) malloc(n * 16);
+    Argument* chain = build_keyed_chain(n, keys);
+    for (int i = 0; i < n; i++) snprintf(probes + (i * 16), 16, "key_%d", i);
+    uint32_t* order = (uint32_t*) malloc(ARG_INDEX_BENCH_LOOKUPS * sizeof(uint32_t));
+    for (int i = 0; i < ARG_INDEX_BENCH_LOOKUPS; i++) order[i] = randomUInt32() % n;
+
+    uint32_t legacy_sum = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < ARG_INDEX_BENCH_LOOKUPS; i++) {
+      legacy_sum += (uintptr_t) legacy_retrieveArgByKey(chain, probes + (order[i] * 16))->pointer();
+    }
+    unsigned long legacy_us = micros() - start;
+
+    uint32_t index_sum = 0;
+    start = micros();
+    for (int i = 0; i < ARG_INDEX_BENCH_LOOKUPS; i++) {
+      index_sum += (uintptr_t) chain->retrieveArgByKey(probes + (order[i] * 16))->pointer();
+    }
+    unsigned long index_us = micros() - start;
+
+    printf("\t %3d Arguments:  walk %8lu us (%6.1f ns/lookup)   index %8lu us (%6.1f ns/lookup)\n",
+      n,
+      legacy_us, (legacy_us * 1000.0) / ARG_INDEX_BENCH_LOOKUPS,
+      index_us,  (index_us  * 1000.0) / ARG_INDEX_BENCH_LOOKUPS
+    );
+    delete chain;
+    free(order);
+    free(probes);
+    free(keys);
+    if (legacy_sum != index_sum) {
+      printf("Implementations disagree at %d Arguments (%u vs %u).\n", n, legacy_sum, index_sum);
+      return -1;
+    }
+  }
+  printf("\n");
+  return 0;
+}
+
+
 int test_Arguments() {
   int return_value = test_Arguments_KVP();
   if (0 == return_value) {
@@ -822,6 +967,12 @@ int test_Arguments() {
       return_value = test_Arguments_PODs();
       if (0 == return_value) {
         return_value = test_Argument_Value_Placement();
+        if (0 == return_value) {
+          return_value = test_Arguments_Index();
+          if (0 == return_value) {
+            return_value = test_Arguments_Index_Benchmark();
+          }
+        }
         if (0 == return_value) {
         #if defined(MANUVR_CBOR)
           return_value = test_CBOR_Argument();
@@ -0,0 +1,316 @@
+/*
+File:   UDPTest.cpp
+Author: agent
+Date:   2026.10.17
+
+Copyright 2016 Manuvr, Inc
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Tests ManuvrUDP's peer table and pipe pool over loopback, and measures datagram
+  throughput with and without batched sends.
+Peers are distinguished by address as well as port. Linux answers for all of
+  127.0.0.0/8 on the loopback interface, so we use several of those addresses.
+*/
+
+#include <cstdio>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include <StringBuilder.h>
+#include <Platform/Platform.h>
+
+#if defined(MANUVR_SUPPORT_UDP)
+#include <Transports/ManuvrSocket/ManuvrUDP.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define UDP_TEST_PORT           56840
+#define UDP_TEST_PEER_PORT      56841
+#define UDP_BENCH_DATAGRAMS     100000
+#define UDP_BENCH_WINDOW        128     // Keeps us under the receive buffer.
+
+
+/*
+* Opens a datagram socket bound to the given address and port, that will not
+*   wait more than a second for a reply.
+*/
+int open_peer(const char* addr, uint16_t port) {
+  int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (-1 == s) return -1;
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family      = AF_INET;
+  sa.sin_port        = htons(port);
+  sa.sin_addr.s_addr = inet_addr(addr);
+  struct timeval tv = { 1, 0 };
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (bind(s, (struct sockaddr*) &sa, sizeof(sa))) {
+    close(s);
+    return -1;
+  }
+  return s;
+}
+
+
+int send_to_udp(int s, const char* str) {
+  struct sockaddr_in sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family      = AF_INET;
+  sa.sin_port        = htons(UDP_TEST_PORT);
+  sa.sin_addr.s_addr = inet_addr("127.0.0.1");
+  return sendto(s, str, strlen(str), 0, (struct sockaddr*) &sa, sizeof(sa));
+}
+
+
+/*
+* Spins until the transport has read the given number of datagrams, or a second
+*   has passed. The count is taken after dispatch, so once it is reached (and
+*   nothing else is in flight) the pipes are safe to inspect.
+*/
+bool await_rx(ManuvrUDP* udp, uint32_t count) {
+  unsigned long deadline = millis() + 1000;
+  while (udp->rxDatagrams() < count) {
+    if (millis() > deadline) return false;
+    sched_yield();
+  }
+  return true;
+}
+
+
+/*
+* Does the pipe hold exactly what we expect?
+*/
+bool pipe_holds(UDPPipe* pipe, const char* str) {
+  StringBuilder taken;
+  if (nullptr == pipe) return false;
+  pipe->takeAccumulator(&taken);
+  return ((taken.length() == (int) strlen(str)) && (0 == memcmp(taken.string(), str, strlen(str))));
+}
+
+
+bool reply_is(int s, const char* str) {
+  char buf[64];
+  int n = recv(s, buf, sizeof(buf), 0);
+  return ((n == (int) strlen(str)) && (0 == memcmp(buf, str, n)));
+}
+
+
+/*
+* Two peers that share a port (but not an address) must get their own pipes,
+*   and replies must find their way back to the right one.
+*/
+int UDP_PEER_TABLE(ManuvrUDP* udp) {
+  printf("===< UDP_PEER_TABLE >============================================\n");
+  int return_value = -1;
+  int a = open_peer("127.0.0.2", UDP_TEST_PEER_PORT);
+  int b = open_peer("127.0.0.3", UDP_TEST_PEER_PORT);
+  int c = open_peer("127.0.0.2", UDP_TEST_PEER_PORT + 1);
+  const uint32_t ip_a = inet_addr("127.0.0.2");
+  const uint32_t ip_b = inet_addr("127.0.0.3");
+
+  if ((0 < a) && (0 < b) && (0 < c)) {
+    const uint32_t rx_base = udp->rxDatagrams();
+    send_to_udp(a, "from a");
+    send_to_udp(b, "from b");
+    send_to_udp(c, "from c");
+    if (await_rx(udp, rx_base + 3)) {
+      UDPPipe* pipe_a = udp->peer(ip_a, UDP_TEST_PEER_PORT);
+      UDPPipe* pipe_b = udp->peer(ip_b, UDP_TEST_PEER_PORT);
+      UDPPipe* pipe_c = udp->peer(ip_a, UDP_TEST_PEER_PORT + 1);
+      if ((3 == udp->peerCount()) && pipe_a && pipe_b && pipe_c && (pipe_a != pipe_b)) {
+        if (pipe_holds(pipe_a, "from a") && pipe_holds(pipe_b, "from b") && pipe_holds(pipe_c, "from c")) {
+          // A second datagram from a known peer lands in its existing pipe.
+          send_to_udp(a, "again a");
+          if (await_rx(udp, rx_base + 4) && (3 == udp->peerCount()) && pipe_holds(pipe_a, "again a")) {
+            StringBuilder reply_a("to a");
+            StringBuilder reply_b("to b");
+            pipe_b->toCounterparty(&reply_b, MEM_MGMT_RESPONSIBLE_CREATOR);
+            pipe_a->toCounterparty(&reply_a, MEM_MGMT_RESPONSIBLE_CREATOR);
+            if (reply_is(a, "to a") && reply_is(b, "to b")) {
+              printf("\tThree peers, three pipes. Replies were routed correctly.\n");
+              return_value = 0;
+            }
+            else printf("\tReplies were misrouted.\n");
+          }
+          else printf("\tA known peer was not found again.\n");
+        }
+        else printf("\tA pipe holds the wrong datagram.\n");
+      }
+      else printf("\tExpected 3 distinct peers. Have %u.\n", udp->peerCount());
+    }
+    else printf("\tDatagrams were never read.\n");
+  }
+  else printf("\tFailed to open the peer sockets.\n");
+
+  if (0 < a) close(a);
+  if (0 < b) close(b);
+  if (0 < c) close(c);
+  return return_value;
+}
+
+
+/*
+* Silent peers should be swept out, unless their pipe is marked persistent. The
+*   next new peer should be given a reclaimed pipe.
+*/
+int UDP_EXPIRY(ManuvrUDP* udp) {
+  printf("===< UDP_EXPIRY >================================================\n");
+  int return_value = -1;
+  const uint32_t ip_a = inet_addr("127.0.0.2");
+  const uint32_t ip_b = inet_addr("127.0.0.3");
+  UDPPipe* pipe_a = udp->peer(ip_a, UDP_TEST_PEER_PORT);
+  UDPPipe* pipe_b = udp->peer(ip_b, UDP_TEST_PEER_PORT);
+  UDPPipe* pipe_c = udp->peer(ip_a, UDP_TEST_PEER_PORT + 1);
+  if (pipe_a && pipe_b && pipe_c) {
+    const uint32_t long_ago = millis() - (MANUVR_UDP_PEER_TIMEOUT + 1);
+    const uint32_t peers    = udp->peerCount();
+    pipe_a->lastSeen(long_ago);
+    pipe_c->lastSeen(long_ago);
+    pipe_c->persistAfterReply(true);
+
+    ManuvrMsg sweep(MANUVR_MSG_XPORT_QUEUE_RDY);
+    udp->notify(&sweep);
+    if ((peers - 1 == udp->peerCount()) && (nullptr == udp->peer(ip_a, UDP_TEST_PEER_PORT))) {
+      if ((pipe_b == udp->peer(ip_b, UDP_TEST_PEER_PORT)) && (pipe_c == udp->peer(ip_a, UDP_TEST_PEER_PORT + 1))) {
+        int d = open_peer("127.0.0.4", UDP_TEST_PEER_PORT);
+        if (0 < d) {
+          const uint32_t rx_base = udp->rxDatagrams();
+          send_to_udp(d, "from d");
+          if (await_rx(udp, rx_base + 1)) {
+            UDPPipe* pipe_d = udp->peer(inet_addr("127.0.0.4"), UDP_TEST_PEER_PORT);
+            if ((pipe_a == pipe_d) && pipe_holds(pipe_d, "from d")) {
+              printf("\tThe silent peer was reclaimed, and its pipe reused.\n");
+              return_value = 0;
+            }
+            else printf("\tThe new peer did not get the reclaimed pipe.\n");
+          }
+          else printf("\tDatagram was never read.\n");
+          close(d);
+        }
+        else printf("\tFailed to open a peer socket.\n");
+      }
+      else printf("\tSweep took the wrong pipes.\n");
+    }
+    else printf("\tThe silent peer is still present.\n");
+  }
+  else printf("\tPrior test left no peers to expire.\n");
+  return return_value;
+}
+
+
+/*
+* Sends datagrams to ourselves, a window at a time, and waits for the reactor to
+*   read each window. Returns the elapsed microseconds, or 0 on failure.
+*/
+unsigned long udp_blast(ManuvrUDP* udp, uint32_t opts) {
+  uint8_t payload[64];
+  memset(payload, 0xA5, sizeof(payload));
+  const uint32_t self = inet_addr("127.0.0.1");
+  uint32_t target = udp->rxDatagrams();
+  unsigned long start = micros();
+  for (int i = 0; i < UDP_BENCH_DATAGRAMS; i += UDP_BENCH_WINDOW) {
+    for (int j = 0; j < UDP_BENCH_WINDOW; j++) {
+      if (!udp->write_datagram(payload, sizeof(payload), self, UDP_TEST_PORT, opts)) return 0;
+    }
+    udp->flushDatagrams();
+    target += UDP_BENCH_WINDOW;
+    if (!await_rx(udp, target)) return 0;
+    // Nobody is bound to our own pipe. Don't let it pile up.
+    StringBuilder sink;
+    UDPPipe* self_pipe = udp->peer(self, UDP_TEST_PORT);
+    if (self_pipe) self_pipe->takeAccumulator(&sink);
+  }
+  return (micros() - start);
+}
+
+
+int UDP_LOOPBACK_BENCH(ManuvrUDP* udp) {
+  printf("===< UDP_LOOPBACK_BENCH >========================================\n");
+  int return_value = -1;
+  uint32_t tx_calls = udp->txSyscalls();
+  uint32_t rx_calls = udp->rxSyscalls();
+  unsigned long single_us = udp_blast(udp, 0);
+  uint32_t single_tx = udp->txSyscalls() - tx_calls;
+  uint32_t single_rx = udp->rxSyscalls() - rx_calls;
+
+  tx_calls = udp->txSyscalls();
+  rx_calls = udp->rxSyscalls();
+  unsigned long batch_us = udp_blast(udp, MANUVR_UDP_WRITE_HOLD);
+  uint32_t batch_tx = udp->txSyscalls() - tx_calls;
+  uint32_t batch_rx = udp->rxSyscalls() - rx_calls;
+
+  if ((0 < single_us) && (0 < batch_us)) {
+    printf("\t%d datagrams each way.\n", UDP_BENCH_DATAGRAMS);
+    printf("\tOne per send:   %8lu pkts/s  (%u send calls, %u recv calls)\n",
+      (unsigned long) ((UDP_BENCH_DATAGRAMS * 1000000.0) / single_us), single_tx, single_rx);
+    printf("\tBatched sends:  %8lu pkts/s  (%u send calls, %u recv calls)\n",
+      (unsigned long) ((UDP_BENCH_DATAGRAMS * 1000000.0) / batch_us), batch_tx, batch_rx);
+    if (batch_tx < single_tx) {
+      return_value = 0;
+    }
+    else printf("\tHeld datagrams were not batched.\n");
+  }
+  else printf("\tDatagrams were lost.\n");
+  return return_value;
+}
+
+#endif  // MANUVR_SUPPORT_UDP
+
+
+void printTestFailure(const char* test) {
+  printf("\n");
+  printf("*********************************************\n");
+  printf("* %s FAILED tests.\n", test);
+  printf("*********************************************\n");
+}
+
+
+/****************************************************************************************************
+* The main function.                                                                                *
+****************************************************************************************************/
+int main(int argc, char *argv[]) {
+  int exit_value = 1;   // Failure is the default result.
+
+  platform.platformPreInit();
+  platform.bootstrap();
+
+  #if defined(MANUVR_SUPPORT_UDP)
+    ManuvrUDP udp("127.0.0.1", UDP_TEST_PORT);
+    if (0 == udp.listen()) {
+      if (0 == UDP_PEER_TABLE(&udp)) {
+        if (0 == UDP_EXPIRY(&udp)) {
+          if (0 == UDP_LOOPBACK_BENCH(&udp)) {
+            printf("**********************************\n");
+            printf("*  UDP tests all pass            *\n");
+            printf("**********************************\n");
+            exit_value = 0;
+          }
+          else printTestFailure("UDP_LOOPBACK_BENCH");
+        }
+        else printTestFailure("UDP_EXPIRY");
+      }
+      else printTestFailure("UDP_PEER_TABLE");
+    }
+    else printTestFailure("ManuvrUDP::listen()");
+  #else
+    printf("UDP support was not built. Nothing to test.\n");
+    exit_value = 0;
+  #endif
+
+  exit(exit_value);
+}